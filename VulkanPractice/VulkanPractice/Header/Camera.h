@@ -0,0 +1,57 @@
+//
+//  Camera.h
+//  VulkanPractice
+//
+
+/**
+ A first person camera and the matrices the shaders get from it.
+ 1. Matrices are for Vulkan clip space: y points down and depth goes from 0 to 1
+ 2. The projection is reversed Z with an infinite far plane, depth is near / distance. It is 1 at the near plane
+    and goes towards 0 far away, where floats are densest, so depth precision stays nearly even over the whole range
+    instead of being spent right in front of the camera. The depth buffer is cleared to 0 and tested with GREATER_OR_EQUAL
+ 3. glm's perspective functions need a far plane, so the matrix is written directly. It is the limit of
+    glm::perspectiveRH_ZO with near and far swapped, as far goes to infinity
+ 4. The camera is a position plus yaw and pitch. Input moves it, so when the input is sampled decides how old the view is
+ */
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+// std140 layout of the camera uniform block in the shaders
+struct CameraUniforms {
+    glm::mat4 viewProjection{1.0f};
+    glm::mat4 view{1.0f};
+    glm::mat4 projection{1.0f};
+    glm::vec4 position{0.0f, 0.0f, 0.0f, 1.0f};
+};
+
+class Camera {
+public:
+    static glm::mat4 reversedInfinitePerspective(float fovY, float aspect, float nearPlane);
+
+    // fovY in radians
+    void setPerspective(float fovY, float nearPlane);
+    void setPosition(const glm::vec3& position) { cameraPosition = position; }
+    // Yaw 0 looks along -z, pitch is clamped short of straight up and down
+    void setRotation(float yaw, float pitch);
+
+    void rotate(float yawDelta, float pitchDelta);
+    // Along the right, up and forward axes of the camera
+    void moveLocal(const glm::vec3& delta);
+
+    const glm::vec3& position() const { return cameraPosition; }
+    glm::vec3 forward() const;
+    glm::vec3 right() const;
+
+    glm::mat4 view() const;
+    glm::mat4 projection(float aspect) const;
+    CameraUniforms uniforms(float aspect) const;
+
+private:
+    glm::vec3 cameraPosition{0.0f};
+    float cameraYaw = 0.0f;
+    float cameraPitch = 0.0f;
+    float fieldOfView = glm::radians(60.0f);
+    float nearDistance = 0.05f;
+};
@@ -0,0 +1,61 @@
+//
+//  CameraUniformBuffer.h
+//  VulkanPractice
+//
+
+/**
+ Camera uniforms for every frame in flight, in one persistently mapped host coherent buffer.
+ 1. Every frame slot has its own region and descriptor set. A slot is only written after the fence of its previous frame
+    signaled, so the GPU never reads a region while it is written
+ 2. The command buffer only references the descriptor set, not the contents. write() is a plain copy into mapped memory
+    and host writes made before vkQueueSubmit are visible to the submitted work without a flush, the memory is coherent.
+    So the camera can still be written after recording, right before the submit: late latching
+ 3. Set 0, binding 0, read by the vertex stage
+ */
+
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "Camera.h"
+#include "VulkanDispatch.h"
+
+class CameraUniformBuffer {
+public:
+    CameraUniformBuffer() = default;
+    CameraUniformBuffer(const CameraUniformBuffer& obj) = delete;
+
+    CameraUniformBuffer& operator=(const CameraUniformBuffer& obj) = delete;
+
+    ~CameraUniformBuffer() = default;
+
+    void init(VkPhysicalDevice physicalDevice, const InstanceDispatch& instanceTable, VkDevice device, const DeviceDispatch* deviceTable,
+              const VkAllocationCallbacks* allocator, uint32_t frameSlots);
+    // The device must be idle
+    void destroy();
+
+    VkDescriptorSetLayout setLayout() const { return descriptorSetLayout; }
+
+    void write(uint32_t frameSlot, const CameraUniforms& uniforms);
+    void bind(VkCommandBuffer commandBuffer, VkPipelineLayout layout, uint32_t frameSlot) const;
+
+private:
+
+    VkDevice device = VK_NULL_HANDLE;
+    const DeviceDispatch* deviceTable = nullptr;
+    const VkAllocationCallbacks* allocator = nullptr;
+    VkPhysicalDeviceMemoryProperties memoryProperties{};
+
+    VkBuffer buffer = VK_NULL_HANDLE;
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    uint8_t* mapped = nullptr;
+    // Size of a region, rounded up to minUniformBufferOffsetAlignment
+    VkDeviceSize slotStride = 0;
+
+    VkDescriptorSetLayout descriptorSetLayout = VK_NULL_HANDLE;
+    VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+    std::vector<VkDescriptorSet> descriptorSets;
+};
@@ -0,0 +1,128 @@
+//
+//  DynamicResolution.h
+//  VulkanPractice
+//
+
+/**
+ Renders into an offscreen target whose resolution follows the GPU frame time, and upscales it to the swap chain image.
+ 1. The color target is allocated once per swap chain size, at maxScale. A lower scale only shrinks the render area
+    and the viewport, so changing the resolution never allocates anything or touches the swap chain
+ 2. The render pass leaves the target in TRANSFER_SRC_OPTIMAL and recordUpscale() blits the rendered area onto the whole
+    swap chain image, filtered linearly where the format allows it. The target may have a format of its own, e.g. a float
+    format for post processing, the blit converts it to the swap chain format
+ 3. update() is fed the GPU time of a finished frame together with the pixels that frame rendered. Those samples are
+    MAX_FRAMES_IN_FLIGHT frames old, so the controller works with time per pixel rather than the raw time: that stays
+    right however much the scale changed since. GPU time grows with the pixel count, i.e. with scale squared
+ 4. The scale aims at a little below the target frame time. It drops quickly when over budget and recovers slowly,
+    which keeps it from oscillating around the target
+ 5. Every stretch that starts with a frame over budget ends once a few frames in a row are within it again.
+    How long those took is the time to target, printReport() gives them together with the scales used
+ */
+
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+#include "VulkanDispatch.h"
+
+struct DynamicResolutionSettings {
+    // Bounds of the render scale, per axis. Above 1 supersamples
+    float minScale = 0.5f;
+    float maxScale = 1.0f;
+    // GPU time per frame the scale is adjusted for
+    double targetFrameMs = 1000.0 / 60.0;
+    // Usage of the target on top of color attachment and blit source
+    VkImageUsageFlags extraUsage = 0;
+    // Queue families using the target, it is shared concurrently when there is more than one
+    std::vector<uint32_t> queueFamilies;
+};
+
+class DynamicResolution {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    DynamicResolution() = default;
+    DynamicResolution(const DynamicResolution& obj) = delete;
+
+    DynamicResolution& operator=(const DynamicResolution& obj) = delete;
+
+    ~DynamicResolution() = default;
+
+    // Whether the target can be blitted from in colorFormat and the swap chain blitted to in outputFormat
+    static bool isSupported(VkPhysicalDevice physicalDevice, const InstanceDispatch& instanceTable, VkFormat colorFormat, VkFormat outputFormat);
+
+    // Throws when isSupported() doesn't hold
+    void init(VkPhysicalDevice physicalDevice, const InstanceDispatch& instanceTable, VkDevice device, const DeviceDispatch* deviceTable,
+              const VkAllocationCallbacks* allocator, VkFormat colorFormat, VkFormat outputFormat, const DynamicResolutionSettings& settings);
+    // The device must be idle
+    void destroy();
+
+    // Size of the offscreen target for a swap chain of outputExtent, the depth buffer has to match it
+    VkExtent2D targetExtent(VkExtent2D outputExtent) const;
+    // Recreates the target and its framebuffer for a new swap chain size. The device must be idle
+    void resize(VkRenderPass renderPass, VkExtent2D outputExtent, VkImageView depthView);
+
+    void setTargetFrameMs(double targetFrameMs) { settings.targetFrameMs = targetFrameMs; }
+    // Keeps the scale at a fixed value until unlocked
+    void lockScale(float scale);
+    void unlockScale() { scaleLocked = false; }
+
+    // GPU time of a finished frame and the pixels it rendered
+    void update(double gpuMs, uint64_t renderedPixels);
+
+    float scale() const { return currentScale; }
+    VkFramebuffer framebuffer() const { return targetFramebuffer; }
+    VkImage image() const { return colorImage; }
+    VkImageView imageView() const { return colorImageView; }
+    // Area of the target the current scale renders to
+    VkExtent2D renderExtent() const;
+
+    // After the render pass, or whatever moved the target to TRANSFER_SRC_OPTIMAL since:
+    // scales the rendered area onto the swap chain image and leaves it ready to present
+    void recordUpscale(VkCommandBuffer commandBuffer, VkImage swapChainImage) const;
+
+    // Drops the statistics so far
+    void resetStats();
+    // Median and max time to target of the stretches so far, in milliseconds
+    double medianTimeToTargetMs() const;
+    double maxTimeToTargetMs() const;
+    void printReport(std::ostream& os) const;
+
+private:
+    void destroyTarget();
+
+    VkDevice device = VK_NULL_HANDLE;
+    const DeviceDispatch* deviceTable = nullptr;
+    const VkAllocationCallbacks* allocator = nullptr;
+    VkPhysicalDeviceMemoryProperties memoryProperties{};
+
+    VkFormat colorFormat = VK_FORMAT_UNDEFINED;
+    VkFilter upscaleFilter = VK_FILTER_LINEAR;
+    DynamicResolutionSettings settings;
+
+    VkExtent2D outputExtent{};
+    VkImage colorImage = VK_NULL_HANDLE;
+    VkDeviceMemory colorImageMemory = VK_NULL_HANDLE;
+    VkImageView colorImageView = VK_NULL_HANDLE;
+    VkFramebuffer targetFramebuffer = VK_NULL_HANDLE;
+
+    float currentScale = 1.0f;
+    bool scaleLocked = false;
+
+    // Over budget stretch in progress, and how many frames in a row have been within the budget since
+    bool overBudget = false;
+    Clock::time_point overBudgetSince;
+    uint32_t framesWithinBudget = 0;
+    std::vector<double> timesToTargetMs;
+
+    uint64_t frames = 0;
+    uint64_t framesOverBudget = 0;
+    double scaleSum = 0.0;
+    float minScaleUsed = 0.0f;
+    float maxScaleUsed = 0.0f;
+};
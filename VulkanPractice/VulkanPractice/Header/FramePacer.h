@@ -0,0 +1,88 @@
+//
+//  FramePacer.h
+//  VulkanPractice
+//
+
+/**
+ Decides when the main loop renders the next frame.
+ 1. Unlimited: poll events and render as fast as presentation allows
+ 2. Limited: render at most targetFrameRate frames per second. The wait sleeps until shortly before the deadline
+    and spins the rest, since OS sleeps overshoot by up to a scheduler tick
+ 3. OnDemand: block in glfwWaitEvents and only render after input, a resize/expose or requestRedraw()
+ Independent of the mode, an unfocused window is throttled to backgroundFrameRate and an iconified window
+ doesn't render at all until it is restored.
+ Wall time, process CPU time and frames are accumulated per state so CPU usage per mode can be reported.
+ */
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+
+struct GLFWwindow;
+
+enum class FramePacingMode {
+    Unlimited,
+    Limited,
+    OnDemand
+};
+
+class FramePacer {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    void configure(FramePacingMode mode, double targetFrameRate, double backgroundFrameRate);
+
+    // Pumps window events and waits as the current state requires.
+    // Returns true when a frame should be rendered now
+    bool beginFrame(GLFWwindow* window);
+
+    // Window state, forwarded from the GLFW callbacks
+    void setFocused(bool focused);
+    void setIconified(bool iconified);
+    void requestRedraw() { redrawRequested = true; }
+
+    void printReport(std::ostream& os);
+
+private:
+    enum class State {
+        Unlimited,
+        Limited,
+        OnDemand,
+        Background,
+        Iconified,
+        Count
+    };
+
+    struct StateUsage {
+        double wallSeconds = 0.0;
+        double cpuSeconds = 0.0;
+        uint64_t frames = 0;
+    };
+
+    State currentState() const;
+    void sample(bool renderedFrame);
+    void waitUntil(Clock::time_point deadline);
+    static double processCpuSeconds();
+    static const char* stateName(State state);
+
+    FramePacingMode mode = FramePacingMode::Unlimited;
+    double targetFrameRate = 60.0;
+    double backgroundFrameRate = 10.0;
+
+    bool focused = true;
+    bool iconified = false;
+    bool redrawRequested = true;
+
+    Clock::time_point nextFrameDeadline = Clock::now();
+    // Running estimate of how late sleep_for wakes up, decides where sleeping stops and spinning starts
+    double sleepOvershootSeconds = 0.001;
+
+    bool sampling = false;
+    State sampledState = State::Unlimited;
+    Clock::time_point lastSampleTime;
+    double lastSampleCpuSeconds = 0.0;
+    std::array<StateUsage, static_cast<size_t>(State::Count)> usage;
+};
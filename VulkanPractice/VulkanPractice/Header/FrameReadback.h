@@ -0,0 +1,130 @@
+//
+//  FrameReadback.h
+//  VulkanPractice
+//
+
+/**
+ Copies presented images back to the CPU without stalling the frame.
+ 1. A ring of host visible buffers stays mapped for its whole lifetime. recordCopy() records the copy of the swap chain image
+    into a free buffer at the end of the frame's command buffer
+ 2. drawFrame() already waits for the fence of a frame slot before reusing it, MAX_FRAMES_IN_FLIGHT frames later.
+    collect() is called right after that wait, so the copies of that slot are known to be done without any extra wait
+ 3. Finished buffers are handed to a consumer thread, which gets a pointer straight into the mapped memory.
+    The buffer returns to the ring once the consumer is done with it
+ 4. When every buffer is still in use the frame is skipped instead of waiting, and counted as such.
+    Callers that would rather hold the frame back than drop it wait with waitForFreeBuffer() first
+ */
+
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "VulkanDispatch.h"
+
+struct ReadbackImage {
+    const uint8_t* pixels;
+    uint32_t width;
+    uint32_t height;
+    size_t rowPitch;
+    VkFormat format;
+    uint64_t frameNumber;
+};
+
+struct ReadbackStats {
+    uint64_t copied = 0;
+    uint64_t skipped = 0;
+    uint64_t consumed = 0;
+};
+
+class FrameReadback {
+public:
+    // Runs on the consumer thread, the pixels are only valid during the call
+    using Consumer = std::function<void(const ReadbackImage& image)>;
+
+    FrameReadback() = default;
+    FrameReadback(const FrameReadback& obj) = delete;
+
+    FrameReadback& operator=(const FrameReadback& obj) = delete;
+
+    ~FrameReadback() = default;
+
+    // Only 8 bit RGBA and BGRA swap chain formats can be read back
+    static bool supportsFormat(VkFormat format);
+
+    void init(VkPhysicalDevice physicalDevice, const InstanceDispatch& instanceTable, VkDevice device, const DeviceDispatch* deviceTable,
+              const VkAllocationCallbacks* allocator, uint32_t bufferCount, Consumer consumer);
+    // The device must be idle
+    void destroy();
+
+    bool isInitialized() const { return consumerThread.joinable(); }
+
+    // (Re)creates the buffers for a new swap chain. The device must be idle, pending copies are consumed first
+    void resize(VkExtent2D extent, VkFormat format);
+
+    // Records the copy of a presented image, which must be in VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, and leaves it in that layout.
+    // Returns false without recording anything when no buffer is free
+    bool recordCopy(VkCommandBuffer commandBuffer, VkImage image, uint32_t frameSlot, uint64_t frameNumber);
+
+    // Call once the fence of frameSlot has signaled
+    void collect(uint32_t frameSlot);
+    // Blocks until every collected copy went through the consumer
+    void waitForConsumer();
+    // Blocks until recordCopy() would find a free buffer. Returns false right away when only copies that aren't
+    // collected yet hold the buffers, since waiting for those would never end
+    bool waitForFreeBuffer();
+
+    ReadbackStats stats() const;
+
+private:
+    enum class BufferState {
+        Free,
+        Copying,
+        Consuming
+    };
+
+    struct ReadbackBuffer {
+        VkBuffer buffer = VK_NULL_HANDLE;
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        uint8_t* mapped = nullptr;
+        BufferState state = BufferState::Free;
+        uint32_t frameSlot = 0;
+        uint64_t frameNumber = 0;
+    };
+
+    // Hands every copying buffer to the consumer, only valid once the device is idle
+    void collectAll();
+    template <typename Predicate>
+    void collectWhere(Predicate predicate);
+
+    void createBuffers();
+    void destroyBuffers();
+    void consumeLoop();
+
+    VkDevice device = VK_NULL_HANDLE;
+    const DeviceDispatch* deviceTable = nullptr;
+    const VkAllocationCallbacks* allocator = nullptr;
+    VkPhysicalDeviceMemoryProperties memoryProperties{};
+    bool coherent = true;
+
+    VkExtent2D extent{};
+    VkFormat format = VK_FORMAT_UNDEFINED;
+    std::vector<ReadbackBuffer> buffers;
+    Consumer consumer;
+
+    mutable std::mutex lock;
+    std::condition_variable consumeSignal;
+    std::condition_variable consumeDone;
+    std::deque<size_t> consumeQueue;
+    bool consuming = false;
+    bool stopConsuming = false;
+    std::thread consumerThread;
+    ReadbackStats counters;
+};
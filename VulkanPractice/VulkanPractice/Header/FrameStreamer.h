@@ -0,0 +1,66 @@
+//
+//  FrameStreamer.h
+//  VulkanPractice
+//
+
+/**
+ Streams raw frames to a file descriptor, e.g. into ffmpeg reading rawvideo on stdin.
+ 1. "-" streams to stdout. The original stdout is kept for the stream and stdout is pointed at stderr,
+    so reports printed with std::cout don't end up between the frames
+ 2. Any other path is opened for writing, which also covers named pipes
+ 3. write() runs on the FrameReadback consumer thread and writes straight from the mapped readback buffer,
+    there is no copy in between. A slow reader blocks the write, which keeps the buffer busy,
+    which in turn holds back or drops frames in the render loop instead of queueing them up
+ 4. Once writing fails, e.g. because the reader went away, the stream stops and failed() reports it
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+#include "FrameReadback.h"
+
+class FrameStreamer {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    FrameStreamer() = default;
+    FrameStreamer(const FrameStreamer& obj) = delete;
+
+    FrameStreamer& operator=(const FrameStreamer& obj) = delete;
+
+    ~FrameStreamer();
+
+    void open(const std::string& path);
+    void close();
+
+    // Called on the consumer thread for every frame read back
+    void write(const ReadbackImage& image);
+
+    bool failed() const { return writeFailed; }
+
+    // Prints the ffmpeg input options that match the streamed frames
+    void printFormat(std::ostream& os, VkExtent2D extent, VkFormat format, double frameRate) const;
+    void printReport(std::ostream& os, const ReadbackStats& readbackStats) const;
+
+private:
+    bool writeAll(const uint8_t* data, size_t size);
+
+    int fd = -1;
+    std::string path;
+
+    std::atomic<bool> writeFailed{false};
+    uint32_t width = 0;
+    uint32_t height = 0;
+
+    // Only touched by the consumer thread until it is stopped
+    uint64_t framesWritten = 0;
+    uint64_t bytesWritten = 0;
+    double writeSeconds = 0.0;
+    Clock::time_point firstWrite;
+    Clock::time_point lastWrite;
+};
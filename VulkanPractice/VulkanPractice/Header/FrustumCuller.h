@@ -0,0 +1,97 @@
+//
+//  FrustumCuller.h
+//  VulkanPractice
+//
+
+/**
+ Decides on the CPU which objects are inside the view frustum, fast enough for a million objects per frame.
+ 1. The bounding volumes are stored as structure of arrays: a bounding sphere and an AABB per object, one array per component.
+    Four consecutive objects are then a single SIMD load per component
+ 2. The six planes are extracted from the view projection matrix (Gribb, Hartmann 2001). Depth goes from 0 to w like in Vulkan,
+    so the near plane is the third row alone. A degenerate plane, the far plane of an infinite projection, always passes
+ 3. Four objects are tested per step with SSE2 or NEON, a scalar loop takes the rest and machines without either.
+    Every sphere is tested first, the AABBs only for groups with a sphere left. The AABB test uses the corner furthest along
+    the plane normal, and since all four lanes share the plane, picking that corner is choosing the min or max arrays once per plane
+ 4. cull() splits the objects into one contiguous range per thread of a WorkerPool, the calling thread takes the first range.
+    Every thread writes into its own visible list, nothing is shared while culling
+ 5. The visible lists hold object indices, increasing within a list and from one list to the next
+ */
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+#include "WorkerPool.h"
+
+// Normals point inside, a point is inside when dot(normal, point) + w >= 0 for all planes
+struct FrustumPlanes {
+    glm::vec4 planes[6];
+
+    static FrustumPlanes fromViewProjection(const glm::mat4& viewProjection);
+};
+
+// Cache line aligned, so threads writing their counts don't share a line
+struct alignas(64) VisibleList {
+    // Sized for the range of the thread, only the first count entries are valid
+    std::vector<uint32_t> indices;
+    size_t count = 0;
+};
+
+struct CullStats {
+    uint64_t objects = 0;
+    uint64_t visible = 0;
+    double ms = 0.0;
+};
+
+class FrustumCuller {
+public:
+    FrustumCuller() = default;
+    FrustumCuller(const FrustumCuller& obj) = delete;
+
+    FrustumCuller& operator=(const FrustumCuller& obj) = delete;
+
+    ~FrustumCuller();
+
+    // threadCount counts the calling thread, 0 uses every hardware thread
+    void init(uint32_t threadCount = 0);
+    void destroy();
+
+    // Returns the index of the object. The AABB must lie inside the sphere for the result to be exact
+    uint32_t addObject(const glm::vec3& center, float radius, const glm::vec3& aabbMin, const glm::vec3& aabbMax);
+    void setObject(uint32_t object, const glm::vec3& center, float radius, const glm::vec3& aabbMin, const glm::vec3& aabbMax);
+    void reserve(size_t objectCount);
+    void clear();
+
+    // Turning it off runs the scalar loop everywhere, to compare against
+    void setSimd(bool enabled) { useSimd = enabled; }
+    // "SSE2", "NEON" or "none"
+    static const char* simdName();
+
+    void cull(const glm::mat4& viewProjection);
+
+    const std::vector<VisibleList>& visibleLists() const { return lists; }
+    size_t visibleCount() const { return cullStats.visible; }
+    size_t objectCount() const { return radius.size(); }
+    uint32_t threadCount() const { return workerPool.threadCount(); }
+    const CullStats& stats() const { return cullStats; }
+
+private:
+    // Culls one range into the visible list of the thread
+    void cullRange(uint32_t thread, size_t begin, size_t end);
+    size_t cullScalar(size_t begin, size_t end, uint32_t* out) const;
+    size_t cullSimd(size_t begin, size_t end, uint32_t* out) const;
+
+    std::vector<float> centerX, centerY, centerZ, radius;
+    std::vector<float> minX, minY, minZ;
+    std::vector<float> maxX, maxY, maxZ;
+
+    FrustumPlanes frustum{};
+    bool useSimd = true;
+    std::vector<VisibleList> lists;
+    CullStats cullStats;
+
+    WorkerPool workerPool;
+};
@@ -0,0 +1,101 @@
+//
+//  GpuFrameStats.h
+//  VulkanPractice
+//
+
+/**
+ GPU side statistics of every frame, from query pools with one set of queries per frame in flight.
+ 1. beginFrame() and endFrame() are recorded around the render pass. They write timestamps for the GPU frame time,
+    and wrap the render pass in a pipeline statistics query and an occlusion query
+ 2. Pipeline statistics count input assembly primitives, vertex shader invocations, primitives entering and leaving
+    clipping and fragment shader invocations. Divided by the pixel count, fragment invocations give the overdraw
+ 3. The occlusion query counts the samples passing depth and stencil tests, precise when the device supports it
+ 4. collect() never waits. drawFrame() calls it once the fence of the frame slot signaled, at which point the results
+    are usually available. When they aren't, the sample is dropped rather than stalling the frame
+ 5. latest() gives the last collected frame, printReport() averages over all of them.
+    Queries the device doesn't support are left out, and so are their values
+ */
+
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <optional>
+#include <ostream>
+#include <vector>
+
+#include "VulkanDispatch.h"
+
+struct GpuFrameSample {
+    uint64_t frameNumber = 0;
+    uint64_t pixels = 0;
+    double gpuMs = 0.0;
+
+    uint64_t inputAssemblyPrimitives = 0;
+    uint64_t vertexShaderInvocations = 0;
+    uint64_t clippingInvocations = 0;
+    uint64_t clippingPrimitives = 0;
+    uint64_t fragmentShaderInvocations = 0;
+
+    uint64_t samplesPassed = 0;
+
+    double overdraw() const { return pixels > 0 ? static_cast<double>(fragmentShaderInvocations) / pixels : 0.0; }
+};
+
+struct GpuQuerySupport {
+    // timestampValidBits of the queue the frames are recorded on, 0 without timestamps
+    uint32_t timestampValidBits = 0;
+    float timestampPeriod = 1.0f;
+    bool pipelineStatistics = false;
+    bool occlusion = true;
+    bool preciseOcclusion = false;
+};
+
+class GpuFrameStats {
+public:
+    GpuFrameStats() = default;
+    GpuFrameStats(const GpuFrameStats& obj) = delete;
+
+    GpuFrameStats& operator=(const GpuFrameStats& obj) = delete;
+
+    ~GpuFrameStats() = default;
+
+    void init(VkDevice device, const DeviceDispatch* deviceTable, const VkAllocationCallbacks* allocator,
+              const GpuQuerySupport& support, uint32_t frameSlots);
+    void destroy();
+
+    // Must be recorded outside of a render pass
+    void beginFrame(VkCommandBuffer commandBuffer, uint32_t frameSlot, uint64_t frameNumber, VkExtent2D extent);
+    void endFrame(VkCommandBuffer commandBuffer, uint32_t frameSlot);
+
+    // Reads the results of frameSlot without waiting, returns true when a new sample was collected
+    bool collect(uint32_t frameSlot);
+
+    const std::optional<GpuFrameSample>& latest() const { return latestSample; }
+    const GpuQuerySupport& support() const { return querySupport; }
+
+    void printReport(std::ostream& os) const;
+
+private:
+    struct Slot {
+        bool pending = false;
+        uint64_t frameNumber = 0;
+        uint64_t pixels = 0;
+    };
+
+    VkDevice device = VK_NULL_HANDLE;
+    const DeviceDispatch* deviceTable = nullptr;
+    const VkAllocationCallbacks* allocator = nullptr;
+    GpuQuerySupport querySupport;
+
+    VkQueryPool timestampPool = VK_NULL_HANDLE;
+    VkQueryPool statisticsPool = VK_NULL_HANDLE;
+    VkQueryPool occlusionPool = VK_NULL_HANDLE;
+    std::vector<Slot> slots;
+
+    std::optional<GpuFrameSample> latestSample;
+    GpuFrameSample totals;
+    uint64_t collectedFrames = 0;
+    uint64_t droppedFrames = 0;
+};
@@ -0,0 +1,93 @@
+//
+//  GpuMesh.h
+//  VulkanPractice
+//
+
+/**
+ A Mesh uploaded into device local vertex and index buffers, in one of two vertex formats.
+ 1. VertexFormat::Float keeps MeshVertex as it is, 48 bytes per vertex
+ 2. VertexFormat::Quantized packs a vertex into 20 bytes with glm's gtc/packing functions:
+    i. Position as snorm16 relative to the bounding box of the mesh, the box is passed to the vertex shader
+    ii. Normal octahedral encoded into 2 x snorm16, the sphere is folded onto a square so both components are used fully
+    iii. Texture coordinates as half floats, color as unorm8
+ 3. Decoding needs no shader code for the formats themselves, the vertex input unit converts snorm, half and unorm to float.
+    The vertex shader only scales the position by the box and unfolds the octahedral normal
+ 4. The upload goes through a staging buffer and waits for the copy, meshes are loaded up front
+ 5. The levels of detail of the mesh are ranges of the one index buffer, a mesh without them has a single level
+ */
+
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+#include "Mesh.h"
+#include "PipelineManager.h"
+#include "VulkanDispatch.h"
+
+enum class VertexFormat {
+    Float,
+    Quantized
+};
+
+// Quantized positions are center + position * halfExtent
+struct MeshBounds {
+    glm::vec3 center{0.0f};
+    glm::vec3 halfExtent{0.0f};
+};
+
+class GpuMesh {
+public:
+    GpuMesh() = default;
+    GpuMesh(const GpuMesh& obj) = delete;
+
+    GpuMesh& operator=(const GpuMesh& obj) = delete;
+
+    ~GpuMesh() = default;
+
+    static VertexLayout vertexLayout(VertexFormat format);
+    static MeshBounds computeBounds(const std::vector<MeshVertex>& vertices);
+    // Vertices in the memory layout of the format, ready to be copied into the vertex buffer
+    static std::vector<uint8_t> encodeVertices(const std::vector<MeshVertex>& vertices, VertexFormat format, const MeshBounds& bounds);
+    // The inverse for one encoded vertex, to measure the quantization error
+    static MeshVertex decodeVertex(const uint8_t* encoded, VertexFormat format, const MeshBounds& bounds);
+    static uint32_t vertexSize(VertexFormat format);
+
+    // queue and commandPool are only used for the upload
+    void init(VkPhysicalDevice physicalDevice, const InstanceDispatch& instanceTable, VkDevice device, const DeviceDispatch* deviceTable,
+              const VkAllocationCallbacks* allocator, VkQueue queue, VkCommandPool commandPool, const Mesh& mesh, VertexFormat format);
+    // The device must be idle
+    void destroy();
+
+    // Binds the vertex buffer to binding 0 and the 32 bit index buffer
+    void bind(VkCommandBuffer commandBuffer) const;
+
+    VertexFormat format() const { return vertexFormat; }
+    const MeshBounds& bounds() const { return meshBounds; }
+    uint32_t indexCount() const { return indices; }
+    const std::vector<MeshLod>& lods() const { return meshLods; }
+    VkDeviceSize vertexBytes() const { return vertexBufferSize; }
+    VkDeviceSize indexBytes() const { return indexBufferSize; }
+
+private:
+    VkDevice device = VK_NULL_HANDLE;
+    const DeviceDispatch* deviceTable = nullptr;
+    const VkAllocationCallbacks* allocator = nullptr;
+    VkPhysicalDeviceMemoryProperties memoryProperties{};
+
+    VkBuffer vertexBuffer = VK_NULL_HANDLE;
+    VkDeviceMemory vertexMemory = VK_NULL_HANDLE;
+    VkBuffer indexBuffer = VK_NULL_HANDLE;
+    VkDeviceMemory indexMemory = VK_NULL_HANDLE;
+    VkDeviceSize vertexBufferSize = 0;
+    VkDeviceSize indexBufferSize = 0;
+
+    VertexFormat vertexFormat = VertexFormat::Float;
+    MeshBounds meshBounds;
+    uint32_t indices = 0;
+    std::vector<MeshLod> meshLods;
+};
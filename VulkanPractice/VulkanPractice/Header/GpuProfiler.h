@@ -0,0 +1,129 @@
+//
+//  GpuProfiler.h
+//  VulkanPractice
+//
+
+/**
+ Nested GPU profiling zones from timestamp queries, on the CPU clock of Profiler so both end up in one trace.
+ 1. beginFrame() resets the queries of a frame slot, then beginZone()/endZone() write a timestamp at either end of the
+    commands in between. Zones nest, and may span several command buffers of the frame submitted to the same queue.
+    The begin is written at the top of the pipe and the end at the bottom, so a zone covers its commands in full
+ 2. collect() never waits, like GpuFrameStats. Frames whose results aren't available yet are dropped
+ 3. GPU ticks are mapped onto steady_clock with VK_EXT_calibrated_timestamps when the device has a time domain of it,
+    recalibrated on every collect() so the clocks can't drift apart. Without it, a timestamp written by an otherwise
+    empty submit is taken to be in the middle of the CPU time around the submit and its wait, once in init().
+    That is off by up to half that time, about the submit latency
+ 4. The collected zones are kept in a ring of the most recent ones, to be exported with Profiler::writeChromeTrace()
+ 5. A profiler times one queue. Frames that also submit to another queue, like async compute, use one profiler per queue,
+    each with a queue index of its own so the trace shows them as separate tracks
+ */
+
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "Profiler.h"
+#include "VulkanDispatch.h"
+
+class GpuProfiler {
+public:
+    // Zones kept for export, older ones are overwritten
+    static constexpr uint32_t zoneCapacity = 1u << 16;
+
+    GpuProfiler() = default;
+    GpuProfiler(const GpuProfiler& obj) = delete;
+
+    GpuProfiler& operator=(const GpuProfiler& obj) = delete;
+
+    ~GpuProfiler() = default;
+
+    // Whether VK_EXT_calibrated_timestamps can correlate the device with steady_clock. The extension has to be enabled as well
+    static bool supportsCalibration(VkPhysicalDevice physicalDevice, const InstanceDispatch& instanceTable);
+
+    // queue runs the timed command buffers, commandPool belongs to its family and is used for the calibration without the extension.
+    // queueIndex is the track of the zones in the trace. timestampValidBits of that queue, 0 leaves every zone out
+    void init(VkDevice device, const DeviceDispatch* deviceTable, const VkAllocationCallbacks* allocator, VkQueue queue,
+              uint32_t queueIndex, VkCommandPool commandPool, uint32_t timestampValidBits, float timestampPeriod, uint32_t frameSlots,
+              uint32_t zonesPerFrame, bool calibratedTimestamps);
+    // The device must be idle
+    void destroy();
+
+    bool isInitialized() const { return timestampPool != VK_NULL_HANDLE; }
+
+    // First thing in the first command buffer of the frame
+    void beginFrame(VkCommandBuffer commandBuffer, uint32_t frameSlot);
+    // Zones past zonesPerFrame are left out. name must outlive the profiler
+    void beginZone(VkCommandBuffer commandBuffer, const char* name);
+    void endZone(VkCommandBuffer commandBuffer);
+
+    // Reads the zones of frameSlot without waiting, returns true when they were collected
+    bool collect(uint32_t frameSlot);
+
+    // The collected zones, oldest first
+    std::vector<TraceZone> zones() const;
+    void printReport(std::ostream& os, const std::string& queueName) const;
+
+private:
+    struct FrameSlot {
+        std::vector<const char*> names;
+        std::vector<uint32_t> depths;
+        bool pending = false;
+    };
+
+    void calibrate();
+    void calibrateWithSubmit();
+    int64_t toCpuNs(uint64_t ticks) const;
+
+    VkDevice device = VK_NULL_HANDLE;
+    const DeviceDispatch* deviceTable = nullptr;
+    const VkAllocationCallbacks* allocator = nullptr;
+    VkQueue queue = VK_NULL_HANDLE;
+    uint32_t queueIndex = 0;
+    VkCommandPool commandPool = VK_NULL_HANDLE;
+
+    uint32_t timestampValidBits = 0;
+    float timestampPeriod = 1.0f;
+    uint32_t zonesPerFrame = 0;
+    VkQueryPool timestampPool = VK_NULL_HANDLE;
+
+    std::vector<FrameSlot> frameSlots;
+    // The slot being recorded and the indices of its open zones, past zonesPerFrame for the ones left out
+    uint32_t recordingSlot = 0;
+    std::vector<uint32_t> openZones;
+    uint64_t zonesLeftOut = 0;
+    uint64_t framesDropped = 0;
+
+    // A GPU tick and the steady_clock time at that tick
+    bool calibratedTimestamps = false;
+    uint64_t calibrationTicks = 0;
+    int64_t calibrationNs = 0;
+    // How far off the calibration may be
+    double calibrationDeviationNs = 0.0;
+
+    std::vector<TraceZone> collected;
+    uint64_t collectedCount = 0;
+};
+
+// RAII GPU zone around the commands recorded in its scope
+class GpuProfileZone {
+public:
+    GpuProfileZone(GpuProfiler& profiler, VkCommandBuffer commandBuffer, const char* name)
+        : profiler(profiler), commandBuffer(commandBuffer) {
+        profiler.beginZone(commandBuffer, name);
+    }
+
+    GpuProfileZone(const GpuProfileZone& obj) = delete;
+
+    GpuProfileZone& operator=(const GpuProfileZone& obj) = delete;
+
+    ~GpuProfileZone() { profiler.endZone(commandBuffer); }
+
+private:
+    GpuProfiler& profiler;
+    VkCommandBuffer commandBuffer;
+};
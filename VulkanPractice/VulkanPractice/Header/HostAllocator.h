@@ -0,0 +1,118 @@
+//
+//  HostAllocator.h
+//  VulkanPractice
+//
+
+/**
+ VkAllocationCallbacks handed to every vkCreate*, vkAllocate* and vkDestroy* call so driver host allocations are visible.
+ 1. Small allocations with scope VK_SYSTEM_ALLOCATION_SCOPE_COMMAND or VK_SYSTEM_ALLOCATION_SCOPE_OBJECT (the scopes the driver uses
+    while acquiring, recording, submitting and presenting a frame) are served from size class free lists carved out of
+    big arena chunks. Once the arena is warm a frame does not touch the system heap anymore
+ 2. Everything else (device, instance, cache scope or large/over aligned blocks) goes to the system heap
+ 3. Bytes and counts are tracked per allocation scope, along with allocations per frame
+ */
+
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+struct HostAllocationFrameStats {
+    uint64_t allocations = 0;
+    uint64_t systemHeapAllocations = 0;
+    uint64_t bytes = 0;
+};
+
+class HostAllocator {
+public:
+    HostAllocator();
+    HostAllocator(const HostAllocator& obj) = delete;
+
+    HostAllocator& operator=(const HostAllocator& obj) = delete;
+
+    ~HostAllocator();
+
+    const VkAllocationCallbacks* callbacks() const { return &allocationCallbacks; }
+
+    // Closes the running frame and starts counting a new one
+    void nextFrame();
+    const HostAllocationFrameStats& lastFrameStats() const { return lastFrame; }
+
+    void printReport(std::ostream& os) const;
+
+private:
+    static constexpr size_t SCOPE_COUNT = VK_SYSTEM_ALLOCATION_SCOPE_INSTANCE + 1;
+    static constexpr size_t SIZE_CLASS_COUNT = 8;         // 32 bytes to 4KB blocks, header included
+    static constexpr size_t MIN_BLOCK_SIZE = 32;
+    static constexpr size_t ARENA_CHUNK_SIZE = 64 * 1024;
+    static constexpr size_t POOL_ALIGNMENT = 16;
+    static constexpr uint16_t SYSTEM_HEAP_CLASS = 0xFFFF;
+
+    // Stored right in front of every pointer handed to the driver
+    struct AllocationHeader {
+        size_t size;
+        uint32_t offset;        // From the start of the underlying block to the user pointer
+        uint16_t sizeClass;
+        uint16_t scope;
+    };
+    static_assert(sizeof(AllocationHeader) == POOL_ALIGNMENT, "header has to keep pool blocks aligned");
+
+    struct FreeBlock {
+        FreeBlock* next;
+    };
+
+    struct SizeClassPool {
+        std::mutex lock;
+        FreeBlock* freeList = nullptr;
+        std::vector<void*> chunks;
+    };
+
+    struct ScopeStats {
+        std::atomic<uint64_t> liveBytes{0};
+        std::atomic<uint64_t> liveCount{0};
+        std::atomic<uint64_t> peakBytes{0};
+        std::atomic<uint64_t> totalAllocations{0};
+        std::atomic<uint64_t> systemHeapAllocations{0};
+        std::atomic<uint64_t> internalBytes{0};
+    };
+
+    static VKAPI_ATTR void* VKAPI_CALL allocationFunction(void* pUserData, size_t size, size_t alignment, VkSystemAllocationScope allocationScope);
+    static VKAPI_ATTR void* VKAPI_CALL reallocationFunction(void* pUserData, void* pOriginal, size_t size, size_t alignment, VkSystemAllocationScope allocationScope);
+    static VKAPI_ATTR void VKAPI_CALL freeFunction(void* pUserData, void* pMemory);
+    static VKAPI_ATTR void VKAPI_CALL internalAllocationNotification(void* pUserData, size_t size, VkInternalAllocationType allocationType, VkSystemAllocationScope allocationScope);
+    static VKAPI_ATTR void VKAPI_CALL internalFreeNotification(void* pUserData, size_t size, VkInternalAllocationType allocationType, VkSystemAllocationScope allocationScope);
+
+    void* allocate(size_t size, size_t alignment, VkSystemAllocationScope scope);
+    void* reallocate(void* pOriginal, size_t size, size_t alignment, VkSystemAllocationScope scope);
+    void release(void* pMemory);
+
+    void* allocateFromPool(uint16_t sizeClass, bool& touchedSystemHeap);
+    bool refillPool(SizeClassPool& pool, size_t blockSize);
+    void* allocateFromSystem(size_t size, size_t alignment, uint32_t& offset);
+
+    static int sizeClassFor(size_t size, size_t alignment);
+    static size_t blockSizeFor(size_t sizeClass) { return MIN_BLOCK_SIZE << sizeClass; }
+    static const char* scopeName(size_t scope);
+
+    VkAllocationCallbacks allocationCallbacks{};
+
+    std::array<SizeClassPool, SIZE_CLASS_COUNT> pools;
+    std::array<ScopeStats, SCOPE_COUNT> scopeStats;
+
+    // Running frame, updated from any thread the driver allocates on
+    std::atomic<uint64_t> frameAllocations{0};
+    std::atomic<uint64_t> frameSystemHeapAllocations{0};
+    std::atomic<uint64_t> frameBytes{0};
+
+    HostAllocationFrameStats lastFrame;
+    uint64_t frameCount = 0;
+    uint64_t framesTouchingSystemHeap = 0;
+    uint64_t allocationsOverAllFrames = 0;
+};
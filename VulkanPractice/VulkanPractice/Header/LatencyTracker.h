@@ -0,0 +1,86 @@
+//
+//  LatencyTracker.h
+//  VulkanPractice
+//
+
+/**
+ Measures how old the input of a frame is when the GPU finishes it.
+ 1. submitted() is called with the fence of a submit and the time the input the frame uses was sampled.
+    A watcher thread waits on the fences in submit order and records completion time - sample time
+ 2. The render loop waits on the same fence before reusing the frame slot, that wait is MAX_FRAMES_IN_FLIGHT frames late,
+    so it can't give the completion time itself. vkResetFences needs the fence to be externally synchronized though:
+    release() blocks until the watcher is done with the fence and has to be called before resetting it
+ 3. Scanout isn't visible without present timing extensions, so the end point is GPU completion rather than photons.
+    Presentation adds about the same on top of every frame, which keeps configurations comparable
+ */
+
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "VulkanDispatch.h"
+
+struct LatencySummary {
+    size_t frames = 0;
+    double medianMs = 0.0;
+    double p95Ms = 0.0;
+    double maxMs = 0.0;
+};
+
+class LatencyTracker {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    LatencyTracker() = default;
+    LatencyTracker(const LatencyTracker& obj) = delete;
+
+    LatencyTracker& operator=(const LatencyTracker& obj) = delete;
+
+    ~LatencyTracker();
+
+    void init(VkDevice device, const DeviceDispatch* deviceTable);
+    // Waits for the pending fences, so every submit must have a chance to complete
+    void destroy();
+
+    bool isInitialized() const { return watcher.joinable(); }
+
+    void submitted(VkFence fence, Clock::time_point inputSampled);
+    // Must be called before the fence is reset
+    void release(VkFence fence);
+    // Waits until every submitted fence has been observed
+    void flush();
+
+    // Drops the samples so far
+    void reset();
+    LatencySummary summary() const;
+    void printReport(std::ostream& os, const std::string& label) const;
+
+private:
+    struct PendingFrame {
+        VkFence fence;
+        Clock::time_point inputSampled;
+    };
+
+    void watch();
+
+    VkDevice device = VK_NULL_HANDLE;
+    const DeviceDispatch* deviceTable = nullptr;
+
+    std::thread watcher;
+    mutable std::mutex mutex;
+    std::condition_variable pendingChanged;
+    // The front entry is the fence being waited on, it is removed once that wait returns
+    std::deque<PendingFrame> pending;
+    bool stopping = false;
+
+    std::vector<double> samplesMs;
+};
@@ -0,0 +1,161 @@
+//
+//  MemoryBudget.h
+//  VulkanPractice
+//
+
+/**
+ Device memory budget of every heap, with eviction callbacks for when our usage gets close to it.
+ 1. update() runs once per frame. With VK_EXT_memory_budget it reads the budget and usage the driver estimates for this
+    process, which take other applications and the driver's own allocations into account. Without the extension the
+    budget is the heap size and the usage is what we allocated
+ 2. trackAllocations() replaces vkAllocateMemory and vkFreeMemory in the device table with versions that count the bytes
+    of every heap and forward to the driver. Every module allocates through the table, so all of them are counted as they are
+ 3. A simulated budget caps the budget of the device local heaps. Software ICDs like lavapipe or SwiftShader have heaps
+    far larger than anything this app allocates, with it eviction can still be exercised and tested on them
+ 4. When the usage of a heap passes highWatermark of its budget, the eviction callbacks are called in order of priority
+    with the bytes to free to get back under lowWatermark, until they freed enough. Streaming systems release evicted
+    textures once the GPU is done with them, so the usage only drops frames later. Until then, for cooldownFrames,
+    the heap doesn't raise another eviction
+ 5. The heaps and the eviction events are kept for the stats report
+ */
+
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <ostream>
+#include <unordered_map>
+#include <vector>
+
+#include "VulkanDispatch.h"
+
+struct MemoryBudgetSettings {
+    // Fractions of the budget that start and end an eviction
+    float highWatermark = 0.9f;
+    float lowWatermark = 0.8f;
+    // Frames a heap waits after an eviction before it raises the next one
+    uint32_t cooldownFrames = 3;
+    // Caps the budget of the device local heaps, or of every heap when none is device local. 0 keeps the real budget
+    VkDeviceSize simulatedBudget = 0;
+};
+
+struct MemoryHeapStats {
+    VkDeviceSize size = 0;
+    VkDeviceSize budget = 0;
+    // The driver's estimate with VK_EXT_memory_budget, trackedBytes otherwise
+    VkDeviceSize usage = 0;
+    VkDeviceSize peakUsage = 0;
+    // What went through vkAllocateMemory and is still allocated, and in how many allocations
+    VkDeviceSize trackedBytes = 0;
+    uint64_t allocations = 0;
+    // Since tracking started
+    uint64_t failedAllocations = 0;
+    bool deviceLocal = false;
+    bool simulated = false;
+};
+
+struct MemoryEvictionEvent {
+    uint64_t frameNumber = 0;
+    uint32_t heap = 0;
+    VkDeviceSize budget = 0;
+    VkDeviceSize usage = 0;
+    // Down to the low watermark
+    VkDeviceSize bytesToFree = 0;
+    // What the callbacks reported
+    VkDeviceSize bytesFreed = 0;
+};
+
+class MemoryBudget {
+public:
+    // Frees memory of heap, or schedules it to be freed, and returns how many bytes that is
+    using EvictionCallback = std::function<VkDeviceSize(uint32_t heap, VkDeviceSize bytesToFree)>;
+
+    // Events kept for the report, older ones are dropped
+    static constexpr size_t eventCapacity = 256;
+
+    MemoryBudget() = default;
+    MemoryBudget(const MemoryBudget& obj) = delete;
+
+    MemoryBudget& operator=(const MemoryBudget& obj) = delete;
+
+    ~MemoryBudget() = default;
+
+    // budgetExtension: VK_EXT_memory_budget is enabled on the device
+    void init(VkPhysicalDevice physicalDevice, const InstanceDispatch& instanceTable, bool budgetExtension,
+              const MemoryBudgetSettings& settings);
+    // Gives deviceTable its functions back, after the last memory was freed through it
+    void destroy();
+
+    // Right after the device table is loaded, before anything is allocated. Only one MemoryBudget can track at a time
+    void trackAllocations(DeviceDispatch& deviceTable);
+
+    // Once per frame, calls the eviction callbacks of heaps above the high watermark
+    void update(uint64_t frameNumber);
+
+    // Lower priorities are called first. Returns an id for removeEvictionCallback()
+    uint32_t addEvictionCallback(int priority, EvictionCallback callback);
+    void removeEvictionCallback(uint32_t id);
+
+    // 0 to go back to the real budget, takes effect with the next update()
+    void setSimulatedBudget(VkDeviceSize bytes);
+
+    uint32_t heapOfMemoryType(uint32_t memoryTypeIndex) const { return memoryProperties.memoryTypes[memoryTypeIndex].heapIndex; }
+    bool hasBudgetExtension() const { return budgetExtension; }
+    const std::vector<MemoryHeapStats>& heaps() const { return heapStats; }
+    // The most recent events, oldest first
+    std::vector<MemoryEvictionEvent> events() const;
+
+    void printReport(std::ostream& os) const;
+
+private:
+    struct Callback {
+        uint32_t id;
+        int priority;
+        EvictionCallback callback;
+    };
+
+    struct Allocation {
+        uint32_t heap;
+        VkDeviceSize size;
+    };
+
+    static VKAPI_ATTR VkResult VKAPI_CALL trackedAllocateMemory(VkDevice device, const VkMemoryAllocateInfo* pAllocateInfo,
+                                                                const VkAllocationCallbacks* pAllocator, VkDeviceMemory* pMemory);
+    static VKAPI_ATTR void VKAPI_CALL trackedFreeMemory(VkDevice device, VkDeviceMemory memory, const VkAllocationCallbacks* pAllocator);
+
+    // The instance the table functions report to, and the driver's functions they forward to
+    static MemoryBudget* tracking;
+    static PFN_vkAllocateMemory nextAllocateMemory;
+    static PFN_vkFreeMemory nextFreeMemory;
+
+    void queryBudget();
+    void evict(uint32_t heap, uint64_t frameNumber);
+
+    VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+    const InstanceDispatch* instanceTable = nullptr;
+    DeviceDispatch* trackedTable = nullptr;
+    bool budgetExtension = false;
+    MemoryBudgetSettings settings;
+    VkPhysicalDeviceMemoryProperties memoryProperties{};
+
+    // Allocations come from any thread
+    std::mutex allocationsMutex;
+    std::unordered_map<VkDeviceMemory, Allocation> allocations;
+    std::vector<VkDeviceSize> trackedBytes;
+    std::vector<uint64_t> allocationCounts;
+    std::vector<uint64_t> failedAllocationCounts;
+
+    std::vector<MemoryHeapStats> heapStats;
+    // Frame of the last eviction of every heap
+    std::vector<uint64_t> lastEviction;
+    std::vector<Callback> callbacks;
+    uint32_t nextCallbackId = 0;
+
+    std::vector<MemoryEvictionEvent> recentEvents;
+    uint64_t eventCount = 0;
+    uint64_t updates = 0;
+    uint64_t updatesOverBudget = 0;
+};
@@ -0,0 +1,69 @@
+//
+//  Mesh.h
+//  VulkanPractice
+//
+
+/**
+ Indexed triangle meshes loaded from Wavefront OBJ or binary glTF (.glb) files.
+ 1. The file is memory mapped and parsed in place, nothing is read into an intermediate buffer
+ 2. OBJ: the file is split into chunks at line boundaries, one per thread. Every thread parses its chunk into local
+    position, normal and texture coordinate lists plus the face corners, which still refer to OBJ indices.
+    A prefix sum over the chunk sizes then turns relative (negative) indices into absolute ones.
+    Polygons are triangulated as fans
+ 3. GLB: the JSON chunk is parsed on the calling thread, the triangle primitives of all meshes are then converted
+    from the mapped binary chunk in parallel ranges. Node transforms and materials are ignored
+ 4. Vertices are deduplicated with a hash map, OBJ on the position/texcoord/normal index triple of a corner,
+    GLB on the vertex contents. The result is exactly one copy of every distinct vertex
+ See MeshOptimizer.h to reorder the result for the vertex cache and vertex fetch.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct MeshVertex {
+    float position[3];
+    float normal[3];
+    float uv[2];
+    // Linear RGBA, OBJ "v x y z r g b" or glTF COLOR_0
+    float color[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+
+    bool operator==(const MeshVertex& other) const;
+};
+
+struct MeshLoadStats {
+    uint32_t threads = 0;
+    uint64_t fileBytes = 0;
+    // Face corners in the file, before deduplication
+    uint64_t inputCorners = 0;
+    double mapMs = 0.0;
+    double parseMs = 0.0;
+    double deduplicateMs = 0.0;
+    double totalMs = 0.0;
+};
+
+// Range of one level of detail in Mesh::indices. error bounds the distance to the full mesh, in mesh units
+struct MeshLod {
+    uint32_t firstIndex = 0;
+    uint32_t indexCount = 0;
+    float error = 0.0f;
+};
+
+struct Mesh {
+    std::vector<MeshVertex> vertices;
+    std::vector<uint32_t> indices;
+    // Empty until LODs are generated, see MeshSimplifier.h. Otherwise lods[0] is the full mesh
+    // and the coarser levels follow it in indices, all of them sharing the vertices
+    std::vector<MeshLod> lods;
+
+    // Of the full mesh
+    uint64_t triangleCount() const { return (lods.empty() ? indices.size() : lods[0].indexCount) / 3; }
+
+    // Picks the format from the extension, .obj or .glb. threadCount 0 uses every hardware thread
+    static Mesh load(const std::string& path, uint32_t threadCount = 0, MeshLoadStats* stats = nullptr);
+
+    // Writes positions, normals, texture coordinates and vertex colors, used to generate test scenes
+    void writeObj(const std::string& path) const;
+};
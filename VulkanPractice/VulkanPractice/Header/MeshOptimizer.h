@@ -0,0 +1,36 @@
+//
+//  MeshOptimizer.h
+//  VulkanPractice
+//
+
+/**
+ Reorders a deduplicated mesh so the GPU reads it efficiently. Neither step changes what is drawn.
+ 1. optimizeVertexCache() reorders the triangles with Tipsify (Sander, Nehab, Barczak 2007). It walks the mesh
+    in fans around a current vertex and jumps to the neighbour that is still in the cache with the most triangles left,
+    so the post transform cache hits more often. It runs in linear time, unlike Forsyth's scoring that rescans the cache.
+    Levels of detail are reordered one by one, their ranges stay where they are
+ 2. optimizeVertexFetch() then renumbers the vertices in the order the new index buffer first uses them,
+    which makes vertex fetches mostly sequential. Unreferenced vertices are dropped
+ 3. analyzeVertexCache() simulates a FIFO cache to measure the result. ACMR is the number of cache misses per triangle,
+    between 0.5 for a perfect regular grid and 3. ATVR is misses per vertex, 1.0 is perfect
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "Mesh.h"
+
+// Typical size of the post transform cache, in vertices
+const uint32_t DEFAULT_VERTEX_CACHE_SIZE = 16;
+
+struct VertexCacheStats {
+    double acmr = 0.0;
+    double atvr = 0.0;
+};
+
+void optimizeVertexCache(Mesh& mesh, uint32_t cacheSize = DEFAULT_VERTEX_CACHE_SIZE);
+void optimizeVertexFetch(Mesh& mesh);
+
+VertexCacheStats analyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize = DEFAULT_VERTEX_CACHE_SIZE);
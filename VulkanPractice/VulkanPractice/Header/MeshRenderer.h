@@ -0,0 +1,72 @@
+//
+//  MeshRenderer.h
+//  VulkanPractice
+//
+
+/**
+ Draws GpuMeshes with a simple directional light, for scenes and benchmarks that need real geometry.
+ 1. One pipeline variant per vertex format. The format is a specialization constant of mesh.vert, the quantized
+    variant decodes the position from the mesh bounds and unfolds the octahedral normal
+ 2. Per draw state goes through push constants: the transform to clip space and the bounds of quantized positions
+ 3. Between begin() and the next begin(), draws of the same mesh skip binding the pipeline and buffers again,
+    so drawing different index ranges of one mesh only costs the draw itself
+ 4. Draws test and write depth, the render pass needs a depth attachment cleared for reversed Z
+ */
+
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+
+#include "GpuMesh.h"
+#include "PipelineManager.h"
+#include "VulkanDispatch.h"
+
+struct MeshDrawStats {
+    uint64_t draws = 0;
+    uint64_t triangles = 0;
+    uint64_t pipelineBinds = 0;
+    uint64_t meshBinds = 0;
+};
+
+class MeshRenderer {
+public:
+    MeshRenderer() = default;
+    MeshRenderer(const MeshRenderer& obj) = delete;
+
+    MeshRenderer& operator=(const MeshRenderer& obj) = delete;
+
+    ~MeshRenderer() = default;
+
+    // The shaders are ids of PipelineManager::addShader
+    void init(VkDevice device, const DeviceDispatch* deviceTable, const VkAllocationCallbacks* allocator, PipelineManager* pipelineManager,
+              VkRenderPass renderPass, VkFormat colorFormat, uint64_t vertexShader, uint64_t fragmentShader);
+    // The device must be idle
+    void destroy();
+
+    // Starts recording into a command buffer inside the render pass and resets the stats
+    void begin(VkCommandBuffer commandBuffer);
+    // transform maps the mesh to clip space. Draws the full mesh, or the index range of one of its levels of detail
+    void draw(const GpuMesh& mesh, const glm::mat4& transform);
+    void draw(const GpuMesh& mesh, const glm::mat4& transform, uint32_t firstIndex, uint32_t indexCount);
+
+    const MeshDrawStats& stats() const { return drawStats; }
+
+private:
+    VkDevice device = VK_NULL_HANDLE;
+    const DeviceDispatch* deviceTable = nullptr;
+    const VkAllocationCallbacks* allocator = nullptr;
+    PipelineManager* pipelineManager = nullptr;
+
+    VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+    PipelineState pipelineState;
+
+    VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+    const GpuMesh* boundMesh = nullptr;
+    bool pipelineBound = false;
+    VertexFormat boundFormat = VertexFormat::Float;
+    MeshDrawStats drawStats;
+};
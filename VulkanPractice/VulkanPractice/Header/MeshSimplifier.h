@@ -0,0 +1,37 @@
+//
+//  MeshSimplifier.h
+//  VulkanPractice
+//
+
+/**
+ Generates levels of detail with quadric error metrics (Garland, Heckbert 1997) and picks one per object and frame.
+ 1. Every vertex carries the quadric of the planes of its triangles, the sum of squared distances to them. Collapsing an edge
+    adds the quadrics, so the error of a vertex keeps measuring the distance to the original surface, not to the last level
+ 2. Collapses are half edge collapses: one end moves onto the other. No vertex is ever created, so all levels share
+    the vertex buffer of the full mesh and only need indices
+ 3. Simplification runs in passes. Each pass sorts the candidate edges by error and collapses the cheapest ones whose
+    ends weren't touched by an earlier collapse of the same pass, skipping collapses that would flip a triangle
+ 4. Vertices where normals, texture coordinates or colors are split (seams) and vertices on open borders are locked,
+    so textures don't tear and outlines stay in place. Those are found by comparing positions
+ 5. buildLods() halves the triangle count per level until the error bound stops it. Every level continues from the previous
+    one with the quadrics it left, so its error and the bound are against the full mesh. The levels are appended to the
+    index buffer of the mesh, so switching levels is only a different range in the same draw
+ 6. selectLod() projects the error of each level onto the screen and picks the coarsest level below a pixel threshold
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "Mesh.h"
+
+// Simplifies the triangles in indices down to about targetIndexCount, but never beyond maxError (in mesh units).
+// Returns the error of the result
+float simplifyMesh(const std::vector<MeshVertex>& vertices, std::vector<uint32_t>& indices, size_t targetIndexCount, float maxError);
+
+// Replaces mesh.lods with lods[0] for the full mesh plus up to maxLods - 1 coarser levels
+void buildLods(Mesh& mesh, uint32_t maxLods, float maxError);
+
+// pixelsPerUnit is the size of one mesh unit on screen at the distance of the object
+uint32_t selectLod(const std::vector<MeshLod>& lods, float pixelsPerUnit, float maxPixelError);
@@ -0,0 +1,168 @@
+//
+//  MultiviewRenderer.h
+//  VulkanPractice
+//
+
+/**
+ Renders the same scene from several cameras into the layers of one image, for stereo and split views.
+ 1. The target is a color and a depth image with one layer per view. With VK_KHR_multiview (core in Vulkan 1.1) a single
+    render pass with a view mask covers all the layers: every draw is recorded once and the driver replays it per view,
+    multiview.vert picks the camera with gl_ViewIndex. The views are marked as correlated, so implementations that can
+    share work between them (e.g. the vertex stages of a stereo pair) are allowed to
+ 2. MultiviewMode::SeparatePasses is the path without multiview, for comparison and for devices without the feature:
+    one ordinary render pass per layer and the scene recorded into each, with multiview_layer.vert: multiview.vert
+    built without the extension, where the baseView push constant alone selects the camera. The two render passes
+    aren't compatible, each has pipeline variants of its own
+ 3. The cameras live in a persistently mapped uniform buffer with a region per frame slot, written like the camera
+    uniforms. Draws push the model matrix, so a draw costs the same whatever the number of views
+ 4. The render passes leave the layers in SHADER_READ_ONLY_OPTIMAL. composite() draws them side by side, layer 0 on the
+    left, with a fullscreen triangle inside another render pass, e.g. the main one, so everything after it
+    (post processing, upscale, readback) works as for any other scene
+ 5. record() measures how long recording the passes took on the CPU, stats() adds them up until resetStats()
+ */
+
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <glm/glm.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "GpuMesh.h"
+#include "PipelineManager.h"
+#include "VulkanDispatch.h"
+
+enum class MultiviewMode {
+    Multiview,      // one render pass with a view mask over all the layers
+    SeparatePasses  // one render pass per layer, the scene recorded for each
+};
+
+struct MultiviewStats {
+    uint64_t frames = 0;
+    uint64_t passes = 0;
+    // Draw calls recorded, a multiview draw counts once however many views it covers
+    uint64_t draws = 0;
+    double recordMs = 0.0;
+};
+
+class MultiviewRenderer {
+public:
+    using Clock = std::chrono::steady_clock;
+    // Records the scene with draw(), called once per render pass
+    using SceneCallback = std::function<void()>;
+
+    // Matches MAX_VIEWS of multiview.vert
+    static constexpr uint32_t maxViews = 4;
+
+    MultiviewRenderer() = default;
+    MultiviewRenderer(const MultiviewRenderer& obj) = delete;
+
+    MultiviewRenderer& operator=(const MultiviewRenderer& obj) = delete;
+
+    ~MultiviewRenderer() = default;
+
+    // Vulkan 1.1 with the multiview feature for at least viewCount views
+    static bool isSupported(VkPhysicalDevice physicalDevice, const InstanceDispatch& instanceTable, uint32_t viewCount);
+
+    // multiviewEnabled: the multiview feature is enabled on the device, otherwise only MultiviewMode::SeparatePasses is available.
+    // colorFormat has to support linear filtering
+    void init(VkPhysicalDevice physicalDevice, const InstanceDispatch& instanceTable, VkDevice device, const DeviceDispatch* deviceTable,
+              const VkAllocationCallbacks* allocator, PipelineManager* pipelineManager, VkFormat colorFormat, VkFormat depthFormat,
+              uint32_t viewCount, uint32_t frameSlots, bool multiviewEnabled);
+    // The device must be idle
+    void destroy();
+
+    bool isInitialized() const { return device != VK_NULL_HANDLE; }
+    bool hasMultiview() const { return multiviewRenderPass != VK_NULL_HANDLE; }
+    uint32_t viewCount() const { return views; }
+
+    // Size of every layer. Reallocates the target, the device must be idle
+    void resize(VkExtent2D layerExtent);
+    VkExtent2D layerExtent() const { return extent; }
+    float layerAspect() const { return static_cast<float>(extent.width) / static_cast<float>(extent.height); }
+
+    // MultiviewMode::Multiview needs hasMultiview()
+    void setMode(MultiviewMode mode);
+    MultiviewMode mode() const { return renderMode; }
+
+    // Written before the submit of the frame slot, after its previous frame finished
+    void setViewProjection(uint32_t frameSlot, uint32_t view, const glm::mat4& viewProjection);
+
+    // Renders every layer with drawScene, outside of a render pass
+    void record(VkCommandBuffer commandBuffer, uint32_t frameSlot, const SceneCallback& drawScene);
+    // Only between the render passes of record(), from drawScene
+    void draw(const GpuMesh& mesh, const glm::mat4& model);
+
+    // The layers side by side over the viewport, inside a render pass with a single color attachment of colorFormat
+    void composite(VkCommandBuffer commandBuffer, VkRenderPass renderPass, VkFormat colorFormat);
+
+    const MultiviewStats& stats() const { return renderStats; }
+    void resetStats() { renderStats = MultiviewStats{}; }
+
+private:
+    void createRenderPasses(bool multiviewEnabled);
+    void createDescriptors(uint32_t frameSlots);
+    void destroyTarget();
+    void beginPass(VkRenderPass renderPass, VkFramebuffer framebuffer);
+
+    VkDevice device = VK_NULL_HANDLE;
+    const DeviceDispatch* deviceTable = nullptr;
+    const VkAllocationCallbacks* allocator = nullptr;
+    PipelineManager* pipelineManager = nullptr;
+    VkPhysicalDeviceMemoryProperties memoryProperties{};
+    VkFormat colorFormat = VK_FORMAT_UNDEFINED;
+    VkFormat depthFormat = VK_FORMAT_UNDEFINED;
+    uint32_t views = 0;
+    MultiviewMode renderMode = MultiviewMode::SeparatePasses;
+
+    // multiviewRenderPass covers every layer, layerRenderPass one of them. Without the multiview feature there is only layerRenderPass
+    VkRenderPass multiviewRenderPass = VK_NULL_HANDLE;
+    VkRenderPass layerRenderPass = VK_NULL_HANDLE;
+
+    VkExtent2D extent{};
+    VkImage colorImage = VK_NULL_HANDLE;
+    VkDeviceMemory colorImageMemory = VK_NULL_HANDLE;
+    VkImage depthImage = VK_NULL_HANDLE;
+    VkDeviceMemory depthImageMemory = VK_NULL_HANDLE;
+    // Array views over all the layers, for the multiview framebuffer and the composite
+    VkImageView colorArrayView = VK_NULL_HANDLE;
+    VkImageView depthArrayView = VK_NULL_HANDLE;
+    VkFramebuffer multiviewFramebuffer = VK_NULL_HANDLE;
+    // One view and framebuffer per layer for the separate passes
+    std::vector<VkImageView> layerViews;
+    std::vector<VkFramebuffer> layerFramebuffers;
+
+    // The cameras, a region of maxViews matrices per frame slot
+    VkBuffer uniformBuffer = VK_NULL_HANDLE;
+    VkDeviceMemory uniformMemory = VK_NULL_HANDLE;
+    uint8_t* mapped = nullptr;
+    VkDeviceSize slotStride = 0;
+
+    VkDescriptorSetLayout sceneSetLayout = VK_NULL_HANDLE;
+    VkDescriptorSetLayout compositeSetLayout = VK_NULL_HANDLE;
+    VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+    std::vector<VkDescriptorSet> sceneSets;
+    VkDescriptorSet compositeSet = VK_NULL_HANDLE;
+    VkSampler sampler = VK_NULL_HANDLE;
+
+    VkPipelineLayout scenePipelineLayout = VK_NULL_HANDLE;
+    VkPipelineLayout compositePipelineLayout = VK_NULL_HANDLE;
+    // The scene in layerRenderPass with multiview_layer.vert, and in multiviewRenderPass with multiview.vert
+    PipelineState layerPipelineState;
+    PipelineState multiviewPipelineState;
+    PipelineState compositePipelineState;
+
+    // Recording state between the render passes of record()
+    VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+    VkRenderPass currentRenderPass = VK_NULL_HANDLE;
+    uint32_t baseView = 0;
+    const GpuMesh* boundMesh = nullptr;
+    bool pipelineBound = false;
+    VertexFormat boundFormat = VertexFormat::Float;
+
+    MultiviewStats renderStats;
+};
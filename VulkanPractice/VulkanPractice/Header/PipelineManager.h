@@ -0,0 +1,207 @@
+//
+//  PipelineManager.h
+//  VulkanPractice
+//
+
+/**
+ Creates graphics pipeline variants on demand and keeps them for the lifetime of the device.
+ 1. A variant is selected by PipelineState: the shader set plus all fixed-function state which is baked into the pipeline
+    (topology, polygon mode, culling, depth test, blending, render pass and attachment format). Viewport and scissor are dynamic
+ 2. The state is hashed into the key of the variant map, a lookup of an existing variant doesn't touch the driver.
+    Misses are compiled through a VkPipelineCache so equal shader stages are only compiled once by the driver
+ 3. Shaders are registered once and identified by the hash of their SPIR-V, the modules live as long as the manager
+ 4. BlendMode::Opaque disables blending entirely, use it whenever the output alpha doesn't matter
+ 5. Specialization constants are part of the state, each specialization is a variant of its own. The driver folds
+    them like literals, so feature toggles, loop counts and array sizes cost nothing at runtime
+ 6. Vertex input comes from at most one vertex buffer, described by VertexLayout. The default layout has no attributes,
+    for shaders which generate their vertices
+ 7. With VK_EXT_graphics_pipeline_library the four parts of a pipeline (vertex input, pre-rasterization shaders,
+    fragment shader, fragment output) are compiled into libraries, each memoized on only the state it depends on.
+    A new variant then only compiles the parts nobody asked for yet and fast links them, without link time optimization.
+    The optimized link is built on a background thread and replaces the fast one in the variant map once it is done
+ Lookups are thread safe, creation happens outside of the lock.
+ */
+
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <array>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <ostream>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "ShaderReflection.h"
+#include "VulkanDispatch.h"
+
+enum class BlendMode : uint8_t {
+    Opaque,
+    AlphaBlend,
+    Additive
+};
+
+// Values for the constant_id of one shader stage. Every value is 32 bits wide,
+// which covers bool (VkBool32), int, uint and float constants
+struct SpecializationConstants {
+    static constexpr uint32_t MAX_CONSTANTS = 8;
+
+    // Replaces the value if the id is already set. Entries are kept sorted by id,
+    // so the order of the calls doesn't create different variants
+    SpecializationConstants& set(uint32_t id, uint32_t value);
+    SpecializationConstants& set(uint32_t id, int32_t value);
+    SpecializationConstants& set(uint32_t id, float value);
+    SpecializationConstants& set(uint32_t id, bool value);
+
+    bool operator==(const SpecializationConstants& other) const;
+    uint64_t hash(uint64_t seed) const;
+
+    uint32_t count = 0;
+    std::array<uint32_t, MAX_CONSTANTS> ids{};
+    std::array<uint32_t, MAX_CONSTANTS> values{};
+};
+
+// Attributes of the vertex buffer at binding 0. Attribute i is read at location i
+struct VertexLayout {
+    static constexpr uint32_t MAX_ATTRIBUTES = 8;
+
+    VertexLayout& add(VkFormat format, uint32_t offset);
+
+    bool operator==(const VertexLayout& other) const;
+    uint64_t hash(uint64_t seed) const;
+
+    uint32_t stride = 0;
+    VkVertexInputRate inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+    uint32_t count = 0;
+    std::array<VkFormat, MAX_ATTRIBUTES> formats{};
+    std::array<uint32_t, MAX_ATTRIBUTES> offsets{};
+};
+
+struct PipelineState {
+    // Ids returned by PipelineManager::addShader
+    uint64_t vertexShader = 0;
+    uint64_t fragmentShader = 0;
+    SpecializationConstants vertexSpecialization;
+    SpecializationConstants fragmentSpecialization;
+
+    VertexLayout vertexLayout;
+
+    VkPipelineLayout layout = VK_NULL_HANDLE;
+    VkRenderPass renderPass = VK_NULL_HANDLE;
+    uint32_t subpass = 0;
+    VkFormat colorFormat = VK_FORMAT_UNDEFINED;
+
+    VkPrimitiveTopology topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    VkPolygonMode polygonMode = VK_POLYGON_MODE_FILL;
+    VkCullModeFlags cullMode = VK_CULL_MODE_NONE;
+    VkFrontFace frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+    BlendMode blendMode = BlendMode::Opaque;
+
+    // Only used when the subpass has a depth attachment. The default compare op is for reversed Z, where closer is larger
+    bool depthTest = false;
+    bool depthWrite = false;
+    VkCompareOp depthCompareOp = VK_COMPARE_OP_GREATER_OR_EQUAL;
+
+    bool operator==(const PipelineState& other) const;
+    uint64_t hash() const;
+};
+
+struct PipelineCacheStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    // Time until the variant could be bound, a fast link when libraries are used
+    double totalCreationMs = 0.0;
+    double maxCreationMs = 0.0;
+
+    uint64_t libraryParts = 0;
+    uint64_t optimizedLinks = 0;
+    double totalOptimizedLinkMs = 0.0;
+};
+
+class PipelineManager {
+public:
+    PipelineManager() = default;
+    PipelineManager(const PipelineManager& obj) = delete;
+
+    PipelineManager& operator=(const PipelineManager& obj) = delete;
+
+    ~PipelineManager() = default;
+
+    // useLibraries requires VK_EXT_graphics_pipeline_library to be enabled on the device
+    void init(VkDevice device, const DeviceDispatch* deviceTable, const VkAllocationCallbacks* allocator, bool useLibraries);
+    // Destroys all variants and shader modules, the device must be idle
+    void destroy();
+
+    bool usesLibraries() const { return useLibraries; }
+
+    // Returns the id of the shader, registering the same SPIR-V again returns the existing id
+    uint64_t addShader(const EmbeddedShader& shader);
+
+    // Returns the memoized variant for the state, or creates it.
+    // Call it again when recording, the variant gets replaced once its optimized link is done
+    VkPipeline getPipeline(const PipelineState& state);
+
+    // Blocks until all queued optimized links are done
+    void waitForBackgroundLinks();
+
+    PipelineCacheStats stats() const;
+    void printStats(std::ostream& os) const;
+
+private:
+    enum LibraryPart {
+        VertexInputPart,
+        PreRasterizationPart,
+        FragmentShaderPart,
+        FragmentOutputPart,
+        LibraryPartCount
+    };
+
+    using Libraries = std::array<VkPipeline, LibraryPartCount>;
+
+    struct StateHasher {
+        size_t operator()(const PipelineState& state) const { return static_cast<size_t>(state.hash()); }
+    };
+
+    struct Variant {
+        VkPipeline pipeline;
+        double creationMs;
+        Libraries libraries;
+        bool optimized;
+    };
+
+    VkPipeline createPipeline(const PipelineState& state) const;
+    VkShaderModule shaderModule(uint64_t id) const;
+
+    // Graphics pipeline library path
+    static PipelineState libraryKey(const PipelineState& state, LibraryPart part);
+    VkPipeline getLibrary(const PipelineState& state, LibraryPart part);
+    VkPipeline createLibrary(const PipelineState& state, LibraryPart part) const;
+    VkPipeline linkLibraries(const Libraries& libraries, VkPipelineLayout layout, bool optimize) const;
+    void optimizeLoop();
+
+    VkDevice device = VK_NULL_HANDLE;
+    const DeviceDispatch* deviceTable = nullptr;
+    const VkAllocationCallbacks* allocator = nullptr;
+    VkPipelineCache pipelineCache = VK_NULL_HANDLE;
+    bool useLibraries = false;
+
+    mutable std::mutex lock;
+    std::unordered_map<uint64_t, VkShaderModule> shaderModules;
+    std::unordered_map<PipelineState, Variant, StateHasher> variants;
+    std::array<std::unordered_map<PipelineState, VkPipeline, StateHasher>, LibraryPartCount> libraries;
+    PipelineCacheStats counters;
+
+    // Fast links replaced by optimized ones. Command buffers in flight may still use them, so they live until destroy
+    std::vector<VkPipeline> retiredPipelines;
+
+    std::thread optimizeThread;
+    std::condition_variable optimizeSignal;
+    std::condition_variable optimizeDone;
+    std::deque<PipelineState> optimizeQueue;
+    bool optimizing = false;
+    bool stopOptimizing = false;
+};
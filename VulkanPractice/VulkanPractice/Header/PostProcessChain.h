@@ -0,0 +1,175 @@
+//
+//  PostProcessChain.h
+//  VulkanPractice
+//
+
+/**
+ Compute shader post processing of the HDR scene, between the render pass and the upscale.
+ 1. The scene is rendered in sceneFormat, a float format the compute shaders can sample and write as a storage image.
+    record() expects it in GENERAL with the render pass writes visible to compute shaders, and leaves it
+    tone mapped in TRANSFER_SRC_OPTIMAL for the blit onto the swap chain image
+ 2. Luminance histogram: every workgroup counts its pixels into shared memory, and adds only the bins it hit to the
+    global histogram. The exposure pass reduces the histogram to the average luminance with subgroupAdd within subgroups
+    and shared memory across them, and adapts the exposure towards it over time. It clears the histogram on the way
+ 3. Bloom: the scene is downsampled through a mip chain, with a threshold on the first step, then upsampled back with a
+    tent filter that adds every level onto the one above. Tone mapping adds the top level to the scene, applies the
+    exposure and maps it with the ACES curve, in place
+ 4. With halfResolution the histogram reads every other pixel and the bloom chain starts at half the render resolution,
+    a quarter of the intermediate pixels to write and read. Only the rendered part of the scene is processed, so the
+    chain follows the scale of dynamic resolution without reallocating
+ 5. Every stage is timed with timestamps on the queue the chain is recorded for. collect() never waits, like GpuFrameStats.
+    The chain can be recorded for a compute only queue, none of it needs graphics
+ */
+
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "ShaderReflection.h"
+#include "VulkanDispatch.h"
+
+struct PostProcessSettings {
+    // Histogram and bloom chain at half the render resolution
+    bool halfResolution = true;
+    // Levels of the bloom chain, each half the size of the one above. Fewer when the scene is too small for them
+    uint32_t bloomLevels = 5;
+    // Brightness above which pixels bloom, and how much of the bloom is added to the scene
+    float bloomThreshold = 1.0f;
+    float bloomStrength = 0.05f;
+    // log2 of the luminance range the histogram covers, the rest is clamped to its ends
+    float minLogLuminance = -10.0f;
+    float maxLogLuminance = 4.0f;
+    // The adapted average luminance is exposed to this
+    float keyValue = 0.18f;
+    // How fast the exposure follows the scene, per second
+    float adaptationRate = 1.5f;
+};
+
+enum class PostProcessStage : uint32_t {
+    Histogram,
+    Exposure,
+    BloomDownsample,
+    BloomUpsample,
+    ToneMap,
+    Count
+};
+
+class PostProcessChain {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr VkFormat sceneFormat = VK_FORMAT_R16G16B16A16_SFLOAT;
+    // Usage the scene needs on top of being a color attachment
+    static constexpr VkImageUsageFlags sceneUsage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT;
+
+    PostProcessChain() = default;
+    PostProcessChain(const PostProcessChain& obj) = delete;
+
+    PostProcessChain& operator=(const PostProcessChain& obj) = delete;
+
+    ~PostProcessChain() = default;
+
+    // Vulkan 1.1 with subgroup arithmetic in compute shaders, and a scene format that can be blitted from
+    static bool isSupported(VkPhysicalDevice physicalDevice, const InstanceDispatch& instanceTable);
+
+    // timestampValidBits of the queue the chain is recorded for, 0 leaves the timing out
+    void init(VkPhysicalDevice physicalDevice, const InstanceDispatch& instanceTable, VkDevice device, const DeviceDispatch* deviceTable,
+              const VkAllocationCallbacks* allocator, uint32_t timestampValidBits, float timestampPeriod, uint32_t frameSlots,
+              const PostProcessSettings& settings);
+    // The device must be idle
+    void destroy();
+
+    // Recreates the intermediates for a new scene image of sceneExtent. The device must be idle
+    void resize(VkImage sceneImage, VkImageView sceneView, VkExtent2D sceneExtent);
+    // Recreates the intermediates at the other resolution. The device must be idle
+    void setHalfResolution(bool halfResolution);
+
+    // Records every stage for the renderExtent part of the scene
+    void record(VkCommandBuffer commandBuffer, uint32_t frameSlot, VkExtent2D renderExtent);
+
+    // Reads the timestamps of frameSlot without waiting, returns true when a new sample was collected
+    bool collect(uint32_t frameSlot);
+    // GPU time of the whole chain in the last collected frame, 0 before the first one
+    double latestMs() const;
+
+    // Drops the statistics so far
+    void resetStats();
+    // Median time of every stage over the collected frames
+    void printReport(std::ostream& os, const std::string& label) const;
+
+private:
+    static constexpr uint32_t stageCount = static_cast<uint32_t>(PostProcessStage::Count);
+
+    struct Pass {
+        VkDescriptorSetLayout setLayout = VK_NULL_HANDLE;
+        VkPipelineLayout layout = VK_NULL_HANDLE;
+        VkPipeline pipeline = VK_NULL_HANDLE;
+    };
+
+    Pass createPass(const EmbeddedShader& shader) const;
+    void destroyPass(Pass& pass) const;
+    void destroyTargets();
+    void writeDescriptors();
+    void timestamp(VkCommandBuffer commandBuffer, uint32_t frameSlot, uint32_t query, VkPipelineStageFlagBits stage) const;
+    // Makes the writes of the dispatches so far visible to the next ones
+    void computeBarrier(VkCommandBuffer commandBuffer) const;
+    // Size of the bloom level, and the part of it a render extent covers
+    VkExtent2D levelExtent(VkExtent2D extent, uint32_t level) const;
+
+    VkDevice device = VK_NULL_HANDLE;
+    const DeviceDispatch* deviceTable = nullptr;
+    const VkAllocationCallbacks* allocator = nullptr;
+    VkPhysicalDeviceMemoryProperties memoryProperties{};
+    PostProcessSettings settings;
+
+    Pass histogramPass;
+    Pass exposurePass;
+    Pass downsamplePass;
+    Pass upsamplePass;
+    Pass toneMapPass;
+    VkSampler sampler = VK_NULL_HANDLE;
+
+    // The histogram bins and the adapted luminance, cleared by the first record()
+    VkBuffer histogramBuffer = VK_NULL_HANDLE;
+    VkDeviceMemory histogramMemory = VK_NULL_HANDLE;
+    VkBuffer exposureBuffer = VK_NULL_HANDLE;
+    VkDeviceMemory exposureMemory = VK_NULL_HANDLE;
+    bool buffersCleared = false;
+
+    // Recreated by resize()
+    VkImage sceneImage = VK_NULL_HANDLE;
+    VkImageView sceneView = VK_NULL_HANDLE;
+    VkExtent2D sceneExtent{};
+    VkImage bloomImage = VK_NULL_HANDLE;
+    VkDeviceMemory bloomMemory = VK_NULL_HANDLE;
+    // One view per level, every pass reads one level and writes another
+    std::vector<VkImageView> bloomViews;
+    uint32_t bloomLevels = 0;
+    VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+    VkDescriptorSet histogramSet = VK_NULL_HANDLE;
+    VkDescriptorSet exposureSet = VK_NULL_HANDLE;
+    // downsampleSets[i] writes level i, upsampleSets[i] adds level i + 1 onto level i
+    std::vector<VkDescriptorSet> downsampleSets;
+    std::vector<VkDescriptorSet> upsampleSets;
+    VkDescriptorSet toneMapSet = VK_NULL_HANDLE;
+    bool bloomInitialized = false;
+
+    Clock::time_point lastRecord;
+    bool recorded = false;
+
+    uint32_t timestampValidBits = 0;
+    float timestampPeriod = 1.0f;
+    // stageCount + 1 timestamps per frame slot, around and between the stages
+    VkQueryPool timestampPool = VK_NULL_HANDLE;
+    // Frame slots with timestamps that weren't collected yet
+    std::vector<bool> pendingSlots;
+    std::vector<std::array<double, stageCount>> samplesMs;
+    uint64_t droppedFrames = 0;
+};
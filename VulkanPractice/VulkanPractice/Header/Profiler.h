@@ -0,0 +1,155 @@
+//
+//  Profiler.h
+//  VulkanPractice
+//
+
+/**
+ Scoped CPU profiling zones, exported together with the GPU zones of GpuProfiler as a Chrome trace.
+ 1. PROFILE_ZONE("name") times the rest of the scope. The zone is written once, when it ends, into a ring buffer of the
+    calling thread: two clock reads and a few stores, no lock and no allocation. Names must be string literals, or
+    otherwise outlive the profiler
+ 2. Only the owning thread writes to its buffer. It publishes every zone with a release store of its count, so
+    collectZones() can copy the zones from any thread while the owner keeps recording. A zone the owner overwrote
+    during the copy is recognized by the count afterwards and left out: the owner puts a release fence between the
+    count of its previous zone and the stores into the next slot, the reader an acquire fence between the copy and
+    reading the count again, so a reader that saw any store of the next zone also sees the count before it
+ 3. The ring keeps the most recent zones of every thread, so the profiler can stay enabled for a whole run with bounded
+    memory. Disabled, a zone costs a relaxed load and a branch
+ 4. writeChromeTrace() writes the JSON trace event format, which chrome://tracing and ui.perfetto.dev open.
+    Times are steady_clock nanoseconds, GpuProfiler maps its zones onto the same clock
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// A finished zone, in steady_clock nanoseconds
+struct TraceZone {
+    const char* name;
+    int64_t beginNs;
+    int64_t endNs;
+    // Zones open around it on the same thread or command buffer
+    uint32_t depth;
+    // Index of the thread, or of the GPU queue
+    uint32_t thread;
+};
+
+class Profiler {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // Zones kept per thread, older ones are overwritten
+    static constexpr uint32_t threadCapacity = 1u << 16;
+
+    class ThreadBuffer {
+    public:
+        ThreadBuffer(uint32_t index, std::string name) : index(index), name(std::move(name)), slots(new Slot[threadCapacity]) {}
+
+        void begin() { depth++; }
+
+        void end(const char* zoneName, int64_t beginNs, int64_t endNs) {
+            depth--;
+            // Only this thread writes count, a relaxed load sees its own last store
+            const uint64_t position = count.load(std::memory_order_relaxed);
+            Slot& slot = slots[position & (threadCapacity - 1)];
+            // Orders the count of the previous zone before the slot stores, on weakly ordered CPUs too. Pairs with the
+            // acquire fence in collectZones()
+            std::atomic_thread_fence(std::memory_order_release);
+            slot.name.store(zoneName, std::memory_order_relaxed);
+            slot.beginNs.store(beginNs, std::memory_order_relaxed);
+            slot.endNs.store(endNs, std::memory_order_relaxed);
+            slot.depth.store(depth, std::memory_order_relaxed);
+            count.store(position + 1, std::memory_order_release);
+        }
+
+    private:
+        friend class Profiler;
+
+        // Relaxed atomics rather than plain fields, a reader may copy a slot while it is overwritten
+        struct Slot {
+            std::atomic<const char*> name{nullptr};
+            std::atomic<int64_t> beginNs{0};
+            std::atomic<int64_t> endNs{0};
+            std::atomic<uint32_t> depth{0};
+        };
+
+        const uint32_t index;
+        std::string name;
+        std::unique_ptr<Slot[]> slots;
+        std::atomic<uint64_t> count{0};
+        uint32_t depth = 0;
+    };
+
+    static void setEnabled(bool enabled) { enabledFlag.store(enabled, std::memory_order_relaxed); }
+    static bool enabled() { return enabledFlag.load(std::memory_order_relaxed); }
+
+    static int64_t now() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+    }
+
+    // The buffer of the calling thread, registered on first use
+    static ThreadBuffer* currentThread() {
+        if (current == nullptr) {
+            current = registerThread();
+        }
+        return current;
+    }
+    // Names the calling thread in the trace
+    static void setThreadName(const std::string& name);
+
+    // Copies the zones still in the buffers of every thread, while they keep recording
+    static std::vector<TraceZone> collectZones();
+    // gpuQueueNames names the track of every GPU queue, indexed by the thread of its zones. Needs at least one
+    static void writeChromeTrace(std::ostream& os, const std::vector<TraceZone>& cpuZones, const std::vector<TraceZone>& gpuZones,
+                                 const std::vector<std::string>& gpuQueueNames);
+    // Count, mean and max of every zone name
+    static void printReport(std::ostream& os, const std::vector<TraceZone>& zones, const std::string& label);
+
+private:
+    static ThreadBuffer* registerThread();
+
+    static std::atomic<bool> enabledFlag;
+    // Buffers are owned here rather than by their threads, so the zones of finished threads can still be exported
+    static std::mutex threadsMutex;
+    static std::vector<std::unique_ptr<ThreadBuffer>> threads;
+    static thread_local ThreadBuffer* current;
+};
+
+// RAII zone, use PROFILE_ZONE
+class ProfileZone {
+public:
+    explicit ProfileZone(const char* name) : name(name) {
+        if (Profiler::enabled()) {
+            buffer = Profiler::currentThread();
+            buffer->begin();
+            beginNs = Profiler::now();
+        }
+    }
+
+    ProfileZone(const ProfileZone& obj) = delete;
+
+    ProfileZone& operator=(const ProfileZone& obj) = delete;
+
+    ~ProfileZone() {
+        if (buffer != nullptr) {
+            buffer->end(name, beginNs, Profiler::now());
+        }
+    }
+
+private:
+    const char* name;
+    Profiler::ThreadBuffer* buffer = nullptr;
+    int64_t beginNs = 0;
+};
+
+#define PROFILE_ZONE_CONCAT_INNER(a, b) a##b
+#define PROFILE_ZONE_CONCAT(a, b) PROFILE_ZONE_CONCAT_INNER(a, b)
+// Times the rest of the enclosing scope
+#define PROFILE_ZONE(name) ProfileZone PROFILE_ZONE_CONCAT(profileZone, __LINE__)(name)
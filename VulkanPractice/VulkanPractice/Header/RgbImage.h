@@ -0,0 +1,43 @@
+//
+//  RgbImage.h
+//  VulkanPractice
+//
+
+/**
+ Tightly packed 8 bit RGB image, used for captured frames and golden images.
+ 1. PPM (binary P6) can be written and read, PNG can be written. PNG is stored without compression,
+    which keeps the writer free of dependencies and fast, the files are about as big as the PPM
+ 2. compare() checks every channel of every pixel against a per-channel tolerance
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct ImageComparison {
+    bool sizeMatches = false;
+    uint64_t mismatchedPixels = 0;
+    std::array<uint8_t, 3> maxDifference{};
+
+    bool passed() const { return sizeMatches && mismatchedPixels == 0; }
+};
+
+struct RgbImage {
+    uint32_t width = 0;
+    uint32_t height = 0;
+    std::vector<uint8_t> pixels;
+
+    // Drops the alpha channel of 8 bit RGBA or BGRA pixels, rows are rowPitch bytes apart
+    static RgbImage fromRgba(const uint8_t* data, uint32_t width, uint32_t height, size_t rowPitch, bool bgra);
+    static RgbImage readPpm(const std::string& path);
+
+    void writePpm(const std::string& path) const;
+    void writePng(const std::string& path) const;
+    // Picks the format from the extension, .png or .ppm
+    void write(const std::string& path) const;
+
+    ImageComparison compare(const RgbImage& golden, const std::array<uint8_t, 3>& tolerance) const;
+};
@@ -0,0 +1,67 @@
+//
+//  ShaderReflection.h
+//  VulkanPractice
+//
+
+/**
+ Shaders compiled into the binary by shaders/build_shaders.py, together with what it reflected from their SPIR-V.
+ 1. Generated/EmbeddedShaders.h defines one constexpr EmbeddedShader per shader source, e.g. shaders::spriteFrag
+    for sprite.frag. The SPIR-V words are constant data in the executable, nothing is read from disk
+ 2. The reflection lists the descriptor bindings the optimized shader still uses, its push constant size and
+    the workgroup size of compute shaders. Everything is constexpr, so the C++ structs written to the shaders can be
+    checked against it with static_assert and a shader change that breaks them fails the build
+ 3. descriptorSetLayoutBindings() and pushConstantRange() build the layouts of a set of shaders from the reflection,
+    merging the stages of bindings and push constants the shaders share
+ */
+
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <vector>
+
+struct ReflectedBinding {
+    uint32_t set;
+    uint32_t binding;
+    VkDescriptorType descriptorType;
+    // Array size, 0 for runtime sized arrays
+    uint32_t descriptorCount;
+    // Bytes in the block of uniform and storage buffers, a runtime sized array at the end counts as empty. 0 for the rest
+    uint32_t blockSize;
+};
+
+struct EmbeddedShader {
+    const char* sourceName;
+    const uint32_t* code;
+    // In bytes, as VkShaderModuleCreateInfo wants it
+    size_t codeSize;
+    VkShaderStageFlagBits stage;
+
+    const ReflectedBinding* bindings;
+    uint32_t bindingCount;
+    uint32_t pushConstantSize;
+    // Workgroup size of compute shaders, 0 for the other stages
+    uint32_t localSize[3];
+
+    constexpr const ReflectedBinding* findBinding(uint32_t set, uint32_t binding) const {
+        for (uint32_t i = 0; i < bindingCount; i++) {
+            if (bindings[i].set == set && bindings[i].binding == binding) return &bindings[i];
+        }
+        return nullptr;
+    }
+
+    // Whether the binding is a buffer of the given type whose block is blockSize bytes
+    constexpr bool hasBuffer(uint32_t set, uint32_t binding, VkDescriptorType descriptorType, uint32_t blockSize) const {
+        const ReflectedBinding* found = findBinding(set, binding);
+        return found != nullptr && found->descriptorType == descriptorType && found->blockSize == blockSize;
+    }
+};
+
+// Bindings of one set over all the shaders, throws when two shaders disagree about a binding
+std::vector<VkDescriptorSetLayoutBinding> descriptorSetLayoutBindings(uint32_t set, std::initializer_list<const EmbeddedShader*> shaders);
+
+// A single range from 0 to the largest push constant block, for every stage which has one. Size 0 when none has
+VkPushConstantRange pushConstantRange(std::initializer_list<const EmbeddedShader*> shaders);
@@ -0,0 +1,138 @@
+//
+//  SpriteBatcher.h
+//  VulkanPractice
+//
+
+/**
+ Draws large numbers of textured 2D quads with as few draw calls as possible.
+ 1. Every frame slot owns a region of one persistently mapped vertex buffer. end() writes four vertices per sprite
+    straight into the region of the current slot, nothing is staged or copied in between
+ 2. The index buffer is static and shared: quad i uses the vertices 4i..4i+3, so every run of quads is a single
+    vkCmdDrawIndexed with the first index of the run
+ 3. Consecutive sprites with the same texture and blend mode form one run. SpriteSortMode::ByState sorts the sprites
+    by blend mode and texture first (stable, so submission order is kept within a run), which brings the draws down
+    to one per used combination. Only use it when the sprites don't overlap or their order doesn't matter
+ 4. Pipelines come from PipelineManager, one variant per blend mode. Textures are bound with one descriptor set each
+ 5. Positions are in pixels with the origin at the top left of the render target
+ */
+
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+#include "PipelineManager.h"
+#include "VulkanDispatch.h"
+
+using TextureId = uint32_t;
+
+struct Sprite {
+    float x = 0.0f;
+    float y = 0.0f;
+    float width = 0.0f;
+    float height = 0.0f;
+    // Texture coordinates of the top left and bottom right corner
+    float u0 = 0.0f, v0 = 0.0f, u1 = 1.0f, v1 = 1.0f;
+    // RGBA8 with R in the lowest byte, multiplied with the texture
+    uint32_t color = 0xFFFFFFFF;
+    TextureId texture = 0;
+    BlendMode blendMode = BlendMode::AlphaBlend;
+};
+
+enum class SpriteSortMode {
+    Submission,     // draw in the order of draw(), only consecutive sprites are batched
+    ByState         // group by blend mode and texture first
+};
+
+struct SpriteBatchStats {
+    uint64_t sprites = 0;
+    // Sprites beyond maxSprites are not drawn
+    uint64_t droppedSprites = 0;
+    uint64_t draws = 0;
+    uint64_t pipelineBinds = 0;
+    uint64_t textureBinds = 0;
+    // From begin() to the end of end(), sorting and writing the vertices included
+    double cpuMs = 0.0;
+};
+
+class SpriteBatcher {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    SpriteBatcher() = default;
+    SpriteBatcher(const SpriteBatcher& obj) = delete;
+
+    SpriteBatcher& operator=(const SpriteBatcher& obj) = delete;
+
+    ~SpriteBatcher() = default;
+
+    // queue and commandPool are only used to upload the index buffer and textures.
+    // The shaders are ids of PipelineManager::addShader
+    void init(VkPhysicalDevice physicalDevice, const InstanceDispatch& instanceTable, VkDevice device, const DeviceDispatch* deviceTable,
+              const VkAllocationCallbacks* allocator, VkQueue queue, VkCommandPool commandPool, PipelineManager* pipelineManager,
+              VkRenderPass renderPass, VkFormat colorFormat, uint64_t vertexShader, uint64_t fragmentShader,
+              uint32_t maxSprites, uint32_t frameSlots);
+    // The device must be idle
+    void destroy();
+
+    // RGBA8 pixels, tightly packed. Waits for the upload to finish
+    TextureId addTexture(uint32_t width, uint32_t height, const uint8_t* pixels);
+
+    void begin(uint32_t frameSlot, VkExtent2D targetExtent, SpriteSortMode sortMode);
+    void draw(const Sprite& sprite);
+    // Writes the vertices and records the draws, must be called inside the render pass
+    void end(VkCommandBuffer commandBuffer);
+
+    const SpriteBatchStats& stats() const { return frameStats; }
+
+private:
+    struct Vertex {
+        float position[2];
+        float uv[2];
+        uint32_t color;
+    };
+
+    struct Texture {
+        VkImage image = VK_NULL_HANDLE;
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        VkImageView view = VK_NULL_HANDLE;
+        VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+    };
+
+    void createIndexBuffer();
+    void createDescriptors();
+
+    VkDevice device = VK_NULL_HANDLE;
+    const DeviceDispatch* deviceTable = nullptr;
+    const VkAllocationCallbacks* allocator = nullptr;
+    VkQueue queue = VK_NULL_HANDLE;
+    VkCommandPool commandPool = VK_NULL_HANDLE;
+    PipelineManager* pipelineManager = nullptr;
+    VkPhysicalDeviceMemoryProperties memoryProperties{};
+
+    uint32_t maxSprites = 0;
+    PipelineState pipelineState;
+
+    VkBuffer indexBuffer = VK_NULL_HANDLE;
+    VkDeviceMemory indexMemory = VK_NULL_HANDLE;
+    VkBuffer vertexBuffer = VK_NULL_HANDLE;
+    VkDeviceMemory vertexMemory = VK_NULL_HANDLE;
+    Vertex* mappedVertices = nullptr;
+
+    VkDescriptorSetLayout descriptorSetLayout = VK_NULL_HANDLE;
+    VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+    VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+    VkSampler sampler = VK_NULL_HANDLE;
+    std::vector<Texture> textures;
+
+    // Current frame
+    uint32_t frameSlot = 0;
+    VkExtent2D targetExtent{};
+    SpriteSortMode sortMode = SpriteSortMode::Submission;
+    std::vector<Sprite> sprites;
+    Clock::time_point frameStart;
+    SpriteBatchStats frameStats;
+};
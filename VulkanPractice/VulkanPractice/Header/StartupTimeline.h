@@ -0,0 +1,58 @@
+//
+//  StartupTimeline.h
+//  VulkanPractice
+//
+
+/**
+ Records when every init step started and how long it took, relative to the start of the application,
+ and on which thread it ran. Time to first frame is the time until the first image was handed to vkQueuePresentKHR.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <mutex>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+class StartupTimeline {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // Sets time zero, the calling thread is treated as the main thread
+    void begin();
+
+    template <typename F>
+    void step(const char* name, F&& function) {
+        auto start = Clock::now();
+        function();
+        record(name, start, Clock::now());
+    }
+
+    void record(const char* name, Clock::time_point start, Clock::time_point end);
+
+    // Returns true only for the first call
+    bool markFirstFrame();
+    std::optional<double> timeToFirstFrameMs() const;
+
+    void print(std::ostream& os) const;
+
+private:
+    struct Step {
+        std::string name;
+        double startMs;
+        double durationMs;
+        bool mainThread;
+    };
+
+    double millisecondsSinceBegin(Clock::time_point time) const;
+
+    mutable std::mutex lock;
+    std::vector<Step> steps;
+    Clock::time_point origin = Clock::now();
+    std::thread::id mainThreadId;
+    std::optional<double> firstFrameMs;
+};
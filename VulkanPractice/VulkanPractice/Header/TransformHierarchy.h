@@ -0,0 +1,101 @@
+//
+//  TransformHierarchy.h
+//  VulkanPractice
+//
+
+/**
+ Parent child transforms for scenes with hundreds of thousands of moving nodes, without a heap object per node.
+ 1. Nodes are handles into structure of arrays storage: parent, local position, rotation and scale, world matrix, a dirty flag
+    and the number of the update that last recomputed the world matrix. The arrays are sorted by depth, level after level, and within a level children of the same parent are next to each other
+ 2. Added nodes go to the end of the arrays and the next update() sorts them in with a breadth first walk, so building
+    the hierarchy is linear and handles stay valid. Parents are added before their children, so there are no cycles
+ 3. setLocal() only marks the node dirty. update() walks the levels in order, a node is recomputed when it is dirty or its
+    parent was recomputed by the same update, so a change reaches the whole subtree below it, parents first. The workers
+    clear the flags and count the recomputed nodes as they go, nothing walks all the nodes on one thread
+ 4. A level only reads the level above it, so each level is split across the threads of a WorkerPool, with one wait per level.
+    The world matrix is parent world times local, multiplied with SSE2 or NEON four floats at a time
+ */
+
+#pragma once
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <cstdint>
+#include <vector>
+
+#include "WorkerPool.h"
+
+using NodeId = uint32_t;
+
+const NodeId NO_PARENT_NODE = UINT32_MAX;
+
+struct Transform {
+    glm::vec3 position{0.0f};
+    glm::quat rotation{1.0f, 0.0f, 0.0f, 0.0f};
+    glm::vec3 scale{1.0f};
+};
+
+struct TransformUpdateStats {
+    uint64_t nodes = 0;
+    // Nodes whose world matrix was recomputed, changed ones and everything below them
+    uint64_t updated = 0;
+    uint32_t levels = 0;
+    double ms = 0.0;
+};
+
+class TransformHierarchy {
+public:
+    TransformHierarchy() = default;
+    TransformHierarchy(const TransformHierarchy& obj) = delete;
+
+    TransformHierarchy& operator=(const TransformHierarchy& obj) = delete;
+
+    ~TransformHierarchy();
+
+    // threadCount counts the calling thread, 0 uses every hardware thread
+    void init(uint32_t threadCount = 0);
+    void destroy();
+
+    NodeId addNode(const Transform& local, NodeId parent = NO_PARENT_NODE);
+    void setLocal(NodeId node, const Transform& local);
+    Transform local(NodeId node) const;
+    // As of the last update()
+    const glm::mat4& world(NodeId node) const { return worlds[slotOfNode[node]]; }
+
+    void update();
+
+    size_t nodeCount() const { return slotOfNode.size(); }
+    const TransformUpdateStats& stats() const { return updateStats; }
+
+private:
+    // Sorts the arrays by depth again after nodes were added
+    void rebuildLayout();
+    // Returns how many nodes were recomputed
+    size_t updateRange(size_t begin, size_t end);
+
+    // Indexed by slot, the position in the depth sorted arrays
+    std::vector<uint32_t> parentSlots;
+    std::vector<glm::vec3> positions;
+    std::vector<glm::quat> rotations;
+    std::vector<glm::vec3> scales;
+    std::vector<glm::mat4> worlds;
+    std::vector<uint8_t> dirty;
+    std::vector<uint32_t> updatedIn;
+
+    // Level i is [levelStarts[i], levelStarts[i + 1])
+    std::vector<size_t> levelStarts = {0};
+    std::vector<uint32_t> slotOfNode;
+    std::vector<NodeId> nodeOfSlot;
+    bool layoutDirty = false;
+
+    // Recomputed nodes per worker thread, on cache lines of their own
+    struct alignas(64) ThreadCount {
+        uint64_t updated = 0;
+    };
+
+    uint32_t updateNumber = 0;
+    std::vector<ThreadCount> threadUpdated;
+    TransformUpdateStats updateStats;
+    WorkerPool workerPool;
+};
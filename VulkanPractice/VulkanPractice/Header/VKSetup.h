@@ -50,13 +50,51 @@
 
 #include <vulkan/vulkan.h>
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <functional>
 #include <iostream>
+#include <memory>
 #include <vector>
 #include <optional>
+#include <string>
+
+#include "Camera.h"
+#include "CameraUniformBuffer.h"
+#include "DynamicResolution.h"
+#include "FramePacer.h"
+#include "FrameReadback.h"
+#include "FrameStreamer.h"
+#include "FrustumCuller.h"
+#include "GpuFrameStats.h"
+#include "GpuMesh.h"
+#include "GpuProfiler.h"
+#include "HostAllocator.h"
+#include "LatencyTracker.h"
+#include "Mesh.h"
+#include "MeshOptimizer.h"
+#include "MeshRenderer.h"
+#include "MemoryBudget.h"
+#include "MeshSimplifier.h"
+#include "MultiviewRenderer.h"
+#include "PipelineManager.h"
+#include "PostProcessChain.h"
+#include "Profiler.h"
+#include "RgbImage.h"
+#include "SpriteBatcher.h"
+#include "StartupTimeline.h"
+#include "TransformHierarchy.h"
+#include "ValidationLogger.h"
+#include "VulkanDispatch.h"
+#include "WindowView.h"
 
 const uint32_t WIDTH = 800;
 const uint32_t HEIGHT = 600;
 
+// Route driver host allocations through HostAllocator instead of the system heap
+const bool trackHostAllocations = true;
+
 #ifdef NDEBUG
 const bool enableValidationLayers = false;
 #else
@@ -67,6 +105,10 @@ const std::vector<const char*> validationLayers = {
     "VK_LAYER_KHRONOS_validation"
 };
 
+// messageIdNumber of validation messages that are known and should not be logged
+const std::vector<int32_t> mutedValidationMessageIds = {
+};
+
 const std::vector<const char*> deviceExtensions = {
     VK_KHR_SWAPCHAIN_EXTENSION_NAME,
 #ifndef WIN
@@ -77,6 +119,8 @@ const std::vector<const char*> deviceExtensions = {
 struct QueueFamilyIndices {
     std::optional<uint32_t> graphicsFamily;
     std::optional<uint32_t> presentFamily;
+    // A family with compute but without graphics, for async compute. Optional
+    std::optional<uint32_t> computeFamily;
     
     bool isComplete() {
         return graphicsFamily.has_value() && presentFamily.has_value();
@@ -91,6 +135,90 @@ struct SwapChainSupportDetails {
 
 const int MAX_FRAMES_IN_FLIGHT = 2;
 
+// Overlap shader loading and pipeline creation with swap chain creation during initVulkan
+const bool parallelStartup = true;
+
+// Build pipeline variants from separately compiled parts with VK_EXT_graphics_pipeline_library, when the device supports it
+const bool useGraphicsPipelineLibrary = true;
+
+// Time every frame on the GPU and count primitives, shader invocations and passing samples, see GpuFrameStats.h
+const bool collectGpuFrameStats = true;
+
+// Render into an offscreen target whose resolution follows the GPU frame time and upscale it to the window, see DynamicResolution.h.
+// The scale stays within these bounds, and aims at the frame rate limit when there is one or at dynamicResolutionFrameRate.
+// Devices that can't blit into the swap chain render straight into it instead
+const bool enableDynamicResolution = true;
+const float minRenderScale = 0.5f;
+const float maxRenderScale = 1.0f;
+const double dynamicResolutionFrameRate = 60.0;
+
+// Render the scene in a float format and tone map it with auto exposure and bloom in compute shaders, see PostProcessChain.h.
+// Needs dynamic resolution and subgroup arithmetic in Vulkan 1.1, without them the scene is rendered straight in the swap chain format.
+// With useAsyncCompute the chain is submitted to a compute only queue family when the device has one
+const bool enablePostProcessing = true;
+const bool useAsyncCompute = true;
+const bool postProcessHalfResolution = true;
+
+// Record CPU and GPU profiling zones, see Profiler.h and GpuProfiler.h. Cheap enough to stay on, setTracePath() exports them
+const bool enableProfiler = true;
+const uint32_t gpuZonesPerFrame = 16;
+
+// Track the device memory budget and usage of every heap, and call the eviction callbacks when a heap gets close to
+// its budget, see MemoryBudget.h. Uses VK_EXT_memory_budget when the device has it
+const bool trackMemoryBudget = true;
+const float memoryBudgetHighWatermark = 0.9f;
+const float memoryBudgetLowWatermark = 0.8f;
+
+// The views of setMultiviewCount() are rendered in one VK_KHR_multiview render pass when the device supports it,
+// otherwise in a render pass each, see MultiviewRenderer.h. Their cameras sit side by side along the camera's right axis,
+// the outer two this far apart
+const bool useMultiview = true;
+const float multiviewEyeSeparation = 0.065f;
+
+// Write the camera uniforms again right before vkQueueSubmit, with input sampled after the frame was recorded
+const bool defaultLateLatchCamera = true;
+
+// Measure the time from sampling the camera input to the GPU finishing the frame, see LatencyTracker.h
+const bool measureInputLatency = true;
+
+// Camera movement, in units per second and radians per pixel of mouse movement
+const float cameraMoveSpeed = 1.5f;
+const float cameraLookSensitivity = 0.003f;
+
+// How mainLoop paces frames by default, see FramePacer.h. Can be changed with setFramePacing
+const FramePacingMode defaultFramePacingMode = FramePacingMode::Unlimited;
+const double defaultTargetFrameRate = 60.0;
+// Frame rate while the window doesn't have focus, 0 disables the throttling
+const double backgroundFrameRate = 10.0;
+
+// Readback buffers for captured frames. A copy is collected MAX_FRAMES_IN_FLIGHT frames after it was recorded,
+// one more buffer leaves room for the consumer thread to still be writing the previous one
+const uint32_t readbackBufferCount = MAX_FRAMES_IN_FLIGHT + 1;
+
+// Readback buffers while streaming, one per frame in flight
+const uint32_t streamBufferCount = MAX_FRAMES_IN_FLIGHT;
+
+enum class StreamBackpressure {
+    Block,      // hold the render loop back until the writer catches up
+    Drop        // keep rendering and leave frames out of the stream
+};
+
+struct StreamSettings {
+    // File or named pipe, "-" for stdout
+    std::string path;
+    StreamBackpressure backpressure = StreamBackpressure::Block;
+};
+
+struct CaptureSettings {
+    // Frame that gets captured, counted from the first frame drawn
+    uint64_t frame = 10;
+    // Written as PNG or PPM depending on the extension, nothing is written when empty
+    std::string outputPath;
+    // PPM the capture is compared against, no comparison when empty
+    std::string goldenPath;
+    std::array<uint8_t, 3> tolerance = {2, 2, 2};
+};
+
 class HelloTriangleApplication {
 public:
     HelloTriangleApplication() = default;
@@ -102,6 +230,36 @@ public:
     
     void run();
     
+    // Must be called before run()
+    void setFramePacing(FramePacingMode mode, double targetFrameRate);
+    
+    // Must be called before run(). run() then closes the window once the frame is captured,
+    // and throws when it doesn't match the golden image
+    void setCapture(const CaptureSettings& settings);
+    
+    // Must be called before run(). Streams every frame as raw pixels, can't be combined with setCapture
+    void setStream(const StreamSettings& settings);
+    
+    // Must be called before runBenchmark(). OBJ or GLB model the mesh benchmarks use instead of a generated one
+    void setModelPath(const std::string& path);
+    
+    // Must be called before run() or runBenchmark(). Writes the profiling zones as a Chrome trace at the end
+    void setTracePath(const std::string& path);
+    
+    // Must be called before run() or runBenchmark(). Caps the budget of the device local heaps, e.g. to exercise eviction
+    // on software ICDs. 0 keeps the real budget
+    void setSimulatedMemoryBudget(VkDeviceSize bytes);
+    
+    // Must be called before run() or runBenchmark(). Opens count - 1 view windows next to the main window, see WindowView.h
+    void setWindowCount(uint32_t count);
+    
+    // Must be called before run() or runBenchmark(). Renders the main window's scene from count cameras into the layers of
+    // one image and shows them side by side, e.g. 2 for stereo. 1 renders it directly
+    void setMultiviewCount(uint32_t count);
+    
+    // Initializes Vulkan, runs a single benchmark instead of the main loop and cleans up
+    void runBenchmark(const std::string& name);
+    
 private:
     void initWindow();
     void initVulkan();
@@ -116,20 +274,73 @@ private:
     void createLogicalDevice();
     void createSwapChain();
     void createImageViews();
+    void createDepthResources();
     void createRenderPass();
     void createGraphicsPipeline();
     void createFramebuffers();
     void createCommandPool();
     void createCommandBuffer();
     void createSyncObjects();
+    void createGpuFrameStats();
+    void createDynamicResolution();
+    void createPostProcessChain();
+    void createGpuProfiler();
+    void createCameraUniforms();
+    void createWindowViews();
+    void createMultiview();
 
     void cleanupSwapChain();
     void recreateSwapChain();
     
     // drawing
     void recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex);
+    // Upscale and readback copies into the swap chain image, after the scene and its post processing
+    void recordPresentation(VkCommandBuffer commandBuffer, uint32_t imageIndex);
+    // With a compute queue: the post processing and the presentation of the frame in command buffers of their own
+    void recordAsyncCommandBuffers(uint32_t imageIndex);
+    // The scene from the camera of every view that acquired an image, into the command buffer that waits for the images
+    void recordViews(VkCommandBuffer commandBuffer);
     void drawFrame();
     
+    // Camera
+    // Moves the camera with the keyboard and mouse state since the last call and writes it into the uniforms of the frame
+    void updateCamera(uint32_t frame);
+    // The main camera has the first MAX_FRAMES_IN_FLIGHT uniform slots, every view the next ones
+    uint32_t viewCameraSlot(size_t view, uint32_t frame) const { return static_cast<uint32_t>(view + 1) * MAX_FRAMES_IN_FLIGHT + frame; }
+    // Every multiview layer gets an equal share of the window's width
+    VkExtent2D multiviewLayerExtent() const { return {std::max(1u, swapChainExtent.width / multiviewCount), swapChainExtent.height}; }
+    
+    // Collects the zones of the last frames and writes the trace, when there is a trace path. The device must be idle
+    void writeTrace();
+    
+    // Frame capture
+    void createFrameReadback();
+    void consumeCapture(const ReadbackImage& image);
+    void reportCapture();
+    
+    // Benchmarks
+    void benchmarkDispatch();
+    void benchmarkStartup();
+    void benchmarkPipelines();
+    void benchmarkSpecialization();
+    void benchmarkSprites();
+    void benchmarkMeshes();
+    void benchmarkQuantization();
+    void benchmarkLods();
+    void benchmarkCulling();
+    void benchmarkTransforms();
+    void benchmarkLatency();
+    void benchmarkResolution();
+    void benchmarkPostProcess();
+    void benchmarkProfiler();
+    void benchmarkMemoryBudget();
+    void benchmarkMultiview();
+    
+    // OBJ or GLB of setModelPath(), or a generated grid written to the temp directory
+    std::string benchmarkModelPath() const;
+    // Draws frames with benchmarkDraws and returns the median GPU time, 0 when GPU times aren't available
+    double measureGpuFrames(int warmupFrames, int frames);
+    
     // Helper functions start
     
     // Vulkan Instance creation
@@ -140,24 +351,11 @@ private:
     bool checkValidationLayerSupport();
     void populateDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT& createInfo);
     
-    static VKAPI_ATTR VkBool32 VKAPI_CALL debugCallback(
-                                                        VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity,
-                                                        VkDebugUtilsMessageTypeFlagsEXT messageType,
-                                                        const VkDebugUtilsMessengerCallbackDataEXT* pCallbackData,
-                                                        void* pUserData) {
-        
-        if (messageSeverity >= VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT) {
-            // Message is important enough to show
-            std::cerr << "validation layer: " << pCallbackData->pMessage << std::endl;
-        }
-        
-        return VK_FALSE;
-    }
-    
     // Logical and Physical Device
     QueueFamilyIndices findQueueFamilies(VkPhysicalDevice device);
     bool isDeviceSuitable(VkPhysicalDevice device);
     bool checkDeviceExtensionSupport(VkPhysicalDevice device);
+    bool checkOptionalDeviceExtensionSupport(VkPhysicalDevice device, const char* extensionName);
     
     // Swap chain
     SwapChainSupportDetails querySwapChainSupport(VkPhysicalDevice device);
@@ -165,40 +363,77 @@ private:
     VkPresentModeKHR chooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes);
     VkExtent2D chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities);
     
+    // Depth buffer
+    VkFormat findDepthFormat();
+    
     // Misc
-    static std::vector<char> readFile(const std::string& filename);
     
-    // Graphics pipeline
-    VkShaderModule createShaderModule(const std::vector<char>& code);
-
     // Callback function : Resize window
     static void framebufferResizeCallback(GLFWwindow* window, int width, int height);
     
+    // Callback functions : Window state and input, used to pace frames
+    static void windowFocusCallback(GLFWwindow* window, int focused);
+    static void windowIconifyCallback(GLFWwindow* window, int iconified);
+    static void windowRefreshCallback(GLFWwindow* window);
+    static void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods);
+    static void cursorPosCallback(GLFWwindow* window, double x, double y);
+    static void mouseButtonCallback(GLFWwindow* window, int button, int action, int mods);
+    static void scrollCallback(GLFWwindow* window, double x, double y);
+    
     // Helper functions end
     
 private:
+    StartupTimeline startupTimeline;
+    FramePacer framePacer;
+    FramePacingMode framePacingMode = defaultFramePacingMode;
+    double targetFrameRate = defaultTargetFrameRate;
+    HostAllocator hostAllocator;
+    const VkAllocationCallbacks* allocator = trackHostAllocations ? hostAllocator.callbacks() : nullptr;
+    
     GLFWwindow* window;
     
     VkInstance instance;
+    InstanceDispatch instanceTable;
     VkDebugUtilsMessengerEXT debugMessenger;
+    ValidationLogger validationLogger;
     VkSurfaceKHR surface;
     VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+    VkPhysicalDeviceMemoryProperties memoryProperties{};
+    // Found once in createLogicalDevice, the queue families don't change afterwards
+    QueueFamilyIndices queueFamilies;
     VkDevice device;
+    DeviceDispatch deviceTable;
+    bool graphicsPipelineLibrarySupported = false;
+    bool calibratedTimestampsSupported = false;
+    bool memoryBudgetSupported = false;
+    GpuQuerySupport gpuQuerySupport;
     VkQueue graphicsQueue;
     VkQueue presentQueue;
+    // Only with async compute post processing
+    VkQueue computeQueue = VK_NULL_HANDLE;
+    uint32_t computeTimestampValidBits = 0;
     
     VkSwapchainKHR swapChain;
     std::vector<VkImage> swapChainImages;
     VkFormat swapChainImageFormat;
     VkExtent2D swapChainExtent;
+    // What the render pass renders in, the swap chain format or the float format of post processing
+    VkFormat sceneColorFormat;
 
     uint32_t currentFrame = 0;
     
     std::vector<VkImageView> swapChainImageViews;
     
+    // Recreated with the swap chain. With dynamic resolution it has the size of the offscreen target
+    VkFormat depthFormat;
+    VkImage depthImage;
+    VkDeviceMemory depthImageMemory;
+    VkImageView depthImageView;
+    
     VkRenderPass renderPass;
     VkPipelineLayout pipelineLayout;
-    VkPipeline graphicsPipeline;
+    PipelineManager pipelineManager;
+    PipelineState trianglePipelineState;
     
     std::vector<VkFramebuffer> swapChainFramebuffers;
     
@@ -208,8 +443,75 @@ private:
     std::vector<VkSemaphore> imageAvailableSemaphores;
     std::vector<VkSemaphore> renderFinishedSemaphores;
     std::vector<VkFence> inFlightFences;
+    
+    // Async compute: the scene, its post processing and the presentation are three submits, chained by the semaphores
+    VkCommandPool computeCommandPool = VK_NULL_HANDLE;
+    std::vector<VkCommandBuffer> computeCommandBuffers;
+    std::vector<VkCommandBuffer> presentCommandBuffers;
+    std::vector<VkSemaphore> sceneFinishedSemaphores;
+    std::vector<VkSemaphore> postFinishedSemaphores;
 
     bool framebufferResized = false;
     
+    // Additional windows, closed views stay in place uninitialized so the camera slots of the others don't move
+    uint32_t windowCount = 1;
+    std::vector<std::unique_ptr<WindowView>> views;
+    
+    // Layers of the main window's scene, composited by the render pass
+    uint32_t multiviewCount = 1;
+    bool multiviewSupported = false;
+    MultiviewRenderer multiview;
+    // The triangle of shader.vert as a mesh, what the layers show outside of the benchmark
+    GpuMesh multiviewTriangle;
+    
+    // Counts the frames recorded so far
+    uint64_t frameNumber = 0;
+    
+    std::optional<CaptureSettings> capture;
+    FrameReadback frameReadback;
+    bool captureRecorded = false;
+    // Written by the readback consumer thread, read once it is done
+    std::atomic<bool> captureDone{false};
+    std::optional<ImageComparison> goldenComparison;
+    std::string captureError;
+    
+    std::optional<StreamSettings> stream;
+    FrameStreamer frameStreamer;
+    
+    GpuFrameStats gpuFrameStats;
+    
+    DynamicResolution dynamicResolution;
+    // Swap chain extent, or the part of the offscreen target the current scale renders to
+    VkExtent2D renderExtent;
+    
+    // enableDynamicResolution, unless the device can't blit into the swap chain
+    bool dynamicResolutionEnabled = false;
+    bool postProcessingEnabled = false;
+    PostProcessChain postProcess;
+    
+    GpuProfiler gpuProfiler;
+    // Post processing on the async compute queue, a track of its own in the trace
+    GpuProfiler computeProfiler;
+    std::string tracePath;
+    
+    MemoryBudget memoryBudget;
+    VkDeviceSize simulatedMemoryBudget = 0;
+    
+    Camera camera;
+    CameraUniformBuffer cameraUniforms;
+    bool lateLatchCamera = defaultLateLatchCamera;
+    // When updateCamera() last sampled the input
+    LatencyTracker::Clock::time_point cameraInputTime;
+    double lastCursorX = 0.0;
+    double lastCursorY = 0.0;
+    bool looking = false;
+    LatencyTracker latencyTracker;
+    
+    // Benchmarks replace the triangle with their own draws
+    std::function<void(VkCommandBuffer)> benchmarkDraws;
+    // And the scene of the multiview layers
+    MultiviewRenderer::SceneCallback benchmarkMultiviewDraws;
+    std::string modelPath;
+    
     float queuePriority = 1.0f;
 };
@@ -0,0 +1,94 @@
+//
+//  ValidationLogger.h
+//  VulkanPractice
+//
+
+/**
+ Validation messages are produced on whatever thread the driver/layer happens to be on,
+ usually the thread recording or submitting work. Writing them straight to std::cerr stalls that thread,
+ so the debug callback only copies the message into a fixed size lock-free ring buffer and returns.
+ A logger thread drains the ring and:
+    i.   drops message ids that are muted
+    ii.  de-duplicates repeated message ids and keeps a count per id
+    iii. prints at most maxPerIdPerWindow messages per id in every rateWindow, the rest are folded into a "repeated N times" line
+ */
+
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+class ValidationLogger {
+public:
+    ValidationLogger() : ring(new Slot[RING_SIZE]) {}
+    ValidationLogger(const ValidationLogger& obj) = delete;
+
+    ValidationLogger& operator=(const ValidationLogger& obj) = delete;
+
+    ~ValidationLogger();
+
+    // mutedIds are filtered on the producer side, so they never reach the ring buffer
+    void start(const std::vector<int32_t>& mutedIds, uint32_t maxPerIdPerWindow = 5, std::chrono::milliseconds rateWindow = std::chrono::milliseconds(1000));
+    void stop();
+
+    // Called from the debug callback, never blocks
+    void push(VkDebugUtilsMessageSeverityFlagBitsEXT severity, const VkDebugUtilsMessengerCallbackDataEXT* pCallbackData);
+
+    static VKAPI_ATTR VkBool32 VKAPI_CALL debugCallback(
+                                                        VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity,
+                                                        VkDebugUtilsMessageTypeFlagsEXT messageType,
+                                                        const VkDebugUtilsMessengerCallbackDataEXT* pCallbackData,
+                                                        void* pUserData);
+
+private:
+    static constexpr size_t RING_SIZE = 1024;    // Must be a power of two
+    static constexpr size_t MAX_MESSAGE_LENGTH = 512;
+
+    struct Slot {
+        std::atomic<size_t> sequence;
+        VkDebugUtilsMessageSeverityFlagBitsEXT severity;
+        int32_t messageIdNumber;
+        char messageIdName[64];
+        char message[MAX_MESSAGE_LENGTH];
+    };
+
+    struct IdState {
+        std::string name;
+        uint64_t total = 0;
+        uint32_t printedInWindow = 0;
+        uint64_t suppressedInWindow = 0;
+        std::chrono::steady_clock::time_point windowStart;
+    };
+
+    bool isMuted(int32_t messageIdNumber) const;
+    void run();
+    bool drain();
+    void flushSuppressed(std::chrono::steady_clock::time_point now, bool force);
+    void printSummary();
+
+    // On the heap, the slots add up to more than half a megabyte
+    std::unique_ptr<Slot[]> ring;
+    std::atomic<size_t> enqueuePos{0};
+    size_t dequeuePos = 0;
+
+    std::atomic<bool> running{false};
+    std::atomic<uint64_t> droppedMessages{0};
+    std::thread worker;
+
+    // Sorted, written only before the worker starts
+    std::vector<int32_t> mutedMessageIds;
+    uint32_t maxPerWindow = 5;
+    std::chrono::milliseconds window{1000};
+
+    // Owned by the logger thread
+    std::unordered_map<int32_t, IdState> idStates;
+    std::string outputBuffer;
+};
@@ -0,0 +1,154 @@
+//
+//  VulkanDispatch.h
+//  VulkanPractice
+//
+
+/**
+ Instance and device function pointers, loaded once after vkCreateInstance / vkCreateDevice.
+ The exported vk* symbols of the loader are trampolines which look up the dispatch table of the handle on every call,
+ device functions fetched through vkGetDeviceProcAddr jump straight into the layer/driver instead.
+ Add a function to one of the lists below and it gets a member of the same name in the matching table.
+ */
+
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+// Instance level functions which must be present
+#define VK_INSTANCE_FUNCTIONS(X) \
+    X(vkDestroyInstance) \
+    X(vkEnumeratePhysicalDevices) \
+    X(vkEnumerateDeviceExtensionProperties) \
+    X(vkGetPhysicalDeviceProperties) \
+    X(vkGetPhysicalDeviceFeatures) \
+    X(vkGetPhysicalDeviceProperties2KHR) \
+    X(vkGetPhysicalDeviceFeatures2KHR) \
+    X(vkGetPhysicalDeviceMemoryProperties) \
+    X(vkGetPhysicalDeviceMemoryProperties2KHR) \
+    X(vkGetPhysicalDeviceFormatProperties) \
+    X(vkGetPhysicalDeviceQueueFamilyProperties) \
+    X(vkCreateDevice) \
+    X(vkGetDeviceProcAddr) \
+    X(vkDestroySurfaceKHR) \
+    X(vkGetPhysicalDeviceSurfaceSupportKHR) \
+    X(vkGetPhysicalDeviceSurfaceCapabilitiesKHR) \
+    X(vkGetPhysicalDeviceSurfaceFormatsKHR) \
+    X(vkGetPhysicalDeviceSurfacePresentModesKHR)
+
+// Instance level functions of optional extensions, null when the extension is not enabled
+#define VK_INSTANCE_OPTIONAL_FUNCTIONS(X) \
+    X(vkCreateDebugUtilsMessengerEXT) \
+    X(vkDestroyDebugUtilsMessengerEXT) \
+    X(vkGetPhysicalDeviceCalibrateableTimeDomainsEXT)
+
+// Device level functions which must be present
+#define VK_DEVICE_FUNCTIONS(X) \
+    X(vkGetDeviceQueue) \
+    X(vkDestroyDevice) \
+    X(vkDeviceWaitIdle) \
+    X(vkQueueSubmit) \
+    X(vkQueueWaitIdle) \
+    X(vkAllocateMemory) \
+    X(vkFreeMemory) \
+    X(vkMapMemory) \
+    X(vkUnmapMemory) \
+    X(vkFlushMappedMemoryRanges) \
+    X(vkInvalidateMappedMemoryRanges) \
+    X(vkCreateBuffer) \
+    X(vkDestroyBuffer) \
+    X(vkGetBufferMemoryRequirements) \
+    X(vkBindBufferMemory) \
+    X(vkCreateImage) \
+    X(vkDestroyImage) \
+    X(vkGetImageMemoryRequirements) \
+    X(vkBindImageMemory) \
+    X(vkCreateImageView) \
+    X(vkDestroyImageView) \
+    X(vkCreateSampler) \
+    X(vkDestroySampler) \
+    X(vkCreateShaderModule) \
+    X(vkDestroyShaderModule) \
+    X(vkCreatePipelineCache) \
+    X(vkDestroyPipelineCache) \
+    X(vkGetPipelineCacheData) \
+    X(vkCreateGraphicsPipelines) \
+    X(vkCreateComputePipelines) \
+    X(vkDestroyPipeline) \
+    X(vkCreatePipelineLayout) \
+    X(vkDestroyPipelineLayout) \
+    X(vkCreateDescriptorSetLayout) \
+    X(vkDestroyDescriptorSetLayout) \
+    X(vkCreateDescriptorPool) \
+    X(vkDestroyDescriptorPool) \
+    X(vkAllocateDescriptorSets) \
+    X(vkUpdateDescriptorSets) \
+    X(vkCreateRenderPass) \
+    X(vkDestroyRenderPass) \
+    X(vkCreateFramebuffer) \
+    X(vkDestroyFramebuffer) \
+    X(vkCreateCommandPool) \
+    X(vkDestroyCommandPool) \
+    X(vkResetCommandPool) \
+    X(vkAllocateCommandBuffers) \
+    X(vkFreeCommandBuffers) \
+    X(vkBeginCommandBuffer) \
+    X(vkEndCommandBuffer) \
+    X(vkResetCommandBuffer) \
+    X(vkCreateSemaphore) \
+    X(vkDestroySemaphore) \
+    X(vkCreateFence) \
+    X(vkDestroyFence) \
+    X(vkWaitForFences) \
+    X(vkResetFences) \
+    X(vkGetFenceStatus) \
+    X(vkCreateQueryPool) \
+    X(vkDestroyQueryPool) \
+    X(vkGetQueryPoolResults) \
+    X(vkCmdBeginRenderPass) \
+    X(vkCmdEndRenderPass) \
+    X(vkCmdBindPipeline) \
+    X(vkCmdSetViewport) \
+    X(vkCmdSetScissor) \
+    X(vkCmdDraw) \
+    X(vkCmdDrawIndexed) \
+    X(vkCmdBindVertexBuffers) \
+    X(vkCmdBindIndexBuffer) \
+    X(vkCmdBindDescriptorSets) \
+    X(vkCmdPushConstants) \
+    X(vkCmdPipelineBarrier) \
+    X(vkCmdCopyBuffer) \
+    X(vkCmdCopyImageToBuffer) \
+    X(vkCmdCopyBufferToImage) \
+    X(vkCmdBlitImage) \
+    X(vkCmdFillBuffer) \
+    X(vkCmdDispatch) \
+    X(vkCmdResetQueryPool) \
+    X(vkCmdBeginQuery) \
+    X(vkCmdEndQuery) \
+    X(vkCmdWriteTimestamp) \
+    X(vkCmdExecuteCommands) \
+    X(vkCreateSwapchainKHR) \
+    X(vkDestroySwapchainKHR) \
+    X(vkGetSwapchainImagesKHR) \
+    X(vkAcquireNextImageKHR) \
+    X(vkQueuePresentKHR)
+
+// Device level functions of optional extensions, null when the extension is not enabled
+#define VK_DEVICE_OPTIONAL_FUNCTIONS(X) \
+    X(vkGetCalibratedTimestampsEXT)
+
+#define VK_DECLARE_FUNCTION_MEMBER(name) PFN_##name name = nullptr;
+
+struct InstanceDispatch {
+    VK_INSTANCE_FUNCTIONS(VK_DECLARE_FUNCTION_MEMBER)
+    VK_INSTANCE_OPTIONAL_FUNCTIONS(VK_DECLARE_FUNCTION_MEMBER)
+
+    void load(VkInstance instance);
+};
+
+struct DeviceDispatch {
+    VK_DEVICE_FUNCTIONS(VK_DECLARE_FUNCTION_MEMBER)
+    VK_DEVICE_OPTIONAL_FUNCTIONS(VK_DECLARE_FUNCTION_MEMBER)
+
+    void load(const InstanceDispatch& instanceTable, VkDevice device);
+};
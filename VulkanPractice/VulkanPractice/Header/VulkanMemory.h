@@ -0,0 +1,36 @@
+//
+//  VulkanMemory.h
+//  VulkanPractice
+//
+
+/**
+ Memory type lookup, buffer creation and one time submits shared by everything that owns Vulkan memory.
+ 1. Both lookups return the first memory type in the filter with all the wanted properties. findMemoryType() throws
+    when there is none, tryFindMemoryType() returns UINT32_MAX for callers that fall back to other properties,
+    like readback preferring HOST_CACHED
+ 2. createBuffer() gives every buffer a dedicated allocation, which is fine for the few long lived buffers of the renderers
+ 3. submitOnce() waits for the queue to go idle, it is meant for uploads at init time
+ */
+
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <functional>
+
+#include "VulkanDispatch.h"
+
+// UINT32_MAX when no type in typeFilter has all the properties
+uint32_t tryFindMemoryType(const VkPhysicalDeviceMemoryProperties& memoryProperties, uint32_t typeFilter, VkMemoryPropertyFlags properties);
+// Throws when no type in typeFilter has all the properties
+uint32_t findMemoryType(const VkPhysicalDeviceMemoryProperties& memoryProperties, uint32_t typeFilter, VkMemoryPropertyFlags properties);
+
+// Creates the buffer and binds memory of its own to it
+void createBuffer(VkDevice device, const DeviceDispatch& deviceTable, const VkAllocationCallbacks* allocator,
+                  const VkPhysicalDeviceMemoryProperties& memoryProperties, VkDeviceSize size, VkBufferUsageFlags usage,
+                  VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& memory);
+
+// Records with the callback into a temporary command buffer from commandPool, submits it to queue and waits for it
+void submitOnce(VkDevice device, const DeviceDispatch& deviceTable, VkQueue queue, VkCommandPool commandPool,
+                const std::function<void(VkCommandBuffer)>& record);
@@ -0,0 +1,119 @@
+//
+//  WindowView.h
+//  VulkanPractice
+//
+
+/**
+ An additional window the scene is rendered to, next to the main window of HelloTriangleApplication.
+ 1. Every view has its own window, surface, swap chain, depth buffer and render pass, and looks at the scene with a camera
+    of its own. It renders straight into its swap chain images, the offscreen target, post processing and readback
+    of the main window are left out
+ 2. The views are recorded into the command buffer of the frame that also writes the main window's swap chain image, and go
+    out with it in one submit that waits for every acquired image. One vkQueuePresentKHR then presents all the swap chains,
+    with a VkResult for each
+ 3. A view whose swap chain is out of date, suboptimal or resized recreates only its own swap chain. The device is waited
+    for since frames in flight may still use its images, the other windows keep theirs. A minimized view is skipped
+ 4. acquire() never blocks on a view, a view without an image this frame is just left out of the submit and the present
+ */
+
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "Camera.h"
+#include "VulkanDispatch.h"
+
+class WindowView {
+public:
+    WindowView() = default;
+    WindowView(const WindowView& obj) = delete;
+
+    WindowView& operator=(const WindowView& obj) = delete;
+
+    ~WindowView() = default;
+
+    // GLFW must be initialized. presentFamily has to be able to present to the new window's surface
+    void init(VkInstance instance, const InstanceDispatch& instanceTable, VkPhysicalDevice physicalDevice, VkDevice device,
+              const DeviceDispatch* deviceTable, const VkAllocationCallbacks* allocator, uint32_t graphicsFamily,
+              uint32_t presentFamily, VkFormat depthFormat, uint32_t frameSlots, const std::string& title, int width, int height);
+    // The device must be idle
+    void destroy();
+
+    bool isInitialized() const { return window != nullptr; }
+    bool shouldClose() const { return glfwWindowShouldClose(window) == GLFW_TRUE; }
+    // Called when the view needs a new frame, e.g. after a resize in on-demand mode
+    void setRedrawCallback(std::function<void()> callback) { redrawCallback = std::move(callback); }
+
+    // Acquires an image with the semaphore of frameSlot, recreating the swap chain first when it is due.
+    // Returns false when the view has no image this frame
+    bool acquire(uint32_t frameSlot);
+    bool isAcquired() const { return acquired; }
+    VkSemaphore imageAvailableSemaphore(uint32_t frameSlot) const { return imageAvailableSemaphores[frameSlot]; }
+
+    // Around the draws into the acquired image, with the viewport and scissor set to the whole window
+    void beginRenderPass(VkCommandBuffer commandBuffer);
+    void endRenderPass(VkCommandBuffer commandBuffer);
+
+    VkSwapchainKHR swapChain() const { return viewSwapChain; }
+    uint32_t imageIndex() const { return acquiredImage; }
+    // With the result of the present of this swap chain. When it is out of date, the next acquire() recreates it
+    void presented(VkResult result);
+
+    VkRenderPass renderPass() const { return viewRenderPass; }
+    VkFormat colorFormat() const { return surfaceFormat.format; }
+    VkExtent2D extent() const { return swapChainExtent; }
+    float aspect() const { return static_cast<float>(swapChainExtent.width) / static_cast<float>(swapChainExtent.height); }
+    Camera& camera() { return viewCamera; }
+
+private:
+    static void framebufferResizeCallback(GLFWwindow* window, int width, int height);
+
+    void createRenderPass();
+    void createSwapChain();
+    void cleanupSwapChain();
+    // Returns false while the window is minimized
+    bool recreateSwapChain();
+
+    GLFWwindow* window = nullptr;
+    VkInstance instance = VK_NULL_HANDLE;
+    const InstanceDispatch* instanceTable = nullptr;
+    VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+    VkDevice device = VK_NULL_HANDLE;
+    const DeviceDispatch* deviceTable = nullptr;
+    const VkAllocationCallbacks* allocator = nullptr;
+    uint32_t graphicsFamily = 0;
+    uint32_t presentFamily = 0;
+    VkFormat depthFormat = VK_FORMAT_UNDEFINED;
+    VkPhysicalDeviceMemoryProperties memoryProperties{};
+
+    VkSurfaceKHR surface = VK_NULL_HANDLE;
+    VkSurfaceFormatKHR surfaceFormat{};
+    VkPresentModeKHR presentMode = VK_PRESENT_MODE_FIFO_KHR;
+    VkRenderPass viewRenderPass = VK_NULL_HANDLE;
+
+    VkSwapchainKHR viewSwapChain = VK_NULL_HANDLE;
+    VkExtent2D swapChainExtent{};
+    std::vector<VkImage> swapChainImages;
+    std::vector<VkImageView> swapChainImageViews;
+    std::vector<VkFramebuffer> framebuffers;
+    VkImage depthImage = VK_NULL_HANDLE;
+    VkDeviceMemory depthImageMemory = VK_NULL_HANDLE;
+    VkImageView depthImageView = VK_NULL_HANDLE;
+
+    std::vector<VkSemaphore> imageAvailableSemaphores;
+    uint32_t acquiredImage = 0;
+    bool acquired = false;
+    bool framebufferResized = false;
+    bool outOfDate = false;
+
+    Camera viewCamera;
+    std::function<void()> redrawCallback;
+};
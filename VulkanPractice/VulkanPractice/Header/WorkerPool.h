@@ -0,0 +1,61 @@
+//
+//  WorkerPool.h
+//  VulkanPractice
+//
+
+/**
+ Persistent threads for work that is split into ranges every frame, like culling or transform updates.
+ 1. The threads are created once in init() and sleep on a condition variable between calls, starting threads per call
+    would cost more than the work itself
+ 2. parallelFor() splits [0, count) into one contiguous range per thread. The calling thread runs the first range and
+    waits for the others, so it returns when everything is done and results can be read right away
+ 3. Every range gets a thread index, so callers can keep per thread output without any synchronization
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class WorkerPool {
+public:
+    using RangeFunction = std::function<void(uint32_t thread, size_t begin, size_t end)>;
+
+    WorkerPool() = default;
+    WorkerPool(const WorkerPool& obj) = delete;
+
+    WorkerPool& operator=(const WorkerPool& obj) = delete;
+
+    ~WorkerPool();
+
+    // threadCount counts the calling thread, 0 uses every hardware thread. Throws when called again without destroy()
+    void init(uint32_t threadCount = 0);
+    void destroy();
+
+    // Range starts are multiples of granularity. Fewer threads are used when a range would get less than minPerThread
+    // items, a thread without a range is not called
+    void parallelFor(size_t count, size_t minPerThread, size_t granularity, const RangeFunction& function);
+
+    uint32_t threadCount() const { return static_cast<uint32_t>(workers.size() + 1); }
+
+private:
+    void workerLoop(uint32_t thread);
+    void runRange(uint32_t thread) const;
+
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable workSignal;
+    std::condition_variable doneSignal;
+    uint64_t generation = 0;
+    uint32_t pendingWorkers = 0;
+    bool stopWorkers = false;
+
+    // The current call, written before the workers are woken
+    const RangeFunction* currentFunction = nullptr;
+    size_t currentCount = 0;
+    size_t currentPerThread = 0;
+};
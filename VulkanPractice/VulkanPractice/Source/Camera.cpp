@@ -0,0 +1,74 @@
+//
+//  Camera.cpp
+//  VulkanPractice
+//
+
+#include <algorithm>
+#include <cmath>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "Camera.h"
+
+namespace {
+
+// Looking straight up or down would make the up vector of the view parallel to the view direction
+const float MAX_PITCH = glm::radians(89.0f);
+
+}
+
+glm::mat4 Camera::reversedInfinitePerspective(float fovY, float aspect, float nearPlane) {
+    const float focalLength = 1.0f / std::tan(fovY * 0.5f);
+
+    // clip.z = near and clip.w = -view.z, so depth = near / distance
+    glm::mat4 projection(0.0f);
+    projection[0][0] = focalLength / aspect;
+    // Negative, Vulkan's y points down
+    projection[1][1] = -focalLength;
+    projection[2][3] = -1.0f;
+    projection[3][2] = nearPlane;
+    return projection;
+}
+
+void Camera::setPerspective(float fovY, float nearPlane) {
+    fieldOfView = fovY;
+    nearDistance = nearPlane;
+}
+
+void Camera::setRotation(float yaw, float pitch) {
+    cameraYaw = yaw;
+    cameraPitch = std::clamp(pitch, -MAX_PITCH, MAX_PITCH);
+}
+
+void Camera::rotate(float yawDelta, float pitchDelta) {
+    setRotation(cameraYaw + yawDelta, cameraPitch + pitchDelta);
+}
+
+void Camera::moveLocal(const glm::vec3& delta) {
+    cameraPosition += right() * delta.x + glm::vec3(0.0f, 1.0f, 0.0f) * delta.y + forward() * delta.z;
+}
+
+glm::vec3 Camera::forward() const {
+    return glm::vec3(-std::sin(cameraYaw) * std::cos(cameraPitch), std::sin(cameraPitch), -std::cos(cameraYaw) * std::cos(cameraPitch));
+}
+
+glm::vec3 Camera::right() const {
+    return glm::vec3(std::cos(cameraYaw), 0.0f, -std::sin(cameraYaw));
+}
+
+glm::mat4 Camera::view() const {
+    return glm::lookAtRH(cameraPosition, cameraPosition + forward(), glm::vec3(0.0f, 1.0f, 0.0f));
+}
+
+glm::mat4 Camera::projection(float aspect) const {
+    return reversedInfinitePerspective(fieldOfView, aspect, nearDistance);
+}
+
+CameraUniforms Camera::uniforms(float aspect) const {
+    CameraUniforms uniforms;
+    uniforms.view = view();
+    uniforms.projection = projection(aspect);
+    uniforms.viewProjection = uniforms.projection * uniforms.view;
+    uniforms.position = glm::vec4(cameraPosition, 1.0f);
+    return uniforms;
+}
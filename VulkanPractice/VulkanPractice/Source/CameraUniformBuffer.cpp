@@ -0,0 +1,137 @@
+//
+//  CameraUniformBuffer.cpp
+//  VulkanPractice
+//
+
+#include <cstring>
+#include <stdexcept>
+
+#include "CameraUniformBuffer.h"
+#include "VulkanMemory.h"
+
+void CameraUniformBuffer::init(VkPhysicalDevice physicalDevice, const InstanceDispatch& instanceTable, VkDevice device, const DeviceDispatch* deviceTable,
+                               const VkAllocationCallbacks* allocator, uint32_t frameSlots) {
+    this->device = device;
+    this->deviceTable = deviceTable;
+    this->allocator = allocator;
+
+    instanceTable.vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+
+    VkPhysicalDeviceProperties properties;
+    instanceTable.vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    const VkDeviceSize alignment = properties.limits.minUniformBufferOffsetAlignment;
+    slotStride = (sizeof(CameraUniforms) + alignment - 1) / alignment * alignment;
+
+    VkBufferCreateInfo bufferInfo{};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = slotStride * frameSlots;
+    bufferInfo.usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    if (deviceTable->vkCreateBuffer(device, &bufferInfo, allocator, &buffer) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create camera uniform buffer!");
+    }
+
+    VkMemoryRequirements memoryRequirements;
+    deviceTable->vkGetBufferMemoryRequirements(device, buffer, &memoryRequirements);
+
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = memoryRequirements.size;
+    allocInfo.memoryTypeIndex = findMemoryType(memoryProperties, memoryRequirements.memoryTypeBits,
+                                               VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+    if (deviceTable->vkAllocateMemory(device, &allocInfo, allocator, &memory) != VK_SUCCESS) {
+        throw std::runtime_error("failed to allocate camera uniform buffer memory!");
+    }
+    deviceTable->vkBindBufferMemory(device, buffer, memory, 0);
+
+    void* data = nullptr;
+    if (deviceTable->vkMapMemory(device, memory, 0, VK_WHOLE_SIZE, 0, &data) != VK_SUCCESS) {
+        throw std::runtime_error("failed to map camera uniform buffer!");
+    }
+    mapped = static_cast<uint8_t*>(data);
+
+    VkDescriptorSetLayoutBinding cameraBinding{};
+    cameraBinding.binding = 0;
+    cameraBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    cameraBinding.descriptorCount = 1;
+    cameraBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = 1;
+    layoutInfo.pBindings = &cameraBinding;
+
+    if (deviceTable->vkCreateDescriptorSetLayout(device, &layoutInfo, allocator, &descriptorSetLayout) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create camera descriptor set layout!");
+    }
+
+    VkDescriptorPoolSize poolSize{};
+    poolSize.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    poolSize.descriptorCount = frameSlots;
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.maxSets = frameSlots;
+    poolInfo.poolSizeCount = 1;
+    poolInfo.pPoolSizes = &poolSize;
+
+    if (deviceTable->vkCreateDescriptorPool(device, &poolInfo, allocator, &descriptorPool) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create camera descriptor pool!");
+    }
+
+    std::vector<VkDescriptorSetLayout> layouts(frameSlots, descriptorSetLayout);
+    VkDescriptorSetAllocateInfo setInfo{};
+    setInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    setInfo.descriptorPool = descriptorPool;
+    setInfo.descriptorSetCount = frameSlots;
+    setInfo.pSetLayouts = layouts.data();
+
+    descriptorSets.resize(frameSlots);
+    if (deviceTable->vkAllocateDescriptorSets(device, &setInfo, descriptorSets.data()) != VK_SUCCESS) {
+        throw std::runtime_error("failed to allocate camera descriptor sets!");
+    }
+
+    for (uint32_t slot = 0; slot < frameSlots; slot++) {
+        VkDescriptorBufferInfo regionInfo{};
+        regionInfo.buffer = buffer;
+        regionInfo.offset = slot * slotStride;
+        regionInfo.range = sizeof(CameraUniforms);
+
+        VkWriteDescriptorSet descriptorWrite{};
+        descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        descriptorWrite.dstSet = descriptorSets[slot];
+        descriptorWrite.dstBinding = 0;
+        descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        descriptorWrite.descriptorCount = 1;
+        descriptorWrite.pBufferInfo = &regionInfo;
+        deviceTable->vkUpdateDescriptorSets(device, 1, &descriptorWrite, 0, nullptr);
+
+        // Valid contents before the first write
+        write(slot, CameraUniforms{});
+    }
+}
+
+void CameraUniformBuffer::destroy() {
+    if (device == VK_NULL_HANDLE) return;
+
+    // Frees the descriptor sets as well
+    deviceTable->vkDestroyDescriptorPool(device, descriptorPool, allocator);
+    deviceTable->vkDestroyDescriptorSetLayout(device, descriptorSetLayout, allocator);
+    deviceTable->vkDestroyBuffer(device, buffer, allocator);
+    // Unmapped implicitly
+    deviceTable->vkFreeMemory(device, memory, allocator);
+
+    descriptorSets.clear();
+    mapped = nullptr;
+    device = VK_NULL_HANDLE;
+}
+
+void CameraUniformBuffer::write(uint32_t frameSlot, const CameraUniforms& uniforms) {
+    std::memcpy(mapped + frameSlot * slotStride, &uniforms, sizeof(uniforms));
+}
+
+void CameraUniformBuffer::bind(VkCommandBuffer commandBuffer, VkPipelineLayout layout, uint32_t frameSlot) const {
+    deviceTable->vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, layout, 0, 1, &descriptorSets[frameSlot], 0, nullptr);
+}
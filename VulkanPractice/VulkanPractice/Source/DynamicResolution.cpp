@@ -0,0 +1,279 @@
+//
+//  DynamicResolution.cpp
+//  VulkanPractice
+//
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <stdexcept>
+
+#include "DynamicResolution.h"
+#include "VulkanMemory.h"
+
+namespace {
+
+// Aim this far below the target, so noise in the GPU time doesn't push every other frame over it
+const double TARGET_HEADROOM = 0.9;
+// Fraction of the way to the wanted scale taken per frame
+const float SCALE_DOWN_GAIN = 0.5f;
+const float SCALE_UP_GAIN = 0.05f;
+// Frames in a row within the budget that end an over budget stretch
+const uint32_t FRAMES_TO_SETTLE = 3;
+
+uint32_t scaled(uint32_t size, float scale) {
+    return std::max(1u, static_cast<uint32_t>(std::lround(size * scale)));
+}
+
+}
+
+bool DynamicResolution::isSupported(VkPhysicalDevice physicalDevice, const InstanceDispatch& instanceTable, VkFormat colorFormat, VkFormat outputFormat) {
+    // The target is the source of the blit and the swap chain image its destination
+    VkFormatProperties formatProperties;
+    instanceTable.vkGetPhysicalDeviceFormatProperties(physicalDevice, colorFormat, &formatProperties);
+    VkFormatProperties outputProperties;
+    instanceTable.vkGetPhysicalDeviceFormatProperties(physicalDevice, outputFormat, &outputProperties);
+    return (formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_BLIT_SRC_BIT) &&
+           (outputProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_BLIT_DST_BIT);
+}
+
+void DynamicResolution::init(VkPhysicalDevice physicalDevice, const InstanceDispatch& instanceTable, VkDevice device, const DeviceDispatch* deviceTable,
+                             const VkAllocationCallbacks* allocator, VkFormat colorFormat, VkFormat outputFormat, const DynamicResolutionSettings& settings) {
+    if (settings.minScale <= 0.0f || settings.minScale > settings.maxScale) {
+        throw std::runtime_error("invalid dynamic resolution scale bounds!");
+    }
+
+    this->device = device;
+    this->deviceTable = deviceTable;
+    this->allocator = allocator;
+    this->colorFormat = colorFormat;
+    this->settings = settings;
+
+    instanceTable.vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+
+    if (!isSupported(physicalDevice, instanceTable, colorFormat, outputFormat)) {
+        throw std::runtime_error("dynamic resolution target can't be blitted to the swap chain!");
+    }
+
+    // The filter depends on the source of the blit
+    VkFormatProperties formatProperties;
+    instanceTable.vkGetPhysicalDeviceFormatProperties(physicalDevice, colorFormat, &formatProperties);
+    upscaleFilter = (formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT) ? VK_FILTER_LINEAR : VK_FILTER_NEAREST;
+
+    currentScale = settings.maxScale;
+    resetStats();
+}
+
+void DynamicResolution::destroy() {
+    if (device == VK_NULL_HANDLE) return;
+
+    destroyTarget();
+    device = VK_NULL_HANDLE;
+}
+
+VkExtent2D DynamicResolution::targetExtent(VkExtent2D outputExtent) const {
+    return {scaled(outputExtent.width, settings.maxScale), scaled(outputExtent.height, settings.maxScale)};
+}
+
+void DynamicResolution::resize(VkRenderPass renderPass, VkExtent2D outputExtent, VkImageView depthView) {
+    destroyTarget();
+    this->outputExtent = outputExtent;
+    const VkExtent2D extent = targetExtent(outputExtent);
+
+    VkImageCreateInfo imageInfo{};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.format = colorFormat;
+    imageInfo.extent = {extent.width, extent.height, 1};
+    imageInfo.mipLevels = 1;
+    imageInfo.arrayLayers = 1;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | settings.extraUsage;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    if (settings.queueFamilies.size() > 1) {
+        imageInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+        imageInfo.queueFamilyIndexCount = static_cast<uint32_t>(settings.queueFamilies.size());
+        imageInfo.pQueueFamilyIndices = settings.queueFamilies.data();
+    }
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+    if (deviceTable->vkCreateImage(device, &imageInfo, allocator, &colorImage) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create dynamic resolution target!");
+    }
+
+    VkMemoryRequirements memoryRequirements;
+    deviceTable->vkGetImageMemoryRequirements(device, colorImage, &memoryRequirements);
+
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = memoryRequirements.size;
+    allocInfo.memoryTypeIndex = findMemoryType(memoryProperties, memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+    if (deviceTable->vkAllocateMemory(device, &allocInfo, allocator, &colorImageMemory) != VK_SUCCESS) {
+        throw std::runtime_error("failed to allocate dynamic resolution target memory!");
+    }
+    deviceTable->vkBindImageMemory(device, colorImage, colorImageMemory, 0);
+
+    VkImageViewCreateInfo viewInfo{};
+    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image = colorImage;
+    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.format = colorFormat;
+    viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    viewInfo.subresourceRange.levelCount = 1;
+    viewInfo.subresourceRange.layerCount = 1;
+
+    if (deviceTable->vkCreateImageView(device, &viewInfo, allocator, &colorImageView) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create dynamic resolution target view!");
+    }
+
+    VkImageView attachments[] = {colorImageView, depthView};
+
+    VkFramebufferCreateInfo framebufferInfo{};
+    framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+    framebufferInfo.renderPass = renderPass;
+    framebufferInfo.attachmentCount = 2;
+    framebufferInfo.pAttachments = attachments;
+    framebufferInfo.width = extent.width;
+    framebufferInfo.height = extent.height;
+    framebufferInfo.layers = 1;
+
+    if (deviceTable->vkCreateFramebuffer(device, &framebufferInfo, allocator, &targetFramebuffer) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create dynamic resolution framebuffer!");
+    }
+}
+
+void DynamicResolution::lockScale(float scale) {
+    currentScale = std::clamp(scale, settings.minScale, settings.maxScale);
+    scaleLocked = true;
+}
+
+void DynamicResolution::update(double gpuMs, uint64_t renderedPixels) {
+    const Clock::time_point now = Clock::now();
+
+    frames++;
+    scaleSum += currentScale;
+    minScaleUsed = frames == 1 ? currentScale : std::min(minScaleUsed, currentScale);
+    maxScaleUsed = frames == 1 ? currentScale : std::max(maxScaleUsed, currentScale);
+
+    if (gpuMs > settings.targetFrameMs) {
+        framesOverBudget++;
+        framesWithinBudget = 0;
+        if (!overBudget) {
+            overBudget = true;
+            overBudgetSince = now;
+        }
+    } else if (overBudget && ++framesWithinBudget == FRAMES_TO_SETTLE) {
+        overBudget = false;
+        timesToTargetMs.push_back(std::chrono::duration<double, std::milli>(now - overBudgetSince).count());
+    }
+
+    if (scaleLocked || gpuMs <= 0.0 || renderedPixels == 0) return;
+
+    // Pixels the budget allows at the time per pixel of the sample, the scale is per axis
+    const double msPerPixel = gpuMs / static_cast<double>(renderedPixels);
+    const double budgetPixels = settings.targetFrameMs * TARGET_HEADROOM / msPerPixel;
+    const double outputPixels = static_cast<double>(outputExtent.width) * outputExtent.height;
+    const float wantedScale = static_cast<float>(std::sqrt(budgetPixels / outputPixels));
+
+    const float gain = wantedScale < currentScale ? SCALE_DOWN_GAIN : SCALE_UP_GAIN;
+    currentScale = std::clamp(currentScale + (wantedScale - currentScale) * gain, settings.minScale, settings.maxScale);
+}
+
+VkExtent2D DynamicResolution::renderExtent() const {
+    const VkExtent2D extent = targetExtent(outputExtent);
+    return {std::min(extent.width, scaled(outputExtent.width, currentScale)), std::min(extent.height, scaled(outputExtent.height, currentScale))};
+}
+
+void DynamicResolution::recordUpscale(VkCommandBuffer commandBuffer, VkImage swapChainImage) const {
+    VkImageSubresourceRange subresourceRange{};
+    subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    subresourceRange.levelCount = 1;
+    subresourceRange.layerCount = 1;
+
+    // The acquire semaphore is waited on at the color attachment output stage, the transition has to come after it.
+    // The previous contents don't matter, the blit overwrites all of it
+    VkImageMemoryBarrier toTransfer{};
+    toTransfer.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    toTransfer.srcAccessMask = 0;
+    toTransfer.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    toTransfer.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    toTransfer.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    toTransfer.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    toTransfer.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    toTransfer.image = swapChainImage;
+    toTransfer.subresourceRange = subresourceRange;
+
+    deviceTable->vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+                                      0, nullptr, 0, nullptr, 1, &toTransfer);
+
+    // The render pass or the post processing after it already waited for their writes and left the target in TRANSFER_SRC_OPTIMAL
+    const VkExtent2D source = renderExtent();
+    VkImageBlit region{};
+    region.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.srcSubresource.layerCount = 1;
+    region.srcOffsets[1] = {static_cast<int32_t>(source.width), static_cast<int32_t>(source.height), 1};
+    region.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.dstSubresource.layerCount = 1;
+    region.dstOffsets[1] = {static_cast<int32_t>(outputExtent.width), static_cast<int32_t>(outputExtent.height), 1};
+
+    deviceTable->vkCmdBlitImage(commandBuffer, colorImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                                swapChainImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region, upscaleFilter);
+
+    VkImageMemoryBarrier toPresent = toTransfer;
+    toPresent.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    toPresent.dstAccessMask = 0;
+    toPresent.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    toPresent.newLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+
+    deviceTable->vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+                                      0, nullptr, 0, nullptr, 1, &toPresent);
+}
+
+void DynamicResolution::resetStats() {
+    overBudget = false;
+    framesWithinBudget = 0;
+    timesToTargetMs.clear();
+    frames = 0;
+    framesOverBudget = 0;
+    scaleSum = 0.0;
+}
+
+double DynamicResolution::medianTimeToTargetMs() const {
+    if (timesToTargetMs.empty()) return 0.0;
+
+    std::vector<double> sorted = timesToTargetMs;
+    std::sort(sorted.begin(), sorted.end());
+    return sorted[sorted.size() / 2];
+}
+
+double DynamicResolution::maxTimeToTargetMs() const {
+    return timesToTargetMs.empty() ? 0.0 : *std::max_element(timesToTargetMs.begin(), timesToTargetMs.end());
+}
+
+void DynamicResolution::printReport(std::ostream& os) const {
+    if (frames == 0) return;
+
+    os << "Dynamic resolution (target " << std::fixed << std::setprecision(2) << settings.targetFrameMs << " ms, scale "
+       << settings.minScale << " to " << settings.maxScale << "):\n";
+    os << "\tscale             average " << scaleSum / frames << ", min " << minScaleUsed << ", max " << maxScaleUsed << '\n';
+    os << "\tover budget       " << framesOverBudget << " of " << frames << " frames\n";
+    os << "\ttime to target    " << timesToTargetMs.size() << " times, median " << medianTimeToTargetMs() << " ms, max "
+       << maxTimeToTargetMs() << " ms" << (overBudget ? ", still over budget at the end" : "") << '\n';
+    os << std::defaultfloat;
+}
+
+void DynamicResolution::destroyTarget() {
+    if (colorImage == VK_NULL_HANDLE) return;
+
+    deviceTable->vkDestroyFramebuffer(device, targetFramebuffer, allocator);
+    deviceTable->vkDestroyImageView(device, colorImageView, allocator);
+    deviceTable->vkDestroyImage(device, colorImage, allocator);
+    deviceTable->vkFreeMemory(device, colorImageMemory, allocator);
+
+    targetFramebuffer = VK_NULL_HANDLE;
+    colorImageView = VK_NULL_HANDLE;
+    colorImage = VK_NULL_HANDLE;
+    colorImageMemory = VK_NULL_HANDLE;
+}
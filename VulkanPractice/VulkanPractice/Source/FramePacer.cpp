@@ -0,0 +1,184 @@
+//
+//  FramePacer.cpp
+//  VulkanPractice
+//
+
+#include <algorithm>
+#include <iomanip>
+#include <thread>
+
+#ifdef WIN
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/resource.h>
+#endif // WIN
+
+#include <GLFW/glfw3.h>
+
+#include "FramePacer.h"
+
+void FramePacer::configure(FramePacingMode mode, double targetFrameRate, double backgroundFrameRate) {
+    this->mode = mode;
+    this->targetFrameRate = targetFrameRate;
+    this->backgroundFrameRate = backgroundFrameRate;
+    redrawRequested = true;
+    nextFrameDeadline = Clock::now();
+}
+
+bool FramePacer::beginFrame(GLFWwindow* window) {
+    sample(false);
+
+    if (iconified) {
+        // Nothing is visible, sleep until the window is restored or closed
+        glfwWaitEvents();
+        return false;
+    }
+
+    if (mode == FramePacingMode::OnDemand && !redrawRequested) {
+        glfwWaitEvents();
+        if (!redrawRequested || iconified) return false;
+    } else {
+        glfwPollEvents();
+    }
+
+    double frameRate = 0.0;
+    if (!focused) {
+        frameRate = backgroundFrameRate;
+    } else if (mode == FramePacingMode::Limited) {
+        frameRate = targetFrameRate;
+    }
+
+    if (frameRate > 0.0) {
+        auto period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / frameRate));
+        auto now = Clock::now();
+        // Advance by whole periods so the average rate doesn't drift, but don't try to catch up after a stall
+        if (now - nextFrameDeadline > period) {
+            nextFrameDeadline = now;
+        }
+        waitUntil(nextFrameDeadline);
+        nextFrameDeadline += period;
+    }
+
+    redrawRequested = false;
+    sample(true);
+    return !glfwWindowShouldClose(window);
+}
+
+void FramePacer::setFocused(bool focused) {
+    this->focused = focused;
+    redrawRequested = true;
+}
+
+void FramePacer::setIconified(bool iconified) {
+    this->iconified = iconified;
+    redrawRequested = true;
+}
+
+void FramePacer::printReport(std::ostream& os) {
+    sample(false);
+
+    os << "Frame pacing (CPU % of one core, averaged over the time spent in each state):\n";
+    os << std::fixed << std::setprecision(1);
+    for (size_t i = 0; i < usage.size(); i++) {
+        const StateUsage& state = usage[i];
+        if (state.wallSeconds <= 0.0) continue;
+
+        os << '\t' << std::left << std::setw(10) << stateName(static_cast<State>(i)) << std::right
+           << std::setw(8) << state.wallSeconds << " s" << std::setw(8) << state.frames << " frames"
+           << std::setw(8) << state.frames / state.wallSeconds << " fps"
+           << std::setw(7) << 100.0 * state.cpuSeconds / state.wallSeconds << " % CPU\n";
+    }
+    os << std::defaultfloat;
+}
+
+FramePacer::State FramePacer::currentState() const {
+    if (iconified) return State::Iconified;
+    if (!focused) return State::Background;
+
+    switch (mode) {
+        case FramePacingMode::Limited:
+            return State::Limited;
+        case FramePacingMode::OnDemand:
+            return State::OnDemand;
+        default:
+            return State::Unlimited;
+    }
+}
+
+void FramePacer::sample(bool renderedFrame) {
+    auto now = Clock::now();
+    double cpuSeconds = processCpuSeconds();
+
+    // Everything since the last sample is charged to the state that was active at that sample
+    if (sampling) {
+        StateUsage& state = usage[static_cast<size_t>(sampledState)];
+        state.wallSeconds += std::chrono::duration<double>(now - lastSampleTime).count();
+        state.cpuSeconds += cpuSeconds - lastSampleCpuSeconds;
+    }
+
+    sampling = true;
+    sampledState = currentState();
+    lastSampleTime = now;
+    lastSampleCpuSeconds = cpuSeconds;
+
+    if (renderedFrame) {
+        usage[static_cast<size_t>(sampledState)].frames++;
+    }
+}
+
+void FramePacer::waitUntil(Clock::time_point deadline) {
+    // Sleep while the deadline is further away than a typical oversleep, then spin for the last stretch
+    for (;;) {
+        auto now = Clock::now();
+        double remaining = std::chrono::duration<double>(deadline - now).count();
+        double spinThreshold = std::min(2.0 * sleepOvershootSeconds + 0.0002, 0.004);
+        if (remaining <= spinThreshold) break;
+
+        auto requested = std::chrono::duration<double>(remaining - spinThreshold);
+        std::this_thread::sleep_for(requested);
+
+        double overshoot = std::chrono::duration<double>(Clock::now() - now).count() - requested.count();
+        sleepOvershootSeconds += 0.1 * (std::max(overshoot, 0.0) - sleepOvershootSeconds);
+    }
+
+    while (Clock::now() < deadline) {
+        std::this_thread::yield();
+    }
+}
+
+double FramePacer::processCpuSeconds() {
+#ifdef WIN
+    FILETIME creationTime, exitTime, kernelTime, userTime;
+    if (!GetProcessTimes(GetCurrentProcess(), &creationTime, &exitTime, &kernelTime, &userTime)) return 0.0;
+
+    // FILETIME counts 100 ns intervals
+    auto toSeconds = [](const FILETIME& time) {
+        return static_cast<double>((static_cast<uint64_t>(time.dwHighDateTime) << 32) | time.dwLowDateTime) * 1e-7;
+    };
+    return toSeconds(kernelTime) + toSeconds(userTime);
+#else
+    rusage resourceUsage{};
+    getrusage(RUSAGE_SELF, &resourceUsage);
+    return static_cast<double>(resourceUsage.ru_utime.tv_sec + resourceUsage.ru_stime.tv_sec)
+         + static_cast<double>(resourceUsage.ru_utime.tv_usec + resourceUsage.ru_stime.tv_usec) * 1e-6;
+#endif // WIN
+}
+
+const char* FramePacer::stateName(State state) {
+    switch (state) {
+        case State::Unlimited:
+            return "unlimited";
+        case State::Limited:
+            return "limited";
+        case State::OnDemand:
+            return "on-demand";
+        case State::Background:
+            return "background";
+        case State::Iconified:
+            return "iconified";
+        default:
+            return "unknown";
+    }
+}
@@ -0,0 +1,294 @@
+//
+//  FrameReadback.cpp
+//  VulkanPractice
+//
+
+#include <iostream>
+#include <stdexcept>
+
+#include "FrameReadback.h"
+#include "VulkanMemory.h"
+
+bool FrameReadback::supportsFormat(VkFormat format) {
+    switch (format) {
+        case VK_FORMAT_B8G8R8A8_UNORM:
+        case VK_FORMAT_B8G8R8A8_SRGB:
+        case VK_FORMAT_R8G8B8A8_UNORM:
+        case VK_FORMAT_R8G8B8A8_SRGB:
+            return true;
+        default:
+            return false;
+    }
+}
+
+void FrameReadback::init(VkPhysicalDevice physicalDevice, const InstanceDispatch& instanceTable, VkDevice device, const DeviceDispatch* deviceTable,
+                         const VkAllocationCallbacks* allocator, uint32_t bufferCount, Consumer consumer) {
+    this->device = device;
+    this->deviceTable = deviceTable;
+    this->allocator = allocator;
+    this->consumer = std::move(consumer);
+
+    instanceTable.vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+
+    buffers.resize(bufferCount);
+
+    stopConsuming = false;
+    consumerThread = std::thread(&FrameReadback::consumeLoop, this);
+}
+
+void FrameReadback::destroy() {
+    if (!consumerThread.joinable()) return;
+
+    // The device is idle, so everything still copying is done as well
+    collectAll();
+    waitForConsumer();
+
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stopConsuming = true;
+    }
+    consumeSignal.notify_one();
+    consumerThread.join();
+
+    destroyBuffers();
+    buffers.clear();
+}
+
+void FrameReadback::resize(VkExtent2D extent, VkFormat format) {
+    if (!supportsFormat(format)) {
+        throw std::runtime_error("swap chain format can't be read back!");
+    }
+
+    collectAll();
+    waitForConsumer();
+    destroyBuffers();
+
+    this->extent = extent;
+    this->format = format;
+    createBuffers();
+}
+
+bool FrameReadback::recordCopy(VkCommandBuffer commandBuffer, VkImage image, uint32_t frameSlot, uint64_t frameNumber) {
+    ReadbackBuffer* target = nullptr;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        for (auto& buffer : buffers) {
+            if (buffer.state == BufferState::Free) {
+                target = &buffer;
+                break;
+            }
+        }
+
+        if (target == nullptr) {
+            counters.skipped++;
+            return false;
+        }
+
+        target->state = BufferState::Copying;
+        target->frameSlot = frameSlot;
+        target->frameNumber = frameNumber;
+        counters.copied++;
+    }
+
+    VkImageSubresourceRange subresourceRange{};
+    subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    subresourceRange.levelCount = 1;
+    subresourceRange.layerCount = 1;
+
+    // Wait for the render pass, or the blit of dynamic resolution, to finish writing before the copy reads the image
+    VkImageMemoryBarrier toTransfer{};
+    toTransfer.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    toTransfer.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+    toTransfer.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    toTransfer.oldLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    toTransfer.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    toTransfer.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    toTransfer.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    toTransfer.image = image;
+    toTransfer.subresourceRange = subresourceRange;
+
+    deviceTable->vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                      VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &toTransfer);
+
+    VkBufferImageCopy region{};
+    region.bufferOffset = 0;
+    region.bufferRowLength = 0;     // tightly packed
+    region.bufferImageHeight = 0;
+    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.mipLevel = 0;
+    region.imageSubresource.baseArrayLayer = 0;
+    region.imageSubresource.layerCount = 1;
+    region.imageOffset = {0, 0, 0};
+    region.imageExtent = {extent.width, extent.height, 1};
+
+    deviceTable->vkCmdCopyImageToBuffer(commandBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, target->buffer, 1, &region);
+
+    // Back to the layout presentation expects, and make the copied bytes visible to the host
+    VkImageMemoryBarrier toPresent = toTransfer;
+    toPresent.srcAccessMask = 0;
+    toPresent.dstAccessMask = 0;
+    toPresent.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    toPresent.newLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+
+    VkBufferMemoryBarrier toHost{};
+    toHost.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    toHost.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    toHost.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    toHost.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    toHost.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    toHost.buffer = target->buffer;
+    toHost.offset = 0;
+    toHost.size = VK_WHOLE_SIZE;
+
+    deviceTable->vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                      VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT | VK_PIPELINE_STAGE_HOST_BIT, 0,
+                                      0, nullptr, 1, &toHost, 1, &toPresent);
+    return true;
+}
+
+template <typename Predicate>
+void FrameReadback::collectWhere(Predicate predicate) {
+    std::lock_guard<std::mutex> guard(lock);
+
+    bool collected = false;
+    for (size_t i = 0; i < buffers.size(); i++) {
+        ReadbackBuffer& buffer = buffers[i];
+        if (buffer.state != BufferState::Copying || !predicate(buffer)) continue;
+
+        if (!coherent) {
+            VkMappedMemoryRange range{};
+            range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+            range.memory = buffer.memory;
+            range.offset = 0;
+            range.size = VK_WHOLE_SIZE;
+            deviceTable->vkInvalidateMappedMemoryRanges(device, 1, &range);
+        }
+
+        buffer.state = BufferState::Consuming;
+        consumeQueue.push_back(i);
+        collected = true;
+    }
+
+    if (collected) {
+        consumeSignal.notify_one();
+    }
+}
+
+void FrameReadback::collect(uint32_t frameSlot) {
+    collectWhere([frameSlot](const ReadbackBuffer& buffer) { return buffer.frameSlot == frameSlot; });
+}
+
+void FrameReadback::collectAll() {
+    collectWhere([](const ReadbackBuffer&) { return true; });
+}
+
+void FrameReadback::waitForConsumer() {
+    std::unique_lock<std::mutex> guard(lock);
+    consumeDone.wait(guard, [this] { return consumeQueue.empty() && !consuming; });
+}
+
+bool FrameReadback::waitForFreeBuffer() {
+    std::unique_lock<std::mutex> guard(lock);
+
+    bool freeBuffer = false;
+    consumeDone.wait(guard, [this, &freeBuffer] {
+        bool consumingBuffer = false;
+        for (const auto& buffer : buffers) {
+            freeBuffer |= buffer.state == BufferState::Free;
+            consumingBuffer |= buffer.state == BufferState::Consuming;
+        }
+        return freeBuffer || !consumingBuffer;
+    });
+    return freeBuffer;
+}
+
+ReadbackStats FrameReadback::stats() const {
+    std::lock_guard<std::mutex> guard(lock);
+    return counters;
+}
+
+void FrameReadback::createBuffers() {
+    const VkDeviceSize size = static_cast<VkDeviceSize>(extent.width) * extent.height * 4;
+
+    for (auto& buffer : buffers) {
+        VkBufferCreateInfo bufferInfo{};
+        bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        bufferInfo.size = size;
+        bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+        bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+        if (deviceTable->vkCreateBuffer(device, &bufferInfo, allocator, &buffer.buffer) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create readback buffer!");
+        }
+
+        VkMemoryRequirements memoryRequirements;
+        deviceTable->vkGetBufferMemoryRequirements(device, buffer.buffer, &memoryRequirements);
+
+        // Cached memory makes the CPU reads fast, it is usually not coherent though
+        uint32_t memoryType = tryFindMemoryType(memoryProperties, memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT);
+        if (memoryType == UINT32_MAX) {
+            memoryType = tryFindMemoryType(memoryProperties, memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        }
+        if (memoryType == UINT32_MAX) {
+            throw std::runtime_error("failed to find host visible memory for readback!");
+        }
+        coherent = (memoryProperties.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) != 0;
+
+        VkMemoryAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocInfo.allocationSize = memoryRequirements.size;
+        allocInfo.memoryTypeIndex = memoryType;
+
+        if (deviceTable->vkAllocateMemory(device, &allocInfo, allocator, &buffer.memory) != VK_SUCCESS) {
+            throw std::runtime_error("failed to allocate readback memory!");
+        }
+        deviceTable->vkBindBufferMemory(device, buffer.buffer, buffer.memory, 0);
+
+        // Mapped once, for as long as the buffer exists
+        void* mapped = nullptr;
+        if (deviceTable->vkMapMemory(device, buffer.memory, 0, VK_WHOLE_SIZE, 0, &mapped) != VK_SUCCESS) {
+            throw std::runtime_error("failed to map readback memory!");
+        }
+        buffer.mapped = static_cast<uint8_t*>(mapped);
+        buffer.state = BufferState::Free;
+    }
+}
+
+void FrameReadback::destroyBuffers() {
+    for (auto& buffer : buffers) {
+        if (buffer.buffer == VK_NULL_HANDLE) continue;
+
+        deviceTable->vkUnmapMemory(device, buffer.memory);
+        deviceTable->vkDestroyBuffer(device, buffer.buffer, allocator);
+        deviceTable->vkFreeMemory(device, buffer.memory, allocator);
+        buffer = ReadbackBuffer{};
+    }
+}
+
+void FrameReadback::consumeLoop() {
+    std::unique_lock<std::mutex> guard(lock);
+
+    for (;;) {
+        consumeSignal.wait(guard, [this] { return stopConsuming || !consumeQueue.empty(); });
+        if (consumeQueue.empty()) return;
+
+        ReadbackBuffer& buffer = buffers[consumeQueue.front()];
+        consumeQueue.pop_front();
+        consuming = true;
+
+        ReadbackImage image{buffer.mapped, extent.width, extent.height, static_cast<size_t>(extent.width) * 4, format, buffer.frameNumber};
+        guard.unlock();
+
+        try {
+            consumer(image);
+        } catch (const std::exception& e) {
+            std::cerr << "frame readback: " << e.what() << std::endl;
+        }
+
+        guard.lock();
+        buffer.state = BufferState::Free;
+        counters.consumed++;
+        consuming = false;
+        consumeDone.notify_all();
+    }
+}
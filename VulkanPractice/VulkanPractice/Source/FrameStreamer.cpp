@@ -0,0 +1,146 @@
+//
+//  FrameStreamer.cpp
+//  VulkanPractice
+//
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+
+#ifdef WIN
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <csignal>
+#include <fcntl.h>
+#include <unistd.h>
+#endif // WIN
+
+#include "FrameStreamer.h"
+
+FrameStreamer::~FrameStreamer() {
+    close();
+}
+
+void FrameStreamer::open(const std::string& path) {
+    this->path = path;
+
+#ifdef WIN
+    if (path == "-") {
+        fd = _dup(1);
+        _dup2(2, 1);
+    } else {
+        fd = _open(path.c_str(), _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, 0644);
+    }
+    if (fd >= 0) {
+        _setmode(fd, _O_BINARY);
+    }
+#else
+    // A reader that goes away should fail the write, not kill the process
+    signal(SIGPIPE, SIG_IGN);
+
+    if (path == "-") {
+        fd = dup(STDOUT_FILENO);
+        dup2(STDERR_FILENO, STDOUT_FILENO);
+    } else {
+        // Blocks until a reader opens the other end when path is a named pipe
+        fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    }
+#endif // WIN
+
+    if (fd < 0) {
+        throw std::runtime_error("failed to open frame stream " + path + ": " + strerror(errno));
+    }
+}
+
+void FrameStreamer::close() {
+    if (fd < 0) return;
+
+#ifdef WIN
+    _close(fd);
+#else
+    ::close(fd);
+#endif // WIN
+    fd = -1;
+}
+
+void FrameStreamer::write(const ReadbackImage& image) {
+    if (writeFailed) return;
+
+    // rawvideo has no header, the reader can't follow a change of the frame size
+    if (framesWritten > 0 && (image.width != width || image.height != height)) {
+        std::cerr << "frame stream: frame size changed to " << image.width << "x" << image.height << ", stopping the stream" << std::endl;
+        writeFailed = true;
+        return;
+    }
+    width = image.width;
+    height = image.height;
+
+    auto start = Clock::now();
+    if (framesWritten == 0) {
+        firstWrite = start;
+    }
+
+    // Rows are tightly packed, so the whole frame goes out in one write from the mapped memory
+    const size_t size = image.rowPitch * image.height;
+    if (!writeAll(image.pixels, size)) {
+        std::cerr << "frame stream: writing to " << path << " failed: " << strerror(errno) << std::endl;
+        writeFailed = true;
+        return;
+    }
+
+    lastWrite = Clock::now();
+    writeSeconds += std::chrono::duration<double>(lastWrite - start).count();
+    framesWritten++;
+    bytesWritten += size;
+}
+
+void FrameStreamer::printFormat(std::ostream& os, VkExtent2D extent, VkFormat format, double frameRate) const {
+    const bool bgra = format == VK_FORMAT_B8G8R8A8_UNORM || format == VK_FORMAT_B8G8R8A8_SRGB;
+
+    os << "Streaming frames to " << path << " as: -f rawvideo -pix_fmt " << (bgra ? "bgra" : "rgba")
+       << " -video_size " << extent.width << "x" << extent.height;
+    if (frameRate > 0.0) {
+        os << " -framerate " << frameRate;
+    }
+    os << std::endl;
+}
+
+void FrameStreamer::printReport(std::ostream& os, const ReadbackStats& readbackStats) const {
+    const double megabytes = bytesWritten / (1024.0 * 1024.0);
+    const double seconds = std::chrono::duration<double>(lastWrite - firstWrite).count();
+
+    os << "Frame stream:\n";
+    os << std::fixed << std::setprecision(1);
+    os << "\tframes written  " << framesWritten << "\n";
+    os << "\tframes dropped  " << readbackStats.skipped << " (no free readback buffer)\n";
+    os << "\tdata written    " << megabytes << " MB\n";
+    if (seconds > 0.0) {
+        os << "\tsustained       " << megabytes / seconds << " MB/s, " << framesWritten / seconds << " fps\n";
+        os << "\tblocked writing " << 100.0 * writeSeconds / seconds << " % of the time\n";
+    }
+    if (writeFailed) {
+        os << "\tstopped early, see the error above\n";
+    }
+    os << std::defaultfloat;
+}
+
+bool FrameStreamer::writeAll(const uint8_t* data, size_t size) {
+    // Pipes accept partial writes, keep going until everything is out
+    while (size > 0) {
+#ifdef WIN
+        int written = _write(fd, data, static_cast<unsigned int>(std::min<size_t>(size, 1u << 30)));
+#else
+        ssize_t written = ::write(fd, data, size);
+        if (written < 0 && errno == EINTR) continue;
+#endif // WIN
+        if (written <= 0) return false;
+
+        data += written;
+        size -= static_cast<size_t>(written);
+    }
+    return true;
+}
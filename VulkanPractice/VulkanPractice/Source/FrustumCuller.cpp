@@ -0,0 +1,239 @@
+//
+//  FrustumCuller.cpp
+//  VulkanPractice
+//
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <stdexcept>
+
+#include "FrustumCuller.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define CULL_SSE2
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define CULL_NEON
+#endif
+
+namespace {
+
+// Below this many objects per thread waking the workers costs more than it saves
+const size_t MIN_OBJECTS_PER_THREAD = 16384;
+const size_t SIMD_WIDTH = 4;
+
+}
+
+FrustumPlanes FrustumPlanes::fromViewProjection(const glm::mat4& viewProjection) {
+    // glm is column major, row i is (m[0][i], m[1][i], m[2][i], m[3][i])
+    auto row = [&](int i) {
+        return glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+    };
+
+    FrustumPlanes frustum;
+    frustum.planes[0] = row(3) + row(0);    // left
+    frustum.planes[1] = row(3) - row(0);    // right
+    frustum.planes[2] = row(3) + row(1);    // bottom
+    frustum.planes[3] = row(3) - row(1);    // top
+    frustum.planes[4] = row(2);             // near, depth 0 instead of -w
+    frustum.planes[5] = row(3) - row(2);    // far
+
+    for (glm::vec4& plane : frustum.planes) {
+        float length = glm::length(glm::vec3(plane));
+        plane = length > 1e-12f ? plane / length : glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+    }
+    return frustum;
+}
+
+FrustumCuller::~FrustumCuller() {
+    destroy();
+}
+
+void FrustumCuller::init(uint32_t threadCount) {
+    workerPool.init(threadCount);
+    lists = std::vector<VisibleList>(workerPool.threadCount());
+}
+
+void FrustumCuller::destroy() {
+    workerPool.destroy();
+    lists.clear();
+}
+
+uint32_t FrustumCuller::addObject(const glm::vec3& center, float sphereRadius, const glm::vec3& aabbMin, const glm::vec3& aabbMax) {
+    centerX.push_back(center.x);
+    centerY.push_back(center.y);
+    centerZ.push_back(center.z);
+    radius.push_back(sphereRadius);
+    minX.push_back(aabbMin.x);
+    minY.push_back(aabbMin.y);
+    minZ.push_back(aabbMin.z);
+    maxX.push_back(aabbMax.x);
+    maxY.push_back(aabbMax.y);
+    maxZ.push_back(aabbMax.z);
+    return static_cast<uint32_t>(radius.size() - 1);
+}
+
+void FrustumCuller::setObject(uint32_t object, const glm::vec3& center, float sphereRadius, const glm::vec3& aabbMin, const glm::vec3& aabbMax) {
+    centerX[object] = center.x;
+    centerY[object] = center.y;
+    centerZ[object] = center.z;
+    radius[object] = sphereRadius;
+    minX[object] = aabbMin.x;
+    minY[object] = aabbMin.y;
+    minZ[object] = aabbMin.z;
+    maxX[object] = aabbMax.x;
+    maxY[object] = aabbMax.y;
+    maxZ[object] = aabbMax.z;
+}
+
+void FrustumCuller::reserve(size_t objectCount) {
+    for (std::vector<float>* component : {&centerX, &centerY, &centerZ, &radius, &minX, &minY, &minZ, &maxX, &maxY, &maxZ}) {
+        component->reserve(objectCount);
+    }
+}
+
+void FrustumCuller::clear() {
+    for (std::vector<float>* component : {&centerX, &centerY, &centerZ, &radius, &minX, &minY, &minZ, &maxX, &maxY, &maxZ}) {
+        component->clear();
+    }
+}
+
+const char* FrustumCuller::simdName() {
+#if defined(CULL_SSE2)
+    return "SSE2";
+#elif defined(CULL_NEON)
+    return "NEON";
+#else
+    return "none";
+#endif
+}
+
+void FrustumCuller::cull(const glm::mat4& viewProjection) {
+    if (lists.empty()) {
+        throw std::runtime_error("frustum culler used before init!");
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    frustum = FrustumPlanes::fromViewProjection(viewProjection);
+
+    for (VisibleList& list : lists) {
+        list.count = 0;
+    }
+    // Ranges start at multiples of the SIMD width, so only the last one has a scalar tail
+    workerPool.parallelFor(objectCount(), MIN_OBJECTS_PER_THREAD, SIMD_WIDTH, [this](uint32_t thread, size_t begin, size_t end) {
+        cullRange(thread, begin, end);
+    });
+
+    cullStats.objects = objectCount();
+    cullStats.visible = 0;
+    for (const VisibleList& list : lists) {
+        cullStats.visible += list.count;
+    }
+    cullStats.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void FrustumCuller::cullRange(uint32_t thread, size_t begin, size_t end) {
+    VisibleList& list = lists[thread];
+    if (list.indices.size() < end - begin) {
+        list.indices.resize(end - begin);
+    }
+    uint32_t* out = list.indices.data();
+
+    size_t count = 0;
+    size_t scalarBegin = begin;
+    if (useSimd) {
+        scalarBegin = begin + (end - begin) / SIMD_WIDTH * SIMD_WIDTH;
+        count = cullSimd(begin, scalarBegin, out);
+    }
+    count += cullScalar(scalarBegin, end, out + count);
+    list.count = count;
+}
+
+size_t FrustumCuller::cullScalar(size_t begin, size_t end, uint32_t* out) const {
+    size_t count = 0;
+    for (size_t i = begin; i < end; i++) {
+        bool inside = true;
+        for (const glm::vec4& plane : frustum.planes) {
+            // Not bit exact with the SIMD loops, NEON accumulates in another order and compilers may fuse. An object
+            // touching a plane can end up on either side, which only decides whether a barely visible object is drawn
+            float distance = (plane.x * centerX[i] + plane.y * centerY[i]) + (plane.z * centerZ[i] + plane.w);
+            inside &= distance >= -radius[i];
+        }
+        if (!inside) continue;
+
+        for (const glm::vec4& plane : frustum.planes) {
+            float x = plane.x > 0.0f ? maxX[i] : minX[i];
+            float y = plane.y > 0.0f ? maxY[i] : minY[i];
+            float z = plane.z > 0.0f ? maxZ[i] : minZ[i];
+            inside &= (plane.x * x + plane.y * y) + (plane.z * z + plane.w) >= 0.0f;
+        }
+        out[count] = static_cast<uint32_t>(i);
+        count += inside;
+    }
+    return count;
+}
+
+size_t FrustumCuller::cullSimd(size_t begin, size_t end, uint32_t* out) const {
+#if defined(CULL_SSE2) || defined(CULL_NEON)
+    size_t count = 0;
+    for (size_t i = begin; i < end; i += SIMD_WIDTH) {
+#if defined(CULL_SSE2)
+        const __m128 x = _mm_loadu_ps(&centerX[i]);
+        const __m128 y = _mm_loadu_ps(&centerY[i]);
+        const __m128 z = _mm_loadu_ps(&centerZ[i]);
+        const __m128 negativeRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(&radius[i]));
+
+        __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        for (const glm::vec4& plane : frustum.planes) {
+            __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.x), x), _mm_mul_ps(_mm_set1_ps(plane.y), y)),
+                                         _mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.z), z), _mm_set1_ps(plane.w)));
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negativeRadius));
+        }
+        if (_mm_movemask_ps(inside) == 0) continue;
+
+        for (const glm::vec4& plane : frustum.planes) {
+            const __m128 px = _mm_loadu_ps(plane.x > 0.0f ? &maxX[i] : &minX[i]);
+            const __m128 py = _mm_loadu_ps(plane.y > 0.0f ? &maxY[i] : &minY[i]);
+            const __m128 pz = _mm_loadu_ps(plane.z > 0.0f ? &maxZ[i] : &minZ[i]);
+            __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.x), px), _mm_mul_ps(_mm_set1_ps(plane.y), py)),
+                                         _mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.z), pz), _mm_set1_ps(plane.w)));
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, _mm_setzero_ps()));
+        }
+        const int mask = _mm_movemask_ps(inside);
+#else
+        const float32x4_t x = vld1q_f32(&centerX[i]);
+        const float32x4_t y = vld1q_f32(&centerY[i]);
+        const float32x4_t z = vld1q_f32(&centerZ[i]);
+        const float32x4_t negativeRadius = vnegq_f32(vld1q_f32(&radius[i]));
+
+        uint32x4_t inside = vdupq_n_u32(0xFFFFFFFF);
+        for (const glm::vec4& plane : frustum.planes) {
+            float32x4_t distance = vmlaq_n_f32(vdupq_n_f32(plane.w), x, plane.x);
+            distance = vmlaq_n_f32(distance, y, plane.y);
+            distance = vmlaq_n_f32(distance, z, plane.z);
+            inside = vandq_u32(inside, vcgeq_f32(distance, negativeRadius));
+        }
+        if (vmaxvq_u32(inside) == 0) continue;
+
+        for (const glm::vec4& plane : frustum.planes) {
+            float32x4_t distance = vmlaq_n_f32(vdupq_n_f32(plane.w), vld1q_f32(plane.x > 0.0f ? &maxX[i] : &minX[i]), plane.x);
+            distance = vmlaq_n_f32(distance, vld1q_f32(plane.y > 0.0f ? &maxY[i] : &minY[i]), plane.y);
+            distance = vmlaq_n_f32(distance, vld1q_f32(plane.z > 0.0f ? &maxZ[i] : &minZ[i]), plane.z);
+            inside = vandq_u32(inside, vcgeq_f32(distance, vdupq_n_f32(0.0f)));
+        }
+        static const uint32_t laneBits[SIMD_WIDTH] = {1, 2, 4, 8};
+        const uint32_t mask = vaddvq_u32(vandq_u32(inside, vld1q_u32(laneBits)));
+#endif
+        // Branchless compaction, a lane that failed is overwritten by the next write
+        for (uint32_t lane = 0; lane < SIMD_WIDTH; lane++) {
+            out[count] = static_cast<uint32_t>(i + lane);
+            count += (mask >> lane) & 1;
+        }
+    }
+    return count;
+#else
+    return cullScalar(begin, end, out);
+#endif
+}
@@ -0,0 +1,183 @@
+//
+//  GpuFrameStats.cpp
+//  VulkanPractice
+//
+
+#include <iomanip>
+#include <stdexcept>
+
+#include "GpuFrameStats.h"
+
+namespace {
+
+// The results come back in the order of the bits, lowest first
+const VkQueryPipelineStatisticFlags pipelineStatisticFlags =
+    VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_PRIMITIVES_BIT |
+    VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT |
+    VK_QUERY_PIPELINE_STATISTIC_CLIPPING_INVOCATIONS_BIT |
+    VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT |
+    VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+const uint32_t pipelineStatisticCount = 5;
+
+}
+
+void GpuFrameStats::init(VkDevice device, const DeviceDispatch* deviceTable, const VkAllocationCallbacks* allocator,
+                         const GpuQuerySupport& support, uint32_t frameSlots) {
+    this->device = device;
+    this->deviceTable = deviceTable;
+    this->allocator = allocator;
+    querySupport = support;
+    slots.assign(frameSlots, Slot{});
+
+    auto createPool = [&](VkQueryType type, uint32_t count, VkQueryPipelineStatisticFlags statistics) {
+        VkQueryPoolCreateInfo queryPoolInfo{};
+        queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        queryPoolInfo.queryType = type;
+        queryPoolInfo.queryCount = count;
+        queryPoolInfo.pipelineStatistics = statistics;
+
+        VkQueryPool pool;
+        if (deviceTable->vkCreateQueryPool(device, &queryPoolInfo, allocator, &pool) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create query pool!");
+        }
+        return pool;
+    };
+
+    // Two timestamps per frame, one query of the other kinds
+    if (querySupport.timestampValidBits > 0) {
+        timestampPool = createPool(VK_QUERY_TYPE_TIMESTAMP, frameSlots * 2, 0);
+    }
+    if (querySupport.pipelineStatistics) {
+        statisticsPool = createPool(VK_QUERY_TYPE_PIPELINE_STATISTICS, frameSlots, pipelineStatisticFlags);
+    }
+    if (querySupport.occlusion) {
+        occlusionPool = createPool(VK_QUERY_TYPE_OCCLUSION, frameSlots, 0);
+    }
+}
+
+void GpuFrameStats::destroy() {
+    for (VkQueryPool* pool : {&timestampPool, &statisticsPool, &occlusionPool}) {
+        if (*pool != VK_NULL_HANDLE) {
+            deviceTable->vkDestroyQueryPool(device, *pool, allocator);
+            *pool = VK_NULL_HANDLE;
+        }
+    }
+    slots.clear();
+}
+
+void GpuFrameStats::beginFrame(VkCommandBuffer commandBuffer, uint32_t frameSlot, uint64_t frameNumber, VkExtent2D extent) {
+    Slot& slot = slots[frameSlot];
+    // Results that weren't available in time are overwritten now
+    if (slot.pending) {
+        droppedFrames++;
+    }
+    slot.pending = true;
+    slot.frameNumber = frameNumber;
+    slot.pixels = static_cast<uint64_t>(extent.width) * extent.height;
+
+    if (timestampPool != VK_NULL_HANDLE) {
+        deviceTable->vkCmdResetQueryPool(commandBuffer, timestampPool, frameSlot * 2, 2);
+        deviceTable->vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, timestampPool, frameSlot * 2);
+    }
+    if (statisticsPool != VK_NULL_HANDLE) {
+        deviceTable->vkCmdResetQueryPool(commandBuffer, statisticsPool, frameSlot, 1);
+        deviceTable->vkCmdBeginQuery(commandBuffer, statisticsPool, frameSlot, 0);
+    }
+    if (occlusionPool != VK_NULL_HANDLE) {
+        deviceTable->vkCmdResetQueryPool(commandBuffer, occlusionPool, frameSlot, 1);
+        deviceTable->vkCmdBeginQuery(commandBuffer, occlusionPool, frameSlot, querySupport.preciseOcclusion ? VK_QUERY_CONTROL_PRECISE_BIT : 0);
+    }
+}
+
+void GpuFrameStats::endFrame(VkCommandBuffer commandBuffer, uint32_t frameSlot) {
+    if (occlusionPool != VK_NULL_HANDLE) {
+        deviceTable->vkCmdEndQuery(commandBuffer, occlusionPool, frameSlot);
+    }
+    if (statisticsPool != VK_NULL_HANDLE) {
+        deviceTable->vkCmdEndQuery(commandBuffer, statisticsPool, frameSlot);
+    }
+    if (timestampPool != VK_NULL_HANDLE) {
+        deviceTable->vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, timestampPool, frameSlot * 2 + 1);
+    }
+}
+
+bool GpuFrameStats::collect(uint32_t frameSlot) {
+    if (frameSlot >= slots.size() || !slots[frameSlot].pending) return false;
+    Slot& slot = slots[frameSlot];
+
+    // Every result is followed by its availability, without VK_QUERY_RESULT_WAIT_BIT the call returns right away
+    const VkQueryResultFlags flags = VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT;
+
+    GpuFrameSample sample;
+    sample.frameNumber = slot.frameNumber;
+    sample.pixels = slot.pixels;
+
+    if (timestampPool != VK_NULL_HANDLE) {
+        uint64_t timestamps[4];
+        deviceTable->vkGetQueryPoolResults(device, timestampPool, frameSlot * 2, 2, sizeof(timestamps), timestamps, 2 * sizeof(uint64_t), flags);
+        if (timestamps[1] == 0 || timestamps[3] == 0) return false;
+
+        // Only the low timestampValidBits bits count, the difference is taken modulo that range
+        const uint64_t mask = querySupport.timestampValidBits >= 64 ? ~0ull : (1ull << querySupport.timestampValidBits) - 1;
+        sample.gpuMs = ((timestamps[2] - timestamps[0]) & mask) * querySupport.timestampPeriod * 1e-6;
+    }
+
+    if (statisticsPool != VK_NULL_HANDLE) {
+        uint64_t statistics[pipelineStatisticCount + 1];
+        deviceTable->vkGetQueryPoolResults(device, statisticsPool, frameSlot, 1, sizeof(statistics), statistics, sizeof(statistics), flags);
+        if (statistics[pipelineStatisticCount] == 0) return false;
+
+        sample.inputAssemblyPrimitives = statistics[0];
+        sample.vertexShaderInvocations = statistics[1];
+        sample.clippingInvocations = statistics[2];
+        sample.clippingPrimitives = statistics[3];
+        sample.fragmentShaderInvocations = statistics[4];
+    }
+
+    if (occlusionPool != VK_NULL_HANDLE) {
+        uint64_t occlusion[2];
+        deviceTable->vkGetQueryPoolResults(device, occlusionPool, frameSlot, 1, sizeof(occlusion), occlusion, sizeof(occlusion), flags);
+        if (occlusion[1] == 0) return false;
+
+        sample.samplesPassed = occlusion[0];
+    }
+
+    slot.pending = false;
+    latestSample = sample;
+
+    totals.pixels += sample.pixels;
+    totals.gpuMs += sample.gpuMs;
+    totals.inputAssemblyPrimitives += sample.inputAssemblyPrimitives;
+    totals.vertexShaderInvocations += sample.vertexShaderInvocations;
+    totals.clippingInvocations += sample.clippingInvocations;
+    totals.clippingPrimitives += sample.clippingPrimitives;
+    totals.fragmentShaderInvocations += sample.fragmentShaderInvocations;
+    totals.samplesPassed += sample.samplesPassed;
+    collectedFrames++;
+    return true;
+}
+
+void GpuFrameStats::printReport(std::ostream& os) const {
+    if (collectedFrames == 0) return;
+
+    const double frames = static_cast<double>(collectedFrames);
+
+    os << "GPU frame statistics (average of " << collectedFrames << " frames, " << droppedFrames << " not ready in time):\n";
+    os << std::fixed << std::setprecision(2);
+    if (timestampPool != VK_NULL_HANDLE) {
+        os << "\tGPU time                  " << std::setw(14) << totals.gpuMs / frames << " ms\n";
+    }
+    if (statisticsPool != VK_NULL_HANDLE) {
+        os << "\tinput assembly primitives " << std::setw(14) << totals.inputAssemblyPrimitives / frames << '\n';
+        os << "\tvertex shader invocations " << std::setw(14) << totals.vertexShaderInvocations / frames << '\n';
+        os << "\tclipping invocations      " << std::setw(14) << totals.clippingInvocations / frames << '\n';
+        os << "\tclipping primitives       " << std::setw(14) << totals.clippingPrimitives / frames << '\n';
+        os << "\tfragment invocations      " << std::setw(14) << totals.fragmentShaderInvocations / frames
+           << "  (overdraw " << totals.overdraw() << ")\n";
+    }
+    if (occlusionPool != VK_NULL_HANDLE) {
+        os << "\tsamples passed            " << std::setw(14) << totals.samplesPassed / frames
+           << (querySupport.preciseOcclusion ? "" : "  (not precise, only zero or not zero is meaningful)") << '\n';
+    }
+    os << std::defaultfloat;
+}
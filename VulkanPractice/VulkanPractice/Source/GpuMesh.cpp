@@ -0,0 +1,222 @@
+//
+//  GpuMesh.cpp
+//  VulkanPractice
+//
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+
+#include <glm/gtc/packing.hpp>
+
+#include "GpuMesh.h"
+#include "VulkanMemory.h"
+
+namespace {
+
+struct QuantizedVertex {
+    // snorm16 x, y, z and one unused, as two words so the struct isn't padded to 8 byte alignment
+    uint32_t position[2];
+    // Octahedral snorm16 x, y
+    uint32_t normal;
+    // Half float u, v
+    uint32_t uv;
+    // unorm8 RGBA
+    uint32_t color;
+};
+
+static_assert(sizeof(QuantizedVertex) == 20, "QuantizedVertex must stay tightly packed");
+
+// Projects the normal onto the octahedron |x| + |y| + |z| = 1 and folds the lower half over the upper one
+glm::vec2 octahedralEncode(glm::vec3 normal) {
+    const float sum = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+    if (sum == 0.0f) return glm::vec2(0.0f);
+
+    normal /= sum;
+    glm::vec2 encoded(normal.x, normal.y);
+    if (normal.z < 0.0f) {
+        const glm::vec2 sign(encoded.x >= 0.0f ? 1.0f : -1.0f, encoded.y >= 0.0f ? 1.0f : -1.0f);
+        encoded = (1.0f - glm::abs(glm::vec2(encoded.y, encoded.x))) * sign;
+    }
+    return encoded;
+}
+
+glm::vec3 octahedralDecode(glm::vec2 encoded) {
+    glm::vec3 normal(encoded, 1.0f - std::abs(encoded.x) - std::abs(encoded.y));
+    if (normal.z < 0.0f) {
+        const glm::vec2 sign(normal.x >= 0.0f ? 1.0f : -1.0f, normal.y >= 0.0f ? 1.0f : -1.0f);
+        const glm::vec2 unfolded = (1.0f - glm::abs(glm::vec2(normal.y, normal.x))) * sign;
+        normal.x = unfolded.x;
+        normal.y = unfolded.y;
+    }
+    return glm::normalize(normal);
+}
+
+}
+
+VertexLayout GpuMesh::vertexLayout(VertexFormat format) {
+    VertexLayout layout;
+    layout.stride = vertexSize(format);
+    if (format == VertexFormat::Quantized) {
+        layout.add(VK_FORMAT_R16G16B16A16_SNORM, offsetof(QuantizedVertex, position))
+            .add(VK_FORMAT_R16G16_SNORM, offsetof(QuantizedVertex, normal))
+            .add(VK_FORMAT_R16G16_SFLOAT, offsetof(QuantizedVertex, uv))
+            .add(VK_FORMAT_R8G8B8A8_UNORM, offsetof(QuantizedVertex, color));
+    } else {
+        layout.add(VK_FORMAT_R32G32B32_SFLOAT, offsetof(MeshVertex, position))
+            .add(VK_FORMAT_R32G32B32_SFLOAT, offsetof(MeshVertex, normal))
+            .add(VK_FORMAT_R32G32_SFLOAT, offsetof(MeshVertex, uv))
+            .add(VK_FORMAT_R32G32B32A32_SFLOAT, offsetof(MeshVertex, color));
+    }
+    return layout;
+}
+
+MeshBounds GpuMesh::computeBounds(const std::vector<MeshVertex>& vertices) {
+    MeshBounds bounds;
+    if (vertices.empty()) return bounds;
+
+    glm::vec3 minimum(vertices[0].position[0], vertices[0].position[1], vertices[0].position[2]);
+    glm::vec3 maximum = minimum;
+    for (const MeshVertex& vertex : vertices) {
+        const glm::vec3 position(vertex.position[0], vertex.position[1], vertex.position[2]);
+        minimum = glm::min(minimum, position);
+        maximum = glm::max(maximum, position);
+    }
+
+    bounds.center = (minimum + maximum) * 0.5f;
+    bounds.halfExtent = (maximum - minimum) * 0.5f;
+    return bounds;
+}
+
+std::vector<uint8_t> GpuMesh::encodeVertices(const std::vector<MeshVertex>& vertices, VertexFormat format, const MeshBounds& bounds) {
+    if (format == VertexFormat::Float) {
+        const auto* bytes = reinterpret_cast<const uint8_t*>(vertices.data());
+        return std::vector<uint8_t>(bytes, bytes + vertices.size() * sizeof(MeshVertex));
+    }
+
+    // A flat axis has no extent, every position on it quantizes to the center
+    const glm::vec3 scale(bounds.halfExtent.x > 0.0f ? 1.0f / bounds.halfExtent.x : 0.0f,
+                          bounds.halfExtent.y > 0.0f ? 1.0f / bounds.halfExtent.y : 0.0f,
+                          bounds.halfExtent.z > 0.0f ? 1.0f / bounds.halfExtent.z : 0.0f);
+
+    std::vector<uint8_t> encoded(vertices.size() * sizeof(QuantizedVertex));
+    auto* out = reinterpret_cast<QuantizedVertex*>(encoded.data());
+    for (const MeshVertex& vertex : vertices) {
+        const glm::vec3 position = (glm::vec3(vertex.position[0], vertex.position[1], vertex.position[2]) - bounds.center) * scale;
+        const uint64_t packedPosition = glm::packSnorm4x16(glm::vec4(position, 0.0f));
+
+        QuantizedVertex quantized;
+        std::memcpy(quantized.position, &packedPosition, sizeof(quantized.position));
+        quantized.normal = glm::packSnorm2x16(octahedralEncode(glm::vec3(vertex.normal[0], vertex.normal[1], vertex.normal[2])));
+        quantized.uv = glm::packHalf2x16(glm::vec2(vertex.uv[0], vertex.uv[1]));
+        quantized.color = glm::packUnorm4x8(glm::vec4(vertex.color[0], vertex.color[1], vertex.color[2], vertex.color[3]));
+        *out++ = quantized;
+    }
+    return encoded;
+}
+
+MeshVertex GpuMesh::decodeVertex(const uint8_t* encoded, VertexFormat format, const MeshBounds& bounds) {
+    MeshVertex vertex;
+    if (format == VertexFormat::Float) {
+        std::memcpy(&vertex, encoded, sizeof(MeshVertex));
+        return vertex;
+    }
+
+    QuantizedVertex quantized;
+    std::memcpy(&quantized, encoded, sizeof(QuantizedVertex));
+
+    uint64_t packedPosition;
+    std::memcpy(&packedPosition, quantized.position, sizeof(packedPosition));
+    const glm::vec3 position = bounds.center + glm::vec3(glm::unpackSnorm4x16(packedPosition)) * bounds.halfExtent;
+    const glm::vec3 normal = octahedralDecode(glm::unpackSnorm2x16(quantized.normal));
+    const glm::vec2 uv = glm::unpackHalf2x16(quantized.uv);
+    const glm::vec4 color = glm::unpackUnorm4x8(quantized.color);
+
+    for (int i = 0; i < 3; i++) {
+        vertex.position[i] = position[i];
+        vertex.normal[i] = normal[i];
+    }
+    vertex.uv[0] = uv.x;
+    vertex.uv[1] = uv.y;
+    for (int i = 0; i < 4; i++) {
+        vertex.color[i] = color[i];
+    }
+    return vertex;
+}
+
+uint32_t GpuMesh::vertexSize(VertexFormat format) {
+    return format == VertexFormat::Quantized ? sizeof(QuantizedVertex) : sizeof(MeshVertex);
+}
+
+void GpuMesh::init(VkPhysicalDevice physicalDevice, const InstanceDispatch& instanceTable, VkDevice device, const DeviceDispatch* deviceTable,
+                   const VkAllocationCallbacks* allocator, VkQueue queue, VkCommandPool commandPool, const Mesh& mesh, VertexFormat format) {
+    this->device = device;
+    this->deviceTable = deviceTable;
+    this->allocator = allocator;
+    vertexFormat = format;
+    indices = static_cast<uint32_t>(mesh.indices.size());
+    meshLods = mesh.lods;
+    if (meshLods.empty()) {
+        meshLods.push_back({0, indices, 0.0f});
+    }
+
+    instanceTable.vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+
+    meshBounds = computeBounds(mesh.vertices);
+    const std::vector<uint8_t> vertices = encodeVertices(mesh.vertices, format, meshBounds);
+    vertexBufferSize = std::max<VkDeviceSize>(vertices.size(), 4);
+    indexBufferSize = std::max<VkDeviceSize>(mesh.indices.size() * sizeof(uint32_t), 4);
+
+    // One staging buffer for both, indices after the vertices
+    VkBuffer stagingBuffer;
+    VkDeviceMemory stagingMemory;
+    createBuffer(device, *deviceTable, allocator, memoryProperties,
+                 vertexBufferSize + indexBufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                 VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingMemory);
+
+    void* mapped = nullptr;
+    deviceTable->vkMapMemory(device, stagingMemory, 0, VK_WHOLE_SIZE, 0, &mapped);
+    std::memcpy(mapped, vertices.data(), vertices.size());
+    std::memcpy(static_cast<uint8_t*>(mapped) + vertexBufferSize, mesh.indices.data(), mesh.indices.size() * sizeof(uint32_t));
+    deviceTable->vkUnmapMemory(device, stagingMemory);
+
+    createBuffer(device, *deviceTable, allocator, memoryProperties,
+                 vertexBufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                 vertexBuffer, vertexMemory);
+    createBuffer(device, *deviceTable, allocator, memoryProperties,
+                 indexBufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                 indexBuffer, indexMemory);
+
+    submitOnce(device, *deviceTable, queue, commandPool, [&](VkCommandBuffer commandBuffer) {
+        VkBufferCopy region{};
+        region.size = vertexBufferSize;
+        deviceTable->vkCmdCopyBuffer(commandBuffer, stagingBuffer, vertexBuffer, 1, &region);
+
+        region.srcOffset = vertexBufferSize;
+        region.size = indexBufferSize;
+        deviceTable->vkCmdCopyBuffer(commandBuffer, stagingBuffer, indexBuffer, 1, &region);
+    });
+
+    deviceTable->vkDestroyBuffer(device, stagingBuffer, allocator);
+    deviceTable->vkFreeMemory(device, stagingMemory, allocator);
+}
+
+void GpuMesh::destroy() {
+    deviceTable->vkDestroyBuffer(device, vertexBuffer, allocator);
+    deviceTable->vkFreeMemory(device, vertexMemory, allocator);
+    deviceTable->vkDestroyBuffer(device, indexBuffer, allocator);
+    deviceTable->vkFreeMemory(device, indexMemory, allocator);
+
+    vertexBuffer = VK_NULL_HANDLE;
+    vertexMemory = VK_NULL_HANDLE;
+    indexBuffer = VK_NULL_HANDLE;
+    indexMemory = VK_NULL_HANDLE;
+}
+
+void GpuMesh::bind(VkCommandBuffer commandBuffer) const {
+    VkDeviceSize offset = 0;
+    deviceTable->vkCmdBindVertexBuffers(commandBuffer, 0, 1, &vertexBuffer, &offset);
+    deviceTable->vkCmdBindIndexBuffer(commandBuffer, indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+}
@@ -0,0 +1,282 @@
+//
+//  GpuProfiler.cpp
+//  VulkanPractice
+//
+
+#include <algorithm>
+#include <iomanip>
+#include <stdexcept>
+#include <string>
+
+#ifdef WIN
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#endif // WIN
+
+#include "GpuProfiler.h"
+
+namespace {
+
+// The host time domain steady_clock counts in: QueryPerformanceCounter with MSVC, CLOCK_MONOTONIC with libstdc++ and libc++
+// on Linux. The clock of steady_clock on macOS has no time domain
+#ifdef WIN
+const bool hasHostTimeDomain = true;
+const VkTimeDomainEXT hostTimeDomain = VK_TIME_DOMAIN_QUERY_PERFORMANCE_COUNTER_EXT;
+#elif defined(__linux__)
+const bool hasHostTimeDomain = true;
+const VkTimeDomainEXT hostTimeDomain = VK_TIME_DOMAIN_CLOCK_MONOTONIC_EXT;
+#else
+const bool hasHostTimeDomain = false;
+const VkTimeDomainEXT hostTimeDomain = VK_TIME_DOMAIN_DEVICE_EXT;
+#endif
+
+// A value of the host time domain in steady_clock nanoseconds
+int64_t hostToNs(uint64_t value) {
+#ifdef WIN
+    LARGE_INTEGER frequency;
+    QueryPerformanceFrequency(&frequency);
+    // Split like MSVC's steady_clock, so the multiplication doesn't overflow
+    const uint64_t ticksPerSecond = static_cast<uint64_t>(frequency.QuadPart);
+    return static_cast<int64_t>(value / ticksPerSecond * 1000000000ull + value % ticksPerSecond * 1000000000ull / ticksPerSecond);
+#else
+    return static_cast<int64_t>(value);
+#endif
+}
+
+}
+
+bool GpuProfiler::supportsCalibration(VkPhysicalDevice physicalDevice, const InstanceDispatch& instanceTable) {
+    if (!hasHostTimeDomain || instanceTable.vkGetPhysicalDeviceCalibrateableTimeDomainsEXT == nullptr) return false;
+
+    uint32_t domainCount = 0;
+    instanceTable.vkGetPhysicalDeviceCalibrateableTimeDomainsEXT(physicalDevice, &domainCount, nullptr);
+    std::vector<VkTimeDomainEXT> domains(domainCount);
+    instanceTable.vkGetPhysicalDeviceCalibrateableTimeDomainsEXT(physicalDevice, &domainCount, domains.data());
+
+    return std::find(domains.begin(), domains.end(), VK_TIME_DOMAIN_DEVICE_EXT) != domains.end()
+        && std::find(domains.begin(), domains.end(), hostTimeDomain) != domains.end();
+}
+
+void GpuProfiler::init(VkDevice device, const DeviceDispatch* deviceTable, const VkAllocationCallbacks* allocator, VkQueue queue,
+                       uint32_t queueIndex, VkCommandPool commandPool, uint32_t timestampValidBits, float timestampPeriod, uint32_t frameSlots,
+                       uint32_t zonesPerFrame, bool calibratedTimestamps) {
+    this->device = device;
+    this->deviceTable = deviceTable;
+    this->allocator = allocator;
+    this->queue = queue;
+    this->queueIndex = queueIndex;
+    this->commandPool = commandPool;
+    this->timestampValidBits = timestampValidBits;
+    this->timestampPeriod = timestampPeriod;
+    this->zonesPerFrame = zonesPerFrame;
+    this->calibratedTimestamps = calibratedTimestamps && deviceTable->vkGetCalibratedTimestampsEXT != nullptr;
+
+    if (timestampValidBits == 0 || zonesPerFrame == 0) return;
+
+    VkQueryPoolCreateInfo queryPoolInfo{};
+    queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    queryPoolInfo.queryCount = frameSlots * zonesPerFrame * 2;
+
+    if (deviceTable->vkCreateQueryPool(device, &queryPoolInfo, allocator, &timestampPool) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create profiler query pool!");
+    }
+
+    this->frameSlots.assign(frameSlots, FrameSlot{});
+    for (FrameSlot& slot : this->frameSlots) {
+        slot.names.reserve(zonesPerFrame);
+        slot.depths.reserve(zonesPerFrame);
+    }
+    openZones.reserve(zonesPerFrame);
+    collected.resize(zoneCapacity);
+    collectedCount = 0;
+
+    if (this->calibratedTimestamps) {
+        calibrate();
+    } else {
+        calibrateWithSubmit();
+    }
+}
+
+void GpuProfiler::destroy() {
+    if (timestampPool == VK_NULL_HANDLE) return;
+
+    deviceTable->vkDestroyQueryPool(device, timestampPool, allocator);
+    timestampPool = VK_NULL_HANDLE;
+    frameSlots.clear();
+    collected.clear();
+}
+
+void GpuProfiler::beginFrame(VkCommandBuffer commandBuffer, uint32_t frameSlot) {
+    if (timestampPool == VK_NULL_HANDLE) return;
+
+    // Results that weren't collected in time are overwritten now
+    FrameSlot& slot = frameSlots[frameSlot];
+    if (slot.pending) {
+        framesDropped++;
+    }
+    slot.names.clear();
+    slot.depths.clear();
+    slot.pending = true;
+    recordingSlot = frameSlot;
+    openZones.clear();
+
+    deviceTable->vkCmdResetQueryPool(commandBuffer, timestampPool, frameSlot * zonesPerFrame * 2, zonesPerFrame * 2);
+}
+
+void GpuProfiler::beginZone(VkCommandBuffer commandBuffer, const char* name) {
+    if (timestampPool == VK_NULL_HANDLE) return;
+
+    FrameSlot& slot = frameSlots[recordingSlot];
+    if (slot.names.size() == zonesPerFrame) {
+        zonesLeftOut++;
+        openZones.push_back(zonesPerFrame);
+        return;
+    }
+
+    const uint32_t zone = static_cast<uint32_t>(slot.names.size());
+    slot.names.push_back(name);
+    slot.depths.push_back(static_cast<uint32_t>(openZones.size()));
+    openZones.push_back(zone);
+
+    deviceTable->vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, timestampPool,
+                                     (recordingSlot * zonesPerFrame + zone) * 2);
+}
+
+void GpuProfiler::endZone(VkCommandBuffer commandBuffer) {
+    if (timestampPool == VK_NULL_HANDLE || openZones.empty()) return;
+
+    const uint32_t zone = openZones.back();
+    openZones.pop_back();
+    if (zone == zonesPerFrame) return;
+
+    deviceTable->vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, timestampPool,
+                                     (recordingSlot * zonesPerFrame + zone) * 2 + 1);
+}
+
+bool GpuProfiler::collect(uint32_t frameSlot) {
+    if (timestampPool == VK_NULL_HANDLE || frameSlot >= frameSlots.size() || !frameSlots[frameSlot].pending) return false;
+
+    FrameSlot& slot = frameSlots[frameSlot];
+    const uint32_t queryCount = static_cast<uint32_t>(slot.names.size()) * 2;
+    if (queryCount == 0) {
+        slot.pending = false;
+        return true;
+    }
+
+    // Every timestamp is followed by its availability, without VK_QUERY_RESULT_WAIT_BIT the call returns right away
+    std::vector<uint64_t> results(queryCount * 2);
+    deviceTable->vkGetQueryPoolResults(device, timestampPool, frameSlot * zonesPerFrame * 2, queryCount,
+                                       results.size() * sizeof(uint64_t), results.data(), 2 * sizeof(uint64_t),
+                                       VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+    for (uint32_t query = 0; query < queryCount; query++) {
+        if (results[query * 2 + 1] == 0) return false;
+    }
+
+    if (calibratedTimestamps) {
+        calibrate();
+    }
+
+    for (size_t zone = 0; zone < slot.names.size(); zone++) {
+        TraceZone& trace = collected[collectedCount % zoneCapacity];
+        trace.name = slot.names[zone];
+        trace.beginNs = toCpuNs(results[zone * 4]);
+        trace.endNs = toCpuNs(results[zone * 4 + 2]);
+        trace.depth = slot.depths[zone];
+        trace.thread = queueIndex;
+        collectedCount++;
+    }
+    slot.pending = false;
+    return true;
+}
+
+std::vector<TraceZone> GpuProfiler::zones() const {
+    std::vector<TraceZone> zones;
+    const uint64_t first = collectedCount > zoneCapacity ? collectedCount - zoneCapacity : 0;
+    zones.reserve(static_cast<size_t>(collectedCount - first));
+    for (uint64_t position = first; position < collectedCount; position++) {
+        zones.push_back(collected[position % zoneCapacity]);
+    }
+    return zones;
+}
+
+void GpuProfiler::printReport(std::ostream& os, const std::string& queueName) const {
+    if (collectedCount == 0) return;
+
+    std::string label = "GPU " + queueName + (calibratedTimestamps ? ", calibrated timestamps" : ", calibrated with a submit");
+    Profiler::printReport(os, zones(), label);
+    os << "\tcalibration within " << std::fixed << std::setprecision(3) << calibrationDeviationNs / 1000.0 << " us, "
+       << framesDropped << " frames not ready in time, " << zonesLeftOut << " zones over " << zonesPerFrame << " per frame\n";
+    os << std::defaultfloat;
+}
+
+void GpuProfiler::calibrate() {
+    VkCalibratedTimestampInfoEXT timestampInfos[2]{};
+    timestampInfos[0].sType = VK_STRUCTURE_TYPE_CALIBRATED_TIMESTAMP_INFO_EXT;
+    timestampInfos[0].timeDomain = VK_TIME_DOMAIN_DEVICE_EXT;
+    timestampInfos[1].sType = VK_STRUCTURE_TYPE_CALIBRATED_TIMESTAMP_INFO_EXT;
+    timestampInfos[1].timeDomain = hostTimeDomain;
+
+    uint64_t timestamps[2];
+    uint64_t maxDeviation = 0;
+    if (deviceTable->vkGetCalibratedTimestampsEXT(device, 2, timestampInfos, timestamps, &maxDeviation) != VK_SUCCESS) {
+        throw std::runtime_error("failed to get calibrated timestamps!");
+    }
+
+    calibrationTicks = timestamps[0];
+    calibrationNs = hostToNs(timestamps[1]);
+    calibrationDeviationNs = static_cast<double>(maxDeviation);
+}
+
+void GpuProfiler::calibrateWithSubmit() {
+    VkCommandBufferAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.commandPool = commandPool;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandBufferCount = 1;
+
+    VkCommandBuffer commandBuffer;
+    if (deviceTable->vkAllocateCommandBuffers(device, &allocInfo, &commandBuffer) != VK_SUCCESS) {
+        throw std::runtime_error("failed to allocate profiler calibration command buffer!");
+    }
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    // Nothing uses the queries yet, the first one is borrowed
+    deviceTable->vkBeginCommandBuffer(commandBuffer, &beginInfo);
+    deviceTable->vkCmdResetQueryPool(commandBuffer, timestampPool, 0, 1);
+    deviceTable->vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, timestampPool, 0);
+    deviceTable->vkEndCommandBuffer(commandBuffer);
+
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &commandBuffer;
+
+    const int64_t beforeNs = Profiler::now();
+    if (deviceTable->vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
+        throw std::runtime_error("failed to submit profiler calibration!");
+    }
+    deviceTable->vkQueueWaitIdle(queue);
+    const int64_t afterNs = Profiler::now();
+
+    uint64_t ticks = 0;
+    deviceTable->vkGetQueryPoolResults(device, timestampPool, 0, 1, sizeof(ticks), &ticks, sizeof(ticks),
+                                       VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT);
+    deviceTable->vkFreeCommandBuffers(device, commandPool, 1, &commandBuffer);
+
+    calibrationTicks = ticks;
+    calibrationNs = beforeNs + (afterNs - beforeNs) / 2;
+    calibrationDeviationNs = (afterNs - beforeNs) / 2.0;
+}
+
+int64_t GpuProfiler::toCpuNs(uint64_t ticks) const {
+    // Only the low timestampValidBits bits count. The difference is sign extended from them, so ticks before the
+    // calibration come out negative and a wrap in between is taken care of
+    const uint32_t unusedBits = 64 - std::min(timestampValidBits, 64u);
+    const int64_t deltaTicks = static_cast<int64_t>((ticks - calibrationTicks) << unusedBits) >> unusedBits;
+    return calibrationNs + static_cast<int64_t>(deltaTicks * static_cast<double>(timestampPeriod));
+}
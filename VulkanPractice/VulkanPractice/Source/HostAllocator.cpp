@@ -0,0 +1,264 @@
+//
+//  HostAllocator.cpp
+//  VulkanPractice
+//
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+
+#include "HostAllocator.h"
+
+HostAllocator::HostAllocator() {
+    allocationCallbacks.pUserData = this;
+    allocationCallbacks.pfnAllocation = allocationFunction;
+    allocationCallbacks.pfnReallocation = reallocationFunction;
+    allocationCallbacks.pfnFree = freeFunction;
+    allocationCallbacks.pfnInternalAllocation = internalAllocationNotification;
+    allocationCallbacks.pfnInternalFree = internalFreeNotification;
+
+    // Warm every size class up front so the first frames don't pay for it either
+    for (size_t i = 0; i < SIZE_CLASS_COUNT; i++) {
+        refillPool(pools[i], blockSizeFor(i));
+    }
+}
+
+HostAllocator::~HostAllocator() {
+    for (auto& pool : pools) {
+        for (void* chunk : pool.chunks) {
+            std::free(chunk);
+        }
+    }
+}
+
+void HostAllocator::nextFrame() {
+    lastFrame.allocations = frameAllocations.exchange(0, std::memory_order_relaxed);
+    lastFrame.systemHeapAllocations = frameSystemHeapAllocations.exchange(0, std::memory_order_relaxed);
+    lastFrame.bytes = frameBytes.exchange(0, std::memory_order_relaxed);
+
+    frameCount++;
+    allocationsOverAllFrames += lastFrame.allocations;
+    if (lastFrame.systemHeapAllocations > 0) {
+        framesTouchingSystemHeap++;
+    }
+}
+
+void HostAllocator::printReport(std::ostream& os) const {
+    os << "Host allocations per scope:\n";
+    for (size_t scope = 0; scope < SCOPE_COUNT; scope++) {
+        const ScopeStats& stats = scopeStats[scope];
+        os << '\t' << std::left << std::setw(9) << scopeName(scope) << std::right
+           << " total " << stats.totalAllocations.load()
+           << ", system heap " << stats.systemHeapAllocations.load()
+           << ", live " << stats.liveCount.load() << " (" << stats.liveBytes.load() << " bytes)"
+           << ", peak " << stats.peakBytes.load() << " bytes"
+           << ", driver internal " << stats.internalBytes.load() << " bytes\n";
+    }
+
+    if (frameCount > 0) {
+        os << "Host allocations per frame: " << static_cast<double>(allocationsOverAllFrames) / frameCount
+           << " on average, " << framesTouchingSystemHeap << " of " << frameCount << " frames hit the system heap\n";
+    }
+}
+
+// Vulkan callbacks, pUserData is the allocator
+
+VKAPI_ATTR void* VKAPI_CALL HostAllocator::allocationFunction(void* pUserData, size_t size, size_t alignment, VkSystemAllocationScope allocationScope) {
+    return static_cast<HostAllocator*>(pUserData)->allocate(size, alignment, allocationScope);
+}
+
+VKAPI_ATTR void* VKAPI_CALL HostAllocator::reallocationFunction(void* pUserData, void* pOriginal, size_t size, size_t alignment, VkSystemAllocationScope allocationScope) {
+    return static_cast<HostAllocator*>(pUserData)->reallocate(pOriginal, size, alignment, allocationScope);
+}
+
+VKAPI_ATTR void VKAPI_CALL HostAllocator::freeFunction(void* pUserData, void* pMemory) {
+    static_cast<HostAllocator*>(pUserData)->release(pMemory);
+}
+
+VKAPI_ATTR void VKAPI_CALL HostAllocator::internalAllocationNotification(void* pUserData, size_t size, VkInternalAllocationType allocationType, VkSystemAllocationScope allocationScope) {
+    auto allocator = static_cast<HostAllocator*>(pUserData);
+    allocator->scopeStats[allocationScope].internalBytes.fetch_add(size, std::memory_order_relaxed);
+}
+
+VKAPI_ATTR void VKAPI_CALL HostAllocator::internalFreeNotification(void* pUserData, size_t size, VkInternalAllocationType allocationType, VkSystemAllocationScope allocationScope) {
+    auto allocator = static_cast<HostAllocator*>(pUserData);
+    allocator->scopeStats[allocationScope].internalBytes.fetch_sub(size, std::memory_order_relaxed);
+}
+
+// Allocation
+
+void* HostAllocator::allocate(size_t size, size_t alignment, VkSystemAllocationScope scope) {
+    if (size == 0) return nullptr;
+
+    int sizeClass = -1;
+    if (scope == VK_SYSTEM_ALLOCATION_SCOPE_COMMAND || scope == VK_SYSTEM_ALLOCATION_SCOPE_OBJECT) {
+        sizeClass = sizeClassFor(size, alignment);
+    }
+
+    bool touchedSystemHeap = false;
+    char* block = nullptr;
+    uint32_t offset = sizeof(AllocationHeader);
+    if (sizeClass >= 0) {
+        block = static_cast<char*>(allocateFromPool(static_cast<uint16_t>(sizeClass), touchedSystemHeap));
+    } else {
+        block = static_cast<char*>(allocateFromSystem(size, alignment, offset));
+        touchedSystemHeap = true;
+    }
+
+    if (block == nullptr) return nullptr;
+
+    char* memory = block + offset;
+    auto header = reinterpret_cast<AllocationHeader*>(memory) - 1;
+    header->size = size;
+    header->offset = offset;
+    header->sizeClass = sizeClass >= 0 ? static_cast<uint16_t>(sizeClass) : SYSTEM_HEAP_CLASS;
+    header->scope = static_cast<uint16_t>(scope);
+
+    ScopeStats& stats = scopeStats[scope];
+    uint64_t liveBytes = stats.liveBytes.fetch_add(size, std::memory_order_relaxed) + size;
+    stats.liveCount.fetch_add(1, std::memory_order_relaxed);
+    stats.totalAllocations.fetch_add(1, std::memory_order_relaxed);
+
+    uint64_t peak = stats.peakBytes.load(std::memory_order_relaxed);
+    while (liveBytes > peak && !stats.peakBytes.compare_exchange_weak(peak, liveBytes, std::memory_order_relaxed)) {
+    }
+
+    frameAllocations.fetch_add(1, std::memory_order_relaxed);
+    frameBytes.fetch_add(size, std::memory_order_relaxed);
+    if (touchedSystemHeap) {
+        stats.systemHeapAllocations.fetch_add(1, std::memory_order_relaxed);
+        frameSystemHeapAllocations.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    return memory;
+}
+
+void* HostAllocator::reallocate(void* pOriginal, size_t size, size_t alignment, VkSystemAllocationScope scope) {
+    if (pOriginal == nullptr) {
+        return allocate(size, alignment, scope);
+    }
+
+    if (size == 0) {
+        release(pOriginal);
+        return nullptr;
+    }
+
+    auto header = static_cast<AllocationHeader*>(pOriginal) - 1;
+
+    // Still fits in the same block, nothing to move
+    if (header->sizeClass != SYSTEM_HEAP_CLASS && header->scope == scope &&
+        sizeClassFor(size, alignment) == header->sizeClass) {
+        ScopeStats& stats = scopeStats[scope];
+        stats.liveBytes.fetch_add(size, std::memory_order_relaxed);
+        stats.liveBytes.fetch_sub(header->size, std::memory_order_relaxed);
+        header->size = size;
+        return pOriginal;
+    }
+
+    void* memory = allocate(size, alignment, scope);
+    if (memory == nullptr) {
+        // Per spec the original allocation stays valid when reallocation fails
+        return nullptr;
+    }
+
+    memcpy(memory, pOriginal, std::min(size, header->size));
+    release(pOriginal);
+
+    return memory;
+}
+
+void HostAllocator::release(void* pMemory) {
+    if (pMemory == nullptr) return;
+
+    auto header = static_cast<AllocationHeader*>(pMemory) - 1;
+    char* block = static_cast<char*>(pMemory) - header->offset;
+
+    ScopeStats& stats = scopeStats[header->scope];
+    stats.liveBytes.fetch_sub(header->size, std::memory_order_relaxed);
+    stats.liveCount.fetch_sub(1, std::memory_order_relaxed);
+
+    if (header->sizeClass == SYSTEM_HEAP_CLASS) {
+        std::free(block);
+        return;
+    }
+
+    SizeClassPool& pool = pools[header->sizeClass];
+    auto freeBlock = reinterpret_cast<FreeBlock*>(block);
+
+    std::lock_guard<std::mutex> lock(pool.lock);
+    freeBlock->next = pool.freeList;
+    pool.freeList = freeBlock;
+}
+
+void* HostAllocator::allocateFromPool(uint16_t sizeClass, bool& touchedSystemHeap) {
+    SizeClassPool& pool = pools[sizeClass];
+
+    std::lock_guard<std::mutex> lock(pool.lock);
+    if (pool.freeList == nullptr) {
+        touchedSystemHeap = true;
+        if (!refillPool(pool, blockSizeFor(sizeClass))) {
+            return nullptr;
+        }
+    }
+
+    FreeBlock* block = pool.freeList;
+    pool.freeList = block->next;
+
+    return block;
+}
+
+bool HostAllocator::refillPool(SizeClassPool& pool, size_t blockSize) {
+    // malloc already returns memory aligned for any fundamental type, which covers POOL_ALIGNMENT
+    auto chunk = static_cast<char*>(std::malloc(ARENA_CHUNK_SIZE));
+    if (chunk == nullptr) return false;
+
+    pool.chunks.push_back(chunk);
+
+    // Thread the new blocks into the free list
+    for (size_t offset = 0; offset + blockSize <= ARENA_CHUNK_SIZE; offset += blockSize) {
+        auto block = reinterpret_cast<FreeBlock*>(chunk + offset);
+        block->next = pool.freeList;
+        pool.freeList = block;
+    }
+
+    return true;
+}
+
+void* HostAllocator::allocateFromSystem(size_t size, size_t alignment, uint32_t& offset) {
+    alignment = std::max(alignment, POOL_ALIGNMENT);
+
+    // Room for the header plus worst case padding to reach the requested alignment
+    auto block = static_cast<char*>(std::malloc(size + sizeof(AllocationHeader) + alignment));
+    if (block == nullptr) return nullptr;
+
+    uintptr_t address = reinterpret_cast<uintptr_t>(block) + sizeof(AllocationHeader);
+    uintptr_t aligned = (address + alignment - 1) & ~(static_cast<uintptr_t>(alignment) - 1);
+    offset = static_cast<uint32_t>(aligned - reinterpret_cast<uintptr_t>(block));
+
+    return block;
+}
+
+int HostAllocator::sizeClassFor(size_t size, size_t alignment) {
+    if (alignment > POOL_ALIGNMENT) return -1;
+
+    size_t needed = size + sizeof(AllocationHeader);
+    for (size_t i = 0; i < SIZE_CLASS_COUNT; i++) {
+        if (needed <= blockSizeFor(i)) {
+            return static_cast<int>(i);
+        }
+    }
+
+    return -1;
+}
+
+const char* HostAllocator::scopeName(size_t scope) {
+    switch (scope) {
+        case VK_SYSTEM_ALLOCATION_SCOPE_COMMAND: return "command";
+        case VK_SYSTEM_ALLOCATION_SCOPE_OBJECT: return "object";
+        case VK_SYSTEM_ALLOCATION_SCOPE_CACHE: return "cache";
+        case VK_SYSTEM_ALLOCATION_SCOPE_DEVICE: return "device";
+        case VK_SYSTEM_ALLOCATION_SCOPE_INSTANCE: return "instance";
+        default: return "unknown";
+    }
+}
@@ -0,0 +1,120 @@
+//
+//  LatencyTracker.cpp
+//  VulkanPractice
+//
+
+#include <algorithm>
+#include <iomanip>
+
+#include "LatencyTracker.h"
+
+namespace {
+
+// The watcher wakes up this often while waiting, to notice destroy() even if a fence never signals
+const uint64_t FENCE_WAIT_TIMEOUT_NS = 100'000'000;
+
+}
+
+LatencyTracker::~LatencyTracker() {
+    destroy();
+}
+
+void LatencyTracker::init(VkDevice device, const DeviceDispatch* deviceTable) {
+    this->device = device;
+    this->deviceTable = deviceTable;
+
+    stopping = false;
+    watcher = std::thread([this] { watch(); });
+}
+
+void LatencyTracker::destroy() {
+    if (!watcher.joinable()) return;
+
+    flush();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    pendingChanged.notify_all();
+    watcher.join();
+}
+
+void LatencyTracker::submitted(VkFence fence, Clock::time_point inputSampled) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending.push_back({fence, inputSampled});
+    }
+    pendingChanged.notify_all();
+}
+
+void LatencyTracker::release(VkFence fence) {
+    std::unique_lock<std::mutex> lock(mutex);
+    pendingChanged.wait(lock, [this, fence] {
+        return std::none_of(pending.begin(), pending.end(), [fence](const PendingFrame& frame) { return frame.fence == fence; });
+    });
+}
+
+void LatencyTracker::flush() {
+    std::unique_lock<std::mutex> lock(mutex);
+    pendingChanged.wait(lock, [this] { return pending.empty(); });
+}
+
+void LatencyTracker::reset() {
+    std::lock_guard<std::mutex> lock(mutex);
+    samplesMs.clear();
+}
+
+LatencySummary LatencyTracker::summary() const {
+    std::vector<double> sorted;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        sorted = samplesMs;
+    }
+
+    LatencySummary result;
+    if (sorted.empty()) return result;
+
+    std::sort(sorted.begin(), sorted.end());
+    result.frames = sorted.size();
+    result.medianMs = sorted[sorted.size() / 2];
+    result.p95Ms = sorted[std::min(sorted.size() - 1, sorted.size() * 95 / 100)];
+    result.maxMs = sorted.back();
+    return result;
+}
+
+void LatencyTracker::printReport(std::ostream& os, const std::string& label) const {
+    LatencySummary result = summary();
+    if (result.frames == 0) return;
+
+    os << std::fixed << std::setprecision(2)
+       << "Input to GPU completion (" << label << "): median " << result.medianMs << " ms, p95 " << result.p95Ms
+       << " ms, max " << result.maxMs << " ms over " << result.frames << " frames" << std::endl;
+    os << std::defaultfloat;
+}
+
+void LatencyTracker::watch() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        pendingChanged.wait(lock, [this] { return stopping || !pending.empty(); });
+        if (pending.empty()) return;
+
+        // Submits complete in order on the one queue, so waiting on the oldest fence first loses nothing
+        PendingFrame frame = pending.front();
+        lock.unlock();
+
+        VkResult result = deviceTable->vkWaitForFences(device, 1, &frame.fence, VK_TRUE, FENCE_WAIT_TIMEOUT_NS);
+        Clock::time_point completed = Clock::now();
+
+        lock.lock();
+        if (result == VK_TIMEOUT) {
+            if (stopping) return;
+            continue;
+        }
+
+        if (result == VK_SUCCESS) {
+            samplesMs.push_back(std::chrono::duration<double, std::milli>(completed - frame.inputSampled).count());
+        }
+        pending.pop_front();
+        pendingChanged.notify_all();
+    }
+}
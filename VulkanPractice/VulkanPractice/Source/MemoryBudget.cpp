@@ -0,0 +1,249 @@
+//
+//  MemoryBudget.cpp
+//  VulkanPractice
+//
+
+#include <algorithm>
+#include <iomanip>
+#include <limits>
+#include <stdexcept>
+
+#include "MemoryBudget.h"
+
+MemoryBudget* MemoryBudget::tracking = nullptr;
+PFN_vkAllocateMemory MemoryBudget::nextAllocateMemory = nullptr;
+PFN_vkFreeMemory MemoryBudget::nextFreeMemory = nullptr;
+
+namespace {
+
+const uint64_t neverEvicted = std::numeric_limits<uint64_t>::max();
+
+double toMiB(VkDeviceSize bytes) {
+    return bytes / (1024.0 * 1024.0);
+}
+
+}
+
+void MemoryBudget::init(VkPhysicalDevice physicalDevice, const InstanceDispatch& instanceTable, bool budgetExtension,
+                        const MemoryBudgetSettings& settings) {
+    if (settings.lowWatermark <= 0.0f || settings.lowWatermark > settings.highWatermark) {
+        throw std::runtime_error("memory budget low watermark must be positive and below the high watermark!");
+    }
+
+    this->physicalDevice = physicalDevice;
+    this->instanceTable = &instanceTable;
+    this->budgetExtension = budgetExtension;
+    this->settings = settings;
+
+    instanceTable.vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+
+    const uint32_t heapCount = memoryProperties.memoryHeapCount;
+    heapStats.assign(heapCount, MemoryHeapStats{});
+    for (uint32_t heap = 0; heap < heapCount; heap++) {
+        heapStats[heap].size = memoryProperties.memoryHeaps[heap].size;
+        heapStats[heap].deviceLocal = (memoryProperties.memoryHeaps[heap].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0;
+    }
+    trackedBytes.assign(heapCount, 0);
+    allocationCounts.assign(heapCount, 0);
+    failedAllocationCounts.assign(heapCount, 0);
+    lastEviction.assign(heapCount, neverEvicted);
+
+    queryBudget();
+}
+
+void MemoryBudget::destroy() {
+    if (trackedTable != nullptr) {
+        trackedTable->vkAllocateMemory = nextAllocateMemory;
+        trackedTable->vkFreeMemory = nextFreeMemory;
+        trackedTable = nullptr;
+        tracking = nullptr;
+    }
+
+    allocations.clear();
+    callbacks.clear();
+    recentEvents.clear();
+}
+
+void MemoryBudget::trackAllocations(DeviceDispatch& deviceTable) {
+    if (tracking != nullptr) {
+        throw std::runtime_error("device memory allocations are tracked already!");
+    }
+
+    tracking = this;
+    trackedTable = &deviceTable;
+    nextAllocateMemory = deviceTable.vkAllocateMemory;
+    nextFreeMemory = deviceTable.vkFreeMemory;
+    deviceTable.vkAllocateMemory = trackedAllocateMemory;
+    deviceTable.vkFreeMemory = trackedFreeMemory;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL MemoryBudget::trackedAllocateMemory(VkDevice device, const VkMemoryAllocateInfo* pAllocateInfo,
+                                                                   const VkAllocationCallbacks* pAllocator, VkDeviceMemory* pMemory) {
+    const VkResult result = nextAllocateMemory(device, pAllocateInfo, pAllocator, pMemory);
+
+    MemoryBudget& budget = *tracking;
+    const uint32_t heap = budget.heapOfMemoryType(pAllocateInfo->memoryTypeIndex);
+    std::lock_guard<std::mutex> lock(budget.allocationsMutex);
+    if (result == VK_SUCCESS) {
+        budget.allocations[*pMemory] = {heap, pAllocateInfo->allocationSize};
+        budget.trackedBytes[heap] += pAllocateInfo->allocationSize;
+        budget.allocationCounts[heap]++;
+    } else {
+        budget.failedAllocationCounts[heap]++;
+    }
+    return result;
+}
+
+VKAPI_ATTR void VKAPI_CALL MemoryBudget::trackedFreeMemory(VkDevice device, VkDeviceMemory memory, const VkAllocationCallbacks* pAllocator) {
+    if (memory != VK_NULL_HANDLE) {
+        MemoryBudget& budget = *tracking;
+        std::lock_guard<std::mutex> lock(budget.allocationsMutex);
+        auto allocation = budget.allocations.find(memory);
+        if (allocation != budget.allocations.end()) {
+            budget.trackedBytes[allocation->second.heap] -= allocation->second.size;
+            budget.allocationCounts[allocation->second.heap]--;
+            budget.allocations.erase(allocation);
+        }
+    }
+    nextFreeMemory(device, memory, pAllocator);
+}
+
+void MemoryBudget::queryBudget() {
+    VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProperties{};
+    budgetProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+    if (budgetExtension) {
+        VkPhysicalDeviceMemoryProperties2 properties{};
+        properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+        properties.pNext = &budgetProperties;
+        instanceTable->vkGetPhysicalDeviceMemoryProperties2KHR(physicalDevice, &properties);
+    }
+
+    const bool anyDeviceLocal = std::any_of(heapStats.begin(), heapStats.end(),
+                                            [](const MemoryHeapStats& heap) { return heap.deviceLocal; });
+
+    std::lock_guard<std::mutex> lock(allocationsMutex);
+    for (uint32_t heap = 0; heap < heapStats.size(); heap++) {
+        MemoryHeapStats& stats = heapStats[heap];
+        stats.trackedBytes = trackedBytes[heap];
+        stats.allocations = allocationCounts[heap];
+        stats.failedAllocations = failedAllocationCounts[heap];
+
+        if (budgetExtension) {
+            stats.budget = budgetProperties.heapBudget[heap];
+            stats.usage = budgetProperties.heapUsage[heap];
+        } else {
+            stats.budget = stats.size;
+            stats.usage = stats.trackedBytes;
+        }
+
+        stats.simulated = settings.simulatedBudget > 0 && (stats.deviceLocal || !anyDeviceLocal);
+        if (stats.simulated) {
+            stats.budget = std::min(stats.budget, settings.simulatedBudget);
+        }
+        stats.peakUsage = std::max(stats.peakUsage, stats.usage);
+    }
+}
+
+void MemoryBudget::update(uint64_t frameNumber) {
+    queryBudget();
+    updates++;
+
+    for (uint32_t heap = 0; heap < heapStats.size(); heap++) {
+        const MemoryHeapStats& stats = heapStats[heap];
+        if (stats.usage > stats.budget) {
+            updatesOverBudget++;
+        }
+        if (stats.usage <= static_cast<VkDeviceSize>(stats.budget * static_cast<double>(settings.highWatermark))) continue;
+
+        // What was evicted last time may not have been released yet
+        if (lastEviction[heap] != neverEvicted && frameNumber - lastEviction[heap] < settings.cooldownFrames) continue;
+
+        evict(heap, frameNumber);
+    }
+}
+
+void MemoryBudget::evict(uint32_t heap, uint64_t frameNumber) {
+    const MemoryHeapStats& stats = heapStats[heap];
+
+    MemoryEvictionEvent event;
+    event.frameNumber = frameNumber;
+    event.heap = heap;
+    event.budget = stats.budget;
+    event.usage = stats.usage;
+    event.bytesToFree = stats.usage - static_cast<VkDeviceSize>(stats.budget * static_cast<double>(settings.lowWatermark));
+
+    for (const Callback& callback : callbacks) {
+        if (event.bytesFreed >= event.bytesToFree) break;
+        event.bytesFreed += callback.callback(heap, event.bytesToFree - event.bytesFreed);
+    }
+    lastEviction[heap] = frameNumber;
+
+    if (recentEvents.size() < eventCapacity) {
+        recentEvents.push_back(event);
+    } else {
+        recentEvents[eventCount % eventCapacity] = event;
+    }
+    eventCount++;
+}
+
+uint32_t MemoryBudget::addEvictionCallback(int priority, EvictionCallback callback) {
+    const uint32_t id = nextCallbackId++;
+    // After the callbacks of the same priority, so they are called in the order they were added
+    auto position = std::upper_bound(callbacks.begin(), callbacks.end(), priority,
+                                     [](int priority, const Callback& other) { return priority < other.priority; });
+    callbacks.insert(position, {id, priority, std::move(callback)});
+    return id;
+}
+
+void MemoryBudget::removeEvictionCallback(uint32_t id) {
+    callbacks.erase(std::remove_if(callbacks.begin(), callbacks.end(), [id](const Callback& callback) { return callback.id == id; }),
+                    callbacks.end());
+}
+
+void MemoryBudget::setSimulatedBudget(VkDeviceSize bytes) {
+    settings.simulatedBudget = bytes;
+}
+
+std::vector<MemoryEvictionEvent> MemoryBudget::events() const {
+    if (recentEvents.size() < eventCapacity) return recentEvents;
+
+    std::vector<MemoryEvictionEvent> ordered;
+    ordered.reserve(eventCapacity);
+    for (uint64_t i = eventCount - eventCapacity; i < eventCount; i++) {
+        ordered.push_back(recentEvents[i % eventCapacity]);
+    }
+    return ordered;
+}
+
+void MemoryBudget::printReport(std::ostream& os) const {
+    if (heapStats.empty()) return;
+
+    os << "Device memory budget (" << (budgetExtension ? "VK_EXT_memory_budget" : "heap sizes and tracked allocations") << ", "
+       << updates << " updates, " << updatesOverBudget << " heaps over budget):\n";
+    os << std::fixed << std::setprecision(1);
+    for (uint32_t heap = 0; heap < heapStats.size(); heap++) {
+        const MemoryHeapStats& stats = heapStats[heap];
+        os << "\theap " << heap << (stats.deviceLocal ? " (device local)" : "") << ": usage " << toMiB(stats.usage)
+           << " MiB, peak " << toMiB(stats.peakUsage) << " MiB, budget " << toMiB(stats.budget) << " MiB"
+           << (stats.simulated ? " (simulated)" : "") << " of " << toMiB(stats.size) << " MiB, "
+           << toMiB(stats.trackedBytes) << " MiB in " << stats.allocations << " allocations";
+        if (stats.failedAllocations > 0) {
+            os << ", " << stats.failedAllocations << " failed";
+        }
+        os << '\n';
+    }
+
+    if (eventCount > 0) {
+        VkDeviceSize requested = 0;
+        VkDeviceSize freed = 0;
+        uint64_t unsatisfied = 0;
+        for (const MemoryEvictionEvent& event : recentEvents) {
+            requested += event.bytesToFree;
+            freed += event.bytesFreed;
+            if (event.bytesFreed < event.bytesToFree) unsatisfied++;
+        }
+        os << "\t" << eventCount << " evictions, the last " << recentEvents.size() << " asked for " << toMiB(requested)
+           << " MiB and freed " << toMiB(freed) << " MiB, " << unsatisfied << " of them could not free enough\n";
+    }
+    os << std::defaultfloat;
+}
@@ -0,0 +1,956 @@
+//
+//  Mesh.cpp
+//  VulkanPractice
+//
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <future>
+#include <limits>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+#ifdef WIN
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif // WIN
+
+#include "Mesh.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double millisecondsSince(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// Read only view of a whole file, unmapped when it goes out of scope
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path);
+    MappedFile(const MappedFile& obj) = delete;
+
+    MappedFile& operator=(const MappedFile& obj) = delete;
+
+    ~MappedFile();
+
+    const char* data() const { return static_cast<const char*>(view); }
+    size_t size() const { return length; }
+
+private:
+    void* view = nullptr;
+    size_t length = 0;
+#ifdef WIN
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+#endif // WIN
+};
+
+MappedFile::MappedFile(const std::string& path) {
+#ifdef WIN
+    file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        throw std::runtime_error("failed to open mesh " + path);
+    }
+
+    LARGE_INTEGER fileSize;
+    GetFileSizeEx(file, &fileSize);
+    length = static_cast<size_t>(fileSize.QuadPart);
+    if (length == 0) return;
+
+    mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    view = mapping != nullptr ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    if (view == nullptr) {
+        throw std::runtime_error("failed to map mesh " + path);
+    }
+#else
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("failed to open mesh " + path);
+    }
+
+    struct stat fileStat;
+    fstat(fd, &fileStat);
+    length = static_cast<size_t>(fileStat.st_size);
+
+    if (length > 0) {
+        view = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    // The mapping keeps the file alive
+    close(fd);
+
+    if (view == MAP_FAILED) {
+        view = nullptr;
+        throw std::runtime_error("failed to map mesh " + path);
+    }
+    if (view != nullptr) {
+        madvise(view, length, MADV_SEQUENTIAL);
+    }
+#endif // WIN
+}
+
+MappedFile::~MappedFile() {
+#ifdef WIN
+    if (view != nullptr) UnmapViewOfFile(view);
+    if (mapping != nullptr) CloseHandle(mapping);
+    if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+#else
+    if (view != nullptr) munmap(view, length);
+#endif // WIN
+}
+
+uint32_t resolveThreadCount(uint32_t threadCount) {
+    if (threadCount > 0) return threadCount;
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+// Splits [0, count) into one range per thread. Exceptions of the workers are rethrown by get()
+template <typename Function>
+void parallelFor(size_t count, uint32_t threads, Function function) {
+    const size_t minPerThread = 4096;
+    threads = static_cast<uint32_t>(std::min<size_t>(threads, std::max<size_t>(1, count / minPerThread)));
+    if (threads <= 1) {
+        function(size_t(0), count);
+        return;
+    }
+
+    const size_t perThread = (count + threads - 1) / threads;
+    std::vector<std::future<void>> workers;
+    for (size_t begin = 0; begin < count; begin += perThread) {
+        workers.push_back(std::async(std::launch::async, function, begin, std::min(count, begin + perThread)));
+    }
+    for (auto& worker : workers) {
+        worker.get();
+    }
+}
+
+// Number parsing, faster than strtof since it doesn't care about the locale
+
+const char* skipSpaces(const char* p, const char* end) {
+    while (p < end && (*p == ' ' || *p == '\t')) p++;
+    return p;
+}
+
+bool isDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+const char* parseFloat(const char* p, const char* end, float& out) {
+    p = skipSpaces(p, end);
+
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = *p == '-';
+        p++;
+    }
+
+    // Up to 19 significant digits fit into the mantissa, the rest only moves the exponent
+    uint64_t mantissa = 0;
+    int digits = 0;
+    int exponent = 0;
+    while (p < end && isDigit(*p)) {
+        if (digits < 19) {
+            mantissa = mantissa * 10 + static_cast<uint64_t>(*p - '0');
+            digits += mantissa > 0;
+        } else {
+            exponent++;
+        }
+        p++;
+    }
+    if (p < end && *p == '.') {
+        p++;
+        while (p < end && isDigit(*p)) {
+            if (digits < 19) {
+                mantissa = mantissa * 10 + static_cast<uint64_t>(*p - '0');
+                digits += mantissa > 0;
+                exponent--;
+            }
+            p++;
+        }
+    }
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        p++;
+        bool negativeExponent = false;
+        if (p < end && (*p == '-' || *p == '+')) {
+            negativeExponent = *p == '-';
+            p++;
+        }
+        int value = 0;
+        while (p < end && isDigit(*p)) {
+            value = std::min(value * 10 + (*p - '0'), 1000);
+            p++;
+        }
+        exponent += negativeExponent ? -value : value;
+    }
+
+    static const double powers[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                                    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+    double value = static_cast<double>(mantissa);
+    if (exponent >= 0 && exponent <= 22) {
+        value *= powers[exponent];
+    } else if (exponent < 0 && exponent >= -22) {
+        value /= powers[-exponent];
+    } else {
+        value *= std::pow(10.0, exponent);
+    }
+
+    out = static_cast<float>(negative ? -value : value);
+    return p;
+}
+
+const char* parseInt(const char* p, const char* end, int64_t& out) {
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = *p == '-';
+        p++;
+    }
+    int64_t value = 0;
+    while (p < end && isDigit(*p)) {
+        value = value * 10 + (*p - '0');
+        p++;
+    }
+    out = negative ? -value : value;
+    return p;
+}
+
+// OBJ
+
+const int32_t missingIndex = std::numeric_limits<int32_t>::min();
+
+struct ObjCorner {
+    // position, texture coordinate, normal. Absolute and zero based, or relative to the start of the chunk
+    int32_t index[3];
+    // Bit i set when index[i] is relative to the chunk
+    uint8_t relative;
+};
+
+struct ObjChunk {
+    std::vector<float> positions;
+    // RGB per position, white unless the file has "v x y z r g b" lines
+    std::vector<float> colors;
+    std::vector<float> uvs;
+    std::vector<float> normals;
+    std::vector<ObjCorner> corners;
+};
+
+ObjChunk parseObjChunk(const char* p, const char* end) {
+    ObjChunk chunk;
+    std::vector<ObjCorner> polygon;
+
+    while (p < end) {
+        const char* lineEnd = static_cast<const char*>(memchr(p, '\n', static_cast<size_t>(end - p)));
+        if (lineEnd == nullptr) lineEnd = end;
+
+        p = skipSpaces(p, lineEnd);
+        if (p + 1 < lineEnd && p[0] == 'v' && (p[1] == ' ' || p[1] == '\t')) {
+            float x = 0, y = 0, z = 0;
+            p = parseFloat(p + 1, lineEnd, x);
+            p = parseFloat(p, lineEnd, y);
+            p = parseFloat(p, lineEnd, z);
+            chunk.positions.insert(chunk.positions.end(), {x, y, z});
+
+            // Three more values are a vertex color, a single one is the rarely used w
+            float extra[3] = {1.0f, 1.0f, 1.0f};
+            int extraCount = 0;
+            while (extraCount < 3) {
+                p = skipSpaces(p, lineEnd);
+                if (p >= lineEnd || !(isDigit(*p) || *p == '-' || *p == '+' || *p == '.')) break;
+                p = parseFloat(p, lineEnd, extra[extraCount++]);
+            }
+            if (extraCount == 3) {
+                chunk.colors.insert(chunk.colors.end(), extra, extra + 3);
+            } else {
+                chunk.colors.insert(chunk.colors.end(), {1.0f, 1.0f, 1.0f});
+            }
+        } else if (p + 2 < lineEnd && p[0] == 'v' && p[1] == 't' && (p[2] == ' ' || p[2] == '\t')) {
+            float u = 0, v = 0;
+            p = parseFloat(p + 2, lineEnd, u);
+            parseFloat(p, lineEnd, v);
+            chunk.uvs.insert(chunk.uvs.end(), {u, v});
+        } else if (p + 2 < lineEnd && p[0] == 'v' && p[1] == 'n' && (p[2] == ' ' || p[2] == '\t')) {
+            float x = 0, y = 0, z = 0;
+            p = parseFloat(p + 2, lineEnd, x);
+            p = parseFloat(p, lineEnd, y);
+            parseFloat(p, lineEnd, z);
+            chunk.normals.insert(chunk.normals.end(), {x, y, z});
+        } else if (p + 1 < lineEnd && p[0] == 'f' && (p[1] == ' ' || p[1] == '\t')) {
+            const size_t counts[3] = {chunk.positions.size() / 3, chunk.uvs.size() / 2, chunk.normals.size() / 3};
+
+            polygon.clear();
+            p = skipSpaces(p + 1, lineEnd);
+            while (p < lineEnd && *p != '\r') {
+                ObjCorner corner{{missingIndex, missingIndex, missingIndex}, 0};
+                // v, v/vt, v//vn or v/vt/vn
+                for (int attribute = 0; attribute < 3 && p < lineEnd; attribute++) {
+                    if (attribute > 0) {
+                        if (*p != '/') break;
+                        p++;
+                    }
+                    if (p < lineEnd && (isDigit(*p) || *p == '-')) {
+                        int64_t value;
+                        p = parseInt(p, lineEnd, value);
+                        if (value > 0) {
+                            corner.index[attribute] = static_cast<int32_t>(value - 1);
+                        } else if (value < 0) {
+                            // Counted back from the last element so far, which may be in an earlier chunk
+                            corner.index[attribute] = static_cast<int32_t>(static_cast<int64_t>(counts[attribute]) + value);
+                            corner.relative |= static_cast<uint8_t>(1 << attribute);
+                        }
+                    }
+                }
+                if (corner.index[0] == missingIndex) {
+                    throw std::runtime_error("OBJ face without position index");
+                }
+                polygon.push_back(corner);
+                p = skipSpaces(p, lineEnd);
+            }
+
+            // Fan triangulation
+            for (size_t i = 2; i < polygon.size(); i++) {
+                chunk.corners.push_back(polygon[0]);
+                chunk.corners.push_back(polygon[i - 1]);
+                chunk.corners.push_back(polygon[i]);
+            }
+        }
+
+        p = lineEnd + 1;
+    }
+    return chunk;
+}
+
+struct ObjKey {
+    int32_t position;
+    int32_t uv;
+    int32_t normal;
+
+    bool operator==(const ObjKey& other) const {
+        return position == other.position && uv == other.uv && normal == other.normal;
+    }
+};
+
+size_t hashObjKey(const ObjKey& key) {
+    uint64_t hash = static_cast<uint32_t>(key.position) * 0x9E3779B97F4A7C15ull;
+    hash ^= (static_cast<uint32_t>(key.uv) + 0x7F4A7C15ull + (hash << 6) + (hash >> 2)) * 0xBF58476D1CE4E5B9ull;
+    hash ^= (static_cast<uint32_t>(key.normal) + 0x94D049BBull + (hash << 6) + (hash >> 2)) * 0x94D049BB133111EBull;
+    return static_cast<size_t>(hash ^ (hash >> 31));
+}
+
+// Open addressing hash set of vertex indices, the keys stay in the caller's arrays.
+// Sized once for the worst case, a node per entry as in std::unordered_map costs more than the parsing
+class VertexTable {
+public:
+    explicit VertexTable(size_t maxEntries) {
+        size_t capacity = 16;
+        while (capacity < maxEntries * 2) capacity *= 2;
+        slots.assign(capacity, emptySlot);
+        mask = capacity - 1;
+    }
+
+    // Returns the index stored for an equal key, or stores and returns newIndex
+    template <typename Equal>
+    uint32_t insert(size_t hash, uint32_t newIndex, Equal equal) {
+        size_t slot = hash & mask;
+        while (slots[slot] != emptySlot) {
+            if (equal(slots[slot])) return slots[slot];
+            slot = (slot + 1) & mask;
+        }
+        slots[slot] = newIndex;
+        return newIndex;
+    }
+
+private:
+    static constexpr uint32_t emptySlot = std::numeric_limits<uint32_t>::max();
+
+    std::vector<uint32_t> slots;
+    size_t mask = 0;
+};
+
+Mesh loadObj(const MappedFile& file, uint32_t threads, MeshLoadStats& stats) {
+    auto parseStart = Clock::now();
+
+    // Chunk boundaries are moved to the next line start
+    const char* begin = file.data();
+    const char* end = begin + file.size();
+    const uint32_t chunkCount = std::max<uint32_t>(1, std::min<uint32_t>(threads, static_cast<uint32_t>(file.size() / (64 * 1024) + 1)));
+    std::vector<const char*> boundaries = {begin};
+    for (uint32_t i = 1; i < chunkCount; i++) {
+        const char* p = std::max(boundaries.back(), begin + file.size() * i / chunkCount);
+        const char* lineEnd = static_cast<const char*>(memchr(p, '\n', static_cast<size_t>(end - p)));
+        boundaries.push_back(lineEnd != nullptr ? lineEnd + 1 : end);
+    }
+    boundaries.push_back(end);
+
+    std::vector<std::future<ObjChunk>> workers;
+    for (uint32_t i = 0; i < chunkCount; i++) {
+        workers.push_back(std::async(std::launch::async, parseObjChunk, boundaries[i], boundaries[i + 1]));
+    }
+    std::vector<ObjChunk> chunks;
+    for (auto& worker : workers) {
+        chunks.push_back(worker.get());
+    }
+
+    // Concatenate the attributes, remembering where every chunk starts
+    std::vector<float> attributes[3];
+    const size_t components[3] = {3, 2, 3};
+    std::vector<float> colors;
+    std::vector<std::array<int64_t, 3>> chunkBases;
+    for (const auto& chunk : chunks) {
+        chunkBases.push_back({static_cast<int64_t>(attributes[0].size() / 3), static_cast<int64_t>(attributes[1].size() / 2),
+                              static_cast<int64_t>(attributes[2].size() / 3)});
+        attributes[0].insert(attributes[0].end(), chunk.positions.begin(), chunk.positions.end());
+        colors.insert(colors.end(), chunk.colors.begin(), chunk.colors.end());
+        attributes[1].insert(attributes[1].end(), chunk.uvs.begin(), chunk.uvs.end());
+        attributes[2].insert(attributes[2].end(), chunk.normals.begin(), chunk.normals.end());
+    }
+    stats.parseMs = millisecondsSince(parseStart);
+
+    auto deduplicateStart = Clock::now();
+
+    size_t cornerCount = 0;
+    for (const auto& chunk : chunks) {
+        cornerCount += chunk.corners.size();
+    }
+    stats.inputCorners = cornerCount;
+
+    Mesh mesh;
+    mesh.indices.reserve(cornerCount);
+    std::vector<ObjKey> vertexKeys;
+    VertexTable uniqueVertices(cornerCount);
+
+    for (size_t c = 0; c < chunks.size(); c++) {
+        for (const ObjCorner& corner : chunks[c].corners) {
+            int32_t resolved[3];
+            for (int attribute = 0; attribute < 3; attribute++) {
+                int64_t index = corner.index[attribute];
+                if (index == missingIndex) {
+                    resolved[attribute] = missingIndex;
+                    continue;
+                }
+                if (corner.relative & (1 << attribute)) {
+                    index += chunkBases[c][attribute];
+                }
+                if (index < 0 || static_cast<size_t>(index) >= attributes[attribute].size() / components[attribute]) {
+                    throw std::runtime_error("OBJ index out of range");
+                }
+                resolved[attribute] = static_cast<int32_t>(index);
+            }
+
+            ObjKey key{resolved[0], resolved[1], resolved[2]};
+            const uint32_t newIndex = static_cast<uint32_t>(mesh.vertices.size());
+            const uint32_t index = uniqueVertices.insert(hashObjKey(key), newIndex, [&](uint32_t v) { return vertexKeys[v] == key; });
+            if (index == newIndex) {
+                vertexKeys.push_back(key);
+
+                // Missing texture coordinates and normals are zero
+                MeshVertex vertex{};
+                std::memcpy(vertex.position, &attributes[0][static_cast<size_t>(key.position) * 3], sizeof(vertex.position));
+                std::memcpy(vertex.color, &colors[static_cast<size_t>(key.position) * 3], 3 * sizeof(float));
+                if (key.uv != missingIndex) {
+                    std::memcpy(vertex.uv, &attributes[1][static_cast<size_t>(key.uv) * 2], sizeof(vertex.uv));
+                }
+                if (key.normal != missingIndex) {
+                    std::memcpy(vertex.normal, &attributes[2][static_cast<size_t>(key.normal) * 3], sizeof(vertex.normal));
+                }
+                mesh.vertices.push_back(vertex);
+            }
+            mesh.indices.push_back(index);
+        }
+    }
+    stats.deduplicateMs = millisecondsSince(deduplicateStart);
+    return mesh;
+}
+
+// JSON, only as much as the glTF header needs
+
+struct JsonValue {
+    enum class Type {
+        Null,
+        Bool,
+        Number,
+        String,
+        Array,
+        Object
+    };
+
+    Type type = Type::Null;
+    bool boolean = false;
+    double number = 0.0;
+    std::string string;
+    std::vector<JsonValue> array;
+    std::vector<std::pair<std::string, JsonValue>> object;
+
+    const JsonValue* find(const char* key) const {
+        for (const auto& [name, value] : object) {
+            if (name == key) return &value;
+        }
+        return nullptr;
+    }
+
+    const JsonValue& at(const char* key) const {
+        const JsonValue* value = find(key);
+        if (value == nullptr) {
+            throw std::runtime_error(std::string("glTF: missing ") + key);
+        }
+        return *value;
+    }
+
+    const JsonValue& at(size_t index) const {
+        if (type != Type::Array || index >= array.size()) {
+            throw std::runtime_error("glTF: index out of range");
+        }
+        return array[index];
+    }
+
+    double numberOr(const char* key, double fallback) const {
+        const JsonValue* value = find(key);
+        return value != nullptr && value->type == Type::Number ? value->number : fallback;
+    }
+};
+
+class JsonParser {
+public:
+    JsonParser(const char* begin, const char* end) : p(begin), end(end) {}
+
+    JsonValue parse() {
+        JsonValue value = parseValue();
+        skipWhitespace();
+        return value;
+    }
+
+private:
+    void skipWhitespace() {
+        while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) p++;
+    }
+
+    void expect(char c) {
+        skipWhitespace();
+        if (p >= end || *p != c) {
+            throw std::runtime_error(std::string("glTF: expected '") + c + "' in JSON");
+        }
+        p++;
+    }
+
+    bool consume(const char* literal) {
+        size_t length = strlen(literal);
+        if (static_cast<size_t>(end - p) < length || strncmp(p, literal, length) != 0) return false;
+        p += length;
+        return true;
+    }
+
+    JsonValue parseValue() {
+        skipWhitespace();
+        if (p >= end) {
+            throw std::runtime_error("glTF: unexpected end of JSON");
+        }
+
+        JsonValue value;
+        if (*p == '{') {
+            value.type = JsonValue::Type::Object;
+            p++;
+            skipWhitespace();
+            if (p < end && *p == '}') {
+                p++;
+                return value;
+            }
+            do {
+                skipWhitespace();
+                std::string key = parseString();
+                expect(':');
+                value.object.emplace_back(std::move(key), parseValue());
+                skipWhitespace();
+            } while (p < end && *p == ',' && ++p);
+            expect('}');
+        } else if (*p == '[') {
+            value.type = JsonValue::Type::Array;
+            p++;
+            skipWhitespace();
+            if (p < end && *p == ']') {
+                p++;
+                return value;
+            }
+            do {
+                value.array.push_back(parseValue());
+                skipWhitespace();
+            } while (p < end && *p == ',' && ++p);
+            expect(']');
+        } else if (*p == '"') {
+            value.type = JsonValue::Type::String;
+            value.string = parseString();
+        } else if (consume("true")) {
+            value.type = JsonValue::Type::Bool;
+            value.boolean = true;
+        } else if (consume("false")) {
+            value.type = JsonValue::Type::Bool;
+        } else if (consume("null")) {
+            value.type = JsonValue::Type::Null;
+        } else {
+            value.type = JsonValue::Type::Number;
+            char* numberEnd = nullptr;
+            std::string text(p, static_cast<size_t>(std::min<ptrdiff_t>(end - p, 64)));
+            value.number = strtod(text.c_str(), &numberEnd);
+            if (numberEnd == text.c_str()) {
+                throw std::runtime_error("glTF: invalid JSON value");
+            }
+            p += numberEnd - text.c_str();
+        }
+        return value;
+    }
+
+    std::string parseString() {
+        if (p >= end || *p != '"') {
+            throw std::runtime_error("glTF: expected a string in JSON");
+        }
+        p++;
+
+        std::string result;
+        while (p < end && *p != '"') {
+            if (*p == '\\' && p + 1 < end) {
+                p++;
+                switch (*p) {
+                    case 'n': result += '\n'; break;
+                    case 't': result += '\t'; break;
+                    case 'r': result += '\r'; break;
+                    case 'b': result += '\b'; break;
+                    case 'f': result += '\f'; break;
+                    case 'u':
+                        // Names and URIs the loader looks at are ASCII, anything else is kept as a placeholder
+                        p += std::min<ptrdiff_t>(4, end - p - 1);
+                        result += '?';
+                        break;
+                    default: result += *p; break;
+                }
+            } else {
+                result += *p;
+            }
+            p++;
+        }
+        if (p >= end) {
+            throw std::runtime_error("glTF: unterminated string in JSON");
+        }
+        p++;
+        return result;
+    }
+
+    const char* p;
+    const char* end;
+};
+
+// GLB
+
+const uint32_t glbMagic = 0x46546C67;       // "glTF"
+const uint32_t glbJsonChunk = 0x4E4F534A;   // "JSON"
+const uint32_t glbBinChunk = 0x004E4942;    // "BIN\0"
+
+const int componentUnsignedByte = 5121;
+const int componentUnsignedShort = 5123;
+const int componentUnsignedInt = 5125;
+const int componentFloat = 5126;
+
+uint32_t readUint32(const char* p) {
+    uint32_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+// Strided elements of one accessor in the binary chunk
+struct AccessorView {
+    const uint8_t* data = nullptr;
+    size_t stride = 0;
+    size_t count = 0;
+    int componentType = 0;
+    uint32_t components = 0;
+    bool normalized = false;
+
+    float component(size_t element, uint32_t c) const {
+        const uint8_t* p = data + element * stride;
+        switch (componentType) {
+            case componentFloat: {
+                float value;
+                std::memcpy(&value, p + c * 4, sizeof(value));
+                return value;
+            }
+            case componentUnsignedShort: {
+                uint16_t value;
+                std::memcpy(&value, p + c * 2, sizeof(value));
+                return normalized ? value / 65535.0f : value;
+            }
+            case componentUnsignedByte:
+                return normalized ? p[c] / 255.0f : p[c];
+            default:
+                throw std::runtime_error("glTF: unsupported attribute component type");
+        }
+    }
+
+    uint32_t index(size_t element) const {
+        const uint8_t* p = data + element * stride;
+        switch (componentType) {
+            case componentUnsignedInt: {
+                uint32_t value;
+                std::memcpy(&value, p, sizeof(value));
+                return value;
+            }
+            case componentUnsignedShort: {
+                uint16_t value;
+                std::memcpy(&value, p, sizeof(value));
+                return value;
+            }
+            case componentUnsignedByte:
+                return p[0];
+            default:
+                throw std::runtime_error("glTF: unsupported index component type");
+        }
+    }
+};
+
+AccessorView accessorView(const JsonValue& gltf, const char* bin, size_t binSize, size_t accessorIndex) {
+    const JsonValue& accessor = gltf.at("accessors").at(accessorIndex);
+
+    AccessorView view;
+    view.count = static_cast<size_t>(accessor.at("count").number);
+    view.componentType = static_cast<int>(accessor.at("componentType").number);
+    const JsonValue* normalized = accessor.find("normalized");
+    view.normalized = normalized != nullptr && normalized->boolean;
+
+    const std::string& type = accessor.at("type").string;
+    view.components = type == "SCALAR" ? 1 : type == "VEC2" ? 2 : type == "VEC3" ? 3 : type == "VEC4" ? 4 : 0;
+    if (view.components == 0) {
+        throw std::runtime_error("glTF: unsupported accessor type " + type);
+    }
+
+    const size_t componentSize = view.componentType == componentUnsignedByte ? 1 : view.componentType == componentUnsignedShort ? 2 : 4;
+    const JsonValue& bufferView = gltf.at("bufferViews").at(static_cast<size_t>(accessor.at("bufferView").number));
+    if (bufferView.numberOr("buffer", 0.0) != 0.0) {
+        throw std::runtime_error("glTF: only the GLB binary buffer is supported");
+    }
+
+    const size_t offset = static_cast<size_t>(bufferView.numberOr("byteOffset", 0.0) + accessor.numberOr("byteOffset", 0.0));
+    view.stride = static_cast<size_t>(bufferView.numberOr("byteStride", 0.0));
+    if (view.stride == 0) {
+        view.stride = componentSize * view.components;
+    }
+
+    if (view.count > 0 && offset + (view.count - 1) * view.stride + componentSize * view.components > binSize) {
+        throw std::runtime_error("glTF: accessor outside of the binary chunk");
+    }
+    view.data = reinterpret_cast<const uint8_t*>(bin) + offset;
+    return view;
+}
+
+size_t hashVertex(const MeshVertex& vertex) {
+    // FNV-1a over the bytes, MeshVertex has no padding
+    const auto* bytes = reinterpret_cast<const uint8_t*>(&vertex);
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < sizeof(MeshVertex); i++) {
+        hash = (hash ^ bytes[i]) * 1099511628211ull;
+    }
+    return static_cast<size_t>(hash ^ (hash >> 32));
+}
+
+Mesh loadGlb(const MappedFile& file, uint32_t threads, MeshLoadStats& stats) {
+    auto parseStart = Clock::now();
+
+    const char* data = file.data();
+    if (file.size() < 20 || readUint32(data) != glbMagic || readUint32(data + 4) != 2) {
+        throw std::runtime_error("not a glTF 2.0 binary file");
+    }
+
+    // JSON chunk first, the optional BIN chunk right after it
+    const uint32_t jsonLength = readUint32(data + 12);
+    if (readUint32(data + 16) != glbJsonChunk || 20 + static_cast<size_t>(jsonLength) > file.size()) {
+        throw std::runtime_error("glTF: missing JSON chunk");
+    }
+    const JsonValue gltf = JsonParser(data + 20, data + 20 + jsonLength).parse();
+
+    const char* bin = nullptr;
+    size_t binSize = 0;
+    const size_t binHeader = 20 + static_cast<size_t>(jsonLength);
+    if (binHeader + 8 <= file.size() && readUint32(data + binHeader + 4) == glbBinChunk) {
+        bin = data + binHeader + 8;
+        binSize = std::min<size_t>(readUint32(data + binHeader), file.size() - binHeader - 8);
+    }
+
+    struct Primitive {
+        AccessorView positions;
+        AccessorView normals;
+        AccessorView uvs;
+        AccessorView colors;
+        AccessorView indices;
+        bool indexed;
+        size_t firstVertex;
+        size_t firstIndex;
+    };
+
+    std::vector<Primitive> primitives;
+    size_t vertexCount = 0;
+    size_t indexCount = 0;
+
+    const JsonValue* meshes = gltf.find("meshes");
+    for (const JsonValue& mesh : meshes != nullptr ? meshes->array : std::vector<JsonValue>{}) {
+        for (const JsonValue& primitiveJson : mesh.at("primitives").array) {
+            // Triangle lists only, points, lines and strips are skipped
+            if (primitiveJson.numberOr("mode", 4.0) != 4.0) continue;
+
+            const JsonValue& attributes = primitiveJson.at("attributes");
+            Primitive primitive{};
+            primitive.positions = accessorView(gltf, bin, binSize, static_cast<size_t>(attributes.at("POSITION").number));
+            if (const JsonValue* normal = attributes.find("NORMAL")) {
+                primitive.normals = accessorView(gltf, bin, binSize, static_cast<size_t>(normal->number));
+            }
+            if (const JsonValue* uv = attributes.find("TEXCOORD_0")) {
+                primitive.uvs = accessorView(gltf, bin, binSize, static_cast<size_t>(uv->number));
+            }
+            if (const JsonValue* color = attributes.find("COLOR_0")) {
+                primitive.colors = accessorView(gltf, bin, binSize, static_cast<size_t>(color->number));
+            }
+            primitive.indexed = primitiveJson.find("indices") != nullptr;
+            if (primitive.indexed) {
+                primitive.indices = accessorView(gltf, bin, binSize, static_cast<size_t>(primitiveJson.at("indices").number));
+            }
+
+            primitive.firstVertex = vertexCount;
+            primitive.firstIndex = indexCount;
+            vertexCount += primitive.positions.count;
+            indexCount += primitive.indexed ? primitive.indices.count : primitive.positions.count;
+            primitives.push_back(primitive);
+        }
+    }
+
+    std::vector<MeshVertex> vertices(vertexCount);
+    std::vector<uint32_t> indices(indexCount);
+
+    // Large primitives are split across the threads as well, not just the primitives
+    for (const Primitive& primitive : primitives) {
+        parallelFor(primitive.positions.count, threads, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                MeshVertex vertex{};
+                for (uint32_t c = 0; c < 3; c++) {
+                    vertex.position[c] = primitive.positions.component(i, c);
+                }
+                if (primitive.normals.data != nullptr && i < primitive.normals.count) {
+                    for (uint32_t c = 0; c < 3; c++) {
+                        vertex.normal[c] = primitive.normals.component(i, c);
+                    }
+                }
+                if (primitive.uvs.data != nullptr && i < primitive.uvs.count) {
+                    for (uint32_t c = 0; c < 2; c++) {
+                        vertex.uv[c] = primitive.uvs.component(i, c);
+                    }
+                }
+                // RGB or RGBA
+                if (primitive.colors.data != nullptr && i < primitive.colors.count) {
+                    for (uint32_t c = 0; c < primitive.colors.components; c++) {
+                        vertex.color[c] = primitive.colors.component(i, c);
+                    }
+                }
+                vertices[primitive.firstVertex + i] = vertex;
+            }
+        });
+
+        const size_t primitiveIndices = primitive.indexed ? primitive.indices.count : primitive.positions.count;
+        parallelFor(primitiveIndices, threads, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                uint32_t index = primitive.indexed ? primitive.indices.index(i) : static_cast<uint32_t>(i);
+                if (index >= primitive.positions.count) {
+                    throw std::runtime_error("glTF: index out of range");
+                }
+                indices[primitive.firstIndex + i] = static_cast<uint32_t>(primitive.firstVertex) + index;
+            }
+        });
+    }
+    stats.parseMs = millisecondsSince(parseStart);
+    stats.inputCorners = indexCount;
+
+    // glTF is indexed already, but exporters often split vertices that end up identical
+    auto deduplicateStart = Clock::now();
+
+    Mesh mesh;
+    std::vector<uint32_t> remap(vertices.size());
+    VertexTable uniqueVertices(vertices.size());
+    for (size_t i = 0; i < vertices.size(); i++) {
+        const uint32_t newIndex = static_cast<uint32_t>(mesh.vertices.size());
+        remap[i] = uniqueVertices.insert(hashVertex(vertices[i]), newIndex, [&](uint32_t v) { return mesh.vertices[v] == vertices[i]; });
+        if (remap[i] == newIndex) {
+            mesh.vertices.push_back(vertices[i]);
+        }
+    }
+
+    mesh.indices.resize(indices.size());
+    for (size_t i = 0; i < indices.size(); i++) {
+        mesh.indices[i] = remap[indices[i]];
+    }
+    stats.deduplicateMs = millisecondsSince(deduplicateStart);
+    return mesh;
+}
+
+}
+
+bool MeshVertex::operator==(const MeshVertex& other) const {
+    return std::memcmp(this, &other, sizeof(MeshVertex)) == 0;
+}
+
+Mesh Mesh::load(const std::string& path, uint32_t threadCount, MeshLoadStats* stats) {
+    auto start = Clock::now();
+
+    MeshLoadStats loadStats;
+    loadStats.threads = resolveThreadCount(threadCount);
+
+    std::string extension = path.size() >= 4 ? path.substr(path.size() - 4) : "";
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](char c) { return static_cast<char>(tolower(c)); });
+    if (extension != ".obj" && extension != ".glb") {
+        throw std::runtime_error("unknown mesh format, use .obj or .glb: " + path);
+    }
+
+    MappedFile file(path);
+    loadStats.fileBytes = file.size();
+    loadStats.mapMs = millisecondsSince(start);
+
+    Mesh mesh = extension == ".obj" ? loadObj(file, loadStats.threads, loadStats) : loadGlb(file, loadStats.threads, loadStats);
+
+    loadStats.totalMs = millisecondsSince(start);
+    if (stats != nullptr) {
+        *stats = loadStats;
+    }
+    return mesh;
+}
+
+void Mesh::writeObj(const std::string& path) const {
+    std::ofstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        throw std::runtime_error("failed to create mesh " + path);
+    }
+
+    // Colors only when there are any, as "v x y z r g b"
+    const bool hasColors = std::any_of(vertices.begin(), vertices.end(), [](const MeshVertex& vertex) {
+        return vertex.color[0] != 1.0f || vertex.color[1] != 1.0f || vertex.color[2] != 1.0f;
+    });
+
+    char line[192];
+    for (const MeshVertex& vertex : vertices) {
+        int length = snprintf(line, sizeof(line), "v %.6g %.6g %.6g", vertex.position[0], vertex.position[1], vertex.position[2]);
+        if (hasColors) {
+            length += snprintf(line + length, sizeof(line) - length, " %.4g %.4g %.4g", vertex.color[0], vertex.color[1], vertex.color[2]);
+        }
+        length += snprintf(line + length, sizeof(line) - length, "\nvt %.6g %.6g\nvn %.6g %.6g %.6g\n", vertex.uv[0], vertex.uv[1],
+                           vertex.normal[0], vertex.normal[1], vertex.normal[2]);
+        file.write(line, length);
+    }
+    // Every vertex has all three attributes under the same index
+    for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+        uint32_t a = indices[i] + 1, b = indices[i + 1] + 1, c = indices[i + 2] + 1;
+        int length = snprintf(line, sizeof(line), "f %u/%u/%u %u/%u/%u %u/%u/%u\n", a, a, a, b, b, b, c, c, c);
+        file.write(line, length);
+    }
+}
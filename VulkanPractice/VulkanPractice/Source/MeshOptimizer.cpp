@@ -0,0 +1,163 @@
+//
+//  MeshOptimizer.cpp
+//  VulkanPractice
+//
+
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+#include "MeshOptimizer.h"
+
+namespace {
+
+const uint32_t noVertex = std::numeric_limits<uint32_t>::max();
+
+// Triangles around every vertex, as offsets into one flat list
+struct VertexAdjacency {
+    std::vector<uint32_t> offsets;
+    std::vector<uint32_t> triangles;
+
+    VertexAdjacency(const std::vector<uint32_t>& indices, size_t vertexCount) : offsets(vertexCount + 1, 0), triangles(indices.size()) {
+        for (uint32_t index : indices) {
+            offsets[index + 1]++;
+        }
+        for (size_t v = 0; v < vertexCount; v++) {
+            offsets[v + 1] += offsets[v];
+        }
+
+        std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+        for (size_t i = 0; i < indices.size(); i++) {
+            triangles[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+        }
+    }
+};
+
+std::vector<uint32_t> tipsify(const std::vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize) {
+    const size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0) return indices;
+
+    VertexAdjacency adjacency(indices, vertexCount);
+
+    // Triangles still to be emitted per vertex
+    std::vector<uint32_t> liveTriangles(vertexCount);
+    for (size_t v = 0; v < vertexCount; v++) {
+        liveTriangles[v] = adjacency.offsets[v + 1] - adjacency.offsets[v];
+    }
+
+    // A vertex is in the cache while time - cacheTime[v] <= cacheSize. Time starts past the cache so nothing is at first
+    std::vector<uint32_t> cacheTime(vertexCount, 0);
+    uint32_t time = cacheSize + 1;
+
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<uint32_t> deadEnds;
+    std::vector<uint32_t> candidates;
+    std::vector<uint32_t> output;
+    output.reserve(indices.size());
+
+    uint32_t fanVertex = 0;
+    uint32_t scanCursor = 1;
+    while (fanVertex != noVertex) {
+        candidates.clear();
+
+        for (uint32_t i = adjacency.offsets[fanVertex]; i < adjacency.offsets[fanVertex + 1]; i++) {
+            uint32_t triangle = adjacency.triangles[i];
+            if (emitted[triangle]) continue;
+            emitted[triangle] = true;
+
+            for (uint32_t corner = 0; corner < 3; corner++) {
+                uint32_t v = indices[triangle * 3 + corner];
+                output.push_back(v);
+                deadEnds.push_back(v);
+                candidates.push_back(v);
+                liveTriangles[v]--;
+                if (time - cacheTime[v] > cacheSize) {
+                    cacheTime[v] = time++;
+                }
+            }
+        }
+
+        // Prefer the candidate that stays in the cache while its remaining triangles are emitted, the oldest of those
+        uint32_t best = noVertex;
+        int64_t bestPriority = -1;
+        for (uint32_t v : candidates) {
+            if (liveTriangles[v] == 0) continue;
+
+            int64_t priority = 0;
+            if (time - cacheTime[v] + 2 * liveTriangles[v] <= cacheSize) {
+                priority = time - cacheTime[v];
+            }
+            if (priority > bestPriority) {
+                bestPriority = priority;
+                best = v;
+            }
+        }
+
+        // Dead end: go back to a recently used vertex, or scan for any vertex that still has triangles
+        while (best == noVertex && !deadEnds.empty()) {
+            uint32_t v = deadEnds.back();
+            deadEnds.pop_back();
+            if (liveTriangles[v] > 0) {
+                best = v;
+            }
+        }
+        while (best == noVertex && scanCursor < vertexCount) {
+            if (liveTriangles[scanCursor] > 0) {
+                best = scanCursor;
+            }
+            scanCursor++;
+        }
+        fanVertex = best;
+    }
+    return output;
+}
+
+}
+
+void optimizeVertexCache(Mesh& mesh, uint32_t cacheSize) {
+    if (mesh.lods.empty()) {
+        mesh.indices = tipsify(mesh.indices, mesh.vertices.size(), cacheSize);
+        return;
+    }
+
+    // Every level is drawn on its own, so each one is ordered for itself
+    for (const MeshLod& lod : mesh.lods) {
+        auto first = mesh.indices.begin() + lod.firstIndex;
+        std::vector<uint32_t> ordered = tipsify(std::vector<uint32_t>(first, first + lod.indexCount), mesh.vertices.size(), cacheSize);
+        std::copy(ordered.begin(), ordered.end(), first);
+    }
+}
+
+void optimizeVertexFetch(Mesh& mesh) {
+    std::vector<uint32_t> remap(mesh.vertices.size(), noVertex);
+    std::vector<MeshVertex> vertices;
+    vertices.reserve(mesh.vertices.size());
+
+    for (uint32_t& index : mesh.indices) {
+        if (remap[index] == noVertex) {
+            remap[index] = static_cast<uint32_t>(vertices.size());
+            vertices.push_back(mesh.vertices[index]);
+        }
+        index = remap[index];
+    }
+    mesh.vertices = std::move(vertices);
+}
+
+VertexCacheStats analyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize) {
+    VertexCacheStats stats;
+    if (indices.empty() || vertexCount == 0) return stats;
+
+    // A FIFO cache holds exactly the last cacheSize vertices that missed, so comparing insertion times is enough
+    std::vector<uint64_t> insertedAt(vertexCount, 0);
+    uint64_t misses = 0;
+    for (uint32_t index : indices) {
+        if (insertedAt[index] == 0 || misses - insertedAt[index] >= cacheSize) {
+            misses++;
+            insertedAt[index] = misses;
+        }
+    }
+
+    stats.acmr = static_cast<double>(misses) / (indices.size() / 3);
+    stats.atvr = static_cast<double>(misses) / vertexCount;
+    return stats;
+}
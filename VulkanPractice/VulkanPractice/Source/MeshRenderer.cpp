@@ -0,0 +1,100 @@
+//
+//  MeshRenderer.cpp
+//  VulkanPractice
+//
+
+#include <stdexcept>
+
+#include "EmbeddedShaders.h"
+#include "MeshRenderer.h"
+
+namespace {
+
+// Matches the push constant block of mesh.vert
+struct MeshPushConstants {
+    glm::mat4 transform;
+    // xyz, w unused
+    glm::vec4 boundsCenter;
+    glm::vec4 boundsHalfExtent;
+};
+
+static_assert(shaders::meshVert.pushConstantSize == sizeof(MeshPushConstants), "mesh.vert doesn't match MeshPushConstants");
+
+// constant_id of QUANTIZED in mesh.vert
+const uint32_t quantizedConstantId = 0;
+
+}
+
+void MeshRenderer::init(VkDevice device, const DeviceDispatch* deviceTable, const VkAllocationCallbacks* allocator, PipelineManager* pipelineManager,
+                        VkRenderPass renderPass, VkFormat colorFormat, uint64_t vertexShader, uint64_t fragmentShader) {
+    this->device = device;
+    this->deviceTable = deviceTable;
+    this->allocator = allocator;
+    this->pipelineManager = pipelineManager;
+
+    VkPushConstantRange drawRange = pushConstantRange({&shaders::meshVert, &shaders::meshFrag});
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &drawRange;
+
+    if (deviceTable->vkCreatePipelineLayout(device, &pipelineLayoutInfo, allocator, &pipelineLayout) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create mesh pipeline layout!");
+    }
+
+    pipelineState.vertexShader = vertexShader;
+    pipelineState.fragmentShader = fragmentShader;
+    pipelineState.layout = pipelineLayout;
+    pipelineState.renderPass = renderPass;
+    pipelineState.colorFormat = colorFormat;
+    // The render pass has the reversed Z depth attachment of the main pass
+    pipelineState.depthTest = true;
+    pipelineState.depthWrite = true;
+}
+
+void MeshRenderer::destroy() {
+    deviceTable->vkDestroyPipelineLayout(device, pipelineLayout, allocator);
+    pipelineLayout = VK_NULL_HANDLE;
+}
+
+void MeshRenderer::begin(VkCommandBuffer commandBuffer) {
+    this->commandBuffer = commandBuffer;
+    boundMesh = nullptr;
+    pipelineBound = false;
+    drawStats = MeshDrawStats{};
+}
+
+void MeshRenderer::draw(const GpuMesh& mesh, const glm::mat4& transform) {
+    draw(mesh, transform, mesh.lods()[0].firstIndex, mesh.lods()[0].indexCount);
+}
+
+void MeshRenderer::draw(const GpuMesh& mesh, const glm::mat4& transform, uint32_t firstIndex, uint32_t indexCount) {
+    if (!pipelineBound || mesh.format() != boundFormat) {
+        PipelineState state = pipelineState;
+        state.vertexLayout = GpuMesh::vertexLayout(mesh.format());
+        state.vertexSpecialization.set(quantizedConstantId, mesh.format() == VertexFormat::Quantized);
+        deviceTable->vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineManager->getPipeline(state));
+
+        pipelineBound = true;
+        boundFormat = mesh.format();
+        drawStats.pipelineBinds++;
+    }
+    if (&mesh != boundMesh) {
+        mesh.bind(commandBuffer);
+        boundMesh = &mesh;
+        drawStats.meshBinds++;
+    }
+
+    // Float positions are used as they are
+    MeshPushConstants constants{transform, glm::vec4(0.0f), glm::vec4(1.0f)};
+    if (mesh.format() == VertexFormat::Quantized) {
+        constants.boundsCenter = glm::vec4(mesh.bounds().center, 0.0f);
+        constants.boundsHalfExtent = glm::vec4(mesh.bounds().halfExtent, 0.0f);
+    }
+    deviceTable->vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(constants), &constants);
+
+    deviceTable->vkCmdDrawIndexed(commandBuffer, indexCount, 1, firstIndex, 0, 0);
+    drawStats.draws++;
+    drawStats.triangles += indexCount / 3;
+}
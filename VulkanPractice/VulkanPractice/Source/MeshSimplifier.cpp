@@ -0,0 +1,320 @@
+//
+//  MeshSimplifier.cpp
+//  VulkanPractice
+//
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+#include "MeshSimplifier.h"
+
+namespace {
+
+// Symmetric 4x4 matrix of the plane equations, only the upper triangle is stored
+struct Quadric {
+    double a2 = 0, ab = 0, ac = 0, ad = 0;
+    double b2 = 0, bc = 0, bd = 0;
+    double c2 = 0, cd = 0;
+    double d2 = 0;
+
+    static Quadric plane(double a, double b, double c, double d) {
+        return {a * a, a * b, a * c, a * d, b * b, b * c, b * d, c * c, c * d, d * d};
+    }
+
+    Quadric& operator+=(const Quadric& other) {
+        a2 += other.a2; ab += other.ab; ac += other.ac; ad += other.ad;
+        b2 += other.b2; bc += other.bc; bd += other.bd;
+        c2 += other.c2; cd += other.cd;
+        d2 += other.d2;
+        return *this;
+    }
+
+    // Sum of squared distances of the point to the planes
+    double error(const float* p) const {
+        const double x = p[0], y = p[1], z = p[2];
+        double value = a2 * x * x + 2 * ab * x * y + 2 * ac * x * z + 2 * ad * x
+                     + b2 * y * y + 2 * bc * y * z + 2 * bd * y
+                     + c2 * z * z + 2 * cd * z
+                     + d2;
+        return std::max(value, 0.0);
+    }
+};
+
+struct Collapse {
+    uint32_t from;
+    uint32_t to;
+    double error;
+};
+
+void cross(const float* a, const float* b, const float* c, double* normal) {
+    const double u[3] = {double(b[0]) - a[0], double(b[1]) - a[1], double(b[2]) - a[2]};
+    const double v[3] = {double(c[0]) - a[0], double(c[1]) - a[1], double(c[2]) - a[2]};
+    normal[0] = u[1] * v[2] - u[2] * v[1];
+    normal[1] = u[2] * v[0] - u[0] * v[2];
+    normal[2] = u[0] * v[1] - u[1] * v[0];
+}
+
+// Index of the first vertex with the same position, for every vertex
+std::vector<uint32_t> positionRepresentatives(const std::vector<MeshVertex>& vertices) {
+    std::vector<uint32_t> order(vertices.size());
+    std::iota(order.begin(), order.end(), 0u);
+    std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+        const float* pa = vertices[a].position;
+        const float* pb = vertices[b].position;
+        if (pa[0] != pb[0]) return pa[0] < pb[0];
+        if (pa[1] != pb[1]) return pa[1] < pb[1];
+        if (pa[2] != pb[2]) return pa[2] < pb[2];
+        return a < b;
+    });
+
+    std::vector<uint32_t> representative(vertices.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        const bool samePosition = i > 0 && std::equal(vertices[order[i]].position, vertices[order[i]].position + 3,
+                                                      vertices[order[i - 1]].position);
+        representative[order[i]] = samePosition ? representative[order[i - 1]] : order[i];
+    }
+    return representative;
+}
+
+// Quadric state of a mesh while it is simplified level by level. The quadrics are built once from the full mesh and carried
+// from level to level, so errors keep measuring the distance to the original surface
+class QuadricSimplifier {
+public:
+    QuadricSimplifier(const std::vector<MeshVertex>& vertices, const std::vector<uint32_t>& indices);
+
+    // Simplifies the triangles in indices, which have to come from the mesh or an earlier call, down to about targetIndexCount
+    void simplify(std::vector<uint32_t>& indices, size_t targetIndexCount, float maxError);
+
+    // Largest distance any collapse so far moved the surface away from the original one
+    float error() const { return static_cast<float>(std::sqrt(resultError)); }
+
+private:
+    const std::vector<MeshVertex>& vertices;
+    // Collapses work on positions, a vertex split by its attributes is one position with several vertices
+    std::vector<uint32_t> position;
+    std::vector<bool> seam;
+    std::vector<Quadric> quadrics;
+    double resultError = 0.0;
+
+    std::vector<uint64_t> edges;
+    std::vector<uint32_t> offsets;
+    std::vector<uint32_t> adjacentTriangles;
+    std::vector<bool> locked;
+    std::vector<bool> touched;
+    std::vector<uint32_t> remap;
+    std::vector<Collapse> collapses;
+};
+
+QuadricSimplifier::QuadricSimplifier(const std::vector<MeshVertex>& vertices, const std::vector<uint32_t>& indices)
+    : vertices(vertices), position(positionRepresentatives(vertices)), seam(vertices.size(), false),
+      quadrics(vertices.size()), remap(vertices.size()) {
+    const size_t vertexCount = vertices.size();
+
+    // Seams: positions that more than one referenced vertex shares
+    std::vector<uint32_t> firstVertex(vertexCount, UINT32_MAX);
+    for (uint32_t index : indices) {
+        uint32_t& first = firstVertex[position[index]];
+        if (first == UINT32_MAX) {
+            first = index;
+        } else if (first != index) {
+            seam[position[index]] = true;
+        }
+    }
+
+    for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+        const float* p0 = vertices[indices[i]].position;
+        double normal[3];
+        cross(p0, vertices[indices[i + 1]].position, vertices[indices[i + 2]].position, normal);
+        const double length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+        if (length == 0.0) continue;
+
+        const double a = normal[0] / length, b = normal[1] / length, c = normal[2] / length;
+        const Quadric plane = Quadric::plane(a, b, c, -(a * p0[0] + b * p0[1] + c * p0[2]));
+        for (int corner = 0; corner < 3; corner++) {
+            quadrics[position[indices[i + corner]]] += plane;
+        }
+    }
+}
+
+void QuadricSimplifier::simplify(std::vector<uint32_t>& indices, size_t targetIndexCount, float maxError) {
+    const size_t vertexCount = vertices.size();
+    const double maxQuadricError = static_cast<double>(maxError) * maxError;
+
+    while (indices.size() > targetIndexCount) {
+        const size_t triangleCount = indices.size() / 3;
+
+        // Every edge once per triangle, as a sorted pair of positions
+        edges.clear();
+        for (size_t i = 0; i < indices.size(); i += 3) {
+            for (int corner = 0; corner < 3; corner++) {
+                uint64_t a = position[indices[i + corner]];
+                uint64_t b = position[indices[i + (corner + 1) % 3]];
+                edges.push_back(a < b ? (a << 32) | b : (b << 32) | a);
+            }
+        }
+        std::sort(edges.begin(), edges.end());
+
+        // Edges that don't have exactly two triangles are borders or non-manifold
+        locked = seam;
+        for (size_t i = 0; i < edges.size();) {
+            size_t end = i;
+            while (end < edges.size() && edges[end] == edges[i]) end++;
+            if (end - i != 2) {
+                locked[edges[i] >> 32] = true;
+                locked[edges[i] & 0xFFFFFFFF] = true;
+            }
+            i = end;
+        }
+        edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+
+        // Triangles around every position
+        offsets.assign(vertexCount + 1, 0);
+        for (uint32_t index : indices) {
+            offsets[position[index] + 1]++;
+        }
+        for (size_t v = 0; v < vertexCount; v++) {
+            offsets[v + 1] += offsets[v];
+        }
+        adjacentTriangles.resize(indices.size());
+        std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+        for (size_t i = 0; i < indices.size(); i++) {
+            adjacentTriangles[fill[position[indices[i]]]++] = static_cast<uint32_t>(i / 3);
+        }
+
+        // The cheaper direction of every edge that can collapse at all
+        collapses.clear();
+        for (uint64_t edge : edges) {
+            const uint32_t a = static_cast<uint32_t>(edge >> 32);
+            const uint32_t b = static_cast<uint32_t>(edge & 0xFFFFFFFF);
+            Quadric sum = quadrics[a];
+            sum += quadrics[b];
+
+            const double errorAToB = locked[a] ? -1.0 : sum.error(vertices[b].position);
+            const double errorBToA = locked[b] ? -1.0 : sum.error(vertices[a].position);
+            if (errorAToB >= 0.0 && (errorBToA < 0.0 || errorAToB <= errorBToA)) {
+                collapses.push_back({a, b, errorAToB});
+            } else if (errorBToA >= 0.0) {
+                collapses.push_back({b, a, errorBToA});
+            }
+        }
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) { return a.error < b.error; });
+
+        std::iota(remap.begin(), remap.end(), 0u);
+        touched.assign(vertexCount, false);
+        const size_t trianglesToRemove = triangleCount - targetIndexCount / 3;
+        size_t removedTriangles = 0;
+        bool collapsed = false;
+
+        // A collapse removes two triangles. Once the cheap collapses are blocked by touched vertices,
+        // going further down the list would take expensive ones that the next pass can do better
+        const size_t collapseGoal = std::min(collapses.size(), trianglesToRemove / 2 + 1);
+        const double passErrorLimit = collapses.empty() ? 0.0 : std::min(maxQuadricError, collapses[collapseGoal - 1].error * 1.5);
+
+        for (const Collapse& collapse : collapses) {
+            if (collapse.error > passErrorLimit || removedTriangles >= trianglesToRemove) break;
+            if (touched[collapse.from] || touched[collapse.to]) continue;
+
+            // Triangles that keep existing must not turn around, the ones on the edge disappear
+            const float* target = vertices[collapse.to].position;
+            uint32_t targetVertex = UINT32_MAX;
+            size_t edgeTriangles = 0;
+            bool flips = false;
+            for (uint32_t i = offsets[collapse.from]; i < offsets[collapse.from + 1] && !flips; i++) {
+                const uint32_t* triangle = &indices[static_cast<size_t>(adjacentTriangles[i]) * 3];
+
+                const float* corners[3];
+                bool onEdge = false;
+                for (int corner = 0; corner < 3; corner++) {
+                    corners[corner] = vertices[triangle[corner]].position;
+                    if (position[triangle[corner]] == collapse.to) {
+                        onEdge = true;
+                        targetVertex = triangle[corner];
+                    }
+                }
+                if (onEdge) {
+                    edgeTriangles++;
+                    continue;
+                }
+
+                double before[3];
+                cross(corners[0], corners[1], corners[2], before);
+                for (int corner = 0; corner < 3; corner++) {
+                    if (position[triangle[corner]] == collapse.from) corners[corner] = target;
+                }
+                double after[3];
+                cross(corners[0], corners[1], corners[2], after);
+                flips = before[0] * after[0] + before[1] * after[1] + before[2] * after[2] <= 0.0;
+            }
+            if (flips || targetVertex == UINT32_MAX) continue;
+
+            // The moving end isn't on a seam, so all of its corners are one vertex. They become the vertex of the other end
+            // the edge triangles used, which has the attributes on this side of any seam there
+            for (uint32_t i = offsets[collapse.from]; i < offsets[collapse.from + 1]; i++) {
+                const uint32_t* triangle = &indices[static_cast<size_t>(adjacentTriangles[i]) * 3];
+                for (int corner = 0; corner < 3; corner++) {
+                    touched[position[triangle[corner]]] = true;
+                    if (position[triangle[corner]] == collapse.from) remap[triangle[corner]] = targetVertex;
+                }
+            }
+
+            quadrics[collapse.to] += quadrics[collapse.from];
+            resultError = std::max(resultError, collapse.error);
+            removedTriangles += edgeTriangles;
+            collapsed = true;
+        }
+        if (!collapsed) break;
+
+        // Apply the pass and drop the triangles that became degenerate
+        size_t written = 0;
+        for (size_t i = 0; i < indices.size(); i += 3) {
+            const uint32_t a = remap[indices[i]], b = remap[indices[i + 1]], c = remap[indices[i + 2]];
+            if (position[a] == position[b] || position[b] == position[c] || position[a] == position[c]) continue;
+            indices[written++] = a;
+            indices[written++] = b;
+            indices[written++] = c;
+        }
+        indices.resize(written);
+    }
+}
+
+}
+
+float simplifyMesh(const std::vector<MeshVertex>& vertices, std::vector<uint32_t>& indices, size_t targetIndexCount, float maxError) {
+    QuadricSimplifier simplifier(vertices, indices);
+    simplifier.simplify(indices, targetIndexCount, maxError);
+    return simplifier.error();
+}
+
+void buildLods(Mesh& mesh, uint32_t maxLods, float maxError) {
+    // Rebuilt from the full mesh, earlier levels are dropped
+    if (!mesh.lods.empty()) {
+        mesh.indices.resize(mesh.lods[0].indexCount);
+    }
+    mesh.lods = {{0, static_cast<uint32_t>(mesh.indices.size()), 0.0f}};
+
+    // Every level continues from the previous one with the same quadrics, so its error is against the full mesh
+    QuadricSimplifier simplifier(mesh.vertices, mesh.indices);
+    std::vector<uint32_t> level = mesh.indices;
+    while (mesh.lods.size() < maxLods) {
+        const size_t previousCount = level.size();
+        const size_t target = previousCount / 6 * 3;
+        simplifier.simplify(level, target, maxError);
+
+        // Stuck at the error bound or the locked vertices, another level would look the same
+        if (level.empty() || level.size() > previousCount * 9 / 10) break;
+
+        mesh.lods.push_back({static_cast<uint32_t>(mesh.indices.size()), static_cast<uint32_t>(level.size()), simplifier.error()});
+        mesh.indices.insert(mesh.indices.end(), level.begin(), level.end());
+    }
+}
+
+uint32_t selectLod(const std::vector<MeshLod>& lods, float pixelsPerUnit, float maxPixelError) {
+    // Errors only grow with the level, so the last one below the threshold is the coarsest acceptable one
+    uint32_t selected = 0;
+    for (uint32_t i = 1; i < lods.size(); i++) {
+        if (lods[i].error * pixelsPerUnit > maxPixelError) break;
+        selected = i;
+    }
+    return selected;
+}
@@ -0,0 +1,619 @@
+//
+//  MultiviewRenderer.cpp
+//  VulkanPractice
+//
+
+#include <array>
+#include <cstring>
+#include <stdexcept>
+
+#include "EmbeddedShaders.h"
+#include "MultiviewRenderer.h"
+#include "VulkanMemory.h"
+
+namespace {
+
+// Matches the uniform block of multiview.vert and multiview_layer.vert
+struct MultiviewUniforms {
+    glm::mat4 viewProjection[MultiviewRenderer::maxViews];
+};
+
+// Matches the push constant block of multiview.vert and multiview_layer.vert
+struct MultiviewPushConstants {
+    glm::mat4 model;
+    // xyz, w unused
+    glm::vec4 boundsCenter;
+    glm::vec4 boundsHalfExtent;
+    uint32_t baseView;
+};
+
+static_assert(shaders::multiviewVert.hasBuffer(0, 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, sizeof(MultiviewUniforms)),
+              "multiview.vert doesn't match MultiviewUniforms");
+static_assert(shaders::multiviewVert.pushConstantSize == sizeof(MultiviewPushConstants), "multiview.vert doesn't match MultiviewPushConstants");
+static_assert(shaders::multiviewLayerVert.hasBuffer(0, 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, sizeof(MultiviewUniforms)),
+              "multiview_layer.vert doesn't match MultiviewUniforms");
+static_assert(shaders::multiviewLayerVert.pushConstantSize == sizeof(MultiviewPushConstants),
+              "multiview_layer.vert doesn't match MultiviewPushConstants");
+
+// constant_id of QUANTIZED in both multiview vertex shaders and of VIEW_COUNT in multiview_composite.frag
+const uint32_t quantizedConstantId = 0;
+const uint32_t viewCountConstantId = 0;
+
+}
+
+bool MultiviewRenderer::isSupported(VkPhysicalDevice physicalDevice, const InstanceDispatch& instanceTable, uint32_t viewCount) {
+    if (viewCount > maxViews) return false;
+
+    // Only filled in by Vulkan 1.1 devices, the rest leave them zeroed
+    VkPhysicalDeviceMultiviewFeatures multiviewFeatures{};
+    multiviewFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MULTIVIEW_FEATURES;
+    VkPhysicalDeviceFeatures2 features{};
+    features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features.pNext = &multiviewFeatures;
+    instanceTable.vkGetPhysicalDeviceFeatures2KHR(physicalDevice, &features);
+
+    VkPhysicalDeviceMultiviewProperties multiviewProperties{};
+    multiviewProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MULTIVIEW_PROPERTIES;
+    VkPhysicalDeviceProperties2 properties{};
+    properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    properties.pNext = &multiviewProperties;
+    instanceTable.vkGetPhysicalDeviceProperties2KHR(physicalDevice, &properties);
+
+    return properties.properties.apiVersion >= VK_API_VERSION_1_1 && multiviewFeatures.multiview == VK_TRUE &&
+           multiviewProperties.maxMultiviewViewCount >= viewCount;
+}
+
+void MultiviewRenderer::init(VkPhysicalDevice physicalDevice, const InstanceDispatch& instanceTable, VkDevice device, const DeviceDispatch* deviceTable,
+                             const VkAllocationCallbacks* allocator, PipelineManager* pipelineManager, VkFormat colorFormat, VkFormat depthFormat,
+                             uint32_t viewCount, uint32_t frameSlots, bool multiviewEnabled) {
+    if (viewCount == 0 || viewCount > maxViews) {
+        throw std::runtime_error("unsupported number of multiview views!");
+    }
+
+    this->device = device;
+    this->deviceTable = deviceTable;
+    this->allocator = allocator;
+    this->pipelineManager = pipelineManager;
+    this->colorFormat = colorFormat;
+    this->depthFormat = depthFormat;
+    views = viewCount;
+
+    instanceTable.vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+
+    VkPhysicalDeviceProperties properties;
+    instanceTable.vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    const VkDeviceSize alignment = properties.limits.minUniformBufferOffsetAlignment;
+    slotStride = (sizeof(MultiviewUniforms) + alignment - 1) / alignment * alignment;
+
+    createRenderPasses(multiviewEnabled);
+    createDescriptors(frameSlots);
+    renderMode = multiviewEnabled ? MultiviewMode::Multiview : MultiviewMode::SeparatePasses;
+
+    layerPipelineState.vertexShader = pipelineManager->addShader(shaders::multiviewLayerVert);
+    layerPipelineState.fragmentShader = pipelineManager->addShader(shaders::meshFrag);
+    layerPipelineState.layout = scenePipelineLayout;
+    layerPipelineState.colorFormat = colorFormat;
+    layerPipelineState.depthTest = true;
+    layerPipelineState.depthWrite = true;
+    // multiview.vert declares the MultiView capability, its module is only valid with the feature enabled
+    if (multiviewEnabled) {
+        multiviewPipelineState = layerPipelineState;
+        multiviewPipelineState.vertexShader = pipelineManager->addShader(shaders::multiviewVert);
+    }
+
+    compositePipelineState.vertexShader = pipelineManager->addShader(shaders::fullscreenVert);
+    compositePipelineState.fragmentShader = pipelineManager->addShader(shaders::multiviewCompositeFrag);
+    compositePipelineState.fragmentSpecialization.set(viewCountConstantId, views);
+    compositePipelineState.layout = compositePipelineLayout;
+}
+
+void MultiviewRenderer::destroy() {
+    if (device == VK_NULL_HANDLE) return;
+
+    destroyTarget();
+
+    deviceTable->vkDestroyPipelineLayout(device, scenePipelineLayout, allocator);
+    deviceTable->vkDestroyPipelineLayout(device, compositePipelineLayout, allocator);
+    deviceTable->vkDestroySampler(device, sampler, allocator);
+    // Frees the descriptor sets as well
+    deviceTable->vkDestroyDescriptorPool(device, descriptorPool, allocator);
+    deviceTable->vkDestroyDescriptorSetLayout(device, sceneSetLayout, allocator);
+    deviceTable->vkDestroyDescriptorSetLayout(device, compositeSetLayout, allocator);
+    deviceTable->vkDestroyBuffer(device, uniformBuffer, allocator);
+    // Unmapped implicitly
+    deviceTable->vkFreeMemory(device, uniformMemory, allocator);
+    if (multiviewRenderPass != VK_NULL_HANDLE) {
+        deviceTable->vkDestroyRenderPass(device, multiviewRenderPass, allocator);
+        multiviewRenderPass = VK_NULL_HANDLE;
+    }
+    deviceTable->vkDestroyRenderPass(device, layerRenderPass, allocator);
+
+    sceneSets.clear();
+    compositeSet = VK_NULL_HANDLE;
+    mapped = nullptr;
+    device = VK_NULL_HANDLE;
+}
+
+void MultiviewRenderer::createRenderPasses(bool multiviewEnabled) {
+    // Both passes clear and keep the color for the composite, depth is only needed during the pass
+    VkAttachmentDescription colorAttachment{};
+    colorAttachment.format = colorFormat;
+    colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+    colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    colorAttachment.finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+    VkAttachmentDescription depthAttachment{};
+    depthAttachment.format = depthFormat;
+    depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+    depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+    VkAttachmentReference colorAttachmentRef{};
+    colorAttachmentRef.attachment = 0;
+    colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+    VkAttachmentReference depthAttachmentRef{};
+    depthAttachmentRef.attachment = 1;
+    depthAttachmentRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+    VkSubpassDescription subpass{};
+    subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    subpass.colorAttachmentCount = 1;
+    subpass.pColorAttachments = &colorAttachmentRef;
+    subpass.pDepthStencilAttachment = &depthAttachmentRef;
+
+    // The target is shared by the frames in flight: the clear waits for the previous frame's depth tests and composite
+    VkSubpassDependency dependency{};
+    dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
+    dependency.dstSubpass = 0;
+    dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT |
+                              VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+    dependency.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+    dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+    // The composite samples the layers right after
+    VkSubpassDependency compositeDependency{};
+    compositeDependency.srcSubpass = 0;
+    compositeDependency.dstSubpass = VK_SUBPASS_EXTERNAL;
+    compositeDependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    compositeDependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    compositeDependency.dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+    compositeDependency.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+    std::array<VkAttachmentDescription, 2> attachments = {colorAttachment, depthAttachment};
+    std::array<VkSubpassDependency, 2> dependencies = {dependency, compositeDependency};
+
+    VkRenderPassCreateInfo renderPassInfo{};
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+    renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+    renderPassInfo.pAttachments = attachments.data();
+    renderPassInfo.subpassCount = 1;
+    renderPassInfo.pSubpasses = &subpass;
+    renderPassInfo.dependencyCount = static_cast<uint32_t>(dependencies.size());
+    renderPassInfo.pDependencies = dependencies.data();
+
+    if (deviceTable->vkCreateRenderPass(device, &renderPassInfo, allocator, &layerRenderPass) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create multiview layer render pass!");
+    }
+    if (!multiviewEnabled) return;
+
+    // Bit i renders view i into layer i. All of them see the same scene from nearby cameras, so they are correlated
+    const uint32_t viewMask = (1u << views) - 1;
+    const uint32_t correlationMask = viewMask;
+
+    VkRenderPassMultiviewCreateInfo multiviewInfo{};
+    multiviewInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_MULTIVIEW_CREATE_INFO;
+    multiviewInfo.subpassCount = 1;
+    multiviewInfo.pViewMasks = &viewMask;
+    multiviewInfo.correlationMaskCount = 1;
+    multiviewInfo.pCorrelationMasks = &correlationMask;
+    renderPassInfo.pNext = &multiviewInfo;
+
+    if (deviceTable->vkCreateRenderPass(device, &renderPassInfo, allocator, &multiviewRenderPass) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create multiview render pass!");
+    }
+}
+
+void MultiviewRenderer::createDescriptors(uint32_t frameSlots) {
+    VkBufferCreateInfo bufferInfo{};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = slotStride * frameSlots;
+    bufferInfo.usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    if (deviceTable->vkCreateBuffer(device, &bufferInfo, allocator, &uniformBuffer) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create multiview uniform buffer!");
+    }
+
+    VkMemoryRequirements memoryRequirements;
+    deviceTable->vkGetBufferMemoryRequirements(device, uniformBuffer, &memoryRequirements);
+
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = memoryRequirements.size;
+    allocInfo.memoryTypeIndex = findMemoryType(memoryProperties, memoryRequirements.memoryTypeBits,
+                                               VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+    if (deviceTable->vkAllocateMemory(device, &allocInfo, allocator, &uniformMemory) != VK_SUCCESS) {
+        throw std::runtime_error("failed to allocate multiview uniform buffer memory!");
+    }
+    deviceTable->vkBindBufferMemory(device, uniformBuffer, uniformMemory, 0);
+
+    void* data = nullptr;
+    if (deviceTable->vkMapMemory(device, uniformMemory, 0, VK_WHOLE_SIZE, 0, &data) != VK_SUCCESS) {
+        throw std::runtime_error("failed to map multiview uniform buffer!");
+    }
+    mapped = static_cast<uint8_t*>(data);
+
+    // The pool below holds one uniform buffer per scene set and one image per composite set
+    static_assert(shaders::multiviewVert.bindingCount == 1 && shaders::multiviewLayerVert.bindingCount == 1 &&
+                  shaders::multiviewCompositeFrag.bindingCount == 1 &&
+                  shaders::multiviewCompositeFrag.bindings[0].descriptorType == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                  "multiview shaders don't match the pool");
+
+    std::vector<VkDescriptorSetLayoutBinding> sceneBindings =
+        descriptorSetLayoutBindings(0, {&shaders::multiviewVert, &shaders::multiviewLayerVert, &shaders::meshFrag});
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = static_cast<uint32_t>(sceneBindings.size());
+    layoutInfo.pBindings = sceneBindings.data();
+
+    if (deviceTable->vkCreateDescriptorSetLayout(device, &layoutInfo, allocator, &sceneSetLayout) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create multiview descriptor set layout!");
+    }
+
+    std::vector<VkDescriptorSetLayoutBinding> compositeBindings =
+        descriptorSetLayoutBindings(0, {&shaders::fullscreenVert, &shaders::multiviewCompositeFrag});
+    layoutInfo.bindingCount = static_cast<uint32_t>(compositeBindings.size());
+    layoutInfo.pBindings = compositeBindings.data();
+
+    if (deviceTable->vkCreateDescriptorSetLayout(device, &layoutInfo, allocator, &compositeSetLayout) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create multiview composite descriptor set layout!");
+    }
+
+    std::array<VkDescriptorPoolSize, 2> poolSizes{};
+    poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    poolSizes[0].descriptorCount = frameSlots;
+    poolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    poolSizes[1].descriptorCount = 1;
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.maxSets = frameSlots + 1;
+    poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+    poolInfo.pPoolSizes = poolSizes.data();
+
+    if (deviceTable->vkCreateDescriptorPool(device, &poolInfo, allocator, &descriptorPool) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create multiview descriptor pool!");
+    }
+
+    std::vector<VkDescriptorSetLayout> layouts(frameSlots, sceneSetLayout);
+    layouts.push_back(compositeSetLayout);
+    VkDescriptorSetAllocateInfo setInfo{};
+    setInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    setInfo.descriptorPool = descriptorPool;
+    setInfo.descriptorSetCount = static_cast<uint32_t>(layouts.size());
+    setInfo.pSetLayouts = layouts.data();
+
+    std::vector<VkDescriptorSet> sets(layouts.size());
+    if (deviceTable->vkAllocateDescriptorSets(device, &setInfo, sets.data()) != VK_SUCCESS) {
+        throw std::runtime_error("failed to allocate multiview descriptor sets!");
+    }
+    compositeSet = sets.back();
+    sets.pop_back();
+    sceneSets = std::move(sets);
+
+    // Valid cameras before the first write
+    MultiviewUniforms identity;
+    for (glm::mat4& viewProjection : identity.viewProjection) {
+        viewProjection = glm::mat4(1.0f);
+    }
+
+    for (uint32_t slot = 0; slot < frameSlots; slot++) {
+        VkDescriptorBufferInfo regionInfo{};
+        regionInfo.buffer = uniformBuffer;
+        regionInfo.offset = slot * slotStride;
+        regionInfo.range = sizeof(MultiviewUniforms);
+
+        VkWriteDescriptorSet descriptorWrite{};
+        descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        descriptorWrite.dstSet = sceneSets[slot];
+        descriptorWrite.dstBinding = 0;
+        descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        descriptorWrite.descriptorCount = 1;
+        descriptorWrite.pBufferInfo = &regionInfo;
+        deviceTable->vkUpdateDescriptorSets(device, 1, &descriptorWrite, 0, nullptr);
+
+        std::memcpy(mapped + slot * slotStride, &identity, sizeof(identity));
+    }
+
+    VkPushConstantRange drawRange = pushConstantRange({&shaders::multiviewVert, &shaders::multiviewLayerVert, &shaders::meshFrag});
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &sceneSetLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &drawRange;
+
+    if (deviceTable->vkCreatePipelineLayout(device, &pipelineLayoutInfo, allocator, &scenePipelineLayout) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create multiview pipeline layout!");
+    }
+
+    pipelineLayoutInfo.pSetLayouts = &compositeSetLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = 0;
+    pipelineLayoutInfo.pPushConstantRanges = nullptr;
+
+    if (deviceTable->vkCreatePipelineLayout(device, &pipelineLayoutInfo, allocator, &compositePipelineLayout) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create multiview composite pipeline layout!");
+    }
+
+    VkSamplerCreateInfo samplerInfo{};
+    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.magFilter = VK_FILTER_LINEAR;
+    samplerInfo.minFilter = VK_FILTER_LINEAR;
+    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.maxLod = 0.0f;
+
+    if (deviceTable->vkCreateSampler(device, &samplerInfo, allocator, &sampler) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create multiview sampler!");
+    }
+}
+
+void MultiviewRenderer::resize(VkExtent2D layerExtent) {
+    destroyTarget();
+    extent = layerExtent;
+
+    auto createImage = [&](VkFormat format, VkImageUsageFlags usage, VkImage& image, VkDeviceMemory& memory) {
+        VkImageCreateInfo imageInfo{};
+        imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageInfo.format = format;
+        imageInfo.extent = {extent.width, extent.height, 1};
+        imageInfo.mipLevels = 1;
+        imageInfo.arrayLayers = views;
+        imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.usage = usage;
+        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+        if (deviceTable->vkCreateImage(device, &imageInfo, allocator, &image) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create multiview target!");
+        }
+
+        VkMemoryRequirements memoryRequirements;
+        deviceTable->vkGetImageMemoryRequirements(device, image, &memoryRequirements);
+
+        VkMemoryAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocInfo.allocationSize = memoryRequirements.size;
+        allocInfo.memoryTypeIndex = findMemoryType(memoryProperties, memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+        if (deviceTable->vkAllocateMemory(device, &allocInfo, allocator, &memory) != VK_SUCCESS) {
+            throw std::runtime_error("failed to allocate multiview target memory!");
+        }
+        deviceTable->vkBindImageMemory(device, image, memory, 0);
+    };
+
+    auto createView = [&](VkImage image, VkFormat format, VkImageAspectFlags aspect, bool array, uint32_t firstLayer, uint32_t layerCount) {
+        VkImageViewCreateInfo viewInfo{};
+        viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        viewInfo.image = image;
+        viewInfo.viewType = array ? VK_IMAGE_VIEW_TYPE_2D_ARRAY : VK_IMAGE_VIEW_TYPE_2D;
+        viewInfo.format = format;
+        viewInfo.subresourceRange.aspectMask = aspect;
+        viewInfo.subresourceRange.levelCount = 1;
+        viewInfo.subresourceRange.baseArrayLayer = firstLayer;
+        viewInfo.subresourceRange.layerCount = layerCount;
+
+        VkImageView view;
+        if (deviceTable->vkCreateImageView(device, &viewInfo, allocator, &view) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create multiview target view!");
+        }
+        return view;
+    };
+
+    auto createFramebuffer = [&](VkRenderPass renderPass, VkImageView color, VkImageView depth) {
+        VkImageView attachments[] = {color, depth};
+
+        // A multiview framebuffer has a single layer, the view mask decides which layers of the attachments are rendered
+        VkFramebufferCreateInfo framebufferInfo{};
+        framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+        framebufferInfo.renderPass = renderPass;
+        framebufferInfo.attachmentCount = 2;
+        framebufferInfo.pAttachments = attachments;
+        framebufferInfo.width = extent.width;
+        framebufferInfo.height = extent.height;
+        framebufferInfo.layers = 1;
+
+        VkFramebuffer framebuffer;
+        if (deviceTable->vkCreateFramebuffer(device, &framebufferInfo, allocator, &framebuffer) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create multiview framebuffer!");
+        }
+        return framebuffer;
+    };
+
+    createImage(colorFormat, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, colorImage, colorImageMemory);
+    createImage(depthFormat, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, depthImage, depthImageMemory);
+
+    // The sampler2DArray of the composite wants an array view, even with a single layer
+    colorArrayView = createView(colorImage, colorFormat, VK_IMAGE_ASPECT_COLOR_BIT, true, 0, views);
+    depthArrayView = createView(depthImage, depthFormat, VK_IMAGE_ASPECT_DEPTH_BIT, true, 0, views);
+    if (multiviewRenderPass != VK_NULL_HANDLE) {
+        multiviewFramebuffer = createFramebuffer(multiviewRenderPass, colorArrayView, depthArrayView);
+    }
+
+    for (uint32_t layer = 0; layer < views; layer++) {
+        VkImageView colorView = createView(colorImage, colorFormat, VK_IMAGE_ASPECT_COLOR_BIT, false, layer, 1);
+        VkImageView depthView = createView(depthImage, depthFormat, VK_IMAGE_ASPECT_DEPTH_BIT, false, layer, 1);
+        layerViews.push_back(colorView);
+        layerViews.push_back(depthView);
+        layerFramebuffers.push_back(createFramebuffer(layerRenderPass, colorView, depthView));
+    }
+
+    VkDescriptorImageInfo imageInfo{};
+    imageInfo.sampler = sampler;
+    imageInfo.imageView = colorArrayView;
+    imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+    VkWriteDescriptorSet descriptorWrite{};
+    descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptorWrite.dstSet = compositeSet;
+    descriptorWrite.dstBinding = 0;
+    descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    descriptorWrite.descriptorCount = 1;
+    descriptorWrite.pImageInfo = &imageInfo;
+    deviceTable->vkUpdateDescriptorSets(device, 1, &descriptorWrite, 0, nullptr);
+}
+
+void MultiviewRenderer::destroyTarget() {
+    if (colorImage == VK_NULL_HANDLE) return;
+
+    for (VkFramebuffer framebuffer : layerFramebuffers) {
+        deviceTable->vkDestroyFramebuffer(device, framebuffer, allocator);
+    }
+    for (VkImageView view : layerViews) {
+        deviceTable->vkDestroyImageView(device, view, allocator);
+    }
+    layerFramebuffers.clear();
+    layerViews.clear();
+
+    if (multiviewFramebuffer != VK_NULL_HANDLE) {
+        deviceTable->vkDestroyFramebuffer(device, multiviewFramebuffer, allocator);
+        multiviewFramebuffer = VK_NULL_HANDLE;
+    }
+    deviceTable->vkDestroyImageView(device, colorArrayView, allocator);
+    deviceTable->vkDestroyImageView(device, depthArrayView, allocator);
+    deviceTable->vkDestroyImage(device, colorImage, allocator);
+    deviceTable->vkFreeMemory(device, colorImageMemory, allocator);
+    deviceTable->vkDestroyImage(device, depthImage, allocator);
+    deviceTable->vkFreeMemory(device, depthImageMemory, allocator);
+    colorImage = VK_NULL_HANDLE;
+    depthImage = VK_NULL_HANDLE;
+}
+
+void MultiviewRenderer::setMode(MultiviewMode mode) {
+    if (mode == MultiviewMode::Multiview && !hasMultiview()) {
+        throw std::runtime_error("multiview isn't enabled on the device!");
+    }
+
+    renderMode = mode;
+}
+
+void MultiviewRenderer::setViewProjection(uint32_t frameSlot, uint32_t view, const glm::mat4& viewProjection) {
+    std::memcpy(mapped + frameSlot * slotStride + view * sizeof(glm::mat4), &viewProjection, sizeof(glm::mat4));
+}
+
+void MultiviewRenderer::record(VkCommandBuffer commandBuffer, uint32_t frameSlot, const SceneCallback& drawScene) {
+    const Clock::time_point start = Clock::now();
+    this->commandBuffer = commandBuffer;
+
+    if (renderMode == MultiviewMode::Multiview) {
+        baseView = 0;
+        beginPass(multiviewRenderPass, multiviewFramebuffer);
+        deviceTable->vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, scenePipelineLayout, 0, 1,
+                                             &sceneSets[frameSlot], 0, nullptr);
+        drawScene();
+        deviceTable->vkCmdEndRenderPass(commandBuffer);
+    } else {
+        for (uint32_t layer = 0; layer < views; layer++) {
+            baseView = layer;
+            beginPass(layerRenderPass, layerFramebuffers[layer]);
+            deviceTable->vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, scenePipelineLayout, 0, 1,
+                                                 &sceneSets[frameSlot], 0, nullptr);
+            drawScene();
+            deviceTable->vkCmdEndRenderPass(commandBuffer);
+        }
+    }
+
+    this->commandBuffer = VK_NULL_HANDLE;
+    renderStats.frames++;
+    renderStats.recordMs += std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+void MultiviewRenderer::beginPass(VkRenderPass renderPass, VkFramebuffer framebuffer) {
+    VkRenderPassBeginInfo renderPassInfo{};
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+    renderPassInfo.renderPass = renderPass;
+    renderPassInfo.framebuffer = framebuffer;
+    renderPassInfo.renderArea.offset = {0, 0};
+    renderPassInfo.renderArea.extent = extent;
+
+    // Depth is cleared to 0, the infinitely far plane of the reversed Z projection
+    std::array<VkClearValue, 2> clearValues{};
+    clearValues[0].color = {{0.0f, 0.0f, 0.0f, 1.0f}};
+    clearValues[1].depthStencil = {0.0f, 0};
+    renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
+    renderPassInfo.pClearValues = clearValues.data();
+
+    deviceTable->vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+    VkViewport viewport{};
+    viewport.width = static_cast<float>(extent.width);
+    viewport.height = static_cast<float>(extent.height);
+    viewport.minDepth = 0.0f;
+    viewport.maxDepth = 1.0f;
+    deviceTable->vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+
+    VkRect2D scissor{};
+    scissor.extent = extent;
+    deviceTable->vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+    currentRenderPass = renderPass;
+    boundMesh = nullptr;
+    pipelineBound = false;
+    renderStats.passes++;
+}
+
+void MultiviewRenderer::draw(const GpuMesh& mesh, const glm::mat4& model) {
+    if (!pipelineBound || mesh.format() != boundFormat) {
+        PipelineState state = currentRenderPass == multiviewRenderPass ? multiviewPipelineState : layerPipelineState;
+        state.renderPass = currentRenderPass;
+        state.vertexLayout = GpuMesh::vertexLayout(mesh.format());
+        state.vertexSpecialization.set(quantizedConstantId, mesh.format() == VertexFormat::Quantized);
+        deviceTable->vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineManager->getPipeline(state));
+
+        pipelineBound = true;
+        boundFormat = mesh.format();
+    }
+    if (&mesh != boundMesh) {
+        mesh.bind(commandBuffer);
+        boundMesh = &mesh;
+    }
+
+    // Float positions are used as they are
+    MultiviewPushConstants constants{model, glm::vec4(0.0f), glm::vec4(1.0f), baseView};
+    if (mesh.format() == VertexFormat::Quantized) {
+        constants.boundsCenter = glm::vec4(mesh.bounds().center, 0.0f);
+        constants.boundsHalfExtent = glm::vec4(mesh.bounds().halfExtent, 0.0f);
+    }
+    deviceTable->vkCmdPushConstants(commandBuffer, scenePipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(constants), &constants);
+
+    const MeshLod& lod = mesh.lods()[0];
+    deviceTable->vkCmdDrawIndexed(commandBuffer, lod.indexCount, 1, lod.firstIndex, 0, 0);
+    renderStats.draws++;
+}
+
+void MultiviewRenderer::composite(VkCommandBuffer commandBuffer, VkRenderPass renderPass, VkFormat colorFormat) {
+    PipelineState state = compositePipelineState;
+    state.renderPass = renderPass;
+    state.colorFormat = colorFormat;
+
+    deviceTable->vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineManager->getPipeline(state));
+    deviceTable->vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, compositePipelineLayout, 0, 1,
+                                         &compositeSet, 0, nullptr);
+    deviceTable->vkCmdDraw(commandBuffer, 3, 1, 0, 0);
+}
@@ -0,0 +1,687 @@
+//
+//  PipelineManager.cpp
+//  VulkanPractice
+//
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+
+#include "PipelineManager.h"
+
+namespace {
+
+constexpr uint64_t FNV_OFFSET_BASIS = 14695981039346656037ull;
+constexpr uint64_t FNV_PRIME = 1099511628211ull;
+
+uint64_t hashBytes(uint64_t hash, const void* data, size_t size) {
+    const auto* bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ bytes[i]) * FNV_PRIME;
+    }
+    return hash;
+}
+
+// Hashes field by field, hashing the whole struct would include the padding
+template <typename T>
+uint64_t hashValue(uint64_t hash, const T& value) {
+    return hashBytes(hash, &value, sizeof(value));
+}
+
+double millisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Every create info of a variant. The members point at each other, so it is filled in place and never copied
+struct PipelineDescription {
+    PipelineDescription(const PipelineState& state, VkShaderModule vertShaderModule, VkShaderModule fragShaderModule);
+    PipelineDescription(const PipelineDescription& obj) = delete;
+
+    PipelineDescription& operator=(const PipelineDescription& obj) = delete;
+
+    void specialize(uint32_t stage, const SpecializationConstants& constants);
+
+    VkSpecializationMapEntry specializationEntries[2][SpecializationConstants::MAX_CONSTANTS]{};
+    VkSpecializationInfo specializationInfos[2]{};
+    VkPipelineShaderStageCreateInfo shaderStages[2]{};
+    VkVertexInputBindingDescription vertexBinding{};
+    VkVertexInputAttributeDescription vertexAttributes[VertexLayout::MAX_ATTRIBUTES]{};
+    VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
+    VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
+    VkDynamicState dynamicStates[2]{};
+    VkPipelineDynamicStateCreateInfo dynamicState{};
+    VkPipelineViewportStateCreateInfo viewportState{};
+    VkPipelineRasterizationStateCreateInfo rasterizer{};
+    VkPipelineMultisampleStateCreateInfo multisampling{};
+    VkPipelineDepthStencilStateCreateInfo depthStencil{};
+    VkPipelineColorBlendAttachmentState colorBlendAttachment{};
+    VkPipelineColorBlendStateCreateInfo colorBlending{};
+    VkGraphicsPipelineCreateInfo pipelineInfo{};
+};
+
+PipelineDescription::PipelineDescription(const PipelineState& state, VkShaderModule vertShaderModule, VkShaderModule fragShaderModule) {
+    // Vertex shader stage
+    shaderStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    shaderStages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+    shaderStages[0].module = vertShaderModule;
+    shaderStages[0].pName = "main";
+
+    // Fragment shader stage
+    shaderStages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    shaderStages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+    shaderStages[1].module = fragShaderModule;
+    shaderStages[1].pName = "main";
+
+    specialize(0, state.vertexSpecialization);
+    specialize(1, state.fragmentSpecialization);
+
+    // Vertex Data
+    // Without attributes the vertex data is hardcoded in the shaders, and there is no binding either
+    vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+
+    const VertexLayout& vertexLayout = state.vertexLayout;
+    if (vertexLayout.count > 0) {
+        vertexBinding.binding = 0;
+        vertexBinding.stride = vertexLayout.stride;
+        vertexBinding.inputRate = vertexLayout.inputRate;
+
+        for (uint32_t i = 0; i < vertexLayout.count; i++) {
+            vertexAttributes[i].location = i;
+            vertexAttributes[i].binding = 0;
+            vertexAttributes[i].format = vertexLayout.formats[i];
+            vertexAttributes[i].offset = vertexLayout.offsets[i];
+        }
+
+        vertexInputInfo.vertexBindingDescriptionCount = 1;
+        vertexInputInfo.pVertexBindingDescriptions = &vertexBinding;
+        vertexInputInfo.vertexAttributeDescriptionCount = vertexLayout.count;
+        vertexInputInfo.pVertexAttributeDescriptions = vertexAttributes;
+    }
+
+    // Input Assembly
+    inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+    inputAssembly.topology = state.topology;
+    inputAssembly.primitiveRestartEnable = VK_FALSE;
+
+    // Viewport and Scissors
+    // Dynamic so that they can be updated at any time, which also keeps them out of the variant key
+    dynamicStates[0] = VK_DYNAMIC_STATE_VIEWPORT;
+    dynamicStates[1] = VK_DYNAMIC_STATE_SCISSOR;
+
+    dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    dynamicState.dynamicStateCount = 2;
+    dynamicState.pDynamicStates = dynamicStates;
+
+    viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+    viewportState.viewportCount = 1;
+    viewportState.scissorCount = 1;
+
+    // Rasterizer
+    rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+    rasterizer.depthClampEnable = VK_FALSE;
+    rasterizer.rasterizerDiscardEnable = VK_FALSE;
+    rasterizer.polygonMode = state.polygonMode;
+    rasterizer.lineWidth = 1.0f;
+    rasterizer.cullMode = state.cullMode;
+    rasterizer.frontFace = state.frontFace;
+    rasterizer.depthBiasEnable = VK_FALSE;
+
+    // Multisampling - Keep it disabled for now
+    multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+    multisampling.sampleShadingEnable = VK_FALSE;
+    multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+    multisampling.minSampleShading = 1.0f;
+
+    // Depth test, the render pass decides whether there is a depth attachment at all
+    depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+    depthStencil.depthTestEnable = state.depthTest ? VK_TRUE : VK_FALSE;
+    depthStencil.depthWriteEnable = state.depthWrite ? VK_TRUE : VK_FALSE;
+    depthStencil.depthCompareOp = state.depthCompareOp;
+    depthStencil.depthBoundsTestEnable = VK_FALSE;
+    depthStencil.stencilTestEnable = VK_FALSE;
+
+    // Color blending
+    // Opaque variants skip the read of the destination, blending is only enabled when the alpha is actually used
+    colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+    colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
+    colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+    colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+    colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
+
+    switch (state.blendMode) {
+        case BlendMode::Opaque:
+            colorBlendAttachment.blendEnable = VK_FALSE;
+            colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
+            colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ZERO;
+            break;
+        case BlendMode::AlphaBlend:
+            colorBlendAttachment.blendEnable = VK_TRUE;
+            colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+            colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+            break;
+        case BlendMode::Additive:
+            colorBlendAttachment.blendEnable = VK_TRUE;
+            colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+            colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE;
+            break;
+    }
+
+    colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+    colorBlending.logicOpEnable = VK_FALSE;
+    colorBlending.logicOp = VK_LOGIC_OP_COPY;
+    colorBlending.attachmentCount = 1;
+    colorBlending.pAttachments = &colorBlendAttachment;
+
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    pipelineInfo.stageCount = 2;
+    pipelineInfo.pStages = shaderStages;
+
+    pipelineInfo.pVertexInputState = &vertexInputInfo;
+    pipelineInfo.pInputAssemblyState = &inputAssembly;
+    pipelineInfo.pViewportState = &viewportState;
+    pipelineInfo.pRasterizationState = &rasterizer;
+    pipelineInfo.pMultisampleState = &multisampling;
+    pipelineInfo.pDepthStencilState = &depthStencil;
+    pipelineInfo.pColorBlendState = &colorBlending;
+    pipelineInfo.pDynamicState = &dynamicState;
+
+    pipelineInfo.layout = state.layout;
+    pipelineInfo.renderPass = state.renderPass;
+    pipelineInfo.subpass = state.subpass;
+
+    pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+    pipelineInfo.basePipelineIndex = -1;
+}
+
+void PipelineDescription::specialize(uint32_t stage, const SpecializationConstants& constants) {
+    if (constants.count == 0) return;
+
+    // The values are tightly packed 32 bit words, entry i reads word i
+    for (uint32_t i = 0; i < constants.count; i++) {
+        specializationEntries[stage][i].constantID = constants.ids[i];
+        specializationEntries[stage][i].offset = i * sizeof(uint32_t);
+        specializationEntries[stage][i].size = sizeof(uint32_t);
+    }
+
+    specializationInfos[stage].mapEntryCount = constants.count;
+    specializationInfos[stage].pMapEntries = specializationEntries[stage];
+    specializationInfos[stage].dataSize = constants.count * sizeof(uint32_t);
+    specializationInfos[stage].pData = constants.values.data();
+
+    shaderStages[stage].pSpecializationInfo = &specializationInfos[stage];
+}
+
+}
+
+SpecializationConstants& SpecializationConstants::set(uint32_t id, uint32_t value) {
+    uint32_t index = 0;
+    while (index < count && ids[index] < id) {
+        index++;
+    }
+
+    if (index < count && ids[index] == id) {
+        values[index] = value;
+        return *this;
+    }
+
+    if (count == MAX_CONSTANTS) {
+        throw std::runtime_error("too many specialization constants!");
+    }
+
+    for (uint32_t i = count; i > index; i--) {
+        ids[i] = ids[i - 1];
+        values[i] = values[i - 1];
+    }
+    ids[index] = id;
+    values[index] = value;
+    count++;
+    return *this;
+}
+
+SpecializationConstants& SpecializationConstants::set(uint32_t id, int32_t value) {
+    return set(id, static_cast<uint32_t>(value));
+}
+
+SpecializationConstants& SpecializationConstants::set(uint32_t id, float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return set(id, bits);
+}
+
+SpecializationConstants& SpecializationConstants::set(uint32_t id, bool value) {
+    return set(id, static_cast<uint32_t>(value ? VK_TRUE : VK_FALSE));
+}
+
+bool SpecializationConstants::operator==(const SpecializationConstants& other) const {
+    return count == other.count
+        && std::equal(ids.begin(), ids.begin() + count, other.ids.begin())
+        && std::equal(values.begin(), values.begin() + count, other.values.begin());
+}
+
+uint64_t SpecializationConstants::hash(uint64_t seed) const {
+    // Only the used entries, the rest of the arrays is not part of the value
+    uint64_t hash = hashValue(seed, count);
+    hash = hashBytes(hash, ids.data(), count * sizeof(uint32_t));
+    return hashBytes(hash, values.data(), count * sizeof(uint32_t));
+}
+
+VertexLayout& VertexLayout::add(VkFormat format, uint32_t offset) {
+    if (count == MAX_ATTRIBUTES) {
+        throw std::runtime_error("too many vertex attributes!");
+    }
+
+    formats[count] = format;
+    offsets[count] = offset;
+    count++;
+    return *this;
+}
+
+bool VertexLayout::operator==(const VertexLayout& other) const {
+    return stride == other.stride && inputRate == other.inputRate && count == other.count
+        && std::equal(formats.begin(), formats.begin() + count, other.formats.begin())
+        && std::equal(offsets.begin(), offsets.begin() + count, other.offsets.begin());
+}
+
+uint64_t VertexLayout::hash(uint64_t seed) const {
+    uint64_t hash = hashValue(seed, stride);
+    hash = hashValue(hash, inputRate);
+    hash = hashValue(hash, count);
+    hash = hashBytes(hash, formats.data(), count * sizeof(VkFormat));
+    return hashBytes(hash, offsets.data(), count * sizeof(uint32_t));
+}
+
+bool PipelineState::operator==(const PipelineState& other) const {
+    return vertexShader == other.vertexShader && fragmentShader == other.fragmentShader &&
+           vertexSpecialization == other.vertexSpecialization && fragmentSpecialization == other.fragmentSpecialization &&
+           vertexLayout == other.vertexLayout && layout == other.layout && renderPass == other.renderPass && subpass == other.subpass &&
+           colorFormat == other.colorFormat && topology == other.topology && polygonMode == other.polygonMode &&
+           cullMode == other.cullMode && frontFace == other.frontFace && blendMode == other.blendMode &&
+           depthTest == other.depthTest && depthWrite == other.depthWrite && depthCompareOp == other.depthCompareOp;
+}
+
+uint64_t PipelineState::hash() const {
+    uint64_t hash = FNV_OFFSET_BASIS;
+    hash = hashValue(hash, vertexShader);
+    hash = hashValue(hash, fragmentShader);
+    hash = vertexSpecialization.hash(hash);
+    hash = fragmentSpecialization.hash(hash);
+    hash = vertexLayout.hash(hash);
+    hash = hashValue(hash, layout);
+    hash = hashValue(hash, renderPass);
+    hash = hashValue(hash, subpass);
+    hash = hashValue(hash, colorFormat);
+    hash = hashValue(hash, topology);
+    hash = hashValue(hash, polygonMode);
+    hash = hashValue(hash, cullMode);
+    hash = hashValue(hash, frontFace);
+    hash = hashValue(hash, blendMode);
+    hash = hashValue(hash, depthTest);
+    hash = hashValue(hash, depthWrite);
+    hash = hashValue(hash, depthCompareOp);
+    return hash;
+}
+
+void PipelineManager::init(VkDevice device, const DeviceDispatch* deviceTable, const VkAllocationCallbacks* allocator, bool useLibraries) {
+    this->device = device;
+    this->deviceTable = deviceTable;
+    this->allocator = allocator;
+    this->useLibraries = useLibraries;
+
+    VkPipelineCacheCreateInfo cacheInfo{};
+    cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+
+    if (deviceTable->vkCreatePipelineCache(device, &cacheInfo, allocator, &pipelineCache) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create pipeline cache!");
+    }
+
+    if (useLibraries) {
+        stopOptimizing = false;
+        optimizeThread = std::thread(&PipelineManager::optimizeLoop, this);
+    }
+}
+
+void PipelineManager::destroy() {
+    if (optimizeThread.joinable()) {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            stopOptimizing = true;
+        }
+        optimizeSignal.notify_one();
+        optimizeThread.join();
+    }
+
+    std::lock_guard<std::mutex> guard(lock);
+
+    for (auto& [state, variant] : variants) {
+        deviceTable->vkDestroyPipeline(device, variant.pipeline, allocator);
+    }
+    variants.clear();
+
+    for (VkPipeline pipeline : retiredPipelines) {
+        deviceTable->vkDestroyPipeline(device, pipeline, allocator);
+    }
+    retiredPipelines.clear();
+
+    // Linked pipelines don't reference their libraries anymore, so the order doesn't matter
+    for (auto& parts : libraries) {
+        for (auto& [state, library] : parts) {
+            deviceTable->vkDestroyPipeline(device, library, allocator);
+        }
+        parts.clear();
+    }
+
+    for (auto& [id, module] : shaderModules) {
+        deviceTable->vkDestroyShaderModule(device, module, allocator);
+    }
+    shaderModules.clear();
+
+    deviceTable->vkDestroyPipelineCache(device, pipelineCache, allocator);
+    pipelineCache = VK_NULL_HANDLE;
+}
+
+uint64_t PipelineManager::addShader(const EmbeddedShader& shader) {
+    uint64_t id = hashBytes(FNV_OFFSET_BASIS, shader.code, shader.codeSize);
+
+    std::lock_guard<std::mutex> guard(lock);
+    if (shaderModules.count(id) != 0) return id;
+
+    // The words are constant data in the executable, the module is created straight from them
+    VkShaderModuleCreateInfo createInfo{};
+    createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    createInfo.codeSize = shader.codeSize;
+    createInfo.pCode = shader.code;
+
+    VkShaderModule module;
+    if (deviceTable->vkCreateShaderModule(device, &createInfo, allocator, &module) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create shader module!");
+    }
+
+    shaderModules.emplace(id, module);
+    return id;
+}
+
+VkPipeline PipelineManager::getPipeline(const PipelineState& state) {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        auto it = variants.find(state);
+        if (it != variants.end()) {
+            counters.hits++;
+            return it->second.pipeline;
+        }
+    }
+
+    // Compiling can take milliseconds, don't block lookups of other variants meanwhile
+    auto start = std::chrono::steady_clock::now();
+    Libraries parts{};
+    VkPipeline pipeline;
+    if (useLibraries) {
+        for (int part = 0; part < LibraryPartCount; part++) {
+            parts[part] = getLibrary(state, static_cast<LibraryPart>(part));
+        }
+        pipeline = linkLibraries(parts, state.layout, false);
+    } else {
+        pipeline = createPipeline(state);
+    }
+    double creationMs = millisecondsSince(start);
+
+    std::lock_guard<std::mutex> guard(lock);
+    auto [it, inserted] = variants.emplace(state, Variant{pipeline, creationMs, parts, !useLibraries});
+    if (!inserted) {
+        // Another thread created the same variant in the meantime
+        deviceTable->vkDestroyPipeline(device, pipeline, allocator);
+        counters.hits++;
+        return it->second.pipeline;
+    }
+
+    counters.misses++;
+    counters.totalCreationMs += creationMs;
+    counters.maxCreationMs = std::max(counters.maxCreationMs, creationMs);
+
+    if (useLibraries) {
+        optimizeQueue.push_back(state);
+        optimizeSignal.notify_one();
+    }
+    return pipeline;
+}
+
+void PipelineManager::waitForBackgroundLinks() {
+    std::unique_lock<std::mutex> guard(lock);
+    optimizeDone.wait(guard, [this] { return optimizeQueue.empty() && !optimizing; });
+}
+
+PipelineCacheStats PipelineManager::stats() const {
+    std::lock_guard<std::mutex> guard(lock);
+    return counters;
+}
+
+void PipelineManager::printStats(std::ostream& os) const {
+    std::lock_guard<std::mutex> guard(lock);
+
+    os << "Pipeline variants: " << variants.size() << ", " << counters.hits << " hits, " << counters.misses << " misses"
+       << (useLibraries ? " (graphics pipeline library)\n" : "\n");
+    os << std::fixed << std::setprecision(3);
+    if (counters.misses > 0) {
+        os << "\tcreation ms: total " << counters.totalCreationMs << ", average " << counters.totalCreationMs / counters.misses
+           << ", max " << counters.maxCreationMs << '\n';
+    }
+    if (useLibraries) {
+        os << "\tlibrary parts: " << counters.libraryParts << ", optimized links: " << counters.optimizedLinks;
+        if (counters.optimizedLinks > 0) {
+            os << ", average " << counters.totalOptimizedLinkMs / counters.optimizedLinks << " ms";
+        }
+        os << '\n';
+    }
+    for (const auto& [state, variant] : variants) {
+        os << "\t" << std::hex << std::setw(16) << std::setfill('0') << state.hash() << std::dec << std::setfill(' ')
+           << "  " << variant.creationMs << " ms" << (variant.optimized ? "\n" : "  (fast link)\n");
+    }
+    os << std::defaultfloat;
+}
+
+VkPipeline PipelineManager::createPipeline(const PipelineState& state) const {
+    PipelineDescription description(state, shaderModule(state.vertexShader), shaderModule(state.fragmentShader));
+
+    VkPipeline pipeline;
+    if (deviceTable->vkCreateGraphicsPipelines(device, pipelineCache, 1, &description.pipelineInfo, allocator, &pipeline) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create graphics pipeline!");
+    }
+
+    return pipeline;
+}
+
+VkShaderModule PipelineManager::shaderModule(uint64_t id) const {
+    std::lock_guard<std::mutex> guard(lock);
+
+    auto it = shaderModules.find(id);
+    if (it == shaderModules.end()) {
+        throw std::runtime_error("unknown shader in pipeline state!");
+    }
+    return it->second;
+}
+
+// Graphics pipeline library path
+
+PipelineState PipelineManager::libraryKey(const PipelineState& state, LibraryPart part) {
+    // Only keep what the part is compiled from, so variants which differ elsewhere share the library
+    PipelineState key;
+    switch (part) {
+        case VertexInputPart:
+            key.vertexLayout = state.vertexLayout;
+            key.topology = state.topology;
+            break;
+        case PreRasterizationPart:
+            key.vertexShader = state.vertexShader;
+            key.vertexSpecialization = state.vertexSpecialization;
+            key.layout = state.layout;
+            key.renderPass = state.renderPass;
+            key.subpass = state.subpass;
+            key.polygonMode = state.polygonMode;
+            key.cullMode = state.cullMode;
+            key.frontFace = state.frontFace;
+            break;
+        case FragmentShaderPart:
+            key.fragmentShader = state.fragmentShader;
+            key.fragmentSpecialization = state.fragmentSpecialization;
+            key.layout = state.layout;
+            key.renderPass = state.renderPass;
+            key.subpass = state.subpass;
+            key.depthTest = state.depthTest;
+            key.depthWrite = state.depthWrite;
+            key.depthCompareOp = state.depthCompareOp;
+            break;
+        case FragmentOutputPart:
+            key.renderPass = state.renderPass;
+            key.subpass = state.subpass;
+            key.colorFormat = state.colorFormat;
+            key.blendMode = state.blendMode;
+            break;
+        default:
+            break;
+    }
+    return key;
+}
+
+VkPipeline PipelineManager::getLibrary(const PipelineState& state, LibraryPart part) {
+    PipelineState key = libraryKey(state, part);
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        auto it = libraries[part].find(key);
+        if (it != libraries[part].end()) return it->second;
+    }
+
+    VkPipeline library = createLibrary(key, part);
+
+    std::lock_guard<std::mutex> guard(lock);
+    auto [it, inserted] = libraries[part].emplace(key, library);
+    if (!inserted) {
+        deviceTable->vkDestroyPipeline(device, library, allocator);
+        return it->second;
+    }
+
+    counters.libraryParts++;
+    return library;
+}
+
+VkPipeline PipelineManager::createLibrary(const PipelineState& state, LibraryPart part) const {
+    VkShaderModule vertShaderModule = part == PreRasterizationPart ? shaderModule(state.vertexShader) : VK_NULL_HANDLE;
+    VkShaderModule fragShaderModule = part == FragmentShaderPart ? shaderModule(state.fragmentShader) : VK_NULL_HANDLE;
+    PipelineDescription description(state, vertShaderModule, fragShaderModule);
+
+    VkGraphicsPipelineLibraryCreateInfoEXT libraryInfo{};
+    libraryInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_LIBRARY_CREATE_INFO_EXT;
+
+    // Keep only the state which belongs to the part, the rest would be ignored anyway
+    VkGraphicsPipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    pipelineInfo.pNext = &libraryInfo;
+    // Retaining the link time optimization info allows the optimized link later on
+    pipelineInfo.flags = VK_PIPELINE_CREATE_LIBRARY_BIT_KHR | VK_PIPELINE_CREATE_RETAIN_LINK_TIME_OPTIMIZATION_INFO_BIT_EXT;
+    pipelineInfo.basePipelineIndex = -1;
+
+    switch (part) {
+        case VertexInputPart:
+            libraryInfo.flags = VK_GRAPHICS_PIPELINE_LIBRARY_VERTEX_INPUT_INTERFACE_BIT_EXT;
+            pipelineInfo.pVertexInputState = &description.vertexInputInfo;
+            pipelineInfo.pInputAssemblyState = &description.inputAssembly;
+            break;
+        case PreRasterizationPart:
+            libraryInfo.flags = VK_GRAPHICS_PIPELINE_LIBRARY_PRE_RASTERIZATION_SHADERS_BIT_EXT;
+            pipelineInfo.stageCount = 1;
+            pipelineInfo.pStages = &description.shaderStages[0];
+            pipelineInfo.pViewportState = &description.viewportState;
+            pipelineInfo.pRasterizationState = &description.rasterizer;
+            pipelineInfo.pDynamicState = &description.dynamicState;
+            pipelineInfo.layout = state.layout;
+            pipelineInfo.renderPass = state.renderPass;
+            pipelineInfo.subpass = state.subpass;
+            break;
+        case FragmentShaderPart:
+            libraryInfo.flags = VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_SHADER_BIT_EXT;
+            pipelineInfo.stageCount = 1;
+            pipelineInfo.pStages = &description.shaderStages[1];
+            pipelineInfo.pMultisampleState = &description.multisampling;
+            pipelineInfo.pDepthStencilState = &description.depthStencil;
+            pipelineInfo.layout = state.layout;
+            pipelineInfo.renderPass = state.renderPass;
+            pipelineInfo.subpass = state.subpass;
+            break;
+        case FragmentOutputPart:
+            libraryInfo.flags = VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_OUTPUT_INTERFACE_BIT_EXT;
+            pipelineInfo.pMultisampleState = &description.multisampling;
+            pipelineInfo.pColorBlendState = &description.colorBlending;
+            pipelineInfo.renderPass = state.renderPass;
+            pipelineInfo.subpass = state.subpass;
+            break;
+        default:
+            break;
+    }
+
+    VkPipeline library;
+    if (deviceTable->vkCreateGraphicsPipelines(device, pipelineCache, 1, &pipelineInfo, allocator, &library) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create graphics pipeline library!");
+    }
+
+    return library;
+}
+
+VkPipeline PipelineManager::linkLibraries(const Libraries& parts, VkPipelineLayout layout, bool optimize) const {
+    VkPipelineLibraryCreateInfoKHR linkInfo{};
+    linkInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LIBRARY_CREATE_INFO_KHR;
+    linkInfo.libraryCount = LibraryPartCount;
+    linkInfo.pLibraries = parts.data();
+
+    VkGraphicsPipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    pipelineInfo.pNext = &linkInfo;
+    pipelineInfo.flags = optimize ? VK_PIPELINE_CREATE_LINK_TIME_OPTIMIZATION_BIT_EXT : 0;
+    pipelineInfo.layout = layout;
+    pipelineInfo.basePipelineIndex = -1;
+
+    VkPipeline pipeline;
+    if (deviceTable->vkCreateGraphicsPipelines(device, pipelineCache, 1, &pipelineInfo, allocator, &pipeline) != VK_SUCCESS) {
+        throw std::runtime_error("failed to link graphics pipeline libraries!");
+    }
+
+    return pipeline;
+}
+
+void PipelineManager::optimizeLoop() {
+    std::unique_lock<std::mutex> guard(lock);
+
+    for (;;) {
+        optimizeSignal.wait(guard, [this] { return stopOptimizing || !optimizeQueue.empty(); });
+        if (stopOptimizing) return;
+
+        PipelineState state = optimizeQueue.front();
+        optimizeQueue.pop_front();
+        Libraries parts = variants.at(state).libraries;
+        optimizing = true;
+        guard.unlock();
+
+        auto start = std::chrono::steady_clock::now();
+        VkPipeline optimized = VK_NULL_HANDLE;
+        try {
+            optimized = linkLibraries(parts, state.layout, true);
+        } catch (const std::exception& e) {
+            // The fast link stays in use, it is only slower on the GPU
+            std::cerr << e.what() << std::endl;
+        }
+        double linkMs = millisecondsSince(start);
+
+        guard.lock();
+        if (optimized != VK_NULL_HANDLE) {
+            Variant& variant = variants.at(state);
+            retiredPipelines.push_back(variant.pipeline);
+            variant.pipeline = optimized;
+            variant.optimized = true;
+
+            counters.optimizedLinks++;
+            counters.totalOptimizedLinkMs += linkMs;
+        }
+        optimizing = false;
+        optimizeDone.notify_all();
+    }
+}
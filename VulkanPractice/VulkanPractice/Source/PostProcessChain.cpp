@@ -0,0 +1,669 @@
+//
+//  PostProcessChain.cpp
+//  VulkanPractice
+//
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iomanip>
+#include <stdexcept>
+
+#include "EmbeddedShaders.h"
+#include "PostProcessChain.h"
+#include "VulkanMemory.h"
+
+namespace {
+
+const uint32_t histogramBins = 256;
+
+// Match the push constant blocks of the post_*.comp shaders
+struct HistogramParams {
+    int32_t extent[2];
+    int32_t stride;
+    float minLogLuminance;
+    float inverseLogLuminanceRange;
+};
+
+struct ExposureParams {
+    float minLogLuminance;
+    float logLuminanceRange;
+    float adaptation;
+};
+
+struct DownsampleParams {
+    float sourceUvExtent[2];
+    int32_t destinationExtent[2];
+    float threshold;
+};
+
+struct UpsampleParams {
+    float sourceUvExtent[2];
+    int32_t destinationExtent[2];
+};
+
+struct ToneMapParams {
+    int32_t extent[2];
+    float bloomUvExtent[2];
+    float bloomStrength;
+    float keyValue;
+};
+
+static_assert(shaders::postHistogramComp.pushConstantSize == sizeof(HistogramParams), "post_histogram.comp doesn't match HistogramParams");
+static_assert(shaders::postExposureComp.pushConstantSize == sizeof(ExposureParams), "post_exposure.comp doesn't match ExposureParams");
+static_assert(shaders::postBloomDownsampleComp.pushConstantSize == sizeof(DownsampleParams), "post_bloom_downsample.comp doesn't match DownsampleParams");
+static_assert(shaders::postBloomUpsampleComp.pushConstantSize == sizeof(UpsampleParams), "post_bloom_upsample.comp doesn't match UpsampleParams");
+static_assert(shaders::postTonemapComp.pushConstantSize == sizeof(ToneMapParams), "post_tonemap.comp doesn't match ToneMapParams");
+static_assert(shaders::postHistogramComp.hasBuffer(0, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, histogramBins * sizeof(uint32_t)),
+              "post_histogram.comp doesn't have histogramBins bins");
+static_assert(shaders::postExposureComp.localSize[0] == histogramBins, "post_exposure.comp needs an invocation per bin");
+
+uint32_t groupCount(uint32_t size, uint32_t localSize) {
+    return (size + localSize - 1) / localSize;
+}
+
+const char* stageNames[] = {"histogram", "exposure", "bloom downsample", "bloom upsample", "tone map"};
+
+}
+
+bool PostProcessChain::isSupported(VkPhysicalDevice physicalDevice, const InstanceDispatch& instanceTable) {
+    // Only filled in by Vulkan 1.1 devices, the rest leave it zeroed
+    VkPhysicalDeviceSubgroupProperties subgroupProperties{};
+    subgroupProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SUBGROUP_PROPERTIES;
+    VkPhysicalDeviceProperties2 properties{};
+    properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    properties.pNext = &subgroupProperties;
+    instanceTable.vkGetPhysicalDeviceProperties2KHR(physicalDevice, &properties);
+
+    const VkSubgroupFeatureFlags operations = VK_SUBGROUP_FEATURE_BASIC_BIT | VK_SUBGROUP_FEATURE_ARITHMETIC_BIT;
+    if (properties.properties.apiVersion < VK_API_VERSION_1_1 ||
+        (subgroupProperties.supportedStages & VK_SHADER_STAGE_COMPUTE_BIT) == 0 ||
+        (subgroupProperties.supportedOperations & operations) != operations) {
+        return false;
+    }
+
+    VkFormatProperties formatProperties;
+    instanceTable.vkGetPhysicalDeviceFormatProperties(physicalDevice, sceneFormat, &formatProperties);
+    const VkFormatFeatureFlags features = VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BIT | VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT |
+                                          VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT | VK_FORMAT_FEATURE_BLIT_SRC_BIT;
+    return (formatProperties.optimalTilingFeatures & features) == features;
+}
+
+void PostProcessChain::init(VkPhysicalDevice physicalDevice, const InstanceDispatch& instanceTable, VkDevice device, const DeviceDispatch* deviceTable,
+                            const VkAllocationCallbacks* allocator, uint32_t timestampValidBits, float timestampPeriod, uint32_t frameSlots,
+                            const PostProcessSettings& settings) {
+    if (settings.bloomLevels == 0 || settings.minLogLuminance >= settings.maxLogLuminance) {
+        throw std::runtime_error("invalid post processing settings!");
+    }
+
+    this->device = device;
+    this->deviceTable = deviceTable;
+    this->allocator = allocator;
+    this->settings = settings;
+    this->timestampValidBits = timestampValidBits;
+    this->timestampPeriod = timestampPeriod;
+
+    instanceTable.vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+
+    histogramPass = createPass(shaders::postHistogramComp);
+    exposurePass = createPass(shaders::postExposureComp);
+    downsamplePass = createPass(shaders::postBloomDownsampleComp);
+    upsamplePass = createPass(shaders::postBloomUpsampleComp);
+    toneMapPass = createPass(shaders::postTonemapComp);
+
+    // Every read goes through the sampler, clamped so the edges don't wrap around
+    VkSamplerCreateInfo samplerInfo{};
+    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.magFilter = VK_FILTER_LINEAR;
+    samplerInfo.minFilter = VK_FILTER_LINEAR;
+    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.maxLod = 0.0f;
+
+    if (deviceTable->vkCreateSampler(device, &samplerInfo, allocator, &sampler) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create post processing sampler!");
+    }
+
+    const VkBufferUsageFlags bufferUsage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    createBuffer(device, *deviceTable, allocator, memoryProperties, histogramBins * sizeof(uint32_t), bufferUsage,
+                 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, histogramBuffer, histogramMemory);
+    createBuffer(device, *deviceTable, allocator, memoryProperties, sizeof(float), bufferUsage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                 exposureBuffer, exposureMemory);
+    buffersCleared = false;
+
+    if (timestampValidBits > 0) {
+        VkQueryPoolCreateInfo queryPoolInfo{};
+        queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+        queryPoolInfo.queryCount = frameSlots * (stageCount + 1);
+
+        if (deviceTable->vkCreateQueryPool(device, &queryPoolInfo, allocator, &timestampPool) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create post processing query pool!");
+        }
+    }
+    pendingSlots.assign(frameSlots, false);
+    recorded = false;
+    resetStats();
+}
+
+void PostProcessChain::destroy() {
+    if (device == VK_NULL_HANDLE) return;
+
+    destroyTargets();
+
+    if (timestampPool != VK_NULL_HANDLE) {
+        deviceTable->vkDestroyQueryPool(device, timestampPool, allocator);
+        timestampPool = VK_NULL_HANDLE;
+    }
+
+    deviceTable->vkDestroyBuffer(device, histogramBuffer, allocator);
+    deviceTable->vkFreeMemory(device, histogramMemory, allocator);
+    deviceTable->vkDestroyBuffer(device, exposureBuffer, allocator);
+    deviceTable->vkFreeMemory(device, exposureMemory, allocator);
+    deviceTable->vkDestroySampler(device, sampler, allocator);
+
+    for (Pass* pass : {&histogramPass, &exposurePass, &downsamplePass, &upsamplePass, &toneMapPass}) {
+        destroyPass(*pass);
+    }
+    device = VK_NULL_HANDLE;
+}
+
+void PostProcessChain::resize(VkImage sceneImage, VkImageView sceneView, VkExtent2D sceneExtent) {
+    destroyTargets();
+    this->sceneImage = sceneImage;
+    this->sceneView = sceneView;
+    this->sceneExtent = sceneExtent;
+
+    // Levels stop before they'd get smaller than 2 pixels
+    const VkExtent2D base = levelExtent(sceneExtent, 0);
+    bloomLevels = 1;
+    while (bloomLevels < settings.bloomLevels && (std::min(base.width, base.height) >> bloomLevels) >= 2) {
+        bloomLevels++;
+    }
+
+    VkImageCreateInfo imageInfo{};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.format = sceneFormat;
+    imageInfo.extent = {base.width, base.height, 1};
+    imageInfo.mipLevels = bloomLevels;
+    imageInfo.arrayLayers = 1;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+    if (deviceTable->vkCreateImage(device, &imageInfo, allocator, &bloomImage) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create bloom image!");
+    }
+
+    VkMemoryRequirements memoryRequirements;
+    deviceTable->vkGetImageMemoryRequirements(device, bloomImage, &memoryRequirements);
+
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = memoryRequirements.size;
+    allocInfo.memoryTypeIndex = findMemoryType(memoryProperties, memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+    if (deviceTable->vkAllocateMemory(device, &allocInfo, allocator, &bloomMemory) != VK_SUCCESS) {
+        throw std::runtime_error("failed to allocate bloom image memory!");
+    }
+    deviceTable->vkBindImageMemory(device, bloomImage, bloomMemory, 0);
+
+    bloomViews.resize(bloomLevels);
+    for (uint32_t level = 0; level < bloomLevels; level++) {
+        VkImageViewCreateInfo viewInfo{};
+        viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        viewInfo.image = bloomImage;
+        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        viewInfo.format = sceneFormat;
+        viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        viewInfo.subresourceRange.baseMipLevel = level;
+        viewInfo.subresourceRange.levelCount = 1;
+        viewInfo.subresourceRange.layerCount = 1;
+
+        if (deviceTable->vkCreateImageView(device, &viewInfo, allocator, &bloomViews[level]) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create bloom image view!");
+        }
+    }
+
+    // Histogram and exposure, a downsample per level, an upsample per level but the last, tone mapping
+    const uint32_t bloomSets = 2 * bloomLevels - 1;
+    std::array<VkDescriptorPoolSize, 3> poolSizes{};
+    poolSizes[0].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    poolSizes[0].descriptorCount = bloomSets + 2;
+    poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    poolSizes[1].descriptorCount = bloomSets + 1;
+    poolSizes[2].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    poolSizes[2].descriptorCount = 4;
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.maxSets = bloomSets + 3;
+    poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+    poolInfo.pPoolSizes = poolSizes.data();
+
+    if (deviceTable->vkCreateDescriptorPool(device, &poolInfo, allocator, &descriptorPool) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create post processing descriptor pool!");
+    }
+
+    std::vector<VkDescriptorSetLayout> layouts = {histogramPass.setLayout, exposurePass.setLayout, toneMapPass.setLayout};
+    layouts.insert(layouts.end(), bloomLevels, downsamplePass.setLayout);
+    layouts.insert(layouts.end(), bloomLevels - 1, upsamplePass.setLayout);
+
+    VkDescriptorSetAllocateInfo setInfo{};
+    setInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    setInfo.descriptorPool = descriptorPool;
+    setInfo.descriptorSetCount = static_cast<uint32_t>(layouts.size());
+    setInfo.pSetLayouts = layouts.data();
+
+    std::vector<VkDescriptorSet> sets(layouts.size());
+    if (deviceTable->vkAllocateDescriptorSets(device, &setInfo, sets.data()) != VK_SUCCESS) {
+        throw std::runtime_error("failed to allocate post processing descriptor sets!");
+    }
+    histogramSet = sets[0];
+    exposureSet = sets[1];
+    toneMapSet = sets[2];
+    downsampleSets.assign(sets.begin() + 3, sets.begin() + 3 + bloomLevels);
+    upsampleSets.assign(sets.begin() + 3 + bloomLevels, sets.end());
+
+    writeDescriptors();
+    bloomInitialized = false;
+}
+
+void PostProcessChain::setHalfResolution(bool halfResolution) {
+    settings.halfResolution = halfResolution;
+    if (sceneImage != VK_NULL_HANDLE) {
+        resize(sceneImage, sceneView, sceneExtent);
+    }
+}
+
+void PostProcessChain::record(VkCommandBuffer commandBuffer, uint32_t frameSlot, VkExtent2D renderExtent) {
+    // The first frame takes the measured luminance as it is
+    const Clock::time_point now = Clock::now();
+    const float seconds = std::chrono::duration<float>(now - lastRecord).count();
+    const float adaptation = recorded ? 1.0f - std::exp(-seconds * settings.adaptationRate) : 1.0f;
+    lastRecord = now;
+    recorded = true;
+
+    if (timestampPool != VK_NULL_HANDLE) {
+        // Results that weren't collected in time are overwritten now
+        if (pendingSlots[frameSlot]) {
+            droppedFrames++;
+        }
+        pendingSlots[frameSlot] = true;
+        deviceTable->vkCmdResetQueryPool(commandBuffer, timestampPool, frameSlot * (stageCount + 1), stageCount + 1);
+    }
+    timestamp(commandBuffer, frameSlot, 0, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT);
+
+    // Starts at 0 bins and a luminance the key value exposes to 1
+    if (!buffersCleared) {
+        float luminance = settings.keyValue;
+        uint32_t luminanceBits;
+        std::memcpy(&luminanceBits, &luminance, sizeof(luminanceBits));
+        deviceTable->vkCmdFillBuffer(commandBuffer, histogramBuffer, 0, VK_WHOLE_SIZE, 0);
+        deviceTable->vkCmdFillBuffer(commandBuffer, exposureBuffer, 0, VK_WHOLE_SIZE, luminanceBits);
+        buffersCleared = true;
+    }
+
+    // The previous frame's chain is done with the buffers and the bloom levels before this one writes them
+    VkMemoryBarrier previousFrame{};
+    previousFrame.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    previousFrame.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+    previousFrame.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+    VkImageMemoryBarrier bloomToGeneral{};
+    bloomToGeneral.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    bloomToGeneral.srcAccessMask = 0;
+    bloomToGeneral.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    bloomToGeneral.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    bloomToGeneral.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+    bloomToGeneral.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    bloomToGeneral.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    bloomToGeneral.image = bloomImage;
+    bloomToGeneral.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, bloomLevels, 0, 1};
+
+    deviceTable->vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                      VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &previousFrame, 0, nullptr,
+                                      bloomInitialized ? 0 : 1, &bloomToGeneral);
+    bloomInitialized = true;
+
+    // Luminance histogram
+    const uint32_t stride = settings.halfResolution ? 2 : 1;
+    HistogramParams histogram{};
+    histogram.extent[0] = static_cast<int32_t>(renderExtent.width);
+    histogram.extent[1] = static_cast<int32_t>(renderExtent.height);
+    histogram.stride = static_cast<int32_t>(stride);
+    histogram.minLogLuminance = settings.minLogLuminance;
+    histogram.inverseLogLuminanceRange = 1.0f / (settings.maxLogLuminance - settings.minLogLuminance);
+
+    deviceTable->vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, histogramPass.pipeline);
+    deviceTable->vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, histogramPass.layout, 0, 1, &histogramSet, 0, nullptr);
+    deviceTable->vkCmdPushConstants(commandBuffer, histogramPass.layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(histogram), &histogram);
+    deviceTable->vkCmdDispatch(commandBuffer,
+                               groupCount(groupCount(renderExtent.width, stride), shaders::postHistogramComp.localSize[0]),
+                               groupCount(groupCount(renderExtent.height, stride), shaders::postHistogramComp.localSize[1]), 1);
+    timestamp(commandBuffer, frameSlot, 1, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    computeBarrier(commandBuffer);
+
+    // Exposure, a single workgroup with an invocation per bin
+    ExposureParams exposure{};
+    exposure.minLogLuminance = settings.minLogLuminance;
+    exposure.logLuminanceRange = settings.maxLogLuminance - settings.minLogLuminance;
+    exposure.adaptation = adaptation;
+
+    deviceTable->vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, exposurePass.pipeline);
+    deviceTable->vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, exposurePass.layout, 0, 1, &exposureSet, 0, nullptr);
+    deviceTable->vkCmdPushConstants(commandBuffer, exposurePass.layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(exposure), &exposure);
+    deviceTable->vkCmdDispatch(commandBuffer, 1, 1, 1);
+    timestamp(commandBuffer, frameSlot, 2, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+
+    // Bloom downsample, the first step only reads the scene and needs no barrier after the exposure
+    deviceTable->vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, downsamplePass.pipeline);
+    for (uint32_t level = 0; level < bloomLevels; level++) {
+        const VkExtent2D sourceSize = level == 0 ? sceneExtent : levelExtent(sceneExtent, level - 1);
+        const VkExtent2D sourceRendered = level == 0 ? renderExtent : levelExtent(renderExtent, level - 1);
+        const VkExtent2D destination = levelExtent(renderExtent, level);
+
+        DownsampleParams downsample{};
+        downsample.sourceUvExtent[0] = static_cast<float>(sourceRendered.width) / sourceSize.width;
+        downsample.sourceUvExtent[1] = static_cast<float>(sourceRendered.height) / sourceSize.height;
+        downsample.destinationExtent[0] = static_cast<int32_t>(destination.width);
+        downsample.destinationExtent[1] = static_cast<int32_t>(destination.height);
+        downsample.threshold = level == 0 ? settings.bloomThreshold : 0.0f;
+
+        deviceTable->vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, downsamplePass.layout, 0, 1,
+                                             &downsampleSets[level], 0, nullptr);
+        deviceTable->vkCmdPushConstants(commandBuffer, downsamplePass.layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(downsample), &downsample);
+        deviceTable->vkCmdDispatch(commandBuffer, groupCount(destination.width, shaders::postBloomDownsampleComp.localSize[0]),
+                                   groupCount(destination.height, shaders::postBloomDownsampleComp.localSize[1]), 1);
+        computeBarrier(commandBuffer);
+    }
+    timestamp(commandBuffer, frameSlot, 3, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+
+    // Bloom upsample, from the smallest level back up to the first
+    deviceTable->vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, upsamplePass.pipeline);
+    for (uint32_t level = bloomLevels - 1; level-- > 0;) {
+        const VkExtent2D sourceSize = levelExtent(sceneExtent, level + 1);
+        const VkExtent2D sourceRendered = levelExtent(renderExtent, level + 1);
+        const VkExtent2D destination = levelExtent(renderExtent, level);
+
+        UpsampleParams upsample{};
+        upsample.sourceUvExtent[0] = static_cast<float>(sourceRendered.width) / sourceSize.width;
+        upsample.sourceUvExtent[1] = static_cast<float>(sourceRendered.height) / sourceSize.height;
+        upsample.destinationExtent[0] = static_cast<int32_t>(destination.width);
+        upsample.destinationExtent[1] = static_cast<int32_t>(destination.height);
+
+        deviceTable->vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, upsamplePass.layout, 0, 1,
+                                             &upsampleSets[level], 0, nullptr);
+        deviceTable->vkCmdPushConstants(commandBuffer, upsamplePass.layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(upsample), &upsample);
+        deviceTable->vkCmdDispatch(commandBuffer, groupCount(destination.width, shaders::postBloomUpsampleComp.localSize[0]),
+                                   groupCount(destination.height, shaders::postBloomUpsampleComp.localSize[1]), 1);
+        computeBarrier(commandBuffer);
+    }
+    timestamp(commandBuffer, frameSlot, 4, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+
+    // Tone mapping, the last barrier above covers the exposure as well
+    const VkExtent2D bloomSize = levelExtent(sceneExtent, 0);
+    const VkExtent2D bloomRendered = levelExtent(renderExtent, 0);
+    ToneMapParams toneMap{};
+    toneMap.extent[0] = static_cast<int32_t>(renderExtent.width);
+    toneMap.extent[1] = static_cast<int32_t>(renderExtent.height);
+    toneMap.bloomUvExtent[0] = static_cast<float>(bloomRendered.width) / bloomSize.width;
+    toneMap.bloomUvExtent[1] = static_cast<float>(bloomRendered.height) / bloomSize.height;
+    toneMap.bloomStrength = settings.bloomStrength;
+    toneMap.keyValue = settings.keyValue;
+
+    deviceTable->vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, toneMapPass.pipeline);
+    deviceTable->vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, toneMapPass.layout, 0, 1, &toneMapSet, 0, nullptr);
+    deviceTable->vkCmdPushConstants(commandBuffer, toneMapPass.layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(toneMap), &toneMap);
+    deviceTable->vkCmdDispatch(commandBuffer, groupCount(renderExtent.width, shaders::postTonemapComp.localSize[0]),
+                               groupCount(renderExtent.height, shaders::postTonemapComp.localSize[1]), 1);
+    timestamp(commandBuffer, frameSlot, 5, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+
+    // Ready for the upscale blit
+    VkImageMemoryBarrier sceneToTransfer{};
+    sceneToTransfer.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    sceneToTransfer.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    sceneToTransfer.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    sceneToTransfer.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+    sceneToTransfer.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    sceneToTransfer.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    sceneToTransfer.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    sceneToTransfer.image = sceneImage;
+    sceneToTransfer.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+
+    deviceTable->vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+                                      0, nullptr, 0, nullptr, 1, &sceneToTransfer);
+}
+
+bool PostProcessChain::collect(uint32_t frameSlot) {
+    if (timestampPool == VK_NULL_HANDLE || frameSlot >= pendingSlots.size() || !pendingSlots[frameSlot]) return false;
+
+    // Every timestamp is followed by its availability, without VK_QUERY_RESULT_WAIT_BIT the call returns right away
+    uint64_t results[(stageCount + 1) * 2];
+    deviceTable->vkGetQueryPoolResults(device, timestampPool, frameSlot * (stageCount + 1), stageCount + 1, sizeof(results), results,
+                                       2 * sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+    for (uint32_t query = 0; query <= stageCount; query++) {
+        if (results[query * 2 + 1] == 0) return false;
+    }
+
+    // Only the low timestampValidBits bits count, the differences are taken modulo that range
+    const uint64_t mask = timestampValidBits >= 64 ? ~0ull : (1ull << timestampValidBits) - 1;
+    std::array<double, stageCount> sample;
+    for (uint32_t stage = 0; stage < stageCount; stage++) {
+        sample[stage] = ((results[(stage + 1) * 2] - results[stage * 2]) & mask) * timestampPeriod * 1e-6;
+    }
+
+    pendingSlots[frameSlot] = false;
+    samplesMs.push_back(sample);
+    return true;
+}
+
+double PostProcessChain::latestMs() const {
+    if (samplesMs.empty()) return 0.0;
+
+    double total = 0.0;
+    for (double stageMs : samplesMs.back()) {
+        total += stageMs;
+    }
+    return total;
+}
+
+void PostProcessChain::resetStats() {
+    samplesMs.clear();
+    droppedFrames = 0;
+}
+
+void PostProcessChain::printReport(std::ostream& os, const std::string& label) const {
+    if (samplesMs.empty()) return;
+
+    auto median = [](std::vector<double> values) {
+        std::sort(values.begin(), values.end());
+        return values[values.size() / 2];
+    };
+
+    os << "Post processing (" << label << ", " << (settings.halfResolution ? "half" : "full") << " resolution intermediates, "
+       << bloomLevels << " bloom levels, median of " << samplesMs.size() << " frames, " << droppedFrames << " not ready in time):\n";
+    os << std::fixed << std::setprecision(3);
+
+    std::vector<double> totals(samplesMs.size(), 0.0);
+    for (uint32_t stage = 0; stage < stageCount; stage++) {
+        std::vector<double> values;
+        values.reserve(samplesMs.size());
+        for (size_t frame = 0; frame < samplesMs.size(); frame++) {
+            values.push_back(samplesMs[frame][stage]);
+            totals[frame] += samplesMs[frame][stage];
+        }
+        os << '\t' << std::left << std::setw(18) << stageNames[stage] << std::right << std::setw(10) << median(values) << " ms\n";
+    }
+    os << '\t' << std::left << std::setw(18) << "total" << std::right << std::setw(10) << median(totals) << " ms\n";
+    os << std::defaultfloat;
+}
+
+PostProcessChain::Pass PostProcessChain::createPass(const EmbeddedShader& shader) const {
+    Pass pass;
+
+    // The layouts come straight from the reflection of the shader
+    std::vector<VkDescriptorSetLayoutBinding> bindings = descriptorSetLayoutBindings(0, {&shader});
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+    layoutInfo.pBindings = bindings.data();
+
+    if (deviceTable->vkCreateDescriptorSetLayout(device, &layoutInfo, allocator, &pass.setLayout) != VK_SUCCESS) {
+        throw std::runtime_error(std::string("failed to create descriptor set layout for ") + shader.sourceName + "!");
+    }
+
+    VkPushConstantRange range = pushConstantRange({&shader});
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &pass.setLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = range.size > 0 ? 1 : 0;
+    pipelineLayoutInfo.pPushConstantRanges = &range;
+
+    if (deviceTable->vkCreatePipelineLayout(device, &pipelineLayoutInfo, allocator, &pass.layout) != VK_SUCCESS) {
+        throw std::runtime_error(std::string("failed to create pipeline layout for ") + shader.sourceName + "!");
+    }
+
+    VkShaderModuleCreateInfo moduleInfo{};
+    moduleInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    moduleInfo.codeSize = shader.codeSize;
+    moduleInfo.pCode = shader.code;
+
+    VkShaderModule module;
+    if (deviceTable->vkCreateShaderModule(device, &moduleInfo, allocator, &module) != VK_SUCCESS) {
+        throw std::runtime_error(std::string("failed to create shader module for ") + shader.sourceName + "!");
+    }
+
+    VkComputePipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipelineInfo.stage.module = module;
+    pipelineInfo.stage.pName = "main";
+    pipelineInfo.layout = pass.layout;
+
+    VkResult result = deviceTable->vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, allocator, &pass.pipeline);
+    deviceTable->vkDestroyShaderModule(device, module, allocator);
+    if (result != VK_SUCCESS) {
+        throw std::runtime_error(std::string("failed to create compute pipeline for ") + shader.sourceName + "!");
+    }
+    return pass;
+}
+
+void PostProcessChain::destroyPass(Pass& pass) const {
+    deviceTable->vkDestroyPipeline(device, pass.pipeline, allocator);
+    deviceTable->vkDestroyPipelineLayout(device, pass.layout, allocator);
+    deviceTable->vkDestroyDescriptorSetLayout(device, pass.setLayout, allocator);
+    pass = Pass{};
+}
+
+void PostProcessChain::destroyTargets() {
+    if (descriptorPool != VK_NULL_HANDLE) {
+        deviceTable->vkDestroyDescriptorPool(device, descriptorPool, allocator);
+        descriptorPool = VK_NULL_HANDLE;
+    }
+    downsampleSets.clear();
+    upsampleSets.clear();
+
+    for (VkImageView view : bloomViews) {
+        deviceTable->vkDestroyImageView(device, view, allocator);
+    }
+    bloomViews.clear();
+
+    if (bloomImage != VK_NULL_HANDLE) {
+        deviceTable->vkDestroyImage(device, bloomImage, allocator);
+        deviceTable->vkFreeMemory(device, bloomMemory, allocator);
+        bloomImage = VK_NULL_HANDLE;
+        bloomMemory = VK_NULL_HANDLE;
+    }
+}
+
+void PostProcessChain::writeDescriptors() {
+    // Reserved up front, the writes point into these
+    std::vector<VkDescriptorImageInfo> imageInfos;
+    imageInfos.reserve(2 * (2 * bloomLevels + 1));
+    std::vector<VkDescriptorBufferInfo> bufferInfos;
+    bufferInfos.reserve(4);
+    std::vector<VkWriteDescriptorSet> writes;
+
+    auto writeImage = [&](VkDescriptorSet set, uint32_t binding, VkDescriptorType type, VkImageView view) {
+        VkDescriptorImageInfo imageInfo{};
+        imageInfo.sampler = type == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER ? sampler : VK_NULL_HANDLE;
+        imageInfo.imageView = view;
+        imageInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+        imageInfos.push_back(imageInfo);
+
+        VkWriteDescriptorSet write{};
+        write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        write.dstSet = set;
+        write.dstBinding = binding;
+        write.descriptorCount = 1;
+        write.descriptorType = type;
+        write.pImageInfo = &imageInfos.back();
+        writes.push_back(write);
+    };
+    auto writeBuffer = [&](VkDescriptorSet set, uint32_t binding, VkBuffer buffer) {
+        bufferInfos.push_back({buffer, 0, VK_WHOLE_SIZE});
+
+        VkWriteDescriptorSet write{};
+        write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        write.dstSet = set;
+        write.dstBinding = binding;
+        write.descriptorCount = 1;
+        write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        write.pBufferInfo = &bufferInfos.back();
+        writes.push_back(write);
+    };
+
+    writeImage(histogramSet, 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, sceneView);
+    writeBuffer(histogramSet, 1, histogramBuffer);
+
+    writeBuffer(exposureSet, 0, histogramBuffer);
+    writeBuffer(exposureSet, 1, exposureBuffer);
+
+    for (uint32_t level = 0; level < bloomLevels; level++) {
+        writeImage(downsampleSets[level], 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, level == 0 ? sceneView : bloomViews[level - 1]);
+        writeImage(downsampleSets[level], 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, bloomViews[level]);
+    }
+    for (uint32_t level = 0; level + 1 < bloomLevels; level++) {
+        writeImage(upsampleSets[level], 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, bloomViews[level + 1]);
+        writeImage(upsampleSets[level], 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, bloomViews[level]);
+    }
+
+    writeImage(toneMapSet, 0, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, sceneView);
+    writeImage(toneMapSet, 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, bloomViews[0]);
+    writeBuffer(toneMapSet, 2, exposureBuffer);
+
+    deviceTable->vkUpdateDescriptorSets(device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+}
+
+void PostProcessChain::timestamp(VkCommandBuffer commandBuffer, uint32_t frameSlot, uint32_t query, VkPipelineStageFlagBits stage) const {
+    if (timestampPool == VK_NULL_HANDLE) return;
+
+    deviceTable->vkCmdWriteTimestamp(commandBuffer, stage, timestampPool, frameSlot * (stageCount + 1) + query);
+}
+
+void PostProcessChain::computeBarrier(VkCommandBuffer commandBuffer) const {
+    VkMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+    deviceTable->vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+                                      1, &barrier, 0, nullptr, 0, nullptr);
+}
+
+VkExtent2D PostProcessChain::levelExtent(VkExtent2D extent, uint32_t level) const {
+    // Rounded up, so half of an odd size still covers the last pixel
+    const uint32_t shift = level + (settings.halfResolution ? 1 : 0);
+    const uint32_t round = (1u << shift) - 1;
+    return {std::max(1u, (extent.width + round) >> shift), std::max(1u, (extent.height + round) >> shift)};
+}
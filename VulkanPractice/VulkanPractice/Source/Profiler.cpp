@@ -0,0 +1,139 @@
+//
+//  Profiler.cpp
+//  VulkanPractice
+//
+
+#include <algorithm>
+#include <iomanip>
+#include <map>
+
+#include "Profiler.h"
+
+std::atomic<bool> Profiler::enabledFlag{false};
+std::mutex Profiler::threadsMutex;
+std::vector<std::unique_ptr<Profiler::ThreadBuffer>> Profiler::threads;
+thread_local Profiler::ThreadBuffer* Profiler::current = nullptr;
+
+namespace {
+
+// Names are string literals of this program, only quotes and backslashes need escaping
+void writeJsonString(std::ostream& os, const char* text) {
+    os << '"';
+    for (const char* c = text; *c != '\0'; c++) {
+        if (*c == '"' || *c == '\\') os << '\\';
+        os << *c;
+    }
+    os << '"';
+}
+
+}
+
+Profiler::ThreadBuffer* Profiler::registerThread() {
+    std::lock_guard<std::mutex> lock(threadsMutex);
+    const uint32_t index = static_cast<uint32_t>(threads.size());
+    threads.push_back(std::make_unique<ThreadBuffer>(index, "thread " + std::to_string(index)));
+    return threads.back().get();
+}
+
+void Profiler::setThreadName(const std::string& name) {
+    ThreadBuffer* buffer = currentThread();
+    std::lock_guard<std::mutex> lock(threadsMutex);
+    buffer->name = name;
+}
+
+std::vector<TraceZone> Profiler::collectZones() {
+    std::lock_guard<std::mutex> lock(threadsMutex);
+
+    std::vector<TraceZone> zones;
+    for (const std::unique_ptr<ThreadBuffer>& thread : threads) {
+        const uint64_t published = thread->count.load(std::memory_order_acquire);
+        const uint64_t first = published > threadCapacity ? published - threadCapacity : 0;
+
+        const size_t start = zones.size();
+        for (uint64_t position = first; position < published; position++) {
+            const ThreadBuffer::Slot& slot = thread->slots[position & (threadCapacity - 1)];
+            zones.push_back({slot.name.load(std::memory_order_relaxed), slot.beginNs.load(std::memory_order_relaxed),
+                             slot.endNs.load(std::memory_order_relaxed), slot.depth.load(std::memory_order_relaxed), thread->index});
+        }
+
+        // Every zone the owner has started writing since shares its slot with one of the oldest copied ones, drop those
+        // The acquire fence pairs with the release fence in ThreadBuffer::end(), a torn copy is always counted here
+        std::atomic_thread_fence(std::memory_order_acquire);
+        const uint64_t written = thread->count.load(std::memory_order_relaxed) + 1;
+        if (written > first + threadCapacity) {
+            const uint64_t overwritten = std::min(published, written - threadCapacity) - first;
+            zones.erase(zones.begin() + start, zones.begin() + start + static_cast<size_t>(overwritten));
+        }
+    }
+    return zones;
+}
+
+void Profiler::writeChromeTrace(std::ostream& os, const std::vector<TraceZone>& cpuZones, const std::vector<TraceZone>& gpuZones,
+                                const std::vector<std::string>& gpuQueueNames) {
+    // Timestamps are in microseconds from the first zone, small enough to keep nanosecond precision in a double
+    int64_t originNs = INT64_MAX;
+    for (const std::vector<TraceZone>* zones : {&cpuZones, &gpuZones}) {
+        for (const TraceZone& zone : *zones) {
+            originNs = std::min(originNs, zone.beginNs);
+        }
+    }
+
+    os << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+    os << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"CPU\"}},\n";
+    os << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":2,\"args\":{\"name\":\"GPU\"}},\n";
+    {
+        std::lock_guard<std::mutex> lock(threadsMutex);
+        for (const std::unique_ptr<ThreadBuffer>& thread : threads) {
+            os << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread->index << ",\"args\":{\"name\":";
+            writeJsonString(os, thread->name.c_str());
+            os << "}},\n";
+        }
+    }
+    // One track per queue, GPU zones carry the index of their queue as thread
+    for (size_t queue = 0; queue < gpuQueueNames.size(); queue++) {
+        os << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":2,\"tid\":" << queue << ",\"args\":{\"name\":";
+        writeJsonString(os, gpuQueueNames[queue].c_str());
+        os << (queue + 1 < gpuQueueNames.size() ? "}},\n" : "}}");
+    }
+
+    os << std::fixed << std::setprecision(3);
+    auto writeZones = [&](const std::vector<TraceZone>& zones, int pid) {
+        for (const TraceZone& zone : zones) {
+            os << ",\n{\"name\":";
+            writeJsonString(os, zone.name);
+            os << ",\"ph\":\"X\",\"pid\":" << pid << ",\"tid\":" << zone.thread
+               << ",\"ts\":" << (zone.beginNs - originNs) / 1000.0 << ",\"dur\":" << (zone.endNs - zone.beginNs) / 1000.0 << '}';
+        }
+    };
+    writeZones(cpuZones, 1);
+    writeZones(gpuZones, 2);
+    os << "\n]}\n";
+    os << std::defaultfloat;
+}
+
+void Profiler::printReport(std::ostream& os, const std::vector<TraceZone>& zones, const std::string& label) {
+    if (zones.empty()) return;
+
+    struct Totals {
+        uint64_t count = 0;
+        double totalMs = 0.0;
+        double maxMs = 0.0;
+    };
+    // Literals with the same text may or may not share an address, so the names are compared as strings
+    std::map<std::string, Totals> byName;
+    for (const TraceZone& zone : zones) {
+        Totals& totals = byName[zone.name];
+        const double ms = (zone.endNs - zone.beginNs) * 1e-6;
+        totals.count++;
+        totals.totalMs += ms;
+        totals.maxMs = std::max(totals.maxMs, ms);
+    }
+
+    os << "Profiler zones (" << label << ", " << zones.size() << " zones):\n";
+    os << std::fixed << std::setprecision(3);
+    for (const auto& [name, totals] : byName) {
+        os << '\t' << std::left << std::setw(28) << name << std::right << std::setw(8) << totals.count << " x, mean "
+           << std::setw(9) << totals.totalMs / totals.count << " ms, max " << std::setw(9) << totals.maxMs << " ms\n";
+    }
+    os << std::defaultfloat;
+}
@@ -0,0 +1,196 @@
+//
+//  RgbImage.cpp
+//  VulkanPractice
+//
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <stdexcept>
+
+#include "RgbImage.h"
+
+namespace {
+
+// Big endian, as everything in PNG
+void appendUint32(std::vector<uint8_t>& out, uint32_t value) {
+    out.push_back(static_cast<uint8_t>(value >> 24));
+    out.push_back(static_cast<uint8_t>(value >> 16));
+    out.push_back(static_cast<uint8_t>(value >> 8));
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+uint32_t crc32(const uint8_t* data, size_t size, uint32_t crc = 0) {
+    static const std::array<uint32_t, 256> table = [] {
+        std::array<uint32_t, 256> values{};
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int bit = 0; bit < 8; bit++) {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            values[i] = c;
+        }
+        return values;
+    }();
+
+    crc = ~crc;
+    for (size_t i = 0; i < size; i++) {
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+void writeChunk(std::ofstream& file, const char* type, const std::vector<uint8_t>& data) {
+    std::vector<uint8_t> chunk;
+    appendUint32(chunk, static_cast<uint32_t>(data.size()));
+    chunk.insert(chunk.end(), type, type + 4);
+    chunk.insert(chunk.end(), data.begin(), data.end());
+    // The CRC covers type and data, not the length
+    appendUint32(chunk, crc32(chunk.data() + 4, chunk.size() - 4));
+
+    file.write(reinterpret_cast<const char*>(chunk.data()), chunk.size());
+}
+
+}
+
+RgbImage RgbImage::fromRgba(const uint8_t* data, uint32_t width, uint32_t height, size_t rowPitch, bool bgra) {
+    RgbImage image;
+    image.width = width;
+    image.height = height;
+    image.pixels.resize(static_cast<size_t>(width) * height * 3);
+
+    const int red = bgra ? 2 : 0;
+    const int blue = bgra ? 0 : 2;
+
+    uint8_t* out = image.pixels.data();
+    for (uint32_t y = 0; y < height; y++) {
+        const uint8_t* row = data + y * rowPitch;
+        for (uint32_t x = 0; x < width; x++) {
+            *out++ = row[x * 4 + red];
+            *out++ = row[x * 4 + 1];
+            *out++ = row[x * 4 + blue];
+        }
+    }
+    return image;
+}
+
+RgbImage RgbImage::readPpm(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        throw std::runtime_error("failed to open image " + path);
+    }
+
+    std::string magic;
+    uint32_t maxValue = 0;
+    RgbImage image;
+    file >> magic >> image.width >> image.height >> maxValue;
+    if (magic != "P6" || maxValue != 255 || image.width == 0 || image.height == 0) {
+        throw std::runtime_error("unsupported PPM, expected binary 8 bit RGB: " + path);
+    }
+    // Exactly one whitespace separates the header from the pixels
+    file.get();
+
+    image.pixels.resize(static_cast<size_t>(image.width) * image.height * 3);
+    file.read(reinterpret_cast<char*>(image.pixels.data()), image.pixels.size());
+    if (!file) {
+        throw std::runtime_error("truncated PPM " + path);
+    }
+    return image;
+}
+
+void RgbImage::writePpm(const std::string& path) const {
+    std::ofstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        throw std::runtime_error("failed to create image " + path);
+    }
+
+    file << "P6\n" << width << ' ' << height << "\n255\n";
+    file.write(reinterpret_cast<const char*>(pixels.data()), pixels.size());
+}
+
+void RgbImage::writePng(const std::string& path) const {
+    std::ofstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        throw std::runtime_error("failed to create image " + path);
+    }
+
+    const uint8_t signature[] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    file.write(reinterpret_cast<const char*>(signature), sizeof(signature));
+
+    std::vector<uint8_t> header;
+    appendUint32(header, width);
+    appendUint32(header, height);
+    header.push_back(8);    // bit depth
+    header.push_back(2);    // color type RGB
+    header.push_back(0);    // compression
+    header.push_back(0);    // filter
+    header.push_back(0);    // no interlace
+    writeChunk(file, "IHDR", header);
+
+    // Every row starts with its filter type, 0 is none
+    const size_t rowSize = static_cast<size_t>(width) * 3;
+    std::vector<uint8_t> raw;
+    raw.reserve((rowSize + 1) * height);
+    for (uint32_t y = 0; y < height; y++) {
+        raw.push_back(0);
+        raw.insert(raw.end(), pixels.begin() + y * rowSize, pixels.begin() + (y + 1) * rowSize);
+    }
+
+    // zlib stream of stored deflate blocks, each holds at most 65535 bytes
+    std::vector<uint8_t> data = {0x78, 0x01};
+    data.reserve(raw.size() + raw.size() / 65535 * 5 + 16);
+    size_t offset = 0;
+    do {
+        size_t blockSize = std::min<size_t>(raw.size() - offset, 65535);
+        bool last = offset + blockSize == raw.size();
+        data.push_back(last ? 1 : 0);
+        data.push_back(static_cast<uint8_t>(blockSize));
+        data.push_back(static_cast<uint8_t>(blockSize >> 8));
+        data.push_back(static_cast<uint8_t>(~blockSize));
+        data.push_back(static_cast<uint8_t>(~blockSize >> 8));
+        data.insert(data.end(), raw.begin() + offset, raw.begin() + offset + blockSize);
+        offset += blockSize;
+    } while (offset < raw.size());
+
+    uint32_t a = 1, b = 0;
+    for (uint8_t byte : raw) {
+        a = (a + byte) % 65521;
+        b = (b + a) % 65521;
+    }
+    appendUint32(data, (b << 16) | a);
+    writeChunk(file, "IDAT", data);
+
+    writeChunk(file, "IEND", {});
+}
+
+void RgbImage::write(const std::string& path) const {
+    std::string extension = path.size() >= 4 ? path.substr(path.size() - 4) : "";
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](char c) { return static_cast<char>(tolower(c)); });
+
+    if (extension == ".png") {
+        writePng(path);
+    } else if (extension == ".ppm") {
+        writePpm(path);
+    } else {
+        throw std::runtime_error("unknown image format, use .png or .ppm: " + path);
+    }
+}
+
+ImageComparison RgbImage::compare(const RgbImage& golden, const std::array<uint8_t, 3>& tolerance) const {
+    ImageComparison result;
+    result.sizeMatches = width == golden.width && height == golden.height;
+    if (!result.sizeMatches) return result;
+
+    for (size_t i = 0; i < pixels.size(); i += 3) {
+        bool mismatch = false;
+        for (int channel = 0; channel < 3; channel++) {
+            uint8_t difference = static_cast<uint8_t>(std::abs(pixels[i + channel] - golden.pixels[i + channel]));
+            result.maxDifference[channel] = std::max(result.maxDifference[channel], difference);
+            mismatch |= difference > tolerance[channel];
+        }
+        if (mismatch) {
+            result.mismatchedPixels++;
+        }
+    }
+    return result;
+}
@@ -0,0 +1,56 @@
+//
+//  ShaderReflection.cpp
+//  VulkanPractice
+//
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+#include "ShaderReflection.h"
+
+std::vector<VkDescriptorSetLayoutBinding> descriptorSetLayoutBindings(uint32_t set, std::initializer_list<const EmbeddedShader*> shaders) {
+    std::vector<VkDescriptorSetLayoutBinding> layoutBindings;
+
+    for (const EmbeddedShader* shader : shaders) {
+        for (uint32_t i = 0; i < shader->bindingCount; i++) {
+            const ReflectedBinding& reflected = shader->bindings[i];
+            if (reflected.set != set) continue;
+
+            auto existing = std::find_if(layoutBindings.begin(), layoutBindings.end(), [&reflected](const VkDescriptorSetLayoutBinding& binding) {
+                return binding.binding == reflected.binding;
+            });
+            if (existing != layoutBindings.end()) {
+                if (existing->descriptorType != reflected.descriptorType || existing->descriptorCount != reflected.descriptorCount) {
+                    throw std::runtime_error(std::string("binding ") + std::to_string(reflected.binding) + " of " + shader->sourceName +
+                                             " doesn't match the other shaders!");
+                }
+                existing->stageFlags |= shader->stage;
+                continue;
+            }
+
+            VkDescriptorSetLayoutBinding binding{};
+            binding.binding = reflected.binding;
+            binding.descriptorType = reflected.descriptorType;
+            binding.descriptorCount = reflected.descriptorCount;
+            binding.stageFlags = shader->stage;
+            layoutBindings.push_back(binding);
+        }
+    }
+
+    std::sort(layoutBindings.begin(), layoutBindings.end(), [](const VkDescriptorSetLayoutBinding& a, const VkDescriptorSetLayoutBinding& b) {
+        return a.binding < b.binding;
+    });
+    return layoutBindings;
+}
+
+VkPushConstantRange pushConstantRange(std::initializer_list<const EmbeddedShader*> shaders) {
+    VkPushConstantRange range{};
+    for (const EmbeddedShader* shader : shaders) {
+        if (shader->pushConstantSize == 0) continue;
+
+        range.stageFlags |= shader->stage;
+        range.size = std::max(range.size, shader->pushConstantSize);
+    }
+    return range;
+}
@@ -0,0 +1,406 @@
+//
+//  SpriteBatcher.cpp
+//  VulkanPractice
+//
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+
+#include "EmbeddedShaders.h"
+#include "SpriteBatcher.h"
+#include "VulkanMemory.h"
+
+namespace {
+
+// Descriptor sets in the pool, one per texture
+const uint32_t maxTextures = 64;
+
+struct ScreenPushConstants {
+    float scale[2];
+};
+
+static_assert(shaders::spriteVert.pushConstantSize == sizeof(ScreenPushConstants), "sprite.vert doesn't match ScreenPushConstants");
+
+}
+
+void SpriteBatcher::init(VkPhysicalDevice physicalDevice, const InstanceDispatch& instanceTable, VkDevice device, const DeviceDispatch* deviceTable,
+                         const VkAllocationCallbacks* allocator, VkQueue queue, VkCommandPool commandPool, PipelineManager* pipelineManager,
+                         VkRenderPass renderPass, VkFormat colorFormat, uint64_t vertexShader, uint64_t fragmentShader,
+                         uint32_t maxSprites, uint32_t frameSlots) {
+    this->device = device;
+    this->deviceTable = deviceTable;
+    this->allocator = allocator;
+    this->queue = queue;
+    this->commandPool = commandPool;
+    this->pipelineManager = pipelineManager;
+    this->maxSprites = maxSprites;
+
+    instanceTable.vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+
+    createIndexBuffer();
+
+    // One region of maxSprites quads per frame slot, written by the CPU while the GPU reads the other regions
+    const VkDeviceSize vertexBufferSize = static_cast<VkDeviceSize>(maxSprites) * 4 * sizeof(Vertex) * frameSlots;
+    createBuffer(device, *deviceTable, allocator, memoryProperties,
+                 vertexBufferSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+                 VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, vertexBuffer, vertexMemory);
+
+    void* mapped = nullptr;
+    if (deviceTable->vkMapMemory(device, vertexMemory, 0, VK_WHOLE_SIZE, 0, &mapped) != VK_SUCCESS) {
+        throw std::runtime_error("failed to map sprite vertex buffer!");
+    }
+    mappedVertices = static_cast<Vertex*>(mapped);
+
+    createDescriptors();
+
+    pipelineState.vertexShader = vertexShader;
+    pipelineState.fragmentShader = fragmentShader;
+    pipelineState.vertexLayout.stride = sizeof(Vertex);
+    pipelineState.vertexLayout
+        .add(VK_FORMAT_R32G32_SFLOAT, offsetof(Vertex, position))
+        .add(VK_FORMAT_R32G32_SFLOAT, offsetof(Vertex, uv))
+        .add(VK_FORMAT_R8G8B8A8_UNORM, offsetof(Vertex, color));
+    pipelineState.layout = pipelineLayout;
+    pipelineState.renderPass = renderPass;
+    pipelineState.colorFormat = colorFormat;
+
+    sprites.reserve(maxSprites);
+}
+
+void SpriteBatcher::destroy() {
+    for (auto& texture : textures) {
+        deviceTable->vkDestroyImageView(device, texture.view, allocator);
+        deviceTable->vkDestroyImage(device, texture.image, allocator);
+        deviceTable->vkFreeMemory(device, texture.memory, allocator);
+    }
+    textures.clear();
+
+    // Frees the descriptor sets as well
+    deviceTable->vkDestroyDescriptorPool(device, descriptorPool, allocator);
+    deviceTable->vkDestroyDescriptorSetLayout(device, descriptorSetLayout, allocator);
+    deviceTable->vkDestroyPipelineLayout(device, pipelineLayout, allocator);
+    deviceTable->vkDestroySampler(device, sampler, allocator);
+
+    deviceTable->vkUnmapMemory(device, vertexMemory);
+    deviceTable->vkDestroyBuffer(device, vertexBuffer, allocator);
+    deviceTable->vkFreeMemory(device, vertexMemory, allocator);
+    deviceTable->vkDestroyBuffer(device, indexBuffer, allocator);
+    deviceTable->vkFreeMemory(device, indexMemory, allocator);
+
+    mappedVertices = nullptr;
+    sprites.clear();
+}
+
+TextureId SpriteBatcher::addTexture(uint32_t width, uint32_t height, const uint8_t* pixels) {
+    if (textures.size() == maxTextures) {
+        throw std::runtime_error("too many sprite textures!");
+    }
+
+    const VkDeviceSize size = static_cast<VkDeviceSize>(width) * height * 4;
+
+    VkBuffer stagingBuffer;
+    VkDeviceMemory stagingMemory;
+    createBuffer(device, *deviceTable, allocator, memoryProperties,
+                 size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                 stagingBuffer, stagingMemory);
+
+    void* mapped = nullptr;
+    deviceTable->vkMapMemory(device, stagingMemory, 0, size, 0, &mapped);
+    std::memcpy(mapped, pixels, static_cast<size_t>(size));
+    deviceTable->vkUnmapMemory(device, stagingMemory);
+
+    Texture texture;
+
+    // The swap chain is sRGB, so are the textures
+    VkImageCreateInfo imageInfo{};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.format = VK_FORMAT_R8G8B8A8_SRGB;
+    imageInfo.extent = {width, height, 1};
+    imageInfo.mipLevels = 1;
+    imageInfo.arrayLayers = 1;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+    if (deviceTable->vkCreateImage(device, &imageInfo, allocator, &texture.image) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create sprite texture!");
+    }
+
+    VkMemoryRequirements memoryRequirements;
+    deviceTable->vkGetImageMemoryRequirements(device, texture.image, &memoryRequirements);
+
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = memoryRequirements.size;
+    allocInfo.memoryTypeIndex = findMemoryType(memoryProperties, memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+    if (deviceTable->vkAllocateMemory(device, &allocInfo, allocator, &texture.memory) != VK_SUCCESS) {
+        throw std::runtime_error("failed to allocate sprite texture memory!");
+    }
+    deviceTable->vkBindImageMemory(device, texture.image, texture.memory, 0);
+
+    submitOnce(device, *deviceTable, queue, commandPool, [&](VkCommandBuffer commandBuffer) {
+        VkImageMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = texture.image;
+        barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        barrier.subresourceRange.levelCount = 1;
+        barrier.subresourceRange.layerCount = 1;
+
+        deviceTable->vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+                                          0, nullptr, 0, nullptr, 1, &barrier);
+
+        VkBufferImageCopy region{};
+        region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        region.imageSubresource.layerCount = 1;
+        region.imageExtent = {width, height, 1};
+        deviceTable->vkCmdCopyBufferToImage(commandBuffer, stagingBuffer, texture.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+        deviceTable->vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
+                                          0, nullptr, 0, nullptr, 1, &barrier);
+    });
+
+    deviceTable->vkDestroyBuffer(device, stagingBuffer, allocator);
+    deviceTable->vkFreeMemory(device, stagingMemory, allocator);
+
+    VkImageViewCreateInfo viewInfo{};
+    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image = texture.image;
+    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.format = imageInfo.format;
+    viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    viewInfo.subresourceRange.levelCount = 1;
+    viewInfo.subresourceRange.layerCount = 1;
+
+    if (deviceTable->vkCreateImageView(device, &viewInfo, allocator, &texture.view) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create sprite texture view!");
+    }
+
+    VkDescriptorSetAllocateInfo setInfo{};
+    setInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    setInfo.descriptorPool = descriptorPool;
+    setInfo.descriptorSetCount = 1;
+    setInfo.pSetLayouts = &descriptorSetLayout;
+
+    if (deviceTable->vkAllocateDescriptorSets(device, &setInfo, &texture.descriptorSet) != VK_SUCCESS) {
+        throw std::runtime_error("failed to allocate sprite descriptor set!");
+    }
+
+    VkDescriptorImageInfo descriptorImage{};
+    descriptorImage.sampler = sampler;
+    descriptorImage.imageView = texture.view;
+    descriptorImage.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+    VkWriteDescriptorSet write{};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet = texture.descriptorSet;
+    write.dstBinding = 0;
+    write.descriptorCount = 1;
+    write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    write.pImageInfo = &descriptorImage;
+    deviceTable->vkUpdateDescriptorSets(device, 1, &write, 0, nullptr);
+
+    textures.push_back(texture);
+    return static_cast<TextureId>(textures.size() - 1);
+}
+
+void SpriteBatcher::begin(uint32_t frameSlot, VkExtent2D targetExtent, SpriteSortMode sortMode) {
+    frameStart = Clock::now();
+
+    this->frameSlot = frameSlot;
+    this->targetExtent = targetExtent;
+    this->sortMode = sortMode;
+    sprites.clear();
+    frameStats = SpriteBatchStats{};
+}
+
+void SpriteBatcher::draw(const Sprite& sprite) {
+    if (sprites.size() == maxSprites) {
+        frameStats.droppedSprites++;
+        return;
+    }
+    sprites.push_back(sprite);
+}
+
+void SpriteBatcher::end(VkCommandBuffer commandBuffer) {
+    frameStats.sprites = sprites.size();
+
+    if (!sprites.empty()) {
+        if (sortMode == SpriteSortMode::ByState) {
+            std::stable_sort(sprites.begin(), sprites.end(), [](const Sprite& a, const Sprite& b) {
+                if (a.blendMode != b.blendMode) return a.blendMode < b.blendMode;
+                return a.texture < b.texture;
+            });
+        }
+
+        // Straight into the mapped region of this frame slot, the GPU is done reading it since its fence signaled
+        const size_t regionVertices = static_cast<size_t>(maxSprites) * 4;
+        Vertex* out = mappedVertices + frameSlot * regionVertices;
+        for (const Sprite& sprite : sprites) {
+            const float x1 = sprite.x + sprite.width;
+            const float y1 = sprite.y + sprite.height;
+            *out++ = {{sprite.x, sprite.y}, {sprite.u0, sprite.v0}, sprite.color};
+            *out++ = {{x1, sprite.y}, {sprite.u1, sprite.v0}, sprite.color};
+            *out++ = {{x1, y1}, {sprite.u1, sprite.v1}, sprite.color};
+            *out++ = {{sprite.x, y1}, {sprite.u0, sprite.v1}, sprite.color};
+        }
+
+        VkDeviceSize vertexOffset = frameSlot * regionVertices * sizeof(Vertex);
+        deviceTable->vkCmdBindVertexBuffers(commandBuffer, 0, 1, &vertexBuffer, &vertexOffset);
+        deviceTable->vkCmdBindIndexBuffer(commandBuffer, indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+
+        // Maps pixels to clip space, the same for every pipeline since they share the layout
+        ScreenPushConstants screen{{2.0f / targetExtent.width, 2.0f / targetExtent.height}};
+        deviceTable->vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(screen), &screen);
+
+        bool firstRun = true;
+        BlendMode boundBlendMode = BlendMode::Opaque;
+        TextureId boundTexture = 0;
+
+        size_t runStart = 0;
+        for (size_t i = 1; i <= sprites.size(); i++) {
+            if (i < sprites.size() && sprites[i].blendMode == sprites[runStart].blendMode && sprites[i].texture == sprites[runStart].texture) {
+                continue;
+            }
+
+            const Sprite& run = sprites[runStart];
+            if (firstRun || run.blendMode != boundBlendMode) {
+                PipelineState state = pipelineState;
+                state.blendMode = run.blendMode;
+                deviceTable->vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineManager->getPipeline(state));
+                boundBlendMode = run.blendMode;
+                frameStats.pipelineBinds++;
+            }
+            if (firstRun || run.texture != boundTexture) {
+                deviceTable->vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1,
+                                                     &textures.at(run.texture).descriptorSet, 0, nullptr);
+                boundTexture = run.texture;
+                frameStats.textureBinds++;
+            }
+            firstRun = false;
+
+            const uint32_t quads = static_cast<uint32_t>(i - runStart);
+            deviceTable->vkCmdDrawIndexed(commandBuffer, quads * 6, 1, static_cast<uint32_t>(runStart) * 6, 0, 0);
+            frameStats.draws++;
+
+            runStart = i;
+        }
+    }
+
+    frameStats.cpuMs = std::chrono::duration<double, std::milli>(Clock::now() - frameStart).count();
+}
+
+void SpriteBatcher::createIndexBuffer() {
+    // Two triangles per quad, 32 bit since 16 bit indices would cap a draw at 16384 quads
+    std::vector<uint32_t> indices(static_cast<size_t>(maxSprites) * 6);
+    for (uint32_t quad = 0; quad < maxSprites; quad++) {
+        const uint32_t first = quad * 4;
+        uint32_t* out = &indices[static_cast<size_t>(quad) * 6];
+        out[0] = first;
+        out[1] = first + 1;
+        out[2] = first + 2;
+        out[3] = first + 2;
+        out[4] = first + 3;
+        out[5] = first;
+    }
+
+    const VkDeviceSize size = indices.size() * sizeof(uint32_t);
+
+    VkBuffer stagingBuffer;
+    VkDeviceMemory stagingMemory;
+    createBuffer(device, *deviceTable, allocator, memoryProperties,
+                 size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                 stagingBuffer, stagingMemory);
+
+    void* mapped = nullptr;
+    deviceTable->vkMapMemory(device, stagingMemory, 0, size, 0, &mapped);
+    std::memcpy(mapped, indices.data(), static_cast<size_t>(size));
+    deviceTable->vkUnmapMemory(device, stagingMemory);
+
+    // Never changes, so it lives in device local memory
+    createBuffer(device, *deviceTable, allocator, memoryProperties,
+                 size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                 indexBuffer, indexMemory);
+
+    submitOnce(device, *deviceTable, queue, commandPool, [&](VkCommandBuffer commandBuffer) {
+        VkBufferCopy region{};
+        region.size = size;
+        deviceTable->vkCmdCopyBuffer(commandBuffer, stagingBuffer, indexBuffer, 1, &region);
+    });
+
+    deviceTable->vkDestroyBuffer(device, stagingBuffer, allocator);
+    deviceTable->vkFreeMemory(device, stagingMemory, allocator);
+}
+
+void SpriteBatcher::createDescriptors() {
+    // The pool below only holds one texture per set
+    static_assert(shaders::spriteFrag.bindingCount == 1 &&
+                  shaders::spriteFrag.bindings[0].descriptorType == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, "sprite.frag doesn't match the pool");
+    std::vector<VkDescriptorSetLayoutBinding> bindings = descriptorSetLayoutBindings(0, {&shaders::spriteVert, &shaders::spriteFrag});
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+    layoutInfo.pBindings = bindings.data();
+
+    if (deviceTable->vkCreateDescriptorSetLayout(device, &layoutInfo, allocator, &descriptorSetLayout) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create sprite descriptor set layout!");
+    }
+
+    VkDescriptorPoolSize poolSize{};
+    poolSize.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    poolSize.descriptorCount = maxTextures;
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.maxSets = maxTextures;
+    poolInfo.poolSizeCount = 1;
+    poolInfo.pPoolSizes = &poolSize;
+
+    if (deviceTable->vkCreateDescriptorPool(device, &poolInfo, allocator, &descriptorPool) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create sprite descriptor pool!");
+    }
+
+    VkPushConstantRange screenRange = pushConstantRange({&shaders::spriteVert, &shaders::spriteFrag});
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &screenRange;
+
+    if (deviceTable->vkCreatePipelineLayout(device, &pipelineLayoutInfo, allocator, &pipelineLayout) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create sprite pipeline layout!");
+    }
+
+    VkSamplerCreateInfo samplerInfo{};
+    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.magFilter = VK_FILTER_LINEAR;
+    samplerInfo.minFilter = VK_FILTER_LINEAR;
+    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.maxLod = 0.0f;
+
+    if (deviceTable->vkCreateSampler(device, &samplerInfo, allocator, &sampler) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create sprite sampler!");
+    }
+}
@@ -0,0 +1,60 @@
+//
+//  StartupTimeline.cpp
+//  VulkanPractice
+//
+
+#include <algorithm>
+#include <iomanip>
+
+#include "StartupTimeline.h"
+
+void StartupTimeline::begin() {
+    std::lock_guard<std::mutex> guard(lock);
+    steps.clear();
+    firstFrameMs.reset();
+    origin = Clock::now();
+    mainThreadId = std::this_thread::get_id();
+}
+
+void StartupTimeline::record(const char* name, Clock::time_point start, Clock::time_point end) {
+    std::lock_guard<std::mutex> guard(lock);
+    steps.push_back({name, millisecondsSinceBegin(start), std::chrono::duration<double, std::milli>(end - start).count(),
+                     std::this_thread::get_id() == mainThreadId});
+}
+
+bool StartupTimeline::markFirstFrame() {
+    std::lock_guard<std::mutex> guard(lock);
+    if (firstFrameMs.has_value()) return false;
+
+    firstFrameMs = millisecondsSinceBegin(Clock::now());
+    return true;
+}
+
+std::optional<double> StartupTimeline::timeToFirstFrameMs() const {
+    std::lock_guard<std::mutex> guard(lock);
+    return firstFrameMs;
+}
+
+void StartupTimeline::print(std::ostream& os) const {
+    std::lock_guard<std::mutex> guard(lock);
+
+    std::vector<Step> sorted = steps;
+    std::sort(sorted.begin(), sorted.end(), [](const Step& a, const Step& b) {
+        return a.startMs < b.startMs;
+    });
+
+    os << "Startup timeline (ms):\n";
+    os << std::fixed << std::setprecision(2);
+    for (const auto& step : sorted) {
+        os << '\t' << std::setw(8) << step.startMs << " +" << std::setw(8) << step.durationMs
+           << (step.mainThread ? "  main    " : "  worker  ") << step.name << '\n';
+    }
+    if (firstFrameMs.has_value()) {
+        os << "Time to first frame: " << *firstFrameMs << " ms\n";
+    }
+    os << std::defaultfloat;
+}
+
+double StartupTimeline::millisecondsSinceBegin(Clock::time_point time) const {
+    return std::chrono::duration<double, std::milli>(time - origin).count();
+}
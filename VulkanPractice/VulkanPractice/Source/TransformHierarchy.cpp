@@ -0,0 +1,234 @@
+//
+//  TransformHierarchy.cpp
+//  VulkanPractice
+//
+
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+#include <type_traits>
+
+#include "TransformHierarchy.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TRANSFORM_SSE2
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define TRANSFORM_NEON
+#endif
+
+namespace {
+
+// Levels smaller than this per thread are updated on the calling thread alone
+const size_t MIN_NODES_PER_THREAD = 8192;
+// Range boundaries are multiples of this many slots from the start of the arrays, so neighbouring threads rarely
+// write to the same cache line of flags
+const size_t RANGE_GRANULARITY = 64;
+
+glm::mat4 localMatrix(const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale) {
+    const glm::mat3 r = glm::mat3_cast(rotation);
+    return glm::mat4(glm::vec4(r[0] * scale.x, 0.0f), glm::vec4(r[1] * scale.y, 0.0f), glm::vec4(r[2] * scale.z, 0.0f), glm::vec4(position, 1.0f));
+}
+
+// out = a * b, every column of out is a combination of the columns of a
+void multiply(const glm::mat4& a, const glm::mat4& b, glm::mat4& out) {
+#if defined(TRANSFORM_SSE2)
+    const __m128 a0 = _mm_loadu_ps(&a[0][0]);
+    const __m128 a1 = _mm_loadu_ps(&a[1][0]);
+    const __m128 a2 = _mm_loadu_ps(&a[2][0]);
+    const __m128 a3 = _mm_loadu_ps(&a[3][0]);
+    for (int column = 0; column < 4; column++) {
+        const __m128 result = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a0, _mm_set1_ps(b[column][0])), _mm_mul_ps(a1, _mm_set1_ps(b[column][1]))),
+                                         _mm_add_ps(_mm_mul_ps(a2, _mm_set1_ps(b[column][2])), _mm_mul_ps(a3, _mm_set1_ps(b[column][3]))));
+        _mm_storeu_ps(&out[column][0], result);
+    }
+#elif defined(TRANSFORM_NEON)
+    const float32x4_t a0 = vld1q_f32(&a[0][0]);
+    const float32x4_t a1 = vld1q_f32(&a[1][0]);
+    const float32x4_t a2 = vld1q_f32(&a[2][0]);
+    const float32x4_t a3 = vld1q_f32(&a[3][0]);
+    for (int column = 0; column < 4; column++) {
+        float32x4_t result = vmulq_n_f32(a0, b[column][0]);
+        result = vmlaq_n_f32(result, a1, b[column][1]);
+        result = vmlaq_n_f32(result, a2, b[column][2]);
+        result = vmlaq_n_f32(result, a3, b[column][3]);
+        vst1q_f32(&out[column][0], result);
+    }
+#else
+    out = a * b;
+#endif
+}
+
+}
+
+TransformHierarchy::~TransformHierarchy() {
+    destroy();
+}
+
+void TransformHierarchy::init(uint32_t threadCount) {
+    workerPool.init(threadCount);
+    threadUpdated.assign(workerPool.threadCount(), ThreadCount{});
+}
+
+void TransformHierarchy::destroy() {
+    workerPool.destroy();
+}
+
+NodeId TransformHierarchy::addNode(const Transform& local, NodeId parent) {
+    if (parent != NO_PARENT_NODE && parent >= slotOfNode.size()) {
+        throw std::runtime_error("parent node doesn't exist!");
+    }
+
+    const NodeId node = static_cast<NodeId>(slotOfNode.size());
+    slotOfNode.push_back(static_cast<uint32_t>(parentSlots.size()));
+    nodeOfSlot.push_back(node);
+
+    parentSlots.push_back(parent == NO_PARENT_NODE ? NO_PARENT_NODE : slotOfNode[parent]);
+    positions.push_back(local.position);
+    rotations.push_back(local.rotation);
+    scales.push_back(local.scale);
+    worlds.emplace_back(1.0f);
+    dirty.push_back(1);
+    updatedIn.push_back(0);
+
+    layoutDirty = true;
+    return node;
+}
+
+void TransformHierarchy::setLocal(NodeId node, const Transform& local) {
+    const uint32_t slot = slotOfNode[node];
+    positions[slot] = local.position;
+    rotations[slot] = local.rotation;
+    scales[slot] = local.scale;
+    dirty[slot] = 1;
+}
+
+Transform TransformHierarchy::local(NodeId node) const {
+    const uint32_t slot = slotOfNode[node];
+    Transform transform;
+    transform.position = positions[slot];
+    transform.rotation = rotations[slot];
+    transform.scale = scales[slot];
+    return transform;
+}
+
+void TransformHierarchy::rebuildLayout() {
+    const size_t count = parentSlots.size();
+
+    // Children of every slot as ranges of one array, in the order they were added
+    std::vector<uint32_t> childStarts(count + 1, 0);
+    std::vector<uint32_t> order;
+    order.reserve(count);
+    for (uint32_t slot = 0; slot < count; slot++) {
+        if (parentSlots[slot] == NO_PARENT_NODE) {
+            order.push_back(slot);
+        } else {
+            childStarts[parentSlots[slot] + 1]++;
+        }
+    }
+    for (size_t slot = 0; slot < count; slot++) {
+        childStarts[slot + 1] += childStarts[slot];
+    }
+    std::vector<uint32_t> children(count - order.size());
+    std::vector<uint32_t> fill(childStarts.begin(), childStarts.end() - 1);
+    for (uint32_t slot = 0; slot < count; slot++) {
+        if (parentSlots[slot] != NO_PARENT_NODE) {
+            children[fill[parentSlots[slot]]++] = slot;
+        }
+    }
+
+    // Breadth first from the roots, every pass over the last level appends the next one
+    levelStarts = {0};
+    for (size_t levelBegin = 0; levelBegin < order.size();) {
+        const size_t levelEnd = order.size();
+        levelStarts.push_back(levelEnd);
+        for (size_t i = levelBegin; i < levelEnd; i++) {
+            order.insert(order.end(), children.begin() + childStarts[order[i]], children.begin() + childStarts[order[i] + 1]);
+        }
+        levelBegin = levelEnd;
+    }
+
+    std::vector<uint32_t> newSlots(count);
+    for (uint32_t slot = 0; slot < count; slot++) {
+        newSlots[order[slot]] = slot;
+    }
+
+    auto permute = [&](auto& array) {
+        std::remove_reference_t<decltype(array)> sorted(array.size());
+        for (size_t slot = 0; slot < count; slot++) {
+            sorted[slot] = array[order[slot]];
+        }
+        array.swap(sorted);
+    };
+    permute(parentSlots);
+    permute(positions);
+    permute(rotations);
+    permute(scales);
+    permute(worlds);
+    permute(dirty);
+    permute(updatedIn);
+    permute(nodeOfSlot);
+
+    for (uint32_t slot = 0; slot < count; slot++) {
+        if (parentSlots[slot] != NO_PARENT_NODE) {
+            parentSlots[slot] = newSlots[parentSlots[slot]];
+        }
+        slotOfNode[nodeOfSlot[slot]] = slot;
+    }
+}
+
+void TransformHierarchy::update() {
+    auto start = std::chrono::steady_clock::now();
+
+    if (layoutDirty) {
+        rebuildLayout();
+        layoutDirty = false;
+    }
+    if (threadUpdated.empty()) {
+        throw std::runtime_error("transform hierarchy used before init!");
+    }
+
+    updateNumber++;
+    for (ThreadCount& count : threadUpdated) {
+        count.updated = 0;
+    }
+
+    // Levels in order, a level is finished on all threads before the next one reads it
+    for (size_t level = 0; level + 1 < levelStarts.size(); level++) {
+        const size_t levelBegin = levelStarts[level];
+        const size_t alignedBegin = levelBegin / RANGE_GRANULARITY * RANGE_GRANULARITY;
+        workerPool.parallelFor(levelStarts[level + 1] - alignedBegin, MIN_NODES_PER_THREAD, RANGE_GRANULARITY,
+                               [this, levelBegin, alignedBegin](uint32_t thread, size_t begin, size_t end) {
+            threadUpdated[thread].updated += updateRange(std::max(levelBegin, alignedBegin + begin), alignedBegin + end);
+        });
+    }
+
+    updateStats.nodes = nodeCount();
+    updateStats.updated = 0;
+    for (const ThreadCount& count : threadUpdated) {
+        updateStats.updated += count.updated;
+    }
+    updateStats.levels = static_cast<uint32_t>(levelStarts.size() - 1);
+    updateStats.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+size_t TransformHierarchy::updateRange(size_t begin, size_t end) {
+    size_t updated = 0;
+    for (size_t slot = begin; slot < end; slot++) {
+        const uint32_t parent = parentSlots[slot];
+        // Children look at the update number of their parent instead of its flag, so the flag can be cleared right away
+        const bool parentUpdated = parent != NO_PARENT_NODE && updatedIn[parent] == updateNumber;
+        if (!dirty[slot] && !parentUpdated) continue;
+
+        if (parent == NO_PARENT_NODE) {
+            worlds[slot] = localMatrix(positions[slot], rotations[slot], scales[slot]);
+        } else {
+            multiply(worlds[parent], localMatrix(positions[slot], rotations[slot], scales[slot]), worlds[slot]);
+        }
+        dirty[slot] = 0;
+        updatedIn[slot] = updateNumber;
+        updated++;
+    }
+    return updated;
+}
@@ -12,39 +12,184 @@
 #include <cstdint> // Necessary for uint32_t
 #include <limits>
 #include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <deque>
+#include <filesystem>
 #include <fstream>
+#include <future>
+#include <iomanip>
+#include <random>
+#include <thread>
 
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "EmbeddedShaders.h"
 #include "VKSetup.h"
+#include "VulkanMemory.h"
 
-VkResult CreateDebugUtilsMessengerEXT(VkInstance instance, const VkDebugUtilsMessengerCreateInfoEXT* pCreateInfo, const VkAllocationCallbacks* pAllocator, VkDebugUtilsMessengerEXT* pDebugMessenger) {
-    auto func = (PFN_vkCreateDebugUtilsMessengerEXT) vkGetInstanceProcAddr(instance, "vkCreateDebugUtilsMessengerEXT");
-    if (func != nullptr) {
-        return func(instance, pCreateInfo, pAllocator, pDebugMessenger);
-    } else {
-        return VK_ERROR_EXTENSION_NOT_PRESENT;
+void HelloTriangleApplication::run() {
+    // Opening a named pipe waits for its reader, so that happens before startup is timed
+    if (stream) {
+        frameStreamer.open(stream->path);
+    }
+    
+    startupTimeline.begin();
+    
+    initWindow();
+    initVulkan();
+    
+    if (stream) {
+        frameStreamer.printFormat(std::cout, swapChainExtent, swapChainImageFormat,
+                                  framePacingMode == FramePacingMode::Limited ? targetFrameRate : 0.0);
+    }
+    
+    mainLoop();
+    cleanup();
+    
+    if (capture) {
+        reportCapture();
+    }
+    if (stream) {
+        frameStreamer.close();
+        frameStreamer.printReport(std::cout, frameReadback.stats());
+    }
+}
+
+void HelloTriangleApplication::setFramePacing(FramePacingMode mode, double targetFrameRate) {
+    if (mode == FramePacingMode::Limited && targetFrameRate <= 0.0) {
+        throw std::runtime_error("frame rate limit must be positive!");
     }
+    
+    framePacingMode = mode;
+    this->targetFrameRate = targetFrameRate;
 }
 
-void DestroyDebugUtilsMessengerEXT(VkInstance instance, VkDebugUtilsMessengerEXT debugMessenger, const VkAllocationCallbacks* pAllocator) {
-    auto func = (PFN_vkDestroyDebugUtilsMessengerEXT) vkGetInstanceProcAddr(instance, "vkDestroyDebugUtilsMessengerEXT");
-    if (func != nullptr) {
-        func(instance, debugMessenger, pAllocator);
+void HelloTriangleApplication::setCapture(const CaptureSettings& settings) {
+    if (settings.outputPath.empty() && settings.goldenPath.empty()) {
+        throw std::runtime_error("capture needs an output or a golden image!");
+    }
+    if (stream) {
+        throw std::runtime_error("capture and streaming can't be combined!");
     }
+    
+    capture = settings;
 }
 
-void HelloTriangleApplication::run() {
+void HelloTriangleApplication::setStream(const StreamSettings& settings) {
+    if (settings.path.empty()) {
+        throw std::runtime_error("stream needs a path!");
+    }
+    if (capture) {
+        throw std::runtime_error("capture and streaming can't be combined!");
+    }
+    
+    stream = settings;
+}
+
+void HelloTriangleApplication::setModelPath(const std::string& path) {
+    modelPath = path;
+}
+
+void HelloTriangleApplication::setTracePath(const std::string& path) {
+    tracePath = path;
+}
+
+void HelloTriangleApplication::setSimulatedMemoryBudget(VkDeviceSize bytes) {
+    simulatedMemoryBudget = bytes;
+}
+
+void HelloTriangleApplication::setWindowCount(uint32_t count) {
+    if (count == 0) {
+        throw std::runtime_error("there has to be at least one window!");
+    }
+    
+    windowCount = count;
+}
+
+void HelloTriangleApplication::setMultiviewCount(uint32_t count) {
+    if (count == 0 || count > MultiviewRenderer::maxViews) {
+        throw std::runtime_error("multiview supports 1 to " + std::to_string(MultiviewRenderer::maxViews) + " views!");
+    }
+    
+    multiviewCount = count;
+}
+
+void HelloTriangleApplication::runBenchmark(const std::string& name) {
+    if (name != "dispatch" && name != "startup" && name != "pipelines" && name != "specialization" && name != "sprites" &&
+        name != "meshes" && name != "quantization" && name != "lods" &&
+        name != "culling" && name != "transforms" && name != "latency" && name != "resolution" &&
+        name != "post" && name != "profiler" && name != "memory" && name != "multiview") {
+        throw std::runtime_error("unknown benchmark: " + name);
+    }
+    
+    // A stereo pair unless more views were asked for
+    if (name == "multiview") {
+        multiviewCount = std::max(multiviewCount, 2u);
+    }
+    
+    startupTimeline.begin();
+    
     initWindow();
     initVulkan();
-    mainLoop();
+    
+    // Measurements at a resolution of their own choosing would be meaningless, only the resolution benchmark lets it move
+    if (dynamicResolutionEnabled) {
+        dynamicResolution.lockScale(maxRenderScale);
+    }
+    
+    if (name == "dispatch") {
+        benchmarkDispatch();
+    } else if (name == "startup") {
+        benchmarkStartup();
+    } else if (name == "pipelines") {
+        benchmarkPipelines();
+    } else if (name == "specialization") {
+        benchmarkSpecialization();
+    } else if (name == "sprites") {
+        benchmarkSprites();
+    } else if (name == "meshes") {
+        benchmarkMeshes();
+    } else if (name == "quantization") {
+        benchmarkQuantization();
+    } else if (name == "lods") {
+        benchmarkLods();
+    } else if (name == "culling") {
+        benchmarkCulling();
+    } else if (name == "transforms") {
+        benchmarkTransforms();
+    } else if (name == "latency") {
+        benchmarkLatency();
+    } else if (name == "resolution") {
+        benchmarkResolution();
+    } else if (name == "post") {
+        benchmarkPostProcess();
+    } else if (name == "profiler") {
+        benchmarkProfiler();
+    } else if (name == "memory") {
+        benchmarkMemoryBudget();
+    } else if (name == "multiview") {
+        benchmarkMultiview();
+    }
+    
+    deviceTable.vkDeviceWaitIdle(device);
+    writeTrace();
     cleanup();
 }
 
 void HelloTriangleApplication::initWindow() {
+    auto start = StartupTimeline::Clock::now();
+    
     glfwInit();
 
     // GLFW was originally designed to create an  OpenGL context
     // hence, explicitly disable it
     glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+    
+    // Raw video can't change its frame size halfway through
+    if (stream) {
+        glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
+    }
 
     // initialize the window
     window = glfwCreateWindow(WIDTH, HEIGHT, "Vulkan", nullptr, nullptr);
@@ -52,57 +197,195 @@ void HelloTriangleApplication::initWindow() {
     // Register for callback
     glfwSetWindowUserPointer(window, this);
     glfwSetFramebufferSizeCallback(window, framebufferResizeCallback);
+    glfwSetWindowFocusCallback(window, windowFocusCallback);
+    glfwSetWindowIconifyCallback(window, windowIconifyCallback);
+    glfwSetWindowRefreshCallback(window, windowRefreshCallback);
+    glfwSetKeyCallback(window, keyCallback);
+    glfwSetCursorPosCallback(window, cursorPosCallback);
+    glfwSetMouseButtonCallback(window, mouseButtonCallback);
+    glfwSetScrollCallback(window, scrollCallback);
+    
+    startupTimeline.record("initWindow", start, StartupTimeline::Clock::now());
 }
 
 void HelloTriangleApplication::initVulkan() {
-    createInstance();
-    setupDebugMessenger();
-    createSurface();
-    pickPhysicalDevice();
-    createLogicalDevice();
-    createSwapChain();
-    createImageViews();
-    createRenderPass();
-    createGraphicsPipeline();
-    createFramebuffers();
-    createCommandPool();
-    createCommandBuffer();
-    createSyncObjects();
+    Profiler::setEnabled(enableProfiler);
+    Profiler::setThreadName("main");
+    
+    // Deferred tasks run on the thread calling get(), which gives the plain sequential startup to compare against
+    const std::launch policy = parallelStartup ? std::launch::async : std::launch::deferred;
+    
+    startupTimeline.step("createInstance", [this] { createInstance(); });
+    startupTimeline.step("setupDebugMessenger", [this] { setupDebugMessenger(); });
+    startupTimeline.step("createSurface", [this] { createSurface(); });
+    startupTimeline.step("pickPhysicalDevice", [this] { pickPhysicalDevice(); });
+    startupTimeline.step("createLogicalDevice", [this] { createLogicalDevice(); });
+    
+    // The render pass only needs the surface format, which is known before the swap chain exists.
+    // So the graphics pipeline can be compiled against it on a worker while the swap chain is created
+    startupTimeline.step("chooseSwapSurfaceFormat", [this] {
+        swapChainImageFormat = chooseSwapSurfaceFormat(querySwapChainSupport(physicalDevice).formats).format;
+        sceneColorFormat = postProcessingEnabled ? PostProcessChain::sceneFormat : swapChainImageFormat;
+    });
+    startupTimeline.step("findDepthFormat", [this] { depthFormat = findDepthFormat(); });
+    startupTimeline.step("createRenderPass", [this] { createRenderPass(); });
+    // The pipeline layout is created with the camera's descriptor set layout
+    startupTimeline.step("createCameraUniforms", [this] { createCameraUniforms(); });
+    
+    // The SPIR-V is embedded in the executable, nothing has to be loaded first
+    auto pipelineReady = std::async(policy, [this] {
+        startupTimeline.step("createGraphicsPipeline", [this] { createGraphicsPipeline(); });
+    });
+    
+    startupTimeline.step("createSwapChain", [this] { createSwapChain(); });
+    startupTimeline.step("createImageViews", [this] { createImageViews(); });
+    if (dynamicResolutionEnabled) {
+        startupTimeline.step("createDynamicResolution", [this] { createDynamicResolution(); });
+    }
+    if (postProcessingEnabled) {
+        startupTimeline.step("createPostProcessChain", [this] { createPostProcessChain(); });
+    }
+    startupTimeline.step("createDepthResources", [this] { createDepthResources(); });
+    startupTimeline.step("createFramebuffers", [this] { createFramebuffers(); });
+    startupTimeline.step("createCommandPool", [this] { createCommandPool(); });
+    startupTimeline.step("createCommandBuffer", [this] { createCommandBuffer(); });
+    if (enableProfiler) {
+        startupTimeline.step("createGpuProfiler", [this] { createGpuProfiler(); });
+    }
+    startupTimeline.step("createSyncObjects", [this] { createSyncObjects(); });
+    
+    if (collectGpuFrameStats) {
+        startupTimeline.step("createGpuFrameStats", [this] { createGpuFrameStats(); });
+    }
+    
+    if (measureInputLatency) {
+        latencyTracker.init(device, &deviceTable);
+    }
+    
+    if (capture || stream) {
+        startupTimeline.step("createFrameReadback", [this] { createFrameReadback(); });
+    }
+    
+    startupTimeline.step("waitForGraphicsPipeline", [&pipelineReady] { pipelineReady.get(); });
+    
+    // Their pipeline variants are derived from the triangle's
+    if (windowCount > 1) {
+        startupTimeline.step("createWindowViews", [this] { createWindowViews(); });
+    }
+    if (multiviewCount > 1) {
+        startupTimeline.step("createMultiview", [this] { createMultiview(); });
+    }
 }
 
 void HelloTriangleApplication::mainLoop() {
+    framePacer.configure(framePacingMode, targetFrameRate, backgroundFrameRate);
+    
     while (!glfwWindowShouldClose(window)) {
-        glfwPollEvents();
-        drawFrame();
+        // Pumps the events, and blocks or sleeps when the window is idle, throttled or limited
+        bool draw;
+        {
+            PROFILE_ZONE("frame pacing");
+            draw = framePacer.beginFrame(window);
+        }
+        if (draw) {
+            drawFrame();
+        }
+        
+        // Closing a view only closes its own window
+        for (auto& view : views) {
+            if (view->isInitialized() && view->shouldClose()) {
+                deviceTable.vkDeviceWaitIdle(device);
+                view->destroy();
+            }
+        }
+        
+        if (stream && frameStreamer.failed()) {
+            glfwSetWindowShouldClose(window, GLFW_TRUE);
+        }
+        
+        if (capture) {
+            // Keep drawing until the captured frame is read back, even in on-demand mode
+            if (captureDone) {
+                glfwSetWindowShouldClose(window, GLFW_TRUE);
+            } else {
+                framePacer.requestRedraw();
+            }
+        }
     }
     
-    vkDeviceWaitIdle(device);
+    deviceTable.vkDeviceWaitIdle(device);
+    writeTrace();
+    
+    framePacer.printReport(std::cout);
+    gpuFrameStats.printReport(std::cout);
+    dynamicResolution.printReport(std::cout);
+    postProcess.printReport(std::cout, computeQueue != VK_NULL_HANDLE ? "async compute queue" : "graphics queue");
+    latencyTracker.printReport(std::cout, lateLatchCamera ? "late latched camera" : "camera sampled before recording");
+    Profiler::printReport(std::cout, Profiler::collectZones(), "CPU");
+    gpuProfiler.printReport(std::cout, "graphics queue");
+    computeProfiler.printReport(std::cout, "async compute queue");
+    memoryBudget.printReport(std::cout);
 }
 
 void HelloTriangleApplication::cleanup() {
+    // Consumes the copies still in flight, the device is idle by now
+    frameReadback.destroy();
+    
+    // Its watcher waits on the frame fences
+    latencyTracker.destroy();
+    
     cleanupSwapChain();
+    for (auto& view : views) {
+        view->destroy();
+    }
 
     for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
     {
-        vkDestroySemaphore(device, imageAvailableSemaphores[i], nullptr);
-        vkDestroySemaphore(device, renderFinishedSemaphores[i], nullptr);
-        vkDestroyFence(device, inFlightFences[i], nullptr);
+        deviceTable.vkDestroySemaphore(device, imageAvailableSemaphores[i], allocator);
+        deviceTable.vkDestroySemaphore(device, renderFinishedSemaphores[i], allocator);
+        deviceTable.vkDestroyFence(device, inFlightFences[i], allocator);
+    }
+    for (size_t i = 0; i < sceneFinishedSemaphores.size(); i++) {
+        deviceTable.vkDestroySemaphore(device, sceneFinishedSemaphores[i], allocator);
+        deviceTable.vkDestroySemaphore(device, postFinishedSemaphores[i], allocator);
     }
     
-    vkDestroyCommandPool(device, commandPool, nullptr);
+    deviceTable.vkDestroyCommandPool(device, commandPool, allocator);
+    if (computeCommandPool != VK_NULL_HANDLE) {
+        deviceTable.vkDestroyCommandPool(device, computeCommandPool, allocator);
+    }
+    
+    gpuFrameStats.destroy();
+    gpuProfiler.destroy();
+    computeProfiler.destroy();
+    cameraUniforms.destroy();
+    if (multiview.isInitialized()) {
+        multiviewTriangle.destroy();
+        multiview.destroy();
+    }
+    postProcess.destroy();
+    dynamicResolution.destroy();
     
-    vkDestroyPipeline(device, graphicsPipeline, nullptr);
-    vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
-    vkDestroyRenderPass(device, renderPass, nullptr);
+    pipelineManager.printStats(std::cout);
+    pipelineManager.destroy();
+    deviceTable.vkDestroyPipelineLayout(device, pipelineLayout, allocator);
+    deviceTable.vkDestroyRenderPass(device, renderPass, allocator);
     
-    vkDestroyDevice(device, nullptr);
-    vkDestroySurfaceKHR(instance, surface, nullptr);
+    memoryBudget.destroy();
+    deviceTable.vkDestroyDevice(device, allocator);
+    instanceTable.vkDestroySurfaceKHR(instance, surface, allocator);
     
     if (enableValidationLayers) {
-        DestroyDebugUtilsMessengerEXT(instance, debugMessenger, nullptr);
+        instanceTable.vkDestroyDebugUtilsMessengerEXT(instance, debugMessenger, allocator);
     }
     
-    vkDestroyInstance(instance, nullptr);
+    instanceTable.vkDestroyInstance(instance, allocator);
+    
+    validationLogger.stop();
+    
+    if (trackHostAllocations) {
+        hostAllocator.printReport(std::cout);
+    }
     
     glfwDestroyWindow(window);
     
@@ -117,6 +400,11 @@ void HelloTriangleApplication::createInstance() {
         throw std::runtime_error("validation layers requested, but not available!");
     }
     
+    // Has to be running before vkCreateInstance since instance creation is already reported through it
+    if (enableValidationLayers) {
+        validationLogger.start(mutedValidationMessageIds);
+    }
+    
     // optional but provide some information to driver in order to optimize our specific application
     VkApplicationInfo appInfo{};
     appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
@@ -124,7 +412,8 @@ void HelloTriangleApplication::createInstance() {
     appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
     appInfo.pEngineName = "No Engine";
     appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-    appInfo.apiVersion = VK_API_VERSION_1_0;
+    // 1.1 for the subgroup operations of post processing, devices without it still work without post processing
+    appInfo.apiVersion = VK_API_VERSION_1_1;
     
     // tells Vulkan  driver which global extensions and validation layers we want to use
     VkInstanceCreateInfo createInfo{};
@@ -154,10 +443,13 @@ void HelloTriangleApplication::createInstance() {
 #endif // !WIN
     
     // create instance
-    if (vkCreateInstance(&createInfo, nullptr, &instance) != VK_SUCCESS) {
+    if (vkCreateInstance(&createInfo, allocator, &instance) != VK_SUCCESS) {
         throw std::runtime_error("Failed to create instance!");
     }
     
+    // Load every instance level function once, instead of going through the loader on each call
+    instanceTable.load(instance);
+    
     checkRequiredExtensionSupport(extensions);
 }
 
@@ -166,29 +458,29 @@ void HelloTriangleApplication::setupDebugMessenger() {
     
     VkDebugUtilsMessengerCreateInfoEXT createInfo{};
     populateDebugMessengerCreateInfo(createInfo);
-    createInfo.pUserData = nullptr; // Optional
     
-    if (CreateDebugUtilsMessengerEXT(instance, &createInfo, nullptr, &debugMessenger) != VK_SUCCESS) {
+    if (instanceTable.vkCreateDebugUtilsMessengerEXT == nullptr ||
+        instanceTable.vkCreateDebugUtilsMessengerEXT(instance, &createInfo, allocator, &debugMessenger) != VK_SUCCESS) {
         throw std::runtime_error("failed to set up debug messenger!");
     }
 }
 
 void HelloTriangleApplication::createSurface() {
-    if (glfwCreateWindowSurface(instance, window, nullptr, &surface) != VK_SUCCESS) {
+    if (glfwCreateWindowSurface(instance, window, allocator, &surface) != VK_SUCCESS) {
         throw std::runtime_error("failed to create window surface!");
     }
 }
 
 void HelloTriangleApplication::pickPhysicalDevice(){
     uint32_t deviceCount = 0;
-    vkEnumeratePhysicalDevices(instance, &deviceCount, nullptr);
+    instanceTable.vkEnumeratePhysicalDevices(instance, &deviceCount, nullptr);
     
     if (deviceCount == 0) {
         throw std::runtime_error("failed to find GPUs with Vulkan support!");
     }
     
     std::vector<VkPhysicalDevice> devices(deviceCount);
-    vkEnumeratePhysicalDevices(instance, &deviceCount, devices.data());
+    instanceTable.vkEnumeratePhysicalDevices(instance, &deviceCount, devices.data());
     
     for (const auto& device : devices) {
         if (isDeviceSuitable(device)) {
@@ -200,13 +492,30 @@ void HelloTriangleApplication::pickPhysicalDevice(){
     if (physicalDevice == VK_NULL_HANDLE) {
         throw std::runtime_error("failed to find a suitable GPU!");
     }
+    
+    instanceTable.vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
 }
 
 void HelloTriangleApplication::createLogicalDevice() {
-    QueueFamilyIndices indices = findQueueFamilies(physicalDevice);
+    queueFamilies = findQueueFamilies(physicalDevice);
+    const QueueFamilyIndices& indices = queueFamilies;
+    
+    // Without blits into the swap chain the frame is rendered straight into it, at the full resolution
+    const SwapChainSupportDetails swapChainSupport = querySwapChainSupport(physicalDevice);
+    const VkFormat outputFormat = chooseSwapSurfaceFormat(swapChainSupport.formats).format;
+    const bool blitToSwapChain = (swapChainSupport.capabilities.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_DST_BIT) != 0;
+    dynamicResolutionEnabled = enableDynamicResolution && blitToSwapChain &&
+                               DynamicResolution::isSupported(physicalDevice, instanceTable, outputFormat, outputFormat);
+    
+    // Post processing is left out on devices that can't run it, and only gets a queue of its own when there is a compute only family
+    postProcessingEnabled = enablePostProcessing && dynamicResolutionEnabled && PostProcessChain::isSupported(physicalDevice, instanceTable);
+    const bool asyncCompute = postProcessingEnabled && useAsyncCompute && indices.computeFamily.has_value();
     
     std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
     std::set<uint32_t> uniqueQueueFamilies = {indices.graphicsFamily.value(), indices.presentFamily.value()};
+    if (asyncCompute) {
+        uniqueQueueFamilies.insert(indices.computeFamily.value());
+    }
     
     for (uint32_t queueFamily : uniqueQueueFamilies) {
         VkDeviceQueueCreateInfo queueCreateInfo{};
@@ -226,16 +535,100 @@ void HelloTriangleApplication::createLogicalDevice() {
     
     VkPhysicalDeviceFeatures deviceFeatures{};
     
+    // Query support for GpuFrameStats, features that aren't supported leave their queries out
+    VkPhysicalDeviceFeatures supportedFeatures;
+    instanceTable.vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+    VkPhysicalDeviceProperties deviceProperties;
+    instanceTable.vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+    
+    uint32_t queueFamilyCount = 0;
+    instanceTable.vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> familyProperties(queueFamilyCount);
+    instanceTable.vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, familyProperties.data());
+    
+    gpuQuerySupport.timestampValidBits = familyProperties[indices.graphicsFamily.value()].timestampValidBits;
+    if (asyncCompute) {
+        computeTimestampValidBits = familyProperties[indices.computeFamily.value()].timestampValidBits;
+    }
+    gpuQuerySupport.timestampPeriod = deviceProperties.limits.timestampPeriod;
+    gpuQuerySupport.pipelineStatistics = supportedFeatures.pipelineStatisticsQuery == VK_TRUE;
+    gpuQuerySupport.preciseOcclusion = supportedFeatures.occlusionQueryPrecise == VK_TRUE;
+    
+    if (collectGpuFrameStats) {
+        deviceFeatures.pipelineStatisticsQuery = supportedFeatures.pipelineStatisticsQuery;
+        deviceFeatures.occlusionQueryPrecise = supportedFeatures.occlusionQueryPrecise;
+    }
+    
+    // Optional extensions are enabled when the device supports them, their feature structs are chained into pNext
+    std::vector<const char*> enabledExtensions = deviceExtensions;
+    void* featureChain = nullptr;
+    
+    VkPhysicalDeviceGraphicsPipelineLibraryFeaturesEXT pipelineLibraryFeatures{};
+    pipelineLibraryFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_FEATURES_EXT;
+    
+    if (useGraphicsPipelineLibrary
+        && checkOptionalDeviceExtensionSupport(physicalDevice, VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME)
+        && checkOptionalDeviceExtensionSupport(physicalDevice, VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME)) {
+        VkPhysicalDeviceFeatures2 features{};
+        features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        features.pNext = &pipelineLibraryFeatures;
+        instanceTable.vkGetPhysicalDeviceFeatures2KHR(physicalDevice, &features);
+        
+        // Without fast linking a link costs about as much as a full pipeline, and there is nothing to gain
+        VkPhysicalDeviceGraphicsPipelineLibraryPropertiesEXT pipelineLibraryProperties{};
+        pipelineLibraryProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_PROPERTIES_EXT;
+        VkPhysicalDeviceProperties2 properties{};
+        properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+        properties.pNext = &pipelineLibraryProperties;
+        instanceTable.vkGetPhysicalDeviceProperties2KHR(physicalDevice, &properties);
+        
+        graphicsPipelineLibrarySupported = pipelineLibraryFeatures.graphicsPipelineLibrary == VK_TRUE
+            && pipelineLibraryProperties.graphicsPipelineLibraryFastLinking == VK_TRUE;
+    }
+    
+    if (graphicsPipelineLibrarySupported) {
+        enabledExtensions.push_back(VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME);
+        enabledExtensions.push_back(VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME);
+        pipelineLibraryFeatures.pNext = featureChain;
+        featureChain = &pipelineLibraryFeatures;
+    }
+    
+    // Puts the GPU profiling zones on the CPU clock
+    if (enableProfiler
+        && checkOptionalDeviceExtensionSupport(physicalDevice, VK_EXT_CALIBRATED_TIMESTAMPS_EXTENSION_NAME)
+        && GpuProfiler::supportsCalibration(physicalDevice, instanceTable)) {
+        calibratedTimestampsSupported = true;
+        enabledExtensions.push_back(VK_EXT_CALIBRATED_TIMESTAMPS_EXTENSION_NAME);
+    }
+    
+    // The driver's budget and usage of every heap, otherwise MemoryBudget falls back to the heap sizes and its own count
+    if (trackMemoryBudget && checkOptionalDeviceExtensionSupport(physicalDevice, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME)) {
+        memoryBudgetSupported = true;
+        enabledExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+    }
+    
+    // Core in Vulkan 1.1, the feature still has to be enabled. Without it the layers are rendered one pass at a time
+    VkPhysicalDeviceMultiviewFeatures multiviewFeatures{};
+    multiviewFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MULTIVIEW_FEATURES;
+    
+    if (multiviewCount > 1 && useMultiview && MultiviewRenderer::isSupported(physicalDevice, instanceTable, multiviewCount)) {
+        multiviewSupported = true;
+        multiviewFeatures.multiview = VK_TRUE;
+        multiviewFeatures.pNext = featureChain;
+        featureChain = &multiviewFeatures;
+    }
+    
     VkDeviceCreateInfo createInfo{};
     createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+    createInfo.pNext = featureChain;
     
     createInfo.pQueueCreateInfos = &queueCreateInfo;
     createInfo.queueCreateInfoCount = 1;
     
     createInfo.pEnabledFeatures = &deviceFeatures;
     
-    createInfo.ppEnabledExtensionNames = deviceExtensions.data();
-    createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
+    createInfo.ppEnabledExtensionNames = enabledExtensions.data();
+    createInfo.enabledExtensionCount = static_cast<uint32_t>(enabledExtensions.size());
     
     if (enableValidationLayers) {
         createInfo.enabledLayerCount = static_cast<uint32_t>(validationLayers.size());
@@ -248,12 +641,30 @@ void HelloTriangleApplication::createLogicalDevice() {
     createInfo.pQueueCreateInfos = queueCreateInfos.data();
     
     // create logical device
-    if (vkCreateDevice(physicalDevice, &createInfo, nullptr, &device) != VK_SUCCESS) {
+    if (instanceTable.vkCreateDevice(physicalDevice, &createInfo, allocator, &device) != VK_SUCCESS) {
         throw std::runtime_error("failed to create logical device!");
     }
     
-    vkGetDeviceQueue(device, indices.graphicsFamily.value(), 0, &graphicsQueue);
-    vkGetDeviceQueue(device, indices.presentFamily.value(), 0, &presentQueue);
+    // Device functions straight from the driver (or the first enabled layer), skipping the loader trampoline
+    deviceTable.load(instanceTable, device);
+    
+    // Before anything is allocated, so every allocation is counted
+    if (trackMemoryBudget) {
+        MemoryBudgetSettings budgetSettings;
+        budgetSettings.highWatermark = memoryBudgetHighWatermark;
+        budgetSettings.lowWatermark = memoryBudgetLowWatermark;
+        // Evicted memory is released once the frames in flight are done with it
+        budgetSettings.cooldownFrames = MAX_FRAMES_IN_FLIGHT + 1;
+        budgetSettings.simulatedBudget = simulatedMemoryBudget;
+        memoryBudget.init(physicalDevice, instanceTable, memoryBudgetSupported, budgetSettings);
+        memoryBudget.trackAllocations(deviceTable);
+    }
+    
+    deviceTable.vkGetDeviceQueue(device, indices.graphicsFamily.value(), 0, &graphicsQueue);
+    deviceTable.vkGetDeviceQueue(device, indices.presentFamily.value(), 0, &presentQueue);
+    if (asyncCompute) {
+        deviceTable.vkGetDeviceQueue(device, indices.computeFamily.value(), 0, &computeQueue);
+    }
 }
 
 void HelloTriangleApplication::createSwapChain() {
@@ -280,11 +691,23 @@ void HelloTriangleApplication::createSwapChain() {
     createInfo.imageArrayLayers = 1;    // Always 1 unless developing stereoscopic 3D application
     createInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;    // For different kinds of operations
     
+    // With dynamic resolution the frame is blitted into the swap chain image instead of rendered into it
+    if (dynamicResolutionEnabled) {
+        createInfo.imageUsage |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    }
+    
+    // Captured and streamed frames are copied out of the swap chain image
+    if (capture || stream) {
+        if (!(swapChainSupport.capabilities.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_SRC_BIT)) {
+            throw std::runtime_error("swap chain images can't be copied for readback!");
+        }
+        createInfo.imageUsage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    }
+    
     // Ownership exchange between different queue families
-    QueueFamilyIndices indices = findQueueFamilies(physicalDevice);
-    uint32_t queueFamilyIndices[] = {indices.graphicsFamily.value(), indices.presentFamily.value()};
+    uint32_t queueFamilyIndices[] = {queueFamilies.graphicsFamily.value(), queueFamilies.presentFamily.value()};
 
-    if (indices.graphicsFamily != indices.presentFamily) {
+    if (queueFamilies.graphicsFamily != queueFamilies.presentFamily) {
         createInfo.imageSharingMode = VK_SHARING_MODE_CONCURRENT;
         createInfo.queueFamilyIndexCount = 2;
         createInfo.pQueueFamilyIndices = queueFamilyIndices;
@@ -306,14 +729,14 @@ void HelloTriangleApplication::createSwapChain() {
     createInfo.oldSwapchain = VK_NULL_HANDLE;
     
     // Create swap chain
-    if (vkCreateSwapchainKHR(device, &createInfo, nullptr, &swapChain) != VK_SUCCESS) {
+    if (deviceTable.vkCreateSwapchainKHR(device, &createInfo, allocator, &swapChain) != VK_SUCCESS) {
         throw std::runtime_error("failed to create swap chain!");
     }
     
     // Retrieve swap chain image handles
-    vkGetSwapchainImagesKHR(device, swapChain, &imageCount, nullptr);
+    deviceTable.vkGetSwapchainImagesKHR(device, swapChain, &imageCount, nullptr);
     swapChainImages.resize(imageCount);
-    vkGetSwapchainImagesKHR(device, swapChain, &imageCount, swapChainImages.data());
+    deviceTable.vkGetSwapchainImagesKHR(device, swapChain, &imageCount, swapChainImages.data());
     
     swapChainImageFormat = surfaceFormat.format;
     swapChainExtent = extent;
@@ -341,17 +764,67 @@ void HelloTriangleApplication::createImageViews() {
         createInfo.subresourceRange.baseArrayLayer = 0;
         createInfo.subresourceRange.layerCount = 1;
         
-        if (vkCreateImageView(device, &createInfo, nullptr, &swapChainImageViews[i]) != VK_SUCCESS) {
+        if (deviceTable.vkCreateImageView(device, &createInfo, allocator, &swapChainImageViews[i]) != VK_SUCCESS) {
             throw std::runtime_error("failed to create image views!");
         }
 
     }
 }
 
+void HelloTriangleApplication::createDepthResources() {
+    // Only the render pass uses the depth buffer, a single image is enough for every frame in flight
+    // since the render passes of consecutive frames run one after another on the graphics queue
+    VkImageCreateInfo imageInfo{};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.format = depthFormat;
+    const VkExtent2D extent = dynamicResolutionEnabled ? dynamicResolution.targetExtent(swapChainExtent) : swapChainExtent;
+    imageInfo.extent = {extent.width, extent.height, 1};
+    imageInfo.mipLevels = 1;
+    imageInfo.arrayLayers = 1;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    
+    if (deviceTable.vkCreateImage(device, &imageInfo, allocator, &depthImage) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create depth image!");
+    }
+    
+    VkMemoryRequirements memoryRequirements;
+    deviceTable.vkGetImageMemoryRequirements(device, depthImage, &memoryRequirements);
+    
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = memoryRequirements.size;
+    allocInfo.memoryTypeIndex = findMemoryType(memoryProperties, memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    
+    if (deviceTable.vkAllocateMemory(device, &allocInfo, allocator, &depthImageMemory) != VK_SUCCESS) {
+        throw std::runtime_error("failed to allocate depth image memory!");
+    }
+    deviceTable.vkBindImageMemory(device, depthImage, depthImageMemory, 0);
+    
+    VkImageViewCreateInfo viewInfo{};
+    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image = depthImage;
+    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.format = depthFormat;
+    viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+    viewInfo.subresourceRange.baseMipLevel = 0;
+    viewInfo.subresourceRange.levelCount = 1;
+    viewInfo.subresourceRange.baseArrayLayer = 0;
+    viewInfo.subresourceRange.layerCount = 1;
+    
+    if (deviceTable.vkCreateImageView(device, &viewInfo, allocator, &depthImageView) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create depth image view!");
+    }
+}
+
 void HelloTriangleApplication::createRenderPass() {
     // Attachment Description
     VkAttachmentDescription colorAttachment{};
-    colorAttachment.format = swapChainImageFormat;
+    colorAttachment.format = sceneColorFormat;
     colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
     
     // Clear the contents(color and depth data) and store the new contents in memory
@@ -366,18 +839,42 @@ void HelloTriangleApplication::createRenderPass() {
     colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
     // Use the image from the swap chain when it isready
     colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    // The offscreen target of dynamic resolution is blitted from afterwards
+    if (dynamicResolutionEnabled) {
+        colorAttachment.finalLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    }
+    // Post processing reads and writes it in compute shaders first, and moves it on to TRANSFER_SRC_OPTIMAL itself
+    if (postProcessingEnabled) {
+        colorAttachment.finalLayout = VK_IMAGE_LAYOUT_GENERAL;
+    }
+    
+    // Reversed Z: cleared to 0, the far end of the depth range. Nothing reads it after the render pass
+    VkAttachmentDescription depthAttachment{};
+    depthAttachment.format = depthFormat;
+    depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+    depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
     
     // Subpass and attachment references
     VkAttachmentReference colorAttachmentRef{};
     // Use the element which is in index 0 of attachment description
     colorAttachmentRef.attachment = 0;
     colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    
+    VkAttachmentReference depthAttachmentRef{};
+    depthAttachmentRef.attachment = 1;
+    depthAttachmentRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
 
     VkSubpassDescription subpass{};
     subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
     
     subpass.colorAttachmentCount = 1;
     subpass.pColorAttachments = &colorAttachmentRef;
+    subpass.pDepthStencilAttachment = &depthAttachmentRef;
     
     // Eventhough there are only one subpass right now,
     // but the operations right before and right after this subpass also count as implicit subpasses
@@ -386,23 +883,42 @@ void HelloTriangleApplication::createRenderPass() {
     dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
     dependency.dstSubpass = 0;
     
-    dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    dependency.srcAccessMask = 0;
+    // The depth image is shared by the frames in flight, the clear of the next frame waits for the depth tests of the previous one.
+    // So is the offscreen target of dynamic resolution, which the previous frame's blit reads
+    dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT;
+    dependency.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    
+    dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+    dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    
+    // The blit of dynamic resolution reads the color attachment right after the render pass
+    VkSubpassDependency blitDependency{};
+    blitDependency.srcSubpass = 0;
+    blitDependency.dstSubpass = VK_SUBPASS_EXTERNAL;
+    blitDependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    blitDependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    blitDependency.dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+    blitDependency.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    // Or the post processing, when it comes in between
+    if (postProcessingEnabled) {
+        blitDependency.dstStageMask |= VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+        blitDependency.dstAccessMask |= VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    }
     
-    dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    std::array<VkAttachmentDescription, 2> attachments = {colorAttachment, depthAttachment};
+    std::array<VkSubpassDependency, 2> dependencies = {dependency, blitDependency};
     
     VkRenderPassCreateInfo renderPassInfo{};
     renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-    renderPassInfo.attachmentCount = 1;
-    renderPassInfo.pAttachments = &colorAttachment;
+    renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+    renderPassInfo.pAttachments = attachments.data();
     renderPassInfo.subpassCount = 1;
     renderPassInfo.pSubpasses = &subpass;
     
-    renderPassInfo.dependencyCount = 1;
-    renderPassInfo.pDependencies = &dependency;
+    renderPassInfo.dependencyCount = dynamicResolutionEnabled ? 2 : 1;
+    renderPassInfo.pDependencies = dependencies.data();
 
-    if (vkCreateRenderPass(device, &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS) {
+    if (deviceTable.vkCreateRenderPass(device, &renderPassInfo, allocator, &renderPass) != VK_SUCCESS) {
         throw std::runtime_error("failed to create render pass!");
     }
     
@@ -410,201 +926,97 @@ void HelloTriangleApplication::createRenderPass() {
 }
 
 void HelloTriangleApplication::createGraphicsPipeline() {
-#ifdef WIN
-    auto vertShaderCode = readFile("D://Learning//Vulkan//shaders//win//vert.spv");
-    auto fragShaderCode = readFile("D://Learning//Vulkan//shaders//win//frag.spv");
-#else
-    auto vertShaderCode = readFile("/Users/lingadan/Code/Practice/Vulkan/shaders/vert.spv");
-    auto fragShaderCode = readFile("/Users/lingadan/Code/Practice/Vulkan/shaders/frag.spv");
-#endif // WIN
-    
-    VkShaderModule vertShaderModule = createShaderModule(vertShaderCode);
-    VkShaderModule fragShaderModule = createShaderModule(fragShaderCode);
-    
-    // Vertex shader stage
-    VkPipelineShaderStageCreateInfo vertShaderStageInfo{};
-    vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-    vertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
-    vertShaderStageInfo.module = vertShaderModule;
-    vertShaderStageInfo.pName = "main";
-    
-    // Fragment shader stage
-    VkPipelineShaderStageCreateInfo fragShaderStageInfo{};
-    fragShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-    fragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-    fragShaderStageInfo.module = fragShaderModule;
-    fragShaderStageInfo.pName = "main";
-    
-    // Create an array of shader stages
-    VkPipelineShaderStageCreateInfo shaderStages[] = {vertShaderStageInfo, fragShaderStageInfo};
-    
-    // Vertex Data
-    // Since we are hardcoding the vertex data, fillthis to specify there is no vertex data
-    VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
-    vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-    vertexInputInfo.vertexBindingDescriptionCount = 0;
-    vertexInputInfo.pVertexBindingDescriptions = nullptr; // Optional
-    vertexInputInfo.vertexAttributeDescriptionCount = 0;
-    vertexInputInfo.pVertexAttributeDescriptions = nullptr; // Optional
-    
-    // Input Assembly
-    // Sticking to triangles
-    VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
-    inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-    inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
-    inputAssembly.primitiveRestartEnable = VK_FALSE;
-    
-    // Viewport and Scissors
-    VkViewport viewport{};
-    viewport.x = 0.0f;
-    viewport.y = 0.0f;
-    viewport.width = (float) swapChainExtent.width;
-    viewport.height = (float) swapChainExtent.height;
-    viewport.minDepth = 0.0f;
-    viewport.maxDepth = 1.0f;
-    
-    VkRect2D scissor{};
-    scissor.offset = {0, 0};
-    scissor.extent = swapChainExtent;
+    // CameraUniformBuffer writes the block the vertex shader reads
+    static_assert(shaders::shaderVert.hasBuffer(0, 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, sizeof(CameraUniforms)),
+                  "shader.vert doesn't match CameraUniforms");
     
-    // Set Viewport and Scissor states as dynamic so that they can be updated at any time
-    std::vector<VkDynamicState> dynamicStates = {
-        VK_DYNAMIC_STATE_VIEWPORT,
-        VK_DYNAMIC_STATE_SCISSOR
-    };
-
-    VkPipelineDynamicStateCreateInfo dynamicState{};
-    dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
-    dynamicState.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
-    dynamicState.pDynamicStates = dynamicStates.data();
-    
-    VkPipelineViewportStateCreateInfo viewportState{};
-    viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
-    viewportState.viewportCount = 1;
-    viewportState.scissorCount = 1;
-    
-    // Rasterizer
-    VkPipelineRasterizationStateCreateInfo rasterizer{};
-    rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
-    rasterizer.depthClampEnable = VK_FALSE;
-    rasterizer.rasterizerDiscardEnable = VK_FALSE;
-    rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
-    rasterizer.lineWidth = 1.0f;
-    rasterizer.depthBiasEnable = VK_FALSE;
-    rasterizer.depthBiasConstantFactor = 0.0f; // Optional
-    rasterizer.depthBiasClamp = 0.0f; // Optional
-    rasterizer.depthBiasSlopeFactor = 0.0f; // Optional
-    
-    // Multisampling - Keep it disabled for now
-    VkPipelineMultisampleStateCreateInfo multisampling{};
-    multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-    multisampling.sampleShadingEnable = VK_FALSE;
-    multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
-    multisampling.minSampleShading = 1.0f; // Optional
-    multisampling.pSampleMask = nullptr; // Optional
-    multisampling.alphaToCoverageEnable = VK_FALSE; // Optional
-    multisampling.alphaToOneEnable = VK_FALSE; // Optional
-    
-    // Color blending
-    VkPipelineColorBlendAttachmentState colorBlendAttachment{};
-    colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-    colorBlendAttachment.blendEnable = VK_TRUE;
-    colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
-    colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
-    colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
-    colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
-    colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
-    colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
-    
-    VkPipelineColorBlendStateCreateInfo colorBlending{};
-    colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
-    colorBlending.logicOpEnable = VK_FALSE;
-    colorBlending.logicOp = VK_LOGIC_OP_COPY; // Optional
-    colorBlending.attachmentCount = 1;
-    colorBlending.pAttachments = &colorBlendAttachment;
-    colorBlending.blendConstants[0] = 0.0f; // Optional
-    colorBlending.blendConstants[1] = 0.0f; // Optional
-    colorBlending.blendConstants[2] = 0.0f; // Optional
-    colorBlending.blendConstants[3] = 0.0f; // Optional
+    pipelineManager.init(device, &deviceTable, allocator, graphicsPipelineLibrarySupported);
     
     // Pipeline layout
     VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
     pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-    pipelineLayoutInfo.setLayoutCount = 0; // Optional
-    pipelineLayoutInfo.pSetLayouts = nullptr; // Optional
+    // Set 0 is the camera
+    VkDescriptorSetLayout cameraSetLayout = cameraUniforms.setLayout();
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &cameraSetLayout;
     pipelineLayoutInfo.pushConstantRangeCount = 0; // Optional
     pipelineLayoutInfo.pPushConstantRanges = nullptr; // Optional
 
-    if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
+    if (deviceTable.vkCreatePipelineLayout(device, &pipelineLayoutInfo, allocator, &pipelineLayout) != VK_SUCCESS) {
         throw std::runtime_error("failed to create pipeline layout!");
     }
     
-    VkGraphicsPipelineCreateInfo pipelineInfo{};
-    pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-    pipelineInfo.stageCount = 2;
-    pipelineInfo.pStages = shaderStages;
-    
-    pipelineInfo.pVertexInputState = &vertexInputInfo;
-    pipelineInfo.pInputAssemblyState = &inputAssembly;
-    pipelineInfo.pViewportState = &viewportState;
-    pipelineInfo.pRasterizationState = &rasterizer;
-    pipelineInfo.pMultisampleState = &multisampling;
-    pipelineInfo.pDepthStencilState = nullptr; // Optional
-    pipelineInfo.pColorBlendState = &colorBlending;
-    pipelineInfo.pDynamicState = &dynamicState;
-    
-    pipelineInfo.layout = pipelineLayout;
-    
-    pipelineInfo.renderPass = renderPass;
-    pipelineInfo.subpass = 0;
-    
-    // Used if we want to derive an pipeline from an existing pipeline
-    pipelineInfo.basePipelineHandle = VK_NULL_HANDLE; // Optional
-    pipelineInfo.basePipelineIndex = -1; // Optional
-    
-    if (vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &graphicsPipeline) != VK_SUCCESS) {
-        throw std::runtime_error("failed to create graphics pipeline!");
-    }
-    
-    // Destroy Vertex and Fragment shaders
-    vkDestroyShaderModule(device, fragShaderModule, nullptr);
-    vkDestroyShaderModule(device, vertShaderModule, nullptr);
+    // The fixed-function setup lives in PipelineManager, only the state which differs per variant is chosen here
+    trianglePipelineState.vertexShader = pipelineManager.addShader(shaders::shaderVert);
+    trianglePipelineState.fragmentShader = pipelineManager.addShader(shaders::shaderFrag);
+    trianglePipelineState.layout = pipelineLayout;
+    trianglePipelineState.renderPass = renderPass;
+    trianglePipelineState.subpass = 0;
+    trianglePipelineState.colorFormat = sceneColorFormat;
+    trianglePipelineState.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    trianglePipelineState.polygonMode = VK_POLYGON_MODE_FILL;
+    trianglePipelineState.cullMode = VK_CULL_MODE_NONE;
+    // The fragment shader always writes alpha 1, blending would only cost bandwidth
+    trianglePipelineState.blendMode = BlendMode::Opaque;
+    // Reversed Z, nearer is greater
+    trianglePipelineState.depthTest = true;
+    trianglePipelineState.depthWrite = true;
+    trianglePipelineState.depthCompareOp = VK_COMPARE_OP_GREATER_OR_EQUAL;
+    
+    // Compile the variant now, so the first frame doesn't have to
+    pipelineManager.getPipeline(trianglePipelineState);
 }
 
 void HelloTriangleApplication::createFramebuffers() {
+    // Every frame renders into the one offscreen target
+    if (dynamicResolutionEnabled) {
+        dynamicResolution.resize(renderPass, swapChainExtent, depthImageView);
+        if (postProcessingEnabled) {
+            postProcess.resize(dynamicResolution.image(), dynamicResolution.imageView(), dynamicResolution.targetExtent(swapChainExtent));
+        }
+        return;
+    }
+    
     swapChainFramebuffers.resize(swapChainImageViews.size());
     
     for (size_t i = 0; i < swapChainImageViews.size(); i++) {
         VkImageView attachments[] = {
-            swapChainImageViews[i]
+            swapChainImageViews[i],
+            depthImageView
         };
         
         VkFramebufferCreateInfo framebufferInfo{};
         framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
         framebufferInfo.renderPass = renderPass;
-        framebufferInfo.attachmentCount = 1;
+        framebufferInfo.attachmentCount = 2;
         framebufferInfo.pAttachments = attachments;
         framebufferInfo.width = swapChainExtent.width;
         framebufferInfo.height = swapChainExtent.height;
         framebufferInfo.layers = 1;
         
-        if (vkCreateFramebuffer(device, &framebufferInfo, nullptr, &swapChainFramebuffers[i]) != VK_SUCCESS) {
+        if (deviceTable.vkCreateFramebuffer(device, &framebufferInfo, allocator, &swapChainFramebuffers[i]) != VK_SUCCESS) {
             throw std::runtime_error("failed to create framebuffer!");
         }
     }
 }
 
 void HelloTriangleApplication::createCommandPool() {
-    QueueFamilyIndices queueFamilyIndices = findQueueFamilies(physicalDevice);
-
     VkCommandPoolCreateInfo poolInfo{};
     poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
     poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
-    poolInfo.queueFamilyIndex = queueFamilyIndices.graphicsFamily.value();
+    poolInfo.queueFamilyIndex = queueFamilies.graphicsFamily.value();
     
-    if (vkCreateCommandPool(device, &poolInfo, nullptr, &commandPool) != VK_SUCCESS) {
+    if (deviceTable.vkCreateCommandPool(device, &poolInfo, allocator, &commandPool) != VK_SUCCESS) {
         throw std::runtime_error("failed to create command pool!");
     }
+    
+    if (computeQueue != VK_NULL_HANDLE) {
+        poolInfo.queueFamilyIndex = queueFamilies.computeFamily.value();
+        
+        if (deviceTable.vkCreateCommandPool(device, &poolInfo, allocator, &computeCommandPool) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create compute command pool!");
+        }
+    }
 }
 
 void HelloTriangleApplication::createCommandBuffer() {
@@ -616,9 +1028,23 @@ void HelloTriangleApplication::createCommandBuffer() {
     allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
     allocInfo.commandBufferCount = static_cast<uint32_t>(commandBuffers.size());
 
-    if (vkAllocateCommandBuffers(device, &allocInfo, commandBuffers.data()) != VK_SUCCESS) {
+    if (deviceTable.vkAllocateCommandBuffers(device, &allocInfo, commandBuffers.data()) != VK_SUCCESS) {
         throw std::runtime_error("failed to allocate command buffers!");
     }
+    
+    if (computeQueue != VK_NULL_HANDLE) {
+        presentCommandBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+        computeCommandBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+        
+        if (deviceTable.vkAllocateCommandBuffers(device, &allocInfo, presentCommandBuffers.data()) != VK_SUCCESS) {
+            throw std::runtime_error("failed to allocate present command buffers!");
+        }
+        
+        allocInfo.commandPool = computeCommandPool;
+        if (deviceTable.vkAllocateCommandBuffers(device, &allocInfo, computeCommandBuffers.data()) != VK_SUCCESS) {
+            throw std::runtime_error("failed to allocate compute command buffers!");
+        }
+    }
 }
 
 void HelloTriangleApplication::createSyncObjects() {
@@ -635,24 +1061,138 @@ void HelloTriangleApplication::createSyncObjects() {
     
     for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
     {
-        if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &imageAvailableSemaphores[i]) != VK_SUCCESS ||
-            vkCreateSemaphore(device, &semaphoreInfo, nullptr, &renderFinishedSemaphores[i]) != VK_SUCCESS ||
-            vkCreateFence(device, &fenceInfo, nullptr, &inFlightFences[i]) != VK_SUCCESS) {
+        if (deviceTable.vkCreateSemaphore(device, &semaphoreInfo, allocator, &imageAvailableSemaphores[i]) != VK_SUCCESS ||
+            deviceTable.vkCreateSemaphore(device, &semaphoreInfo, allocator, &renderFinishedSemaphores[i]) != VK_SUCCESS ||
+            deviceTable.vkCreateFence(device, &fenceInfo, allocator, &inFlightFences[i]) != VK_SUCCESS) {
             throw std::runtime_error("failed to create semaphores and fence!");
         }
     }
+    
+    if (computeQueue != VK_NULL_HANDLE) {
+        sceneFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
+        postFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
+        
+        for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+            if (deviceTable.vkCreateSemaphore(device, &semaphoreInfo, allocator, &sceneFinishedSemaphores[i]) != VK_SUCCESS ||
+                deviceTable.vkCreateSemaphore(device, &semaphoreInfo, allocator, &postFinishedSemaphores[i]) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create async compute semaphores!");
+            }
+        }
+    }
+}
+
+void HelloTriangleApplication::createGpuFrameStats() {
+    gpuFrameStats.init(device, &deviceTable, allocator, gpuQuerySupport, MAX_FRAMES_IN_FLIGHT);
+}
+
+void HelloTriangleApplication::createGpuProfiler() {
+    gpuProfiler.init(device, &deviceTable, allocator, graphicsQueue, 0, commandPool, gpuQuerySupport.timestampValidBits,
+                     gpuQuerySupport.timestampPeriod, MAX_FRAMES_IN_FLIGHT, gpuZonesPerFrame, calibratedTimestampsSupported);
+    if (computeQueue != VK_NULL_HANDLE) {
+        computeProfiler.init(device, &deviceTable, allocator, computeQueue, 1, computeCommandPool, computeTimestampValidBits,
+                             gpuQuerySupport.timestampPeriod, MAX_FRAMES_IN_FLIGHT, gpuZonesPerFrame, calibratedTimestampsSupported);
+    }
+}
+
+void HelloTriangleApplication::createDynamicResolution() {
+    DynamicResolutionSettings settings;
+    settings.minScale = minRenderScale;
+    settings.maxScale = maxRenderScale;
+    settings.targetFrameMs = 1000.0 / (framePacingMode == FramePacingMode::Limited ? targetFrameRate : dynamicResolutionFrameRate);
+    
+    // Post processing samples the target and writes it as a storage image, from the compute family when it has one
+    if (postProcessingEnabled) {
+        settings.extraUsage = PostProcessChain::sceneUsage;
+        if (computeQueue != VK_NULL_HANDLE) {
+            settings.queueFamilies = {queueFamilies.graphicsFamily.value(), queueFamilies.computeFamily.value()};
+        }
+    }
+    
+    dynamicResolution.init(physicalDevice, instanceTable, device, &deviceTable, allocator, sceneColorFormat, swapChainImageFormat, settings);
+}
+
+void HelloTriangleApplication::createPostProcessChain() {
+    PostProcessSettings settings;
+    settings.halfResolution = postProcessHalfResolution;
+    
+    // Timed on the queue it runs on
+    const uint32_t timestampValidBits = collectGpuFrameStats
+        ? (computeQueue != VK_NULL_HANDLE ? computeTimestampValidBits : gpuQuerySupport.timestampValidBits) : 0;
+    
+    postProcess.init(physicalDevice, instanceTable, device, &deviceTable, allocator, timestampValidBits, gpuQuerySupport.timestampPeriod,
+                     MAX_FRAMES_IN_FLIGHT, settings);
+}
+
+void HelloTriangleApplication::createCameraUniforms() {
+    cameraUniforms.init(physicalDevice, instanceTable, device, &deviceTable, allocator, MAX_FRAMES_IN_FLIGHT * windowCount);
+    
+    // Far enough back that the triangle covers about as much of the window as it did in clip space
+    camera.setPosition(glm::vec3(0.0f, 0.0f, 1.75f));
+    cameraInputTime = LatencyTracker::Clock::now();
+    glfwGetCursorPos(window, &lastCursorX, &lastCursorY);
+}
+
+void HelloTriangleApplication::createWindowViews() {
+    const uint32_t viewCount = windowCount - 1;
+    
+    for (uint32_t i = 0; i < viewCount; i++) {
+        auto view = std::make_unique<WindowView>();
+        view->init(instance, instanceTable, physicalDevice, device, &deviceTable, allocator, queueFamilies.graphicsFamily.value(),
+                   queueFamilies.presentFamily.value(), depthFormat, MAX_FRAMES_IN_FLIGHT, "Vulkan view " + std::to_string(i + 1),
+                   static_cast<int>(WIDTH), static_cast<int>(HEIGHT));
+        view->setRedrawCallback([this] { framePacer.requestRedraw(); });
+        
+        // Evenly around the scene, at the distance of the main camera
+        const float angle = glm::two_pi<float>() * static_cast<float>(i + 1) / static_cast<float>(windowCount);
+        view->camera().setPosition(glm::vec3(std::sin(angle), 0.0f, std::cos(angle)) * glm::length(camera.position()));
+        view->camera().setRotation(angle, 0.0f);
+        
+        // Created now rather than while recording the first frame
+        PipelineState viewPipelineState = trianglePipelineState;
+        viewPipelineState.renderPass = view->renderPass();
+        viewPipelineState.colorFormat = view->colorFormat();
+        pipelineManager.getPipeline(viewPipelineState);
+        
+        views.push_back(std::move(view));
+    }
+}
+
+void HelloTriangleApplication::createMultiview() {
+    multiview.init(physicalDevice, instanceTable, device, &deviceTable, allocator, &pipelineManager, sceneColorFormat, depthFormat,
+                   multiviewCount, MAX_FRAMES_IN_FLIGHT, multiviewSupported);
+    multiview.resize(multiviewLayerExtent());
+    
+    // The vertices of shader.vert, facing the camera
+    const float positions[3][3] = {{0.0f, 0.5f, 0.0f}, {0.5f, -0.5f, 0.0f}, {-0.5f, -0.5f, 0.0f}};
+    Mesh triangle;
+    for (uint32_t i = 0; i < 3; i++) {
+        MeshVertex vertex{};
+        std::copy(positions[i], positions[i] + 3, vertex.position);
+        vertex.normal[2] = 1.0f;
+        vertex.color[0] = i == 0 ? 1.0f : 0.0f;
+        vertex.color[1] = i == 1 ? 1.0f : 0.0f;
+        vertex.color[2] = i == 2 ? 1.0f : 0.0f;
+        triangle.vertices.push_back(vertex);
+    }
+    triangle.indices = {0, 1, 2};
+    multiviewTriangle.init(physicalDevice, instanceTable, device, &deviceTable, allocator, graphicsQueue, commandPool, triangle, VertexFormat::Float);
 }
 
 void HelloTriangleApplication::cleanupSwapChain() {
+    deviceTable.vkDestroyImageView(device, depthImageView, allocator);
+    deviceTable.vkDestroyImage(device, depthImage, allocator);
+    deviceTable.vkFreeMemory(device, depthImageMemory, allocator);
+    
     for (auto framebuffer : swapChainFramebuffers) {
-        vkDestroyFramebuffer(device, framebuffer, nullptr);
+        deviceTable.vkDestroyFramebuffer(device, framebuffer, allocator);
     }
+    swapChainFramebuffers.clear();
 
     for (auto imageView : swapChainImageViews) {
-        vkDestroyImageView(device, imageView, nullptr);
+        deviceTable.vkDestroyImageView(device, imageView, allocator);
     }
 
-    vkDestroySwapchainKHR(device, swapChain, nullptr);
+    deviceTable.vkDestroySwapchainKHR(device, swapChain, allocator);
 }
 
 void HelloTriangleApplication::recreateSwapChain() {
@@ -663,13 +1203,25 @@ void HelloTriangleApplication::recreateSwapChain() {
         glfwWaitEvents();
     }
 
-    vkDeviceWaitIdle(device);
+    deviceTable.vkDeviceWaitIdle(device);
+
+    // The frame that hit the out of date swap chain was never shown, in on-demand mode nothing else would redraw it
+    framePacer.requestRedraw();
 
     cleanupSwapChain();
 
     createSwapChain();
     createImageViews();
+    createDepthResources();
     createFramebuffers();
+    
+    if (frameReadback.isInitialized()) {
+        frameReadback.resize(swapChainExtent, swapChainImageFormat);
+    }
+    
+    if (multiview.isInitialized()) {
+        multiview.resize(multiviewLayerExtent());
+    }
 }
 
 void HelloTriangleApplication::recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex) {
@@ -678,102 +1230,358 @@ void HelloTriangleApplication::recordCommandBuffer(VkCommandBuffer commandBuffer
     beginInfo.flags = 0; // Optional
     beginInfo.pInheritanceInfo = nullptr; // Optional
 
-    if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+    if (deviceTable.vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
         throw std::runtime_error("failed to begin recording command buffer!");
     }
     
+    // The scale only changes the area rendered to, the framebuffer stays the same
+    renderExtent = dynamicResolutionEnabled ? dynamicResolution.renderExtent() : swapChainExtent;
+    
+    // The queries wrap the whole render pass
+    if (collectGpuFrameStats) {
+        gpuFrameStats.beginFrame(commandBuffer, currentFrame, frameNumber, renderExtent);
+    }
+    
+    gpuProfiler.beginFrame(commandBuffer, currentFrame);
+    
+    // The layers are rendered first, the render pass composites them
+    if (multiview.isInitialized()) {
+        GpuProfileZone zone(gpuProfiler, commandBuffer, "multiview");
+        if (benchmarkMultiviewDraws) {
+            multiview.record(commandBuffer, currentFrame, benchmarkMultiviewDraws);
+        } else {
+            multiview.record(commandBuffer, currentFrame, [this] { multiview.draw(multiviewTriangle, glm::mat4(1.0f)); });
+        }
+    }
+    
+    gpuProfiler.beginZone(commandBuffer, "render pass");
+    
     // Render pass start
     VkRenderPassBeginInfo renderPassInfo{};
     renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
     renderPassInfo.renderPass = renderPass;
-    renderPassInfo.framebuffer = swapChainFramebuffers[imageIndex];
+    renderPassInfo.framebuffer = dynamicResolutionEnabled ? dynamicResolution.framebuffer() : swapChainFramebuffers[imageIndex];
     
     renderPassInfo.renderArea.offset = {0, 0};
-    renderPassInfo.renderArea.extent = swapChainExtent;
+    renderPassInfo.renderArea.extent = renderExtent;
     
-    VkClearValue clearColor = {{{0.0f, 0.0f, 0.0f, 1.0f}}};
-    renderPassInfo.clearValueCount = 1;
-    renderPassInfo.pClearValues = &clearColor;
+    // Depth is cleared to 0, the infinitely far plane of the reversed Z projection
+    std::array<VkClearValue, 2> clearValues{};
+    clearValues[0].color = {{0.0f, 0.0f, 0.0f, 1.0f}};
+    clearValues[1].depthStencil = {0.0f, 0};
+    renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
+    renderPassInfo.pClearValues = clearValues.data();
     
-    vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-    
-    // Drawing commands
-    
-    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
+    deviceTable.vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
     
     // Setting View port dynamically
     VkViewport viewport{};
     viewport.x = 0.0f;
     viewport.y = 0.0f;
-    viewport.width = static_cast<float>(swapChainExtent.width);
-    viewport.height = static_cast<float>(swapChainExtent.height);
+    viewport.width = static_cast<float>(renderExtent.width);
+    viewport.height = static_cast<float>(renderExtent.height);
     viewport.minDepth = 0.0f;
     viewport.maxDepth = 1.0f;
-    vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+    deviceTable.vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
 
     VkRect2D scissor{};
     scissor.offset = {0, 0};
-    scissor.extent = swapChainExtent;
-    vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+    scissor.extent = renderExtent;
+    deviceTable.vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
     
-    vkCmdDraw(commandBuffer, 3, 1, 0, 0);
+    // Drawing commands
+    if (benchmarkDraws) {
+        benchmarkDraws(commandBuffer);
+    } else if (multiview.isInitialized()) {
+        multiview.composite(commandBuffer, renderPass, sceneColorFormat);
+    } else {
+        // Looked up on every recording, so the optimized link replaces the fast linked variant as soon as it is ready
+        VkPipeline graphicsPipeline = pipelineManager.getPipeline(trianglePipelineState);
+        deviceTable.vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
+        // Only the descriptor set is recorded, the camera in it can still change until the submit
+        cameraUniforms.bind(commandBuffer, pipelineLayout, currentFrame);
+        
+        deviceTable.vkCmdDraw(commandBuffer, 3, 1, 0, 0);
+    }
     
     // Render pass end
-    vkCmdEndRenderPass(commandBuffer);
+    deviceTable.vkCmdEndRenderPass(commandBuffer);
+    gpuProfiler.endZone(commandBuffer);
+    
+    if (postProcessingEnabled) {
+        // The chain times its own stages, the frame stats cover the render pass alone
+        if (collectGpuFrameStats) {
+            gpuFrameStats.endFrame(commandBuffer, currentFrame);
+        }
+        
+        // Without a compute queue everything follows in this command buffer, otherwise recordAsyncCommandBuffers() takes over
+        if (computeQueue == VK_NULL_HANDLE) {
+            gpuProfiler.beginZone(commandBuffer, "post processing");
+            postProcess.record(commandBuffer, currentFrame, renderExtent);
+            gpuProfiler.endZone(commandBuffer);
+            recordPresentation(commandBuffer, imageIndex);
+        }
+    } else {
+        recordPresentation(commandBuffer, imageIndex);
+        
+        if (collectGpuFrameStats) {
+            gpuFrameStats.endFrame(commandBuffer, currentFrame);
+        }
+    }
+    
+    // With async compute this command buffer doesn't wait for the swap chain images, the present command buffer takes the views
+    if (computeQueue == VK_NULL_HANDLE) {
+        recordViews(commandBuffer);
+    }
     
-    if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+    if (deviceTable.vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
         throw std::runtime_error("failed to record command buffer!");
     }
 }
 
-void HelloTriangleApplication::drawFrame() {
-    // Wait for the previous frame to finish
-    vkWaitForFences(device, 1, &inFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
+void HelloTriangleApplication::recordPresentation(VkCommandBuffer commandBuffer, uint32_t imageIndex) {
+    GpuProfileZone zone(gpuProfiler, commandBuffer, "presentation");
     
-    // Acquire an image from the swap chain
-    uint32_t imageIndex;
-    auto result = vkAcquireNextImageKHR(device, swapChain, UINT64_MAX, imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, &imageIndex);
-
-    if (result == VK_ERROR_OUT_OF_DATE_KHR) {
-        recreateSwapChain();
-        return;
-    }
-    else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
-        throw std::runtime_error("failed to acquire swap chain image!");
+    if (dynamicResolutionEnabled) {
+        dynamicResolution.recordUpscale(commandBuffer, swapChainImages[imageIndex]);
     }
-
-    // Reset the fence to the unsignaled state
-    vkResetFences(device, 1, &inFlightFences[currentFrame]);
     
-    // Reset the command buffer
-    vkResetCommandBuffer(commandBuffers[currentFrame], 0);
+    // Retried on the next frames when no readback buffer is free
+    if (capture && !captureRecorded && frameNumber >= capture->frame) {
+        captureRecorded = frameReadback.recordCopy(commandBuffer, swapChainImages[imageIndex], currentFrame, frameNumber);
+    }
+    
+    // A frame without a free buffer is counted as dropped
+    if (stream && !frameStreamer.failed()) {
+        frameReadback.recordCopy(commandBuffer, swapChainImages[imageIndex], currentFrame, frameNumber);
+    }
+}
+
+void HelloTriangleApplication::recordAsyncCommandBuffers(uint32_t imageIndex) {
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    
+    // The scene image is shared concurrently, no ownership transfer between the queue families is needed
+    VkCommandBuffer computeCommandBuffer = computeCommandBuffers[currentFrame];
+    deviceTable.vkResetCommandBuffer(computeCommandBuffer, 0);
+    if (deviceTable.vkBeginCommandBuffer(computeCommandBuffer, &beginInfo) != VK_SUCCESS) {
+        throw std::runtime_error("failed to begin recording compute command buffer!");
+    }
+    computeProfiler.beginFrame(computeCommandBuffer, currentFrame);
+    {
+        GpuProfileZone zone(computeProfiler, computeCommandBuffer, "post processing");
+        postProcess.record(computeCommandBuffer, currentFrame, renderExtent);
+    }
+    if (deviceTable.vkEndCommandBuffer(computeCommandBuffer) != VK_SUCCESS) {
+        throw std::runtime_error("failed to record compute command buffer!");
+    }
+    
+    VkCommandBuffer presentCommandBuffer = presentCommandBuffers[currentFrame];
+    deviceTable.vkResetCommandBuffer(presentCommandBuffer, 0);
+    if (deviceTable.vkBeginCommandBuffer(presentCommandBuffer, &beginInfo) != VK_SUCCESS) {
+        throw std::runtime_error("failed to begin recording present command buffer!");
+    }
+    recordPresentation(presentCommandBuffer, imageIndex);
+    recordViews(presentCommandBuffer);
+    if (deviceTable.vkEndCommandBuffer(presentCommandBuffer) != VK_SUCCESS) {
+        throw std::runtime_error("failed to record present command buffer!");
+    }
+}
+
+void HelloTriangleApplication::recordViews(VkCommandBuffer commandBuffer) {
+    if (views.empty()) return;
+    
+    GpuProfileZone zone(gpuProfiler, commandBuffer, "views");
+    for (size_t i = 0; i < views.size(); i++) {
+        WindowView& view = *views[i];
+        if (!view.isInitialized() || !view.isAcquired()) continue;
+        
+        // The same variant as the main window, against the render pass and format of the view
+        PipelineState viewPipelineState = trianglePipelineState;
+        viewPipelineState.renderPass = view.renderPass();
+        viewPipelineState.colorFormat = view.colorFormat();
+        
+        view.beginRenderPass(commandBuffer);
+        deviceTable.vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineManager.getPipeline(viewPipelineState));
+        cameraUniforms.bind(commandBuffer, pipelineLayout, viewCameraSlot(i, currentFrame));
+        deviceTable.vkCmdDraw(commandBuffer, 3, 1, 0, 0);
+        view.endRenderPass(commandBuffer);
+    }
+}
+
+void HelloTriangleApplication::drawFrame() {
+    PROFILE_ZONE("drawFrame");
+    hostAllocator.nextFrame();
+    
+    // Wait for the previous frame to finish
+    {
+        PROFILE_ZONE("wait for frame fence");
+        deviceTable.vkWaitForFences(device, 1, &inFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
+    }
+    gpuProfiler.collect(currentFrame);
+    computeProfiler.collect(currentFrame);
+    
+    // Streaming systems evict before this frame allocates, and release what they evicted frames ago
+    if (trackMemoryBudget) {
+        memoryBudget.update(frameNumber);
+    }
+    
+    // Its queries are done too, collecting them doesn't wait. The GPU time decides the resolution of the next frames,
+    // the post processing counts towards it since it scales with the rendered pixels as well
+    if (postProcessingEnabled) {
+        postProcess.collect(currentFrame);
+    }
+    if (collectGpuFrameStats && gpuFrameStats.collect(currentFrame) && dynamicResolutionEnabled) {
+        dynamicResolution.update(gpuFrameStats.latest()->gpuMs + postProcess.latestMs(), gpuFrameStats.latest()->pixels);
+    }
+    
+    // The copies recorded with that frame are done as well, hand them to the consumer thread without waiting any further
+    if (frameReadback.isInitialized()) {
+        frameReadback.collect(currentFrame);
+    }
+    
+    // Backpressure: with every buffer still being written, wait for the writer rather than dropping this frame
+    if (stream && stream->backpressure == StreamBackpressure::Block) {
+        frameReadback.waitForFreeBuffer();
+    }
+    
+    // Acquire an image from the swap chain
+    uint32_t imageIndex;
+    VkResult result;
+    {
+        PROFILE_ZONE("acquire");
+        result = deviceTable.vkAcquireNextImageKHR(device, swapChain, UINT64_MAX, imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, &imageIndex);
+    }
+
+    if (result == VK_ERROR_OUT_OF_DATE_KHR) {
+        recreateSwapChain();
+        return;
+    }
+    else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
+        throw std::runtime_error("failed to acquire swap chain image!");
+    }
+    
+    // Views without an image this frame are left out of the submit and the present. A view recreates its own swap chain here
+    if (!views.empty()) {
+        PROFILE_ZONE("acquire views");
+        for (auto& view : views) {
+            if (view->isInitialized()) {
+                view->acquire(currentFrame);
+            }
+        }
+    }
+
+    // The latency watcher may still be waiting on the fence, resetting it has to wait for that
+    if (latencyTracker.isInitialized()) {
+        latencyTracker.release(inFlightFences[currentFrame]);
+    }
+    
+    // Reset the fence to the unsignaled state
+    deviceTable.vkResetFences(device, 1, &inFlightFences[currentFrame]);
+    
+    // The frame's uniforms are free again now that its fence signaled
+    updateCamera(currentFrame);
+    
+    // Reset the command buffer
+    deviceTable.vkResetCommandBuffer(commandBuffers[currentFrame], 0);
     
     // Record the command buffer in the sameindex as acquired swap chain
-    recordCommandBuffer(commandBuffers[currentFrame], imageIndex);
+    {
+        PROFILE_ZONE("record");
+        recordCommandBuffer(commandBuffers[currentFrame], imageIndex);
+        if (computeQueue != VK_NULL_HANDLE) {
+            recordAsyncCommandBuffers(imageIndex);
+        }
+    }
+    frameNumber++;
+    
+    // Late latching: recording took a while, pick up the input that arrived meanwhile.
+    // The uniform memory is coherent, so writes before the submit reach the GPU without a flush
+    if (lateLatchCamera) {
+        glfwPollEvents();
+        updateCamera(currentFrame);
+    }
+    
+    // With async compute the scene doesn't touch the swap chain image, so it needn't wait for it. Post processing on the
+    // compute queue waits for the scene and the presentation submit below for post processing, so with the single
+    // offscreen target the three still run one after another. Only the acquire is off the scene's critical path
+    if (computeQueue != VK_NULL_HANDLE) {
+        VkSubmitInfo sceneSubmit{};
+        sceneSubmit.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        sceneSubmit.commandBufferCount = 1;
+        sceneSubmit.pCommandBuffers = &commandBuffers[currentFrame];
+        sceneSubmit.signalSemaphoreCount = 1;
+        sceneSubmit.pSignalSemaphores = &sceneFinishedSemaphores[currentFrame];
+        
+        if (deviceTable.vkQueueSubmit(graphicsQueue, 1, &sceneSubmit, VK_NULL_HANDLE) != VK_SUCCESS) {
+            throw std::runtime_error("failed to submit scene command buffer!");
+        }
+        
+        const VkPipelineStageFlags computeWaitStage = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+        VkSubmitInfo computeSubmit{};
+        computeSubmit.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        computeSubmit.waitSemaphoreCount = 1;
+        computeSubmit.pWaitSemaphores = &sceneFinishedSemaphores[currentFrame];
+        computeSubmit.pWaitDstStageMask = &computeWaitStage;
+        computeSubmit.commandBufferCount = 1;
+        computeSubmit.pCommandBuffers = &computeCommandBuffers[currentFrame];
+        computeSubmit.signalSemaphoreCount = 1;
+        computeSubmit.pSignalSemaphores = &postFinishedSemaphores[currentFrame];
+        
+        if (deviceTable.vkQueueSubmit(computeQueue, 1, &computeSubmit, VK_NULL_HANDLE) != VK_SUCCESS) {
+            throw std::runtime_error("failed to submit post processing command buffer!");
+        }
+    }
     
     // Submitting the command buffer
     VkSubmitInfo submitInfo{};
     submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
-    // Wait for the image at color attachment time of graphics pipeline
-    VkSemaphore waitSemaphores[] = {imageAvailableSemaphores[currentFrame]};
-    VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-    submitInfo.waitSemaphoreCount = 1;
-    submitInfo.pWaitSemaphores = waitSemaphores;
-    submitInfo.pWaitDstStageMask = waitStages;
+    // Wait for the image at color attachment time of graphics pipeline, and with async compute for the post processing before the blit.
+    // Then for the image of every view that got one, all windows go out with this one submit
+    std::vector<VkSemaphore> waitSemaphores = {imageAvailableSemaphores[currentFrame]};
+    std::vector<VkPipelineStageFlags> waitStages = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
     
     submitInfo.commandBufferCount = 1;
     submitInfo.pCommandBuffers = &commandBuffers[currentFrame];
     
+    if (computeQueue != VK_NULL_HANDLE) {
+        waitSemaphores.push_back(postFinishedSemaphores[currentFrame]);
+        waitStages.push_back(VK_PIPELINE_STAGE_TRANSFER_BIT);
+        submitInfo.pCommandBuffers = &presentCommandBuffers[currentFrame];
+    }
+    
+    // Every swap chain of the present below, the main window's first
+    std::vector<VkSwapchainKHR> presentSwapChains = {swapChain};
+    std::vector<uint32_t> presentImageIndices = {imageIndex};
+    std::vector<WindowView*> presentedViews;
+    for (auto& view : views) {
+        if (view->isInitialized() && view->isAcquired()) {
+            waitSemaphores.push_back(view->imageAvailableSemaphore(currentFrame));
+            waitStages.push_back(VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+            presentSwapChains.push_back(view->swapChain());
+            presentImageIndices.push_back(view->imageIndex());
+            presentedViews.push_back(view.get());
+        }
+    }
+    
+    submitInfo.waitSemaphoreCount = static_cast<uint32_t>(waitSemaphores.size());
+    submitInfo.pWaitSemaphores = waitSemaphores.data();
+    submitInfo.pWaitDstStageMask = waitStages.data();
+    
     // Signal renderFinishedSemaphore semaphore after completing the execution of the command buffer(s)
     VkSemaphore signalSemaphores[] = {renderFinishedSemaphores[currentFrame]};
     submitInfo.signalSemaphoreCount = 1;
     submitInfo.pSignalSemaphores = signalSemaphores;
     
-    if (vkQueueSubmit(graphicsQueue, 1, &submitInfo, inFlightFences[currentFrame]) != VK_SUCCESS) {
+    if (deviceTable.vkQueueSubmit(graphicsQueue, 1, &submitInfo, inFlightFences[currentFrame]) != VK_SUCCESS) {
         throw std::runtime_error("failed to submit draw command buffer!");
     }
     
+    if (latencyTracker.isInitialized()) {
+        latencyTracker.submitted(inFlightFences[currentFrame], cameraInputTime);
+    }
+    
     // Presentation
     VkPresentInfoKHR presentInfo{};
     presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
@@ -781,15 +1589,29 @@ void HelloTriangleApplication::drawFrame() {
     presentInfo.waitSemaphoreCount = 1;
     presentInfo.pWaitSemaphores = signalSemaphores;
     
-    // Specify the swap chain
-    VkSwapchainKHR swapChains[] = {swapChain};
-    presentInfo.swapchainCount = 1;
-    presentInfo.pSwapchains = swapChains;
-    presentInfo.pImageIndices = &imageIndex;
+    // Specify the swap chains, one call presents every window. Each gets a result of its own
+    std::vector<VkResult> presentResults(presentSwapChains.size(), VK_SUCCESS);
+    presentInfo.swapchainCount = static_cast<uint32_t>(presentSwapChains.size());
+    presentInfo.pSwapchains = presentSwapChains.data();
+    presentInfo.pImageIndices = presentImageIndices.data();
+    presentInfo.pResults = presentResults.data();
     
-    presentInfo.pResults = nullptr; // Optional
+    {
+        PROFILE_ZONE("present");
+        result = deviceTable.vkQueuePresentKHR(presentQueue, &presentInfo);
+    }
     
-    result = vkQueuePresentKHR(presentQueue, &presentInfo);
+    // An out of date view only recreates its own swap chain, on its next acquire
+    for (size_t i = 0; i < presentedViews.size(); i++) {
+        presentedViews[i]->presented(presentResults[i + 1]);
+    }
+    if (!presentedViews.empty()) {
+        result = presentResults[0];
+    }
+    
+    if (startupTimeline.markFirstFrame()) {
+        startupTimeline.print(std::cout);
+    }
 
     if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || framebufferResized) {
         framebufferResized = false;
@@ -803,6 +1625,1378 @@ void HelloTriangleApplication::drawFrame() {
     currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
 }
 
+// Camera
+
+void HelloTriangleApplication::updateCamera(uint32_t frame) {
+    PROFILE_ZONE("updateCamera");
+    LatencyTracker::Clock::time_point now = LatencyTracker::Clock::now();
+    const float seconds = std::chrono::duration<float>(now - cameraInputTime).count();
+    cameraInputTime = now;
+    
+    bool moved = false;
+    
+    // Look around while the left mouse button is held
+    double cursorX, cursorY;
+    glfwGetCursorPos(window, &cursorX, &cursorY);
+    const bool lookPressed = glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS;
+    if (lookPressed && looking && (cursorX != lastCursorX || cursorY != lastCursorY)) {
+        camera.rotate(-static_cast<float>(cursorX - lastCursorX) * cameraLookSensitivity,
+                      -static_cast<float>(cursorY - lastCursorY) * cameraLookSensitivity);
+        moved = true;
+    }
+    looking = lookPressed;
+    lastCursorX = cursorX;
+    lastCursorY = cursorY;
+    
+    // WASD moves, Q and E go down and up
+    glm::vec3 direction(0.0f);
+    if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS) direction.x += 1.0f;
+    if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS) direction.x -= 1.0f;
+    if (glfwGetKey(window, GLFW_KEY_E) == GLFW_PRESS) direction.y += 1.0f;
+    if (glfwGetKey(window, GLFW_KEY_Q) == GLFW_PRESS) direction.y -= 1.0f;
+    if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS) direction.z += 1.0f;
+    if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS) direction.z -= 1.0f;
+    if (direction != glm::vec3(0.0f)) {
+        camera.moveLocal(glm::normalize(direction) * cameraMoveSpeed * seconds);
+        moved = true;
+    }
+    
+    // Keys held down don't send events, in on-demand mode the next frame has to be asked for
+    if (moved) {
+        framePacer.requestRedraw();
+    }
+    
+    const float aspect = static_cast<float>(swapChainExtent.width) / static_cast<float>(swapChainExtent.height);
+    cameraUniforms.write(frame, camera.uniforms(aspect));
+    
+    for (size_t i = 0; i < views.size(); i++) {
+        if (views[i]->isInitialized()) {
+            cameraUniforms.write(viewCameraSlot(i, frame), views[i]->camera().uniforms(views[i]->aspect()));
+        }
+    }
+    
+    // Moved along the camera's own x axis, which is the right axis in view space
+    if (multiview.isInitialized()) {
+        const glm::mat4 view = camera.view();
+        const glm::mat4 projection = camera.projection(multiview.layerAspect());
+        const uint32_t viewCount = multiview.viewCount();
+        for (uint32_t i = 0; i < viewCount; i++) {
+            const float offset = multiviewEyeSeparation * (static_cast<float>(i) / static_cast<float>(viewCount - 1) - 0.5f);
+            multiview.setViewProjection(frame, i, projection * glm::translate(glm::mat4(1.0f), glm::vec3(-offset, 0.0f, 0.0f)) * view);
+        }
+    }
+}
+
+// Profiling
+
+void HelloTriangleApplication::writeTrace() {
+    // The device is idle, the last frames can be collected as well
+    for (uint32_t frame = 0; frame < MAX_FRAMES_IN_FLIGHT; frame++) {
+        gpuProfiler.collect(frame);
+        computeProfiler.collect(frame);
+    }
+    
+    if (tracePath.empty()) return;
+    
+    std::ofstream file(tracePath);
+    if (!file) {
+        throw std::runtime_error("failed to open trace file " + tracePath + "!");
+    }
+    // Queue 1 is only profiled with async compute
+    std::vector<TraceZone> gpuZones = gpuProfiler.zones();
+    std::vector<std::string> gpuQueueNames = {"graphics queue"};
+    if (computeQueue != VK_NULL_HANDLE) {
+        const std::vector<TraceZone> computeZones = computeProfiler.zones();
+        gpuZones.insert(gpuZones.end(), computeZones.begin(), computeZones.end());
+        gpuQueueNames.push_back("async compute queue");
+    }
+    Profiler::writeChromeTrace(file, Profiler::collectZones(), gpuZones, gpuQueueNames);
+    std::cout << "Trace written to " << tracePath << "\n";
+}
+
+// Frame capture
+
+void HelloTriangleApplication::createFrameReadback() {
+    if (stream) {
+        frameReadback.init(physicalDevice, instanceTable, device, &deviceTable, allocator, streamBufferCount,
+                           [this](const ReadbackImage& image) { frameStreamer.write(image); });
+    } else {
+        frameReadback.init(physicalDevice, instanceTable, device, &deviceTable, allocator, readbackBufferCount,
+                           [this](const ReadbackImage& image) { consumeCapture(image); });
+    }
+    frameReadback.resize(swapChainExtent, swapChainImageFormat);
+}
+
+void HelloTriangleApplication::consumeCapture(const ReadbackImage& image) {
+    // Runs on the readback consumer thread, the render loop only looks at the results once captureDone is set
+    try {
+        const bool bgra = image.format == VK_FORMAT_B8G8R8A8_UNORM || image.format == VK_FORMAT_B8G8R8A8_SRGB;
+        RgbImage frame = RgbImage::fromRgba(image.pixels, image.width, image.height, image.rowPitch, bgra);
+        
+        if (!capture->outputPath.empty()) {
+            frame.write(capture->outputPath);
+        }
+        if (!capture->goldenPath.empty()) {
+            goldenComparison = frame.compare(RgbImage::readPpm(capture->goldenPath), capture->tolerance);
+        }
+    } catch (const std::exception& e) {
+        captureError = e.what();
+    }
+    
+    captureDone = true;
+}
+
+void HelloTriangleApplication::reportCapture() {
+    if (!captureDone) {
+        throw std::runtime_error("window closed before frame " + std::to_string(capture->frame) + " was captured!");
+    }
+    if (!captureError.empty()) {
+        throw std::runtime_error("frame capture failed: " + captureError);
+    }
+    
+    if (!capture->outputPath.empty()) {
+        std::cout << "Captured frame " << capture->frame << " to " << capture->outputPath << std::endl;
+    }
+    
+    if (goldenComparison) {
+        const ImageComparison& result = *goldenComparison;
+        if (!result.sizeMatches) {
+            throw std::runtime_error("captured frame and golden image " + capture->goldenPath + " differ in size!");
+        }
+        
+        std::cout << "Golden image " << capture->goldenPath << ": " << result.mismatchedPixels << " mismatched pixels, max difference "
+                  << static_cast<int>(result.maxDifference[0]) << "/" << static_cast<int>(result.maxDifference[1]) << "/"
+                  << static_cast<int>(result.maxDifference[2]) << " (tolerance " << static_cast<int>(capture->tolerance[0]) << "/"
+                  << static_cast<int>(capture->tolerance[1]) << "/" << static_cast<int>(capture->tolerance[2]) << ")" << std::endl;
+        
+        if (!result.passed()) {
+            throw std::runtime_error("captured frame doesn't match the golden image!");
+        }
+    }
+}
+
+// Benchmarks
+
+void HelloTriangleApplication::benchmarkDispatch() {
+    // vkCmdSetViewport does next to no work in the driver, so the time per call is mostly the call overhead
+    const uint32_t commandsPerRecording = 1 << 20;
+    const int rounds = 5;
+    
+    VkCommandBuffer commandBuffer = commandBuffers[0];
+    
+    auto record = [&](auto setViewport) {
+        deviceTable.vkResetCommandBuffer(commandBuffer, 0);
+        
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        if (deviceTable.vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+            throw std::runtime_error("failed to begin recording command buffer!");
+        }
+        
+        VkViewport viewport{};
+        viewport.width = static_cast<float>(swapChainExtent.width);
+        viewport.height = static_cast<float>(swapChainExtent.height);
+        viewport.maxDepth = 1.0f;
+        
+        auto start = std::chrono::steady_clock::now();
+        for (uint32_t i = 0; i < commandsPerRecording; i++) {
+            viewport.x = static_cast<float>(i & 1);
+            setViewport(commandBuffer, 0, 1, &viewport);
+        }
+        auto end = std::chrono::steady_clock::now();
+        
+        deviceTable.vkEndCommandBuffer(commandBuffer);
+        
+        return std::chrono::duration<double, std::nano>(end - start).count() / commandsPerRecording;
+    };
+    
+    std::vector<double> trampolineTimes;
+    std::vector<double> dispatchTimes;
+    
+    // Interleave both variants so clock and cache effects hit them equally
+    for (int round = 0; round < rounds; round++) {
+        trampolineTimes.push_back(record([](VkCommandBuffer cmd, uint32_t first, uint32_t count, const VkViewport* pViewports) {
+            vkCmdSetViewport(cmd, first, count, pViewports);
+        }));
+        dispatchTimes.push_back(record([this](VkCommandBuffer cmd, uint32_t first, uint32_t count, const VkViewport* pViewports) {
+            deviceTable.vkCmdSetViewport(cmd, first, count, pViewports);
+        }));
+    }
+    
+    deviceTable.vkResetCommandBuffer(commandBuffer, 0);
+    
+    std::sort(trampolineTimes.begin(), trampolineTimes.end());
+    std::sort(dispatchTimes.begin(), dispatchTimes.end());
+    
+    std::cout << "vkCmdSetViewport x " << commandsPerRecording << ", " << rounds << " rounds (ns per call, min / median)\n";
+    std::cout << "\tloader trampoline: " << trampolineTimes.front() << " / " << trampolineTimes[rounds / 2] << '\n';
+    std::cout << "\tdevice dispatch:   " << dispatchTimes.front() << " / " << dispatchTimes[rounds / 2] << '\n';
+}
+
+void HelloTriangleApplication::benchmarkStartup() {
+    // initVulkan already ran with the timeline recording, so only the first frame is missing
+    while (!startupTimeline.timeToFirstFrameMs().has_value()) {
+        glfwPollEvents();
+        drawFrame();
+    }
+    
+    std::cout << "startup benchmark (" << (parallelStartup ? "parallel" : "sequential") << "): time to first frame "
+              << *startupTimeline.timeToFirstFrameMs() << " ms\n";
+}
+
+void HelloTriangleApplication::benchmarkPipelines() {
+    std::vector<PipelineState> states;
+    for (VkPrimitiveTopology topology : {VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST, VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP}) {
+        for (VkCullModeFlags cullMode : {VK_CULL_MODE_NONE, VK_CULL_MODE_BACK_BIT, VK_CULL_MODE_FRONT_BIT}) {
+            for (VkFrontFace frontFace : {VK_FRONT_FACE_COUNTER_CLOCKWISE, VK_FRONT_FACE_CLOCKWISE}) {
+                for (BlendMode blendMode : {BlendMode::Opaque, BlendMode::AlphaBlend, BlendMode::Additive}) {
+                    PipelineState state = trianglePipelineState;
+                    state.topology = topology;
+                    state.cullMode = cullMode;
+                    state.frontFace = frontFace;
+                    state.blendMode = blendMode;
+                    states.push_back(state);
+                }
+            }
+        }
+    }
+    
+    // Every run gets its own manager and VkPipelineCache, so all variants start out as misses.
+    // Drivers with an on-disk shader cache may still favour the later run
+    auto measure = [&](bool useLibraries) {
+        PipelineManager manager;
+        manager.init(device, &deviceTable, allocator, useLibraries);
+        // Ids are SPIR-V hashes, so they match the ones already in the states
+        manager.addShader(shaders::shaderVert);
+        manager.addShader(shaders::shaderFrag);
+        
+        auto start = std::chrono::steady_clock::now();
+        for (const auto& state : states) {
+            manager.getPipeline(state);
+        }
+        double createMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        
+        start = std::chrono::steady_clock::now();
+        for (const auto& state : states) {
+            manager.getPipeline(state);
+        }
+        double lookupMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        
+        start = std::chrono::steady_clock::now();
+        manager.waitForBackgroundLinks();
+        double backgroundMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        
+        PipelineCacheStats stats = manager.stats();
+        std::cout << (useLibraries ? "graphics pipeline library" : "monolithic") << ", " << states.size() << " variants\n";
+        std::cout << "\tfirst request:  " << createMs << " ms, per variant average " << stats.totalCreationMs / stats.misses
+                  << " ms, max " << stats.maxCreationMs << " ms\n";
+        std::cout << "\tsecond request: " << lookupMs * 1e6 / states.size() << " ns per variant\n";
+        if (useLibraries) {
+            std::cout << "\t" << stats.libraryParts << " library parts, optimized links done " << backgroundMs
+                      << " ms after the last request\n";
+        }
+        
+        manager.destroy();
+    };
+    
+    measure(false);
+    if (graphicsPipelineLibrarySupported) {
+        measure(true);
+    } else {
+        std::cout << "graphics pipeline library: not supported by the device\n";
+    }
+}
+
+void HelloTriangleApplication::benchmarkSpecialization() {
+    // Every configuration draws the same shader twice: as uber-shader with the features in push constants,
+    // and specialized with the features as constants
+    struct FeaturePushConstants {
+        int32_t iterations;
+        uint32_t flags;
+    };
+    const uint32_t TINT_BIT = 1, NOISE_BIT = 2, VIGNETTE_BIT = 4;
+    const std::vector<FeaturePushConstants> configurations = {
+        {4, 0},
+        {4, TINT_BIT | NOISE_BIT | VIGNETTE_BIT},
+        {16, TINT_BIT},
+        {64, 0},
+        {64, TINT_BIT | NOISE_BIT | VIGNETTE_BIT},
+    };
+    // Fullscreen triangles per frame, so the fragment shader dominates the frame time
+    const uint32_t drawsPerFrame = 16;
+    const int framesPerMeasurement = 30;
+    
+    // The render pass is timed by GpuFrameStats
+    if (!collectGpuFrameStats || gpuQuerySupport.timestampValidBits == 0) {
+        throw std::runtime_error("graphics queue doesn't support timestamps!");
+    }
+    
+    static_assert(shaders::uberFrag.pushConstantSize == sizeof(FeaturePushConstants), "uber.frag doesn't match FeaturePushConstants");
+    VkPushConstantRange featureRange = pushConstantRange({&shaders::fullscreenVert, &shaders::uberFrag});
+    
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &featureRange;
+    
+    VkPipelineLayout featureLayout;
+    if (deviceTable.vkCreatePipelineLayout(device, &pipelineLayoutInfo, allocator, &featureLayout) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create pipeline layout!");
+    }
+    
+    PipelineState uberState = trianglePipelineState;
+    uberState.vertexShader = pipelineManager.addShader(shaders::fullscreenVert);
+    uberState.fragmentShader = pipelineManager.addShader(shaders::uberFrag);
+    uberState.layout = featureLayout;
+    
+    auto specialize = [&uberState](const FeaturePushConstants& features) {
+        PipelineState state = uberState;
+        state.fragmentSpecialization
+            .set(0, true)
+            .set(1, features.iterations)
+            .set(2, (features.flags & TINT_BIT) != 0)
+            .set(3, (features.flags & NOISE_BIT) != 0)
+            .set(4, (features.flags & VIGNETTE_BIT) != 0);
+        return state;
+    };
+    
+    // Create every pipeline up front, the measurement is about the GPU time
+    PipelineCacheStats before = pipelineManager.stats();
+    pipelineManager.getPipeline(uberState);
+    for (const auto& features : configurations) {
+        pipelineManager.getPipeline(specialize(features));
+    }
+    PipelineCacheStats after = pipelineManager.stats();
+    pipelineManager.waitForBackgroundLinks();
+    
+    // Returns the median GPU time of the render pass in ms
+    auto measure = [&](const PipelineState& state, const FeaturePushConstants& features) {
+        benchmarkDraws = [&](VkCommandBuffer commandBuffer) {
+            deviceTable.vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineManager.getPipeline(state));
+            deviceTable.vkCmdPushConstants(commandBuffer, featureLayout, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(features), &features);
+            deviceTable.vkCmdDraw(commandBuffer, 3, drawsPerFrame, 0, 0);
+        };
+        
+        std::vector<double> frameTimes;
+        while (frameTimes.size() < framesPerMeasurement) {
+            glfwPollEvents();
+            
+            uint32_t frame = currentFrame;
+            uint64_t recordedFrames = frameNumber;
+            drawFrame();
+            // Nothing was recorded when the swap chain had to be recreated
+            if (frameNumber == recordedFrames) continue;
+            
+            // Once the queue is idle the results are available, so collect() finds them
+            deviceTable.vkQueueWaitIdle(graphicsQueue);
+            if (gpuFrameStats.collect(frame)) {
+                frameTimes.push_back(gpuFrameStats.latest()->gpuMs);
+            }
+        }
+        
+        std::sort(frameTimes.begin(), frameTimes.end());
+        return frameTimes[frameTimes.size() / 2];
+    };
+    
+    std::cout << "specialization constants, " << drawsPerFrame << " fullscreen draws per frame, median GPU ms of "
+              << framesPerMeasurement << " frames\n";
+    std::cout << "\t" << (after.misses - before.misses) << " pipelines created in " << (after.totalCreationMs - before.totalCreationMs) << " ms\n";
+    for (const auto& features : configurations) {
+        double uberMs = measure(uberState, features);
+        double specializedMs = measure(specialize(features), features);
+        std::cout << "\titerations " << std::setw(3) << features.iterations << ", tint " << ((features.flags & TINT_BIT) != 0)
+                  << " noise " << ((features.flags & NOISE_BIT) != 0) << " vignette " << ((features.flags & VIGNETTE_BIT) != 0)
+                  << ":  uber " << uberMs << ", specialized " << specializedMs << '\n';
+    }
+    
+    benchmarkDraws = nullptr;
+    deviceTable.vkDeviceWaitIdle(device);
+    deviceTable.vkDestroyPipelineLayout(device, featureLayout, allocator);
+}
+
+void HelloTriangleApplication::benchmarkSprites() {
+    const uint32_t spriteCount = 100000;
+    const uint32_t textureCount = 8;
+    const uint32_t textureSize = 16;
+    const int warmupFrames = 5;
+    const int framesPerMeasurement = 60;
+    
+    SpriteBatcher spriteBatcher;
+    spriteBatcher.init(physicalDevice, instanceTable, device, &deviceTable, allocator, graphicsQueue, commandPool, &pipelineManager,
+                       renderPass, sceneColorFormat,
+                       pipelineManager.addShader(shaders::spriteVert),
+                       pipelineManager.addShader(shaders::spriteFrag),
+                       spriteCount, MAX_FRAMES_IN_FLIGHT);
+    
+    // Checkerboards in different colors
+    for (uint32_t t = 0; t < textureCount; t++) {
+        std::vector<uint8_t> pixels(textureSize * textureSize * 4);
+        for (uint32_t i = 0; i < textureSize * textureSize; i++) {
+            bool dark = ((i % textureSize) / 4 + (i / textureSize) / 4) % 2 == 0;
+            pixels[i * 4 + 0] = static_cast<uint8_t>(dark ? 64 : 255);
+            pixels[i * 4 + 1] = static_cast<uint8_t>((t * 97) % 256);
+            pixels[i * 4 + 2] = static_cast<uint8_t>((t * 53 + 128) % 256);
+            pixels[i * 4 + 3] = 255;
+        }
+        spriteBatcher.addTexture(textureSize, textureSize, pixels.data());
+    }
+    
+    // The same scene every frame, textures and blend modes interleaved as UI and particles usually are
+    std::mt19937 random(1234);
+    std::uniform_real_distribution<float> x(0.0f, static_cast<float>(swapChainExtent.width));
+    std::uniform_real_distribution<float> y(0.0f, static_cast<float>(swapChainExtent.height));
+    std::uniform_real_distribution<float> size(4.0f, 16.0f);
+    std::vector<Sprite> scene(spriteCount);
+    for (auto& sprite : scene) {
+        sprite.x = x(random);
+        sprite.y = y(random);
+        sprite.width = sprite.height = size(random);
+        sprite.color = 0x80FFFFFF;
+        sprite.texture = random() % textureCount;
+        sprite.blendMode = random() % 2 == 0 ? BlendMode::AlphaBlend : BlendMode::Additive;
+    }
+    
+    auto median = [](std::vector<double>& values) {
+        if (values.empty()) return 0.0;
+        std::sort(values.begin(), values.end());
+        return values[values.size() / 2];
+    };
+    
+    auto measure = [&](SpriteSortMode sortMode) {
+        benchmarkDraws = [&](VkCommandBuffer commandBuffer) {
+            spriteBatcher.begin(currentFrame, swapChainExtent, sortMode);
+            for (const auto& sprite : scene) {
+                spriteBatcher.draw(sprite);
+            }
+            spriteBatcher.end(commandBuffer);
+        };
+        
+        std::vector<double> cpuTimes;
+        std::vector<double> gpuTimes;
+        int frames = 0;
+        while (frames < warmupFrames + framesPerMeasurement) {
+            glfwPollEvents();
+            
+            uint32_t frame = currentFrame;
+            uint64_t recordedFrames = frameNumber;
+            drawFrame();
+            if (frameNumber == recordedFrames) continue;
+            
+            // The first frames create the pipeline variants
+            if (frames++ < warmupFrames) continue;
+            
+            cpuTimes.push_back(spriteBatcher.stats().cpuMs);
+            deviceTable.vkQueueWaitIdle(graphicsQueue);
+            if (collectGpuFrameStats && gpuFrameStats.collect(frame)) {
+                gpuTimes.push_back(gpuFrameStats.latest()->gpuMs);
+            }
+        }
+        
+        const SpriteBatchStats& stats = spriteBatcher.stats();
+        std::cout << '\t' << (sortMode == SpriteSortMode::ByState ? "sorted by state " : "submission order")
+                  << ": " << std::setw(6) << stats.draws << " draws, " << std::setw(6) << stats.pipelineBinds << " pipeline binds, "
+                  << std::setw(6) << stats.textureBinds << " texture binds, CPU " << median(cpuTimes) << " ms";
+        if (!gpuTimes.empty()) {
+            std::cout << ", GPU " << median(gpuTimes) << " ms";
+        }
+        std::cout << '\n';
+    };
+    
+    std::cout << "sprites, " << spriteCount << " per frame with " << textureCount << " textures and 2 blend modes, median of "
+              << framesPerMeasurement << " frames (one draw per sprite would be " << spriteCount << " draws)\n";
+    measure(SpriteSortMode::Submission);
+    measure(SpriteSortMode::ByState);
+    
+    benchmarkDraws = nullptr;
+    deviceTable.vkDeviceWaitIdle(device);
+    spriteBatcher.destroy();
+}
+
+std::string HelloTriangleApplication::benchmarkModelPath() const {
+    if (!modelPath.empty()) return modelPath;
+    
+    // A wavy grid of about a million triangles in random order, the worst case for the vertex cache
+    const uint32_t gridSize = 708;
+    const float waves = 6.0f * 3.14159265f;
+    const float amplitude = 0.05f;
+    
+    Mesh grid;
+    for (uint32_t y = 0; y <= gridSize; y++) {
+        for (uint32_t x = 0; x <= gridSize; x++) {
+            float u = static_cast<float>(x) / gridSize;
+            float v = static_cast<float>(y) / gridSize;
+            
+            // Height amplitude * sin(waves * u) * cos(waves * v), the normal follows from its gradient
+            float dzdx = amplitude * waves * 0.5f * std::cos(waves * u) * std::cos(waves * v);
+            float dzdy = -amplitude * waves * 0.5f * std::sin(waves * u) * std::sin(waves * v);
+            float length = std::sqrt(dzdx * dzdx + dzdy * dzdy + 1.0f);
+            
+            MeshVertex vertex;
+            vertex.position[0] = u * 2.0f - 1.0f;
+            vertex.position[1] = v * 2.0f - 1.0f;
+            vertex.position[2] = amplitude * std::sin(waves * u) * std::cos(waves * v);
+            vertex.normal[0] = -dzdx / length;
+            vertex.normal[1] = -dzdy / length;
+            vertex.normal[2] = 1.0f / length;
+            vertex.uv[0] = u;
+            vertex.uv[1] = v;
+            vertex.color[0] = 0.3f + 0.7f * u;
+            vertex.color[1] = 0.5f;
+            vertex.color[2] = 0.3f + 0.7f * v;
+            grid.vertices.push_back(vertex);
+        }
+    }
+    
+    std::vector<std::array<uint32_t, 3>> triangles;
+    for (uint32_t y = 0; y < gridSize; y++) {
+        for (uint32_t x = 0; x < gridSize; x++) {
+            uint32_t corner = y * (gridSize + 1) + x;
+            triangles.push_back({corner, corner + 1, corner + gridSize + 2});
+            triangles.push_back({corner, corner + gridSize + 2, corner + gridSize + 1});
+        }
+    }
+    std::shuffle(triangles.begin(), triangles.end(), std::mt19937(1234));
+    for (const auto& triangle : triangles) {
+        grid.indices.insert(grid.indices.end(), triangle.begin(), triangle.end());
+    }
+    
+    std::string path = (std::filesystem::temp_directory_path() / "vulkanpractice_grid.obj").string();
+    grid.writeObj(path);
+    return path;
+}
+
+double HelloTriangleApplication::measureGpuFrames(int warmupFrames, int frames) {
+    std::vector<double> gpuTimes;
+    int drawn = 0;
+    while (drawn < warmupFrames + frames) {
+        glfwPollEvents();
+        
+        uint32_t frame = currentFrame;
+        uint64_t recordedFrames = frameNumber;
+        drawFrame();
+        if (frameNumber == recordedFrames) continue;
+        
+        // The first frames create the pipeline variants
+        if (drawn++ < warmupFrames) continue;
+        
+        deviceTable.vkQueueWaitIdle(graphicsQueue);
+        if (collectGpuFrameStats && gpuFrameStats.collect(frame)) {
+            gpuTimes.push_back(gpuFrameStats.latest()->gpuMs);
+        }
+    }
+    
+    if (gpuTimes.empty()) return 0.0;
+    std::sort(gpuTimes.begin(), gpuTimes.end());
+    return gpuTimes[gpuTimes.size() / 2];
+}
+
+void HelloTriangleApplication::benchmarkMeshes() {
+    const int runs = 3;
+    const std::string path = benchmarkModelPath();
+    
+    // Fastest of a few runs, the first one also pays for reading the file from disk
+    auto load = [&](uint32_t threads, MeshLoadStats& best) {
+        Mesh mesh;
+        for (int run = 0; run < runs; run++) {
+            MeshLoadStats stats;
+            mesh = Mesh::load(path, threads, &stats);
+            if (run == 0 || stats.totalMs < best.totalMs) {
+                best = stats;
+            }
+        }
+        return mesh;
+    };
+    
+    std::cout << "meshes, " << path << ", fastest of " << runs << " loads\n";
+    
+    Mesh mesh;
+    std::vector<uint32_t> threadCounts = {1};
+    if (std::thread::hardware_concurrency() > 1) {
+        threadCounts.push_back(std::thread::hardware_concurrency());
+    }
+    for (uint32_t threads : threadCounts) {
+        MeshLoadStats stats;
+        mesh = load(threads, stats);
+        double millionTriangles = std::max(1.0, static_cast<double>(mesh.triangleCount())) / 1e6;
+        std::cout << '\t' << std::setw(2) << stats.threads << " threads: " << stats.totalMs << " ms, "
+                  << stats.totalMs / millionTriangles << " ms per million triangles (map " << stats.mapMs
+                  << " ms, parse " << stats.parseMs << " ms, deduplicate " << stats.deduplicateMs << " ms)\n";
+    }
+    std::cout << '\t' << mesh.triangleCount() << " triangles, " << mesh.vertices.size() << " unique vertices of "
+              << mesh.indices.size() << " corners\n";
+    
+    auto report = [&](const char* stage, double milliseconds) {
+        VertexCacheStats cache = analyzeVertexCache(mesh.indices, mesh.vertices.size());
+        std::cout << '\t' << stage << ": ACMR " << cache.acmr << ", ATVR " << cache.atvr;
+        if (milliseconds > 0.0) {
+            std::cout << " (" << milliseconds << " ms)";
+        }
+        std::cout << '\n';
+    };
+    
+    auto time = [](auto&& function) {
+        auto start = std::chrono::steady_clock::now();
+        function();
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    };
+    
+    std::cout << "\tFIFO vertex cache of " << DEFAULT_VERTEX_CACHE_SIZE << " entries\n";
+    report("as loaded       ", 0.0);
+    report("vertex cache    ", time([&] { optimizeVertexCache(mesh); }));
+    report("vertex fetch    ", time([&] { optimizeVertexFetch(mesh); }));
+}
+
+void HelloTriangleApplication::benchmarkQuantization() {
+    const int drawsPerFrame = 4;
+    const int warmupFrames = 5;
+    const int framesPerMeasurement = 60;
+    
+    Mesh mesh = Mesh::load(benchmarkModelPath());
+    optimizeVertexCache(mesh);
+    optimizeVertexFetch(mesh);
+    
+    MeshRenderer meshRenderer;
+    meshRenderer.init(device, &deviceTable, allocator, &pipelineManager, renderPass, sceneColorFormat,
+                      pipelineManager.addShader(shaders::meshVert),
+                      pipelineManager.addShader(shaders::meshFrag));
+    
+    // Fits the bounds into clip space, y flipped and depth in [0, 1]
+    const MeshBounds bounds = GpuMesh::computeBounds(mesh.vertices);
+    const float scale = 1.0f / std::max(glm::length(bounds.halfExtent), 1e-6f);
+    const glm::mat4 transform = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, 0.5f)) *
+                                glm::scale(glm::mat4(1.0f), glm::vec3(scale, -scale, 0.5f * scale)) *
+                                glm::translate(glm::mat4(1.0f), -bounds.center);
+    
+    std::cout << "quantization, " << mesh.triangleCount() << " triangles and " << mesh.vertices.size() << " vertices drawn "
+              << drawsPerFrame << " times per frame, median of " << framesPerMeasurement << " frames\n";
+    
+    for (VertexFormat format : {VertexFormat::Float, VertexFormat::Quantized}) {
+        GpuMesh gpuMesh;
+        gpuMesh.init(physicalDevice, instanceTable, device, &deviceTable, allocator, graphicsQueue, commandPool, mesh, format);
+        
+        benchmarkDraws = [&](VkCommandBuffer commandBuffer) {
+            meshRenderer.begin(commandBuffer);
+            for (int i = 0; i < drawsPerFrame; i++) {
+                meshRenderer.draw(gpuMesh, transform);
+            }
+        };
+        double gpuMs = measureGpuFrames(warmupFrames, framesPerMeasurement);
+        
+        std::cout << '\t' << (format == VertexFormat::Quantized ? "quantized" : "float    ") << ": " << std::setw(2)
+                  << GpuMesh::vertexSize(format) << " bytes per vertex, vertex buffer " << gpuMesh.vertexBytes() / 1048576.0
+                  << " MB, index buffer " << gpuMesh.indexBytes() / 1048576.0 << " MB";
+        if (gpuMs > 0.0) {
+            std::cout << ", GPU " << gpuMs << " ms";
+        }
+        std::cout << '\n';
+        
+        benchmarkDraws = nullptr;
+        deviceTable.vkDeviceWaitIdle(device);
+        gpuMesh.destroy();
+    }
+    
+    // Worst case of the round trip through the quantized format
+    const uint32_t quantizedSize = GpuMesh::vertexSize(VertexFormat::Quantized);
+    const std::vector<uint8_t> encoded = GpuMesh::encodeVertices(mesh.vertices, VertexFormat::Quantized, bounds);
+    float positionError = 0.0f;
+    float normalError = 0.0f;
+    float uvError = 0.0f;
+    for (size_t i = 0; i < mesh.vertices.size(); i++) {
+        const MeshVertex& original = mesh.vertices[i];
+        const MeshVertex decoded = GpuMesh::decodeVertex(&encoded[i * quantizedSize], VertexFormat::Quantized, bounds);
+        
+        const glm::vec3 originalNormal(original.normal[0], original.normal[1], original.normal[2]);
+        if (glm::length(originalNormal) > 0.0f) {
+            const glm::vec3 decodedNormal(decoded.normal[0], decoded.normal[1], decoded.normal[2]);
+            float cosine = std::clamp(glm::dot(glm::normalize(originalNormal), decodedNormal), -1.0f, 1.0f);
+            normalError = std::max(normalError, glm::degrees(std::acos(cosine)));
+        }
+        for (int c = 0; c < 3; c++) {
+            positionError = std::max(positionError, std::abs(decoded.position[c] - original.position[c]));
+        }
+        for (int c = 0; c < 2; c++) {
+            uvError = std::max(uvError, std::abs(decoded.uv[c] - original.uv[c]));
+        }
+    }
+    
+    const float boundsSize = 2.0f * std::max({bounds.halfExtent.x, bounds.halfExtent.y, bounds.halfExtent.z, 1e-6f});
+    std::cout << "\tlargest quantization error: position " << positionError / boundsSize * 100.0f << "% of the bounds, normal "
+              << normalError << " degrees, texture coordinate " << uvError << '\n';
+    
+    meshRenderer.destroy();
+}
+
+void HelloTriangleApplication::benchmarkLods() {
+    const uint32_t objectCount = 32;
+    const uint32_t maxLods = 8;
+    const float maxPixelError = 1.0f;
+    const float fieldOfView = glm::radians(60.0f);
+    const int warmupFrames = 5;
+    const int framesPerMeasurement = 60;
+    
+    Mesh mesh = Mesh::load(benchmarkModelPath());
+    const MeshBounds bounds = GpuMesh::computeBounds(mesh.vertices);
+    const float radius = std::max(glm::length(bounds.halfExtent), 1e-6f);
+    
+    // No level may be further than 2% of the size of the mesh from the full one
+    auto buildStart = std::chrono::steady_clock::now();
+    buildLods(mesh, maxLods, 0.02f * radius);
+    double buildMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - buildStart).count();
+    optimizeVertexCache(mesh);
+    optimizeVertexFetch(mesh);
+    
+    std::cout << "lods, " << mesh.lods.size() << " levels built in " << buildMs << " ms\n";
+    for (size_t i = 0; i < mesh.lods.size(); i++) {
+        std::cout << "\tlevel " << i << ": " << std::setw(8) << mesh.lods[i].indexCount / 3 << " triangles, error "
+                  << mesh.lods[i].error / radius * 100.0f << "% of the radius\n";
+    }
+    
+    GpuMesh gpuMesh;
+    gpuMesh.init(physicalDevice, instanceTable, device, &deviceTable, allocator, graphicsQueue, commandPool, mesh, VertexFormat::Quantized);
+    
+    MeshRenderer meshRenderer;
+    meshRenderer.init(device, &deviceTable, allocator, &pipelineManager, renderPass, sceneColorFormat,
+                      pipelineManager.addShader(shaders::meshVert),
+                      pipelineManager.addShader(shaders::meshFrag));
+    
+    // A double row of objects going away from the camera, every one scaled to a radius of 1
+    const glm::vec3 eye(0.0f, 1.0f, 3.0f);
+    const glm::mat4 view = glm::lookAt(eye, glm::vec3(0.0f, 0.0f, -10.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    std::vector<glm::vec3> positions;
+    for (uint32_t i = 0; i < objectCount; i++) {
+        positions.emplace_back(i % 2 == 0 ? -1.2f : 1.2f, 0.0f, -2.0f * static_cast<float>(i / 2) * (1.0f + 0.2f * (i / 2)));
+    }
+    
+    auto measure = [&](bool useLods) {
+        std::vector<uint32_t> objectsPerLevel(gpuMesh.lods().size(), 0);
+        MeshDrawStats drawStats;
+        
+        benchmarkDraws = [&](VkCommandBuffer commandBuffer) {
+            const float aspect = static_cast<float>(swapChainExtent.width) / static_cast<float>(swapChainExtent.height);
+            glm::mat4 projection = glm::perspectiveRH_ZO(fieldOfView, aspect, 0.1f, 500.0f);
+            projection[1][1] *= -1.0f;
+            const glm::mat4 viewProjection = projection * view;
+            
+            // Pixels per unit at a distance of 1, mesh units are 1 / radius of that
+            const float pixelsPerUnit = swapChainExtent.height / (2.0f * std::tan(fieldOfView * 0.5f)) / radius;
+            
+            std::fill(objectsPerLevel.begin(), objectsPerLevel.end(), 0);
+            meshRenderer.begin(commandBuffer);
+            for (const glm::vec3& position : positions) {
+                uint32_t level = 0;
+                if (useLods) {
+                    // Closest point of the bounding sphere, so the error is never underestimated
+                    float distance = std::max(glm::length(position - eye) - 1.0f, 0.1f);
+                    level = selectLod(gpuMesh.lods(), pixelsPerUnit / distance, maxPixelError);
+                }
+                objectsPerLevel[level]++;
+                
+                const glm::mat4 model = glm::translate(glm::mat4(1.0f), position) * glm::scale(glm::mat4(1.0f), glm::vec3(1.0f / radius)) *
+                                        glm::translate(glm::mat4(1.0f), -bounds.center);
+                const MeshLod& lod = gpuMesh.lods()[level];
+                meshRenderer.draw(gpuMesh, viewProjection * model, lod.firstIndex, lod.indexCount);
+            }
+            drawStats = meshRenderer.stats();
+        };
+        double gpuMs = measureGpuFrames(warmupFrames, framesPerMeasurement);
+        
+        std::cout << '\t' << (useLods ? "with lods   " : "without lods") << ": " << std::setw(9) << drawStats.triangles
+                  << " triangles, " << drawStats.draws << " draws, " << drawStats.meshBinds << " mesh binds";
+        if (gpuMs > 0.0) {
+            std::cout << ", GPU " << gpuMs << " ms";
+        }
+        std::cout << ", objects per level";
+        for (uint32_t count : objectsPerLevel) {
+            std::cout << ' ' << count;
+        }
+        std::cout << '\n';
+    };
+    
+    std::cout << objectCount << " objects, at most " << maxPixelError << " pixel of error, median of " << framesPerMeasurement << " frames\n";
+    measure(false);
+    measure(true);
+    
+    benchmarkDraws = nullptr;
+    deviceTable.vkDeviceWaitIdle(device);
+    meshRenderer.destroy();
+    gpuMesh.destroy();
+}
+
+void HelloTriangleApplication::benchmarkCulling() {
+    const size_t objectCount = 1000000;
+    const int warmupFrames = 5;
+    const int frames = 50;
+    
+    // Objects spread over a flat 2 km square around the camera, a fraction of them is in view whichever way it looks
+    std::mt19937 random(7);
+    std::uniform_real_distribution<float> horizontal(-1000.0f, 1000.0f);
+    std::uniform_real_distribution<float> vertical(-50.0f, 50.0f);
+    std::uniform_real_distribution<float> size(0.5f, 4.0f);
+    std::uniform_real_distribution<float> extent(0.2f, 1.0f);
+    struct Object {
+        glm::vec3 center;
+        float radius;
+        glm::vec3 halfExtent;
+    };
+    std::vector<Object> objects(objectCount);
+    for (Object& object : objects) {
+        object.center = glm::vec3(horizontal(random), vertical(random), horizontal(random));
+        object.radius = size(random);
+        // Inside the sphere, so the box test only ever removes more
+        object.halfExtent = glm::vec3(extent(random), extent(random), extent(random)) * object.radius / std::sqrt(3.0f);
+    }
+    
+    const float aspect = static_cast<float>(swapChainExtent.width) / static_cast<float>(swapChainExtent.height);
+    glm::mat4 projection = glm::perspectiveRH_ZO(glm::radians(60.0f), aspect, 0.1f, 1000.0f);
+    projection[1][1] *= -1.0f;
+    
+    // The camera turns a little every frame, so the visible set keeps changing
+    auto viewProjection = [&](int frame) {
+        const float yaw = 0.05f * static_cast<float>(frame);
+        const glm::vec3 eye(0.0f, 10.0f, 0.0f);
+        return projection * glm::lookAt(eye, eye + glm::vec3(std::sin(yaw), -0.1f, std::cos(yaw)), glm::vec3(0.0f, 1.0f, 0.0f));
+    };
+    
+    auto measure = [&](uint32_t threads, bool simd) {
+        FrustumCuller culler;
+        culler.init(threads);
+        culler.setSimd(simd);
+        culler.reserve(objects.size());
+        for (const Object& object : objects) {
+            culler.addObject(object.center, object.radius, object.center - object.halfExtent, object.center + object.halfExtent);
+        }
+        
+        std::vector<double> times;
+        uint64_t visible = 0;
+        for (int frame = 0; frame < warmupFrames + frames; frame++) {
+            culler.cull(viewProjection(frame));
+            if (frame >= warmupFrames) {
+                times.push_back(culler.stats().ms);
+                visible += culler.stats().visible;
+            }
+        }
+        std::sort(times.begin(), times.end());
+        culler.destroy();
+        return std::make_pair(times[times.size() / 2], visible / frames);
+    };
+    
+    std::cout << "culling, " << objectCount << " objects, sphere and AABB per object, SIMD " << FrustumCuller::simdName()
+              << ", median of " << frames << " frames\n";
+    
+    auto scalar = measure(1, false);
+    std::cout << "\tscalar,  1 thread : " << std::setw(7) << scalar.first << " ms, " << objectCount / scalar.first / 1000.0
+              << " M objects/s, " << scalar.second << " visible\n";
+    
+    std::vector<uint32_t> threadCounts;
+    for (uint32_t threads = 1; threads < std::thread::hardware_concurrency(); threads *= 2) {
+        threadCounts.push_back(threads);
+    }
+    threadCounts.push_back(std::max(1u, std::thread::hardware_concurrency()));
+    
+    double singleThreadMs = 0.0;
+    for (uint32_t threads : threadCounts) {
+        auto result = measure(threads, true);
+        if (threads == 1) {
+            singleThreadMs = result.first;
+        }
+        std::cout << "\tSIMD,   " << std::setw(2) << threads << (threads == 1 ? " thread : " : " threads: ") << std::setw(7) << result.first
+                  << " ms, " << objectCount / result.first / 1000.0 << " M objects/s, " << result.second << " visible, speedup "
+                  << scalar.first / result.first << "x over scalar, " << singleThreadMs / result.first << "x over 1 thread\n";
+    }
+}
+
+void HelloTriangleApplication::benchmarkTransforms() {
+    const uint32_t rootCount = 1000;
+    const int warmupFrames = 3;
+    const int frames = 20;
+    
+    std::vector<uint32_t> threadCounts;
+    for (uint32_t threads = 1; threads < std::thread::hardware_concurrency(); threads *= 2) {
+        threadCounts.push_back(threads);
+    }
+    threadCounts.push_back(std::max(1u, std::thread::hardware_concurrency()));
+    
+    std::cout << "transforms, " << rootCount << " roots, median of " << frames << " frames\n";
+    
+    for (size_t nodeCount : {size_t(100000), size_t(1000000)}) {
+        // Every node hangs below a random earlier one, which gives a depth of about ln(nodes). Added in that order,
+        // the hierarchy has to sort them by depth
+        std::mt19937 random(11);
+        std::uniform_real_distribution<float> offset(-1.0f, 1.0f);
+        std::vector<NodeId> parents(nodeCount, NO_PARENT_NODE);
+        std::vector<Transform> locals(nodeCount);
+        for (size_t i = 0; i < nodeCount; i++) {
+            if (i >= rootCount) {
+                parents[i] = std::uniform_int_distribution<NodeId>(0, static_cast<NodeId>(i - 1))(random);
+            }
+            locals[i].position = glm::vec3(offset(random), offset(random), offset(random));
+            locals[i].rotation = glm::angleAxis(offset(random) * 3.14159f, glm::normalize(glm::vec3(offset(random), 1.0f, offset(random))));
+        }
+        std::vector<NodeId> moving(nodeCount / 100);
+        for (NodeId& node : moving) {
+            node = std::uniform_int_distribution<NodeId>(0, static_cast<NodeId>(nodeCount - 1))(random);
+        }
+        
+        for (uint32_t threads : threadCounts) {
+            TransformHierarchy hierarchy;
+            hierarchy.init(threads);
+            for (size_t i = 0; i < nodeCount; i++) {
+                hierarchy.addNode(locals[i], parents[i]);
+            }
+            hierarchy.update();
+            const double buildMs = hierarchy.stats().ms;
+            
+            // moveNodes changes the locals for the frame, only the update itself is timed
+            auto measure = [&](const std::function<void(int)>& moveNodes) {
+                std::vector<double> times;
+                uint64_t updated = 0;
+                for (int frame = 0; frame < warmupFrames + frames; frame++) {
+                    moveNodes(frame);
+                    hierarchy.update();
+                    if (frame >= warmupFrames) {
+                        times.push_back(hierarchy.stats().ms);
+                        updated += hierarchy.stats().updated;
+                    }
+                }
+                std::sort(times.begin(), times.end());
+                return std::make_pair(times[times.size() / 2], updated / frames);
+            };
+            
+            // Turning the roots moves every node below them
+            auto all = measure([&](int frame) {
+                for (NodeId root = 0; root < rootCount; root++) {
+                    Transform local = locals[root];
+                    local.rotation = glm::angleAxis(0.01f * static_cast<float>(frame), glm::vec3(0.0f, 1.0f, 0.0f)) * local.rotation;
+                    hierarchy.setLocal(root, local);
+                }
+            });
+            auto some = measure([&](int frame) {
+                for (NodeId node : moving) {
+                    Transform local = locals[node];
+                    local.position.y += 0.01f * static_cast<float>(frame);
+                    hierarchy.setLocal(node, local);
+                }
+            });
+            auto none = measure([](int) {});
+            
+            std::cout << '\t' << std::setw(7) << nodeCount << " nodes, " << hierarchy.stats().levels << " levels, " << std::setw(2)
+                      << threads << (threads == 1 ? " thread : " : " threads: ") << "sort and first update " << buildMs << " ms\n";
+            std::cout << "\t\troots moving: " << std::setw(7) << all.second << " updated, " << all.first << " ms, "
+                      << all.second / all.first / 1000.0 << " M nodes/s\n";
+            std::cout << "\t\t1% moving   : " << std::setw(7) << some.second << " updated, " << some.first << " ms\n";
+            std::cout << "\t\tnone moving : " << std::setw(7) << none.second << " updated, " << none.first << " ms\n";
+        }
+    }
+}
+
+void HelloTriangleApplication::benchmarkLatency() {
+    const int warmupFrames = 10;
+    const int frames = 200;
+    
+    if (!latencyTracker.isInitialized()) {
+        std::cout << "latency: measureInputLatency is off\n";
+        return;
+    }
+    
+    std::cout << "latency, input sampled to GPU completion, " << frames << " frames\n";
+    
+    // Stands in for the CPU time of recording a real scene, which is what late latching hides
+    for (double recordingMs : {0.0, 4.0}) {
+        benchmarkDraws = [this, recordingMs](VkCommandBuffer commandBuffer) {
+            auto end = std::chrono::steady_clock::now() + std::chrono::duration<double, std::milli>(recordingMs);
+            while (std::chrono::steady_clock::now() < end) {
+            }
+            
+            deviceTable.vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineManager.getPipeline(trianglePipelineState));
+            cameraUniforms.bind(commandBuffer, pipelineLayout, currentFrame);
+            deviceTable.vkCmdDraw(commandBuffer, 3, 1, 0, 0);
+        };
+        
+        for (bool lateLatch : {false, true}) {
+            lateLatchCamera = lateLatch;
+            
+            int drawn = 0;
+            while (drawn < warmupFrames + frames) {
+                glfwPollEvents();
+                
+                uint64_t recordedFrames = frameNumber;
+                drawFrame();
+                if (frameNumber == recordedFrames) continue;
+                
+                // Only the frames after the warmup are counted
+                if (++drawn == warmupFrames) {
+                    latencyTracker.flush();
+                    latencyTracker.reset();
+                }
+            }
+            latencyTracker.flush();
+            
+            LatencySummary result = latencyTracker.summary();
+            std::cout << '\t' << std::setw(3) << recordingMs << " ms recording, " << (lateLatch ? "late latched    : " : "before recording: ")
+                      << "median " << result.medianMs << " ms, p95 " << result.p95Ms << " ms, max " << result.maxMs << " ms\n";
+        }
+    }
+    
+    benchmarkDraws = nullptr;
+    lateLatchCamera = defaultLateLatchCamera;
+}
+
+void HelloTriangleApplication::benchmarkResolution() {
+    if (!dynamicResolutionEnabled || !collectGpuFrameStats || gpuQuerySupport.timestampValidBits == 0) {
+        std::cout << "resolution: needs dynamic resolution and GPU timestamps\n";
+        return;
+    }
+    
+    // Every instance covers the same triangle again, so the GPU time grows with the pixel count times the instances
+    uint32_t instances = 16;
+    benchmarkDraws = [&](VkCommandBuffer commandBuffer) {
+        deviceTable.vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineManager.getPipeline(trianglePipelineState));
+        cameraUniforms.bind(commandBuffer, pipelineLayout, currentFrame);
+        deviceTable.vkCmdDraw(commandBuffer, 3, instances, 0, 0);
+    };
+    
+    // The load that takes a few milliseconds at full resolution becomes the target. Twice that load then needs a scale
+    // of about 0.7 to fit, a quarter of it fits at full resolution
+    double fullResolutionMs = 0.0;
+    while (instances < (1u << 16)) {
+        fullResolutionMs = measureGpuFrames(3, 10);
+        if (fullResolutionMs >= 4.0) break;
+        instances *= 2;
+    }
+    const uint32_t baseInstances = instances;
+    dynamicResolution.setTargetFrameMs(fullResolutionMs);
+    dynamicResolution.unlockScale();
+    
+    std::cout << "resolution, target " << fullResolutionMs << " ms = " << baseInstances << " instances at scale " << maxRenderScale << "\n";
+    
+    struct Phase {
+        const char* name;
+        uint32_t instances;
+        int frames;
+    };
+    const Phase phases[] = {
+        {"light load (x0.25)", baseInstances / 4, 120},
+        {"heavy load (x2)", baseInstances * 2, 240},
+        {"light load (x0.25)", baseInstances / 4, 240},
+    };
+    
+    for (const Phase& phase : phases) {
+        instances = std::max(1u, phase.instances);
+        dynamicResolution.resetStats();
+        
+        int drawn = 0;
+        while (drawn < phase.frames) {
+            glfwPollEvents();
+            
+            uint64_t recordedFrames = frameNumber;
+            drawFrame();
+            if (frameNumber != recordedFrames) drawn++;
+        }
+        
+        std::cout << '\t' << phase.name << ", scale at the end " << dynamicResolution.scale() << ":\n";
+        dynamicResolution.printReport(std::cout);
+    }
+    
+    benchmarkDraws = nullptr;
+}
+
+void HelloTriangleApplication::benchmarkPostProcess() {
+    if (!postProcessingEnabled || !collectGpuFrameStats) {
+        std::cout << "post: needs post processing, which needs dynamic resolution and Vulkan 1.1 subgroup arithmetic, and GPU timestamps\n";
+        return;
+    }
+    
+    const char* queueName = computeQueue != VK_NULL_HANDLE ? "async compute queue" : "graphics queue";
+    
+    // The scene stays the same, only the resolution of the histogram and the bloom chain changes
+    for (bool halfResolution : {false, true}) {
+        deviceTable.vkDeviceWaitIdle(device);
+        postProcess.setHalfResolution(halfResolution);
+        
+        // The timestamps of a frame are collected when its frame slot comes around again, the warm-up ones are dropped
+        measureGpuFrames(10, 0);
+        postProcess.resetStats();
+        const double sceneMs = measureGpuFrames(0, 200);
+        
+        std::cout << "post, scene render pass " << sceneMs << " ms\n";
+        postProcess.printReport(std::cout, queueName);
+    }
+    
+    deviceTable.vkDeviceWaitIdle(device);
+    postProcess.setHalfResolution(postProcessHalfResolution);
+}
+
+void HelloTriangleApplication::benchmarkProfiler() {
+    using Clock = std::chrono::steady_clock;
+    const int zones = 1 << 22;
+    
+    // Tight loops of empty zones, the cost of the zone itself
+    auto nsPerZone = [&]() {
+        auto start = Clock::now();
+        for (int i = 0; i < zones; i++) {
+            PROFILE_ZONE("benchmark zone");
+        }
+        return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / zones;
+    };
+    
+    Profiler::setEnabled(false);
+    const double disabledNs = nsPerZone();
+    Profiler::setEnabled(true);
+    const double enabledNs = nsPerZone();
+    
+    // A worker keeps recording while the main thread collects, the way an export during a run would
+    std::atomic<bool> stop{false};
+    std::thread writer([&stop] {
+        Profiler::setThreadName("benchmark writer");
+        while (!stop.load(std::memory_order_relaxed)) {
+            PROFILE_ZONE("benchmark writer zone");
+        }
+    });
+    auto start = Clock::now();
+    const size_t collected = Profiler::collectZones().size();
+    const double collectMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    stop = true;
+    writer.join();
+    
+    Profiler::setEnabled(enableProfiler);
+    
+    // GPU zones on top of the usual frames, their results show up in the report
+    measureGpuFrames(10, 100);
+    deviceTable.vkDeviceWaitIdle(device);
+    for (uint32_t frame = 0; frame < MAX_FRAMES_IN_FLIGHT; frame++) {
+        gpuProfiler.collect(frame);
+        computeProfiler.collect(frame);
+    }
+    
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "profiler, CPU zone disabled " << disabledNs << " ns, enabled " << enabledNs << " ns\n";
+    std::cout << "\tcollecting " << collected << " zones while a thread records " << collectMs << " ms\n";
+    std::cout << std::defaultfloat;
+    gpuProfiler.printReport(std::cout, "graphics queue");
+    computeProfiler.printReport(std::cout, "async compute queue");
+}
+
+void HelloTriangleApplication::benchmarkMemoryBudget() {
+    using Clock = std::chrono::steady_clock;
+    const int updates = 1000;
+    const int frames = 300;
+    const VkDeviceSize streamingBudget = 64ull * 1024 * 1024;
+    const uint32_t textureSize = 1024;
+    
+    if (!trackMemoryBudget) {
+        std::cout << "memory: needs trackMemoryBudget\n";
+        return;
+    }
+    
+    // The cost of reading the budget every frame, before there is anything to evict
+    auto start = Clock::now();
+    for (int i = 0; i < updates; i++) {
+        memoryBudget.update(frameNumber);
+    }
+    const double updateUs = std::chrono::duration<double, std::micro>(Clock::now() - start).count() / updates;
+    
+    // A stand-in for texture streaming: every frame streams in one more texture with a full mip chain, and the eviction
+    // callback gives up the least recently streamed ones. They are only released MAX_FRAMES_IN_FLIGHT frames later,
+    // once no frame in flight can be using them anymore
+    struct StreamedTexture {
+        VkImage image;
+        VkDeviceMemory memory;
+        VkDeviceSize size;
+        uint64_t releaseFrame;
+    };
+    std::deque<StreamedTexture> resident;
+    std::deque<StreamedTexture> evicted;
+    uint32_t textureHeap = 0;
+    
+    auto streamIn = [&]() {
+        VkImageCreateInfo imageInfo{};
+        imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageInfo.format = VK_FORMAT_R8G8B8A8_UNORM;
+        imageInfo.extent = {textureSize, textureSize, 1};
+        imageInfo.mipLevels = static_cast<uint32_t>(std::log2(textureSize)) + 1;
+        imageInfo.arrayLayers = 1;
+        imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        
+        StreamedTexture texture{};
+        if (deviceTable.vkCreateImage(device, &imageInfo, allocator, &texture.image) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create streamed texture!");
+        }
+        
+        VkMemoryRequirements memoryRequirements;
+        deviceTable.vkGetImageMemoryRequirements(device, texture.image, &memoryRequirements);
+        
+        VkMemoryAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocInfo.allocationSize = memoryRequirements.size;
+        allocInfo.memoryTypeIndex = findMemoryType(memoryProperties, memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        
+        if (deviceTable.vkAllocateMemory(device, &allocInfo, allocator, &texture.memory) != VK_SUCCESS) {
+            throw std::runtime_error("failed to allocate streamed texture memory!");
+        }
+        deviceTable.vkBindImageMemory(device, texture.image, texture.memory, 0);
+        
+        texture.size = memoryRequirements.size;
+        textureHeap = memoryBudget.heapOfMemoryType(allocInfo.memoryTypeIndex);
+        resident.push_back(texture);
+    };
+    auto release = [&](const StreamedTexture& texture) {
+        deviceTable.vkDestroyImage(device, texture.image, allocator);
+        deviceTable.vkFreeMemory(device, texture.memory, allocator);
+    };
+    
+    const uint32_t callbackId = memoryBudget.addEvictionCallback(0, [&](uint32_t heap, VkDeviceSize bytesToFree) {
+        VkDeviceSize freed = 0;
+        while (heap == textureHeap && freed < bytesToFree && !resident.empty()) {
+            resident.front().releaseFrame = frameNumber + MAX_FRAMES_IN_FLIGHT;
+            freed += resident.front().size;
+            evicted.push_back(resident.front());
+            resident.pop_front();
+        }
+        return freed;
+    });
+    
+    // Room for the streamed textures on top of what the app uses already
+    streamIn();
+    memoryBudget.update(frameNumber);
+    memoryBudget.setSimulatedBudget(memoryBudget.heaps()[textureHeap].usage + streamingBudget);
+    
+    uint64_t streamed = 1;
+    uint64_t framesOverBudget = 0;
+    double peakFraction = 0.0;
+    int drawn = 0;
+    while (drawn < frames) {
+        glfwPollEvents();
+        
+        while (!evicted.empty() && evicted.front().releaseFrame <= frameNumber) {
+            release(evicted.front());
+            evicted.pop_front();
+        }
+        
+        uint64_t recordedFrames = frameNumber;
+        drawFrame();
+        if (frameNumber == recordedFrames) continue;
+        drawn++;
+        
+        streamIn();
+        streamed++;
+        
+        const MemoryHeapStats& heap = memoryBudget.heaps()[textureHeap];
+        peakFraction = std::max(peakFraction, static_cast<double>(heap.usage) / heap.budget);
+        if (heap.usage > heap.budget) framesOverBudget++;
+    }
+    
+    deviceTable.vkDeviceWaitIdle(device);
+    memoryBudget.removeEvictionCallback(callbackId);
+    for (const StreamedTexture& texture : resident) {
+        release(texture);
+    }
+    for (const StreamedTexture& texture : evicted) {
+        release(texture);
+    }
+    const uint64_t residentAtEnd = resident.size();
+    memoryBudget.setSimulatedBudget(simulatedMemoryBudget);
+    
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "memory, budget update " << updateUs << " us\n";
+    std::cout << "\tstreamed " << streamed << " textures, " << residentAtEnd << " resident at the end, peak usage "
+              << peakFraction * 100.0 << "% of the budget, " << framesOverBudget << " of " << frames << " frames over it\n";
+    std::cout << std::defaultfloat;
+    memoryBudget.printReport(std::cout);
+}
+
+void HelloTriangleApplication::benchmarkMultiview() {
+    const uint32_t gridSize = 64;
+    const int warmupFrames = 10;
+    const int frames = 100;
+    
+    Mesh model = Mesh::load(benchmarkModelPath());
+    optimizeVertexCache(model);
+    optimizeVertexFetch(model);
+    GpuMesh modelMesh;
+    modelMesh.init(physicalDevice, instanceTable, device, &deviceTable, allocator, graphicsQueue, commandPool, model, VertexFormat::Quantized);
+    
+    // A grid of small triangles in front of the camera, one draw each: recording dominates
+    std::vector<glm::mat4> gridTransforms;
+    const float cell = 2.0f / gridSize;
+    for (uint32_t y = 0; y < gridSize; y++) {
+        for (uint32_t x = 0; x < gridSize; x++) {
+            const glm::vec3 center(-1.0f + (x + 0.5f) * cell, -1.0f + (y + 0.5f) * cell, 0.0f);
+            gridTransforms.push_back(glm::translate(glm::mat4(1.0f), center) * glm::scale(glm::mat4(1.0f), glm::vec3(cell)));
+        }
+    }
+    
+    // The model four times, scaled to a radius of 0.5: few draws and a lot of vertices for every view
+    const MeshBounds bounds = modelMesh.bounds();
+    const float scale = 0.5f / std::max(glm::length(bounds.halfExtent), 1e-6f);
+    std::vector<glm::mat4> modelTransforms;
+    for (glm::vec2 corner : {glm::vec2(-0.5f, -0.5f), glm::vec2(0.5f, -0.5f), glm::vec2(-0.5f, 0.5f), glm::vec2(0.5f, 0.5f)}) {
+        modelTransforms.push_back(glm::translate(glm::mat4(1.0f), glm::vec3(corner, 0.0f)) * glm::scale(glm::mat4(1.0f), glm::vec3(scale)) *
+                                  glm::translate(glm::mat4(1.0f), -bounds.center));
+    }
+    
+    const VkExtent2D layer = multiview.layerExtent();
+    std::cout << "multiview, " << multiview.viewCount() << " views of " << layer.width << "x" << layer.height
+              << ", mean CPU recording time and median GPU frame time of " << frames << " frames\n";
+    
+    auto measure = [&](const char* scene, const GpuMesh& mesh, const std::vector<glm::mat4>& transforms) {
+        std::cout << '\t' << scene << ", " << transforms.size() << " draws of " << mesh.lods()[0].indexCount / 3 << " triangles\n";
+        
+        benchmarkMultiviewDraws = [&] {
+            for (const glm::mat4& transform : transforms) {
+                multiview.draw(mesh, transform);
+            }
+        };
+        
+        double separateRecordMs = 0.0;
+        double separateGpuMs = 0.0;
+        for (MultiviewMode mode : {MultiviewMode::SeparatePasses, MultiviewMode::Multiview}) {
+            if (mode == MultiviewMode::Multiview && !multiview.hasMultiview()) {
+                std::cout << "\t\tmultiview      : not supported by the device\n";
+                continue;
+            }
+            
+            // The first frames of a mode create its pipeline variants
+            multiview.setMode(mode);
+            measureGpuFrames(warmupFrames, 0);
+            multiview.resetStats();
+            const double gpuMs = measureGpuFrames(0, frames);
+            
+            const MultiviewStats& stats = multiview.stats();
+            const double recordMs = stats.recordMs / static_cast<double>(std::max<uint64_t>(stats.frames, 1));
+            std::cout << (mode == MultiviewMode::Multiview ? "\t\tmultiview      : " : "\t\tseparate passes: ")
+                      << stats.passes / std::max<uint64_t>(stats.frames, 1) << " render passes, "
+                      << stats.draws / std::max<uint64_t>(stats.frames, 1) << " draws, recording " << std::setw(7) << recordMs << " ms";
+            if (gpuMs > 0.0) {
+                std::cout << ", GPU " << std::setw(7) << gpuMs << " ms";
+            }
+            if (mode == MultiviewMode::SeparatePasses) {
+                separateRecordMs = recordMs;
+                separateGpuMs = gpuMs;
+            } else {
+                std::cout << ", recording " << separateRecordMs / std::max(recordMs, 1e-6) << "x faster";
+                if (gpuMs > 0.0 && separateGpuMs > 0.0) {
+                    std::cout << ", GPU " << separateGpuMs / gpuMs << "x faster";
+                }
+            }
+            std::cout << '\n';
+        }
+    };
+    
+    measure("small draws", multiviewTriangle, gridTransforms);
+    measure("heavy geometry", modelMesh, modelTransforms);
+    
+    benchmarkMultiviewDraws = nullptr;
+    deviceTable.vkDeviceWaitIdle(device);
+    modelMesh.destroy();
+    multiview.setMode(multiviewSupported ? MultiviewMode::Multiview : MultiviewMode::SeparatePasses);
+}
+
 /****************************** Helper functions start ******************************/
 
 // Vulkan Instance creation
@@ -864,10 +3058,11 @@ std::vector<const char*> HelloTriangleApplication::getRequiredExtensions() {
 #ifndef WIN
     // From SDK 1.3.216 onwards
     extensions.push_back(VK_KHR_PORTABILITY_ENUMERATION_EXTENSION_NAME);
+#endif // !WIN
 
+    // Queries the features and properties of optional device extensions, also
     // https://vulkan.lunarg.com/doc/view/1.3.236.0/mac/1.3-extensions/vkspec.html#VUID-vkCreateDevice-ppEnabledExtensionNames-01387
-    extensions.push_back("VK_KHR_get_physical_device_properties2");
-#endif // !WIN
+    extensions.push_back(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
     
     return extensions;
 }
@@ -904,7 +3099,8 @@ void HelloTriangleApplication::populateDebugMessengerCreateInfo(VkDebugUtilsMess
     createInfo.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_MESSENGER_CREATE_INFO_EXT;
     createInfo.messageSeverity = VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT;
     createInfo.messageType = VK_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT;
-    createInfo.pfnUserCallback = debugCallback;
+    createInfo.pfnUserCallback = ValidationLogger::debugCallback;
+    createInfo.pUserData = &validationLogger;
 }
 
 // Logical and Physical Device
@@ -912,24 +3108,31 @@ void HelloTriangleApplication::populateDebugMessengerCreateInfo(VkDebugUtilsMess
 QueueFamilyIndices HelloTriangleApplication::findQueueFamilies(VkPhysicalDevice device) {
     QueueFamilyIndices indices;
     uint32_t queueFamilyCount = 0;
-    vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, nullptr);
+    instanceTable.vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, nullptr);
     
     std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
-    vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, queueFamilies.data());
+    instanceTable.vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, queueFamilies.data());
     
     int i = 0;
     for (const auto& queueFamily : queueFamilies) {
-        if (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
-            indices.graphicsFamily = i;
+        // Keeps looking for a compute family once complete, without changing the families found so far
+        if (!indices.isComplete()) {
+            if (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
+                indices.graphicsFamily = i;
+            }
+            
+            VkBool32 presentSupport = false;
+            instanceTable.vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
+            if (presentSupport) {
+                indices.presentFamily = i;
+            }
         }
         
-        VkBool32 presentSupport = false;
-        vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
-        if (presentSupport) {
-            indices.presentFamily = i;
+        if (!indices.computeFamily.has_value() && (queueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT) && !(queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT)) {
+            indices.computeFamily = i;
         }
         
-        if (indices.isComplete()) {
+        if (indices.isComplete() && indices.computeFamily.has_value()) {
             break;
         }
         
@@ -955,10 +3158,10 @@ bool HelloTriangleApplication::isDeviceSuitable(VkPhysicalDevice device) {
 
 bool HelloTriangleApplication::checkDeviceExtensionSupport(VkPhysicalDevice device) {
     uint32_t extensionCount;
-    vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+    instanceTable.vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
     
     std::vector<VkExtensionProperties> availableExtensions(extensionCount);
-    vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data());
+    instanceTable.vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data());
     
     std::set<std::string> requiredExtensions(deviceExtensions.begin(), deviceExtensions.end());
     
@@ -973,29 +3176,60 @@ bool HelloTriangleApplication::checkDeviceExtensionSupport(VkPhysicalDevice devi
     return requiredExtensions.empty();
 }
 
+bool HelloTriangleApplication::checkOptionalDeviceExtensionSupport(VkPhysicalDevice device, const char* extensionName) {
+    uint32_t extensionCount;
+    instanceTable.vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+    
+    std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+    instanceTable.vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data());
+    
+    for (const auto& extension : availableExtensions) {
+        if (strcmp(extension.extensionName, extensionName) == 0) {
+            return true;
+        }
+    }
+    
+    return false;
+}
+
 // Swap chain
 
+VkFormat HelloTriangleApplication::findDepthFormat() {
+    // 32 bit float first, reversed Z only pays off with a floating point depth buffer
+    const VkFormat candidates[] = {VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT};
+    
+    for (VkFormat format : candidates) {
+        VkFormatProperties properties;
+        instanceTable.vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &properties);
+        if (properties.optimalTilingFeatures & VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT) {
+            return format;
+        }
+    }
+    
+    throw std::runtime_error("failed to find a supported depth format!");
+}
+
 SwapChainSupportDetails HelloTriangleApplication::querySwapChainSupport(VkPhysicalDevice device) {
     SwapChainSupportDetails details;
     
     // swap chain surface capabilities
-    vkGetPhysicalDeviceSurfaceCapabilitiesKHR(device, surface, &details.capabilities);
+    instanceTable.vkGetPhysicalDeviceSurfaceCapabilitiesKHR(device, surface, &details.capabilities);
     
     // swap chain surface formats
     uint32_t formatCount;
-    vkGetPhysicalDeviceSurfaceFormatsKHR(device, surface, &formatCount, nullptr);
+    instanceTable.vkGetPhysicalDeviceSurfaceFormatsKHR(device, surface, &formatCount, nullptr);
     
     if (formatCount != 0) {
         details.formats.resize(formatCount);
-        vkGetPhysicalDeviceSurfaceFormatsKHR(device, surface, &formatCount, details.formats.data());
+        instanceTable.vkGetPhysicalDeviceSurfaceFormatsKHR(device, surface, &formatCount, details.formats.data());
     }
     
     uint32_t presentModeCount;
-    vkGetPhysicalDeviceSurfacePresentModesKHR(device, surface, &presentModeCount, nullptr);
+    instanceTable.vkGetPhysicalDeviceSurfacePresentModesKHR(device, surface, &presentModeCount, nullptr);
     
     if (presentModeCount != 0) {
         details.presentModes.resize(presentModeCount);
-        vkGetPhysicalDeviceSurfacePresentModesKHR(device, surface, &presentModeCount, details.presentModes.data());
+        instanceTable.vkGetPhysicalDeviceSurfacePresentModesKHR(device, surface, &presentModeCount, details.presentModes.data());
     }
     
     return details;
@@ -1040,46 +3274,47 @@ VkExtent2D HelloTriangleApplication::chooseSwapExtent(const VkSurfaceCapabilitie
     }
 }
 
-std::vector<char> HelloTriangleApplication::readFile(const std::string& filename) {
-    // ate: start reading at the end of the file
-    // binary: read the file as binary file (avoid text transformations)
-    std::ifstream file(filename, std::ios::ate | std::ios::binary);
+void HelloTriangleApplication::framebufferResizeCallback(GLFWwindow* window, int width, int height) {
+    auto app = reinterpret_cast<HelloTriangleApplication*>(glfwGetWindowUserPointer(window));
+    app->framebufferResized = true;
+    app->framePacer.requestRedraw();
+}
 
-    if (!file.is_open()) {
-        throw std::runtime_error("failed to open file!");
-    }
-    
-    // The advantage of starting to read at the end of the file is that we can use the read position to determine the size of the file and allocate a buffer
-    
-    size_t fileSize = (size_t) file.tellg();
-    std::vector<char> buffer(fileSize);
-    
-    // After that, we can seek back to the beginning of the file and read all of the bytes at once
-    file.seekg(0);
-    file.read(buffer.data(), fileSize);
-    
-    file.close();
+void HelloTriangleApplication::windowFocusCallback(GLFWwindow* window, int focused) {
+    auto app = reinterpret_cast<HelloTriangleApplication*>(glfwGetWindowUserPointer(window));
+    app->framePacer.setFocused(focused == GLFW_TRUE);
+}
 
-    return buffer;
+void HelloTriangleApplication::windowIconifyCallback(GLFWwindow* window, int iconified) {
+    auto app = reinterpret_cast<HelloTriangleApplication*>(glfwGetWindowUserPointer(window));
+    app->framePacer.setIconified(iconified == GLFW_TRUE);
 }
 
-VkShaderModule HelloTriangleApplication::createShaderModule(const std::vector<char>& code) {
-    VkShaderModuleCreateInfo createInfo{};
-    createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-    createInfo.codeSize = code.size();
-    createInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
-    
-    VkShaderModule shaderModule;
-    if (vkCreateShaderModule(device, &createInfo, nullptr, &shaderModule) != VK_SUCCESS) {
-        throw std::runtime_error("failed to create shader module!");
-    }
+void HelloTriangleApplication::windowRefreshCallback(GLFWwindow* window) {
+    auto app = reinterpret_cast<HelloTriangleApplication*>(glfwGetWindowUserPointer(window));
+    app->framePacer.requestRedraw();
+}
 
-    return shaderModule;
+// The camera polls the input state itself in updateCamera(), the callbacks only make sure a frame follows the input in on-demand mode
+
+void HelloTriangleApplication::keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods) {
+    auto app = reinterpret_cast<HelloTriangleApplication*>(glfwGetWindowUserPointer(window));
+    app->framePacer.requestRedraw();
 }
 
-void HelloTriangleApplication::framebufferResizeCallback(GLFWwindow* window, int width, int height) {
+void HelloTriangleApplication::cursorPosCallback(GLFWwindow* window, double x, double y) {
     auto app = reinterpret_cast<HelloTriangleApplication*>(glfwGetWindowUserPointer(window));
-    app->framebufferResized = true;
+    app->framePacer.requestRedraw();
+}
+
+void HelloTriangleApplication::mouseButtonCallback(GLFWwindow* window, int button, int action, int mods) {
+    auto app = reinterpret_cast<HelloTriangleApplication*>(glfwGetWindowUserPointer(window));
+    app->framePacer.requestRedraw();
+}
+
+void HelloTriangleApplication::scrollCallback(GLFWwindow* window, double x, double y) {
+    auto app = reinterpret_cast<HelloTriangleApplication*>(glfwGetWindowUserPointer(window));
+    app->framePacer.requestRedraw();
 }
 
 /****************************** Helper functions end ******************************/
@@ -0,0 +1,213 @@
+//
+//  ValidationLogger.cpp
+//  VulkanPractice
+//
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+#include "ValidationLogger.h"
+
+static void copyTruncated(char* dst, size_t dstSize, const char* src) {
+    if (src == nullptr) {
+        dst[0] = '\0';
+        return;
+    }
+
+    size_t length = strnlen(src, dstSize - 1);
+    memcpy(dst, src, length);
+    dst[length] = '\0';
+}
+
+ValidationLogger::~ValidationLogger() {
+    stop();
+}
+
+void ValidationLogger::start(const std::vector<int32_t>& mutedIds, uint32_t maxPerIdPerWindow, std::chrono::milliseconds rateWindow) {
+    if (running) return;
+
+    mutedMessageIds = mutedIds;
+    std::sort(mutedMessageIds.begin(), mutedMessageIds.end());
+    maxPerWindow = maxPerIdPerWindow;
+    window = rateWindow;
+
+    // Every slot starts out free for the lap that begins at its own index
+    for (size_t i = 0; i < RING_SIZE; i++) {
+        ring[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    enqueuePos.store(0, std::memory_order_relaxed);
+    dequeuePos = 0;
+    droppedMessages = 0;
+
+    running = true;
+    worker = std::thread(&ValidationLogger::run, this);
+}
+
+void ValidationLogger::stop() {
+    if (!running.exchange(false)) return;
+
+    if (worker.joinable()) {
+        worker.join();
+    }
+}
+
+bool ValidationLogger::isMuted(int32_t messageIdNumber) const {
+    return std::binary_search(mutedMessageIds.begin(), mutedMessageIds.end(), messageIdNumber);
+}
+
+void ValidationLogger::push(VkDebugUtilsMessageSeverityFlagBitsEXT severity, const VkDebugUtilsMessengerCallbackDataEXT* pCallbackData) {
+    if (isMuted(pCallbackData->messageIdNumber)) return;
+
+    // Bounded multi producer queue, a producer claims a slot by bumping enqueuePos
+    size_t pos = enqueuePos.load(std::memory_order_relaxed);
+    Slot* slot = nullptr;
+    for (;;) {
+        slot = &ring[pos & (RING_SIZE - 1)];
+        size_t sequence = slot->sequence.load(std::memory_order_acquire);
+        intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+
+        if (diff == 0) {
+            if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            // Ring is full, the logger thread is behind. Never block the driver thread for it
+            droppedMessages.fetch_add(1, std::memory_order_relaxed);
+            return;
+        } else {
+            pos = enqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+
+    slot->severity = severity;
+    slot->messageIdNumber = pCallbackData->messageIdNumber;
+    copyTruncated(slot->messageIdName, sizeof(slot->messageIdName), pCallbackData->pMessageIdName);
+    copyTruncated(slot->message, sizeof(slot->message), pCallbackData->pMessage);
+
+    slot->sequence.store(pos + 1, std::memory_order_release);
+}
+
+VKAPI_ATTR VkBool32 VKAPI_CALL ValidationLogger::debugCallback(
+                                                               VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity,
+                                                               VkDebugUtilsMessageTypeFlagsEXT messageType,
+                                                               const VkDebugUtilsMessengerCallbackDataEXT* pCallbackData,
+                                                               void* pUserData) {
+    if (messageSeverity >= VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT) {
+        // Message is important enough to show
+        auto logger = reinterpret_cast<ValidationLogger*>(pUserData);
+        if (logger != nullptr) {
+            logger->push(messageSeverity, pCallbackData);
+        } else {
+            std::cerr << "validation layer: " << pCallbackData->pMessage << '\n';
+        }
+    }
+
+    return VK_FALSE;
+}
+
+void ValidationLogger::run() {
+    while (running.load(std::memory_order_acquire)) {
+        bool didWork = drain();
+        flushSuppressed(std::chrono::steady_clock::now(), false);
+
+        if (!outputBuffer.empty()) {
+            std::cerr << outputBuffer;
+            std::cerr.flush();
+            outputBuffer.clear();
+        }
+
+        if (!didWork) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        }
+    }
+
+    // Messages emitted while tearing down the instance still need to go out
+    drain();
+    flushSuppressed(std::chrono::steady_clock::now(), true);
+    printSummary();
+
+    std::cerr << outputBuffer;
+    std::cerr.flush();
+    outputBuffer.clear();
+}
+
+bool ValidationLogger::drain() {
+    bool didWork = false;
+
+    for (;;) {
+        Slot& slot = ring[dequeuePos & (RING_SIZE - 1)];
+        size_t sequence = slot.sequence.load(std::memory_order_acquire);
+        if (sequence != dequeuePos + 1) {
+            break;
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        IdState& state = idStates[slot.messageIdNumber];
+        if (state.total == 0) {
+            state.name = slot.messageIdName;
+            state.windowStart = now;
+        }
+        state.total++;
+
+        if (now - state.windowStart >= window) {
+            // New rate window for this id, report what was folded in the last one
+            if (state.suppressedInWindow > 0) {
+                outputBuffer += "validation layer: [" + state.name + "] repeated " + std::to_string(state.suppressedInWindow) + " more times\n";
+            }
+            state.windowStart = now;
+            state.printedInWindow = 0;
+            state.suppressedInWindow = 0;
+        }
+
+        if (state.printedInWindow < maxPerWindow) {
+            state.printedInWindow++;
+            outputBuffer += "validation layer: ";
+            outputBuffer += slot.message;
+            outputBuffer += '\n';
+        } else {
+            state.suppressedInWindow++;
+        }
+
+        // Hand the slot back to producers for the next lap
+        slot.sequence.store(dequeuePos + RING_SIZE, std::memory_order_release);
+        dequeuePos++;
+        didWork = true;
+    }
+
+    return didWork;
+}
+
+void ValidationLogger::flushSuppressed(std::chrono::steady_clock::time_point now, bool force) {
+    for (auto& [id, state] : idStates) {
+        if (state.suppressedInWindow == 0) continue;
+
+        if (force || now - state.windowStart >= window) {
+            outputBuffer += "validation layer: [" + state.name + "] repeated " + std::to_string(state.suppressedInWindow) + " more times\n";
+            state.windowStart = now;
+            state.printedInWindow = 0;
+            state.suppressedInWindow = 0;
+        }
+    }
+}
+
+void ValidationLogger::printSummary() {
+    uint64_t dropped = droppedMessages.load(std::memory_order_relaxed);
+    if (idStates.empty() && dropped == 0) return;
+
+    std::vector<std::pair<int32_t, const IdState*>> sorted;
+    for (const auto& [id, state] : idStates) {
+        sorted.emplace_back(id, &state);
+    }
+    std::sort(sorted.begin(), sorted.end(), [](const auto& a, const auto& b) {
+        return a.second->total > b.second->total;
+    });
+
+    outputBuffer += "Validation message summary:\n";
+    for (const auto& [id, state] : sorted) {
+        outputBuffer += '\t' + std::to_string(state->total) + "x [" + state->name + "] id " + std::to_string(id) + '\n';
+    }
+    if (dropped > 0) {
+        outputBuffer += '\t' + std::to_string(dropped) + " messages dropped, ring buffer was full\n";
+    }
+}
@@ -0,0 +1,41 @@
+//
+//  VulkanDispatch.cpp
+//  VulkanPractice
+//
+
+#include <stdexcept>
+#include <string>
+
+#include "VulkanDispatch.h"
+
+void InstanceDispatch::load(VkInstance instance) {
+#define VK_LOAD_REQUIRED(name) \
+    name = reinterpret_cast<PFN_##name>(vkGetInstanceProcAddr(instance, #name)); \
+    if (name == nullptr) { \
+        throw std::runtime_error(std::string("failed to load instance function ") + #name); \
+    }
+#define VK_LOAD_OPTIONAL(name) \
+    name = reinterpret_cast<PFN_##name>(vkGetInstanceProcAddr(instance, #name));
+
+    VK_INSTANCE_FUNCTIONS(VK_LOAD_REQUIRED)
+    VK_INSTANCE_OPTIONAL_FUNCTIONS(VK_LOAD_OPTIONAL)
+
+#undef VK_LOAD_OPTIONAL
+#undef VK_LOAD_REQUIRED
+}
+
+void DeviceDispatch::load(const InstanceDispatch& instanceTable, VkDevice device) {
+#define VK_LOAD_REQUIRED(name) \
+    name = reinterpret_cast<PFN_##name>(instanceTable.vkGetDeviceProcAddr(device, #name)); \
+    if (name == nullptr) { \
+        throw std::runtime_error(std::string("failed to load device function ") + #name); \
+    }
+#define VK_LOAD_OPTIONAL(name) \
+    name = reinterpret_cast<PFN_##name>(instanceTable.vkGetDeviceProcAddr(device, #name));
+
+    VK_DEVICE_FUNCTIONS(VK_LOAD_REQUIRED)
+    VK_DEVICE_OPTIONAL_FUNCTIONS(VK_LOAD_OPTIONAL)
+
+#undef VK_LOAD_OPTIONAL
+#undef VK_LOAD_REQUIRED
+}
@@ -0,0 +1,413 @@
+//
+//  WindowView.cpp
+//  VulkanPractice
+//
+
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <stdexcept>
+
+#include "VulkanMemory.h"
+#include "WindowView.h"
+
+void WindowView::init(VkInstance instance, const InstanceDispatch& instanceTable, VkPhysicalDevice physicalDevice, VkDevice device,
+                      const DeviceDispatch* deviceTable, const VkAllocationCallbacks* allocator, uint32_t graphicsFamily,
+                      uint32_t presentFamily, VkFormat depthFormat, uint32_t frameSlots, const std::string& title, int width, int height) {
+    this->instance = instance;
+    this->instanceTable = &instanceTable;
+    this->physicalDevice = physicalDevice;
+    this->device = device;
+    this->deviceTable = deviceTable;
+    this->allocator = allocator;
+    this->graphicsFamily = graphicsFamily;
+    this->presentFamily = presentFamily;
+    this->depthFormat = depthFormat;
+
+    instanceTable.vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+
+    // The hints of the main window may have made it fixed size, views can always be resized
+    glfwDefaultWindowHints();
+    glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+    window = glfwCreateWindow(width, height, title.c_str(), nullptr, nullptr);
+    if (window == nullptr) {
+        throw std::runtime_error("failed to create view window!");
+    }
+    glfwSetWindowUserPointer(window, this);
+    glfwSetFramebufferSizeCallback(window, framebufferResizeCallback);
+
+    if (glfwCreateWindowSurface(instance, window, allocator, &surface) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create view window surface!");
+    }
+
+    // Every swap chain of a vkQueuePresentKHR call is presented on the same queue
+    VkBool32 presentSupport = VK_FALSE;
+    instanceTable.vkGetPhysicalDeviceSurfaceSupportKHR(physicalDevice, presentFamily, surface, &presentSupport);
+    if (!presentSupport) {
+        throw std::runtime_error("the present queue can't present to the view window!");
+    }
+
+    uint32_t formatCount = 0;
+    instanceTable.vkGetPhysicalDeviceSurfaceFormatsKHR(physicalDevice, surface, &formatCount, nullptr);
+    std::vector<VkSurfaceFormatKHR> formats(formatCount);
+    instanceTable.vkGetPhysicalDeviceSurfaceFormatsKHR(physicalDevice, surface, &formatCount, formats.data());
+    if (formats.empty()) {
+        throw std::runtime_error("view window surface has no formats!");
+    }
+    surfaceFormat = formats[0];
+    for (const VkSurfaceFormatKHR& format : formats) {
+        if (format.format == VK_FORMAT_B8G8R8A8_SRGB && format.colorSpace == VK_COLOR_SPACE_SRGB_NONLINEAR_KHR) {
+            surfaceFormat = format;
+            break;
+        }
+    }
+
+    uint32_t presentModeCount = 0;
+    instanceTable.vkGetPhysicalDeviceSurfacePresentModesKHR(physicalDevice, surface, &presentModeCount, nullptr);
+    std::vector<VkPresentModeKHR> presentModes(presentModeCount);
+    instanceTable.vkGetPhysicalDeviceSurfacePresentModesKHR(physicalDevice, surface, &presentModeCount, presentModes.data());
+    presentMode = std::find(presentModes.begin(), presentModes.end(), VK_PRESENT_MODE_MAILBOX_KHR) != presentModes.end()
+        ? VK_PRESENT_MODE_MAILBOX_KHR : VK_PRESENT_MODE_FIFO_KHR;
+
+    createRenderPass();
+
+    VkSemaphoreCreateInfo semaphoreInfo{};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    imageAvailableSemaphores.resize(frameSlots);
+    for (VkSemaphore& semaphore : imageAvailableSemaphores) {
+        if (deviceTable->vkCreateSemaphore(device, &semaphoreInfo, allocator, &semaphore) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create view semaphores!");
+        }
+    }
+
+    createSwapChain();
+}
+
+void WindowView::destroy() {
+    if (window == nullptr) return;
+
+    cleanupSwapChain();
+    for (VkSemaphore semaphore : imageAvailableSemaphores) {
+        deviceTable->vkDestroySemaphore(device, semaphore, allocator);
+    }
+    imageAvailableSemaphores.clear();
+    deviceTable->vkDestroyRenderPass(device, viewRenderPass, allocator);
+    instanceTable->vkDestroySurfaceKHR(instance, surface, allocator);
+    glfwDestroyWindow(window);
+
+    viewRenderPass = VK_NULL_HANDLE;
+    surface = VK_NULL_HANDLE;
+    window = nullptr;
+}
+
+void WindowView::createRenderPass() {
+    // Rendered straight into the swap chain image, which is presented right after
+    VkAttachmentDescription colorAttachment{};
+    colorAttachment.format = surfaceFormat.format;
+    colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+    colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+
+    // Reversed Z like the main window
+    VkAttachmentDescription depthAttachment{};
+    depthAttachment.format = depthFormat;
+    depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+    depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+    VkAttachmentReference colorAttachmentRef{};
+    colorAttachmentRef.attachment = 0;
+    colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+    VkAttachmentReference depthAttachmentRef{};
+    depthAttachmentRef.attachment = 1;
+    depthAttachmentRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+    VkSubpassDescription subpass{};
+    subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    subpass.colorAttachmentCount = 1;
+    subpass.pColorAttachments = &colorAttachmentRef;
+    subpass.pDepthStencilAttachment = &depthAttachmentRef;
+
+    // Waits for the acquired image, and for the depth tests of the previous frame on the shared depth buffer
+    VkSubpassDependency dependency{};
+    dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
+    dependency.dstSubpass = 0;
+    dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+    dependency.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+    dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+    std::array<VkAttachmentDescription, 2> attachments = {colorAttachment, depthAttachment};
+
+    VkRenderPassCreateInfo renderPassInfo{};
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+    renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+    renderPassInfo.pAttachments = attachments.data();
+    renderPassInfo.subpassCount = 1;
+    renderPassInfo.pSubpasses = &subpass;
+    renderPassInfo.dependencyCount = 1;
+    renderPassInfo.pDependencies = &dependency;
+
+    if (deviceTable->vkCreateRenderPass(device, &renderPassInfo, allocator, &viewRenderPass) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create view render pass!");
+    }
+}
+
+void WindowView::createSwapChain() {
+    VkSurfaceCapabilitiesKHR capabilities;
+    instanceTable->vkGetPhysicalDeviceSurfaceCapabilitiesKHR(physicalDevice, surface, &capabilities);
+
+    if (capabilities.currentExtent.width != std::numeric_limits<uint32_t>::max()) {
+        swapChainExtent = capabilities.currentExtent;
+    } else {
+        int width, height;
+        glfwGetFramebufferSize(window, &width, &height);
+        swapChainExtent.width = std::clamp(static_cast<uint32_t>(width), capabilities.minImageExtent.width, capabilities.maxImageExtent.width);
+        swapChainExtent.height = std::clamp(static_cast<uint32_t>(height), capabilities.minImageExtent.height, capabilities.maxImageExtent.height);
+    }
+
+    uint32_t imageCount = capabilities.minImageCount + 1;
+    if (capabilities.maxImageCount > 0 && imageCount > capabilities.maxImageCount) {
+        imageCount = capabilities.maxImageCount;
+    }
+
+    VkSwapchainCreateInfoKHR createInfo{};
+    createInfo.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
+    createInfo.surface = surface;
+    createInfo.minImageCount = imageCount;
+    createInfo.imageFormat = surfaceFormat.format;
+    createInfo.imageColorSpace = surfaceFormat.colorSpace;
+    createInfo.imageExtent = swapChainExtent;
+    createInfo.imageArrayLayers = 1;
+    createInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+
+    uint32_t queueFamilyIndices[] = {graphicsFamily, presentFamily};
+    if (graphicsFamily != presentFamily) {
+        createInfo.imageSharingMode = VK_SHARING_MODE_CONCURRENT;
+        createInfo.queueFamilyIndexCount = 2;
+        createInfo.pQueueFamilyIndices = queueFamilyIndices;
+    } else {
+        createInfo.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    }
+
+    createInfo.preTransform = capabilities.currentTransform;
+    createInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
+    createInfo.presentMode = presentMode;
+    createInfo.clipped = VK_TRUE;
+    createInfo.oldSwapchain = VK_NULL_HANDLE;
+
+    if (deviceTable->vkCreateSwapchainKHR(device, &createInfo, allocator, &viewSwapChain) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create view swap chain!");
+    }
+
+    deviceTable->vkGetSwapchainImagesKHR(device, viewSwapChain, &imageCount, nullptr);
+    swapChainImages.resize(imageCount);
+    deviceTable->vkGetSwapchainImagesKHR(device, viewSwapChain, &imageCount, swapChainImages.data());
+
+    swapChainImageViews.resize(imageCount);
+    for (uint32_t i = 0; i < imageCount; i++) {
+        VkImageViewCreateInfo viewInfo{};
+        viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        viewInfo.image = swapChainImages[i];
+        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        viewInfo.format = surfaceFormat.format;
+        viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        viewInfo.subresourceRange.levelCount = 1;
+        viewInfo.subresourceRange.layerCount = 1;
+
+        if (deviceTable->vkCreateImageView(device, &viewInfo, allocator, &swapChainImageViews[i]) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create view image views!");
+        }
+    }
+
+    // One depth buffer for every frame in flight, the render passes of a queue run one after another
+    VkImageCreateInfo imageInfo{};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.format = depthFormat;
+    imageInfo.extent = {swapChainExtent.width, swapChainExtent.height, 1};
+    imageInfo.mipLevels = 1;
+    imageInfo.arrayLayers = 1;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+    if (deviceTable->vkCreateImage(device, &imageInfo, allocator, &depthImage) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create view depth image!");
+    }
+
+    VkMemoryRequirements memoryRequirements;
+    deviceTable->vkGetImageMemoryRequirements(device, depthImage, &memoryRequirements);
+
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = memoryRequirements.size;
+    allocInfo.memoryTypeIndex = findMemoryType(memoryProperties, memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+    if (deviceTable->vkAllocateMemory(device, &allocInfo, allocator, &depthImageMemory) != VK_SUCCESS) {
+        throw std::runtime_error("failed to allocate view depth image memory!");
+    }
+    deviceTable->vkBindImageMemory(device, depthImage, depthImageMemory, 0);
+
+    VkImageViewCreateInfo depthViewInfo{};
+    depthViewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    depthViewInfo.image = depthImage;
+    depthViewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    depthViewInfo.format = depthFormat;
+    depthViewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+    depthViewInfo.subresourceRange.levelCount = 1;
+    depthViewInfo.subresourceRange.layerCount = 1;
+
+    if (deviceTable->vkCreateImageView(device, &depthViewInfo, allocator, &depthImageView) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create view depth image view!");
+    }
+
+    framebuffers.resize(imageCount);
+    for (uint32_t i = 0; i < imageCount; i++) {
+        std::array<VkImageView, 2> attachments = {swapChainImageViews[i], depthImageView};
+
+        VkFramebufferCreateInfo framebufferInfo{};
+        framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+        framebufferInfo.renderPass = viewRenderPass;
+        framebufferInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+        framebufferInfo.pAttachments = attachments.data();
+        framebufferInfo.width = swapChainExtent.width;
+        framebufferInfo.height = swapChainExtent.height;
+        framebufferInfo.layers = 1;
+
+        if (deviceTable->vkCreateFramebuffer(device, &framebufferInfo, allocator, &framebuffers[i]) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create view framebuffer!");
+        }
+    }
+}
+
+void WindowView::cleanupSwapChain() {
+    if (viewSwapChain == VK_NULL_HANDLE) return;
+
+    for (VkFramebuffer framebuffer : framebuffers) {
+        deviceTable->vkDestroyFramebuffer(device, framebuffer, allocator);
+    }
+    framebuffers.clear();
+
+    deviceTable->vkDestroyImageView(device, depthImageView, allocator);
+    deviceTable->vkDestroyImage(device, depthImage, allocator);
+    deviceTable->vkFreeMemory(device, depthImageMemory, allocator);
+
+    for (VkImageView imageView : swapChainImageViews) {
+        deviceTable->vkDestroyImageView(device, imageView, allocator);
+    }
+    swapChainImageViews.clear();
+
+    deviceTable->vkDestroySwapchainKHR(device, viewSwapChain, allocator);
+    viewSwapChain = VK_NULL_HANDLE;
+}
+
+bool WindowView::recreateSwapChain() {
+    // A minimized window has no extent to create a swap chain with, the view sits out until it comes back
+    int width = 0, height = 0;
+    glfwGetFramebufferSize(window, &width, &height);
+    if (width == 0 || height == 0) return false;
+
+    // Frames in flight may still render to or present the old images. The other windows keep their swap chains
+    deviceTable->vkDeviceWaitIdle(device);
+
+    cleanupSwapChain();
+    createSwapChain();
+
+    framebufferResized = false;
+    outOfDate = false;
+    return true;
+}
+
+bool WindowView::acquire(uint32_t frameSlot) {
+    acquired = false;
+
+    if ((outOfDate || framebufferResized || viewSwapChain == VK_NULL_HANDLE) && !recreateSwapChain()) {
+        return false;
+    }
+
+    // No timeout: the main window already waited for its image, a view that has none ready sits this frame out
+    VkResult result = deviceTable->vkAcquireNextImageKHR(device, viewSwapChain, 0, imageAvailableSemaphores[frameSlot],
+                                                         VK_NULL_HANDLE, &acquiredImage);
+    if (result == VK_NOT_READY || result == VK_TIMEOUT) {
+        return false;
+    }
+    if (result == VK_ERROR_OUT_OF_DATE_KHR) {
+        outOfDate = true;
+        if (redrawCallback) redrawCallback();
+        return false;
+    }
+    if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
+        throw std::runtime_error("failed to acquire view swap chain image!");
+    }
+
+    // A suboptimal image is still used, the swap chain is recreated after it was presented
+    if (result == VK_SUBOPTIMAL_KHR) {
+        outOfDate = true;
+    }
+    acquired = true;
+    return true;
+}
+
+void WindowView::beginRenderPass(VkCommandBuffer commandBuffer) {
+    VkRenderPassBeginInfo renderPassInfo{};
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+    renderPassInfo.renderPass = viewRenderPass;
+    renderPassInfo.framebuffer = framebuffers[acquiredImage];
+    renderPassInfo.renderArea.offset = {0, 0};
+    renderPassInfo.renderArea.extent = swapChainExtent;
+
+    std::array<VkClearValue, 2> clearValues{};
+    clearValues[0].color = {{0.0f, 0.0f, 0.0f, 1.0f}};
+    clearValues[1].depthStencil = {0.0f, 0};
+    renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
+    renderPassInfo.pClearValues = clearValues.data();
+
+    deviceTable->vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+    VkViewport viewport{};
+    viewport.width = static_cast<float>(swapChainExtent.width);
+    viewport.height = static_cast<float>(swapChainExtent.height);
+    viewport.maxDepth = 1.0f;
+    deviceTable->vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+
+    VkRect2D scissor{};
+    scissor.extent = swapChainExtent;
+    deviceTable->vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+}
+
+void WindowView::endRenderPass(VkCommandBuffer commandBuffer) {
+    deviceTable->vkCmdEndRenderPass(commandBuffer);
+}
+
+void WindowView::presented(VkResult result) {
+    acquired = false;
+
+    if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR) {
+        outOfDate = true;
+    } else if (result != VK_SUCCESS) {
+        throw std::runtime_error("failed to present view swap chain image!");
+    }
+
+    // Recreated on the next acquire, by then the next frame wants to be drawn anyway
+    if ((outOfDate || framebufferResized) && redrawCallback) {
+        redrawCallback();
+    }
+}
+
+void WindowView::framebufferResizeCallback(GLFWwindow* window, int width, int height) {
+    auto view = reinterpret_cast<WindowView*>(glfwGetWindowUserPointer(window));
+    view->framebufferResized = true;
+    if (view->redrawCallback) view->redrawCallback();
+}
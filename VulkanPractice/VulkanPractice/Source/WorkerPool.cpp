@@ -0,0 +1,105 @@
+//
+//  WorkerPool.cpp
+//  VulkanPractice
+//
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+#include "Profiler.h"
+#include "WorkerPool.h"
+
+WorkerPool::~WorkerPool() {
+    destroy();
+}
+
+void WorkerPool::init(uint32_t threadCount) {
+    if (!workers.empty()) {
+        throw std::runtime_error("worker pool initialized twice!");
+    }
+    if (threadCount == 0) {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    stopWorkers = false;
+    for (uint32_t thread = 1; thread < threadCount; thread++) {
+        workers.emplace_back(&WorkerPool::workerLoop, this, thread);
+    }
+}
+
+void WorkerPool::destroy() {
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        stopWorkers = true;
+    }
+    workSignal.notify_all();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+    workers.clear();
+}
+
+void WorkerPool::parallelFor(size_t count, size_t minPerThread, size_t granularity, const RangeFunction& function) {
+    if (count == 0) return;
+
+    granularity = std::max<size_t>(1, granularity);
+    const size_t threads = std::min<size_t>(threadCount(), std::max<size_t>(1, count / std::max<size_t>(1, minPerThread)));
+    currentFunction = &function;
+    currentCount = count;
+    currentPerThread = ((count + threads - 1) / threads + granularity - 1) / granularity * granularity;
+
+    if (threads == 1) {
+        runRange(0);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        generation++;
+        pendingWorkers = static_cast<uint32_t>(workers.size());
+    }
+    workSignal.notify_all();
+
+    runRange(0);
+
+    std::unique_lock<std::mutex> guard(mutex);
+    doneSignal.wait(guard, [this] { return pendingWorkers == 0; });
+}
+
+void WorkerPool::runRange(uint32_t thread) const {
+    const size_t begin = std::min(currentCount, thread * currentPerThread);
+    const size_t end = std::min(currentCount, begin + currentPerThread);
+    if (begin < end) {
+        PROFILE_ZONE("parallelFor range");
+        (*currentFunction)(thread, begin, end);
+    }
+}
+
+void WorkerPool::workerLoop(uint32_t thread) {
+    // Registering a thread allocates its zone buffer, only worth it when zones are recorded
+    if (Profiler::enabled()) {
+        Profiler::setThreadName("worker " + std::to_string(thread));
+    }
+
+    uint64_t seenGeneration = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> guard(mutex);
+            workSignal.wait(guard, [&] { return stopWorkers || generation != seenGeneration; });
+            if (stopWorkers) return;
+            seenGeneration = generation;
+        }
+
+        runRange(thread);
+
+        bool last;
+        {
+            std::lock_guard<std::mutex> guard(mutex);
+            last = --pendingWorkers == 0;
+        }
+        if (last) {
+            doneSignal.notify_one();
+        }
+    }
+}
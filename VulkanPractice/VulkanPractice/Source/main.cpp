@@ -5,13 +5,104 @@
 //  Created by Anudeep on 26/04/23.
 //
 
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
 #include "VKSetup.h"
 
-int main() {
+int main(int argc, char* argv[]) {
     HelloTriangleApplication app;
     
     try {
-        app.run();
+        std::string benchmark;
+        std::optional<CaptureSettings> capture;
+        std::optional<StreamSettings> stream;
+        
+        // Every option takes a value
+        for (int i = 1; i < argc; i += 2) {
+            if (i + 1 >= argc) {
+                throw std::runtime_error(std::string("missing value for ") + argv[i]);
+            }
+            const char* option = argv[i];
+            const char* value = argv[i + 1];
+            
+            if (strcmp(option, "--bench") == 0) {
+                // --bench <name> runs one of the benchmarks instead of the render loop
+                benchmark = value;
+            } else if (strcmp(option, "--model") == 0) {
+                // --model <file.obj|file.glb> model the mesh benchmarks load
+                app.setModelPath(value);
+            } else if (strcmp(option, "--trace") == 0) {
+                // --trace <file.json> writes the profiling zones as a Chrome trace, for chrome://tracing or ui.perfetto.dev
+                app.setTracePath(value);
+            } else if (strcmp(option, "--memory-budget") == 0) {
+                // --memory-budget <MiB> caps the device local heaps at a simulated budget, to exercise eviction
+                app.setSimulatedMemoryBudget(strtoull(value, nullptr, 10) * 1024 * 1024);
+            } else if (strcmp(option, "--windows") == 0) {
+                // --windows <n> renders the scene to n windows, presented together
+                app.setWindowCount(static_cast<uint32_t>(std::max(atoi(value), 1)));
+            } else if (strcmp(option, "--multiview") == 0) {
+                // --multiview <n> renders the scene from n cameras side by side, in one multiview render pass when supported
+                app.setMultiviewCount(static_cast<uint32_t>(std::max(atoi(value), 1)));
+            } else if (strcmp(option, "--pacing") == 0) {
+                // --pacing unlimited | ondemand | <fps> selects how the render loop paces frames
+                if (strcmp(value, "unlimited") == 0) {
+                    app.setFramePacing(FramePacingMode::Unlimited, 0.0);
+                } else if (strcmp(value, "ondemand") == 0) {
+                    app.setFramePacing(FramePacingMode::OnDemand, 0.0);
+                } else {
+                    app.setFramePacing(FramePacingMode::Limited, atof(value));
+                }
+            } else if (strcmp(option, "--capture") == 0) {
+                // --capture <file.png|file.ppm> writes one frame and exits
+                if (!capture) capture.emplace();
+                capture->outputPath = value;
+            } else if (strcmp(option, "--golden") == 0) {
+                // --golden <file.ppm> compares one frame against a golden image and fails when they differ
+                if (!capture) capture.emplace();
+                capture->goldenPath = value;
+            } else if (strcmp(option, "--tolerance") == 0) {
+                // --tolerance <n> allowed difference per channel for --golden
+                if (!capture) capture.emplace();
+                uint8_t tolerance = static_cast<uint8_t>(std::clamp(atoi(value), 0, 255));
+                capture->tolerance = {tolerance, tolerance, tolerance};
+            } else if (strcmp(option, "--capture-frame") == 0) {
+                // --capture-frame <n> which frame --capture and --golden look at
+                if (!capture) capture.emplace();
+                capture->frame = strtoull(value, nullptr, 10);
+            } else if (strcmp(option, "--stream") == 0) {
+                // --stream <path> | - writes every frame as raw video, e.g. for ffmpeg -f rawvideo -i -
+                if (!stream) stream.emplace();
+                stream->path = value;
+            } else if (strcmp(option, "--backpressure") == 0) {
+                // --backpressure block | drop what --stream does when the reader falls behind
+                if (!stream) stream.emplace();
+                if (strcmp(value, "block") == 0) {
+                    stream->backpressure = StreamBackpressure::Block;
+                } else if (strcmp(value, "drop") == 0) {
+                    stream->backpressure = StreamBackpressure::Drop;
+                } else {
+                    throw std::runtime_error(std::string("unknown backpressure: ") + value);
+                }
+            } else {
+                throw std::runtime_error(std::string("unknown option: ") + option);
+            }
+        }
+        
+        if (!benchmark.empty()) {
+            app.runBenchmark(benchmark);
+        } else {
+            if (capture) {
+                app.setCapture(*capture);
+            }
+            if (stream) {
+                app.setStream(*stream);
+            }
+            app.run();
+        }
     }
     catch (const std::exception& e) {
         std::cerr << e.what() << std::endl;
@@ -0,0 +1,369 @@
+#!/usr/bin/env python3
+#
+#  build_shaders.py
+#  VulkanPractice
+#
+#  Build step for the shaders, run by the Xcode and Visual Studio projects before compiling:
+#  1. Compiles every .vert/.frag/.comp next to this script with glslc -O, and the VARIANTS of them with their defines
+#  2. Runs the spirv-opt performance passes, then the size passes, and validates the result
+#  3. Reflects descriptor bindings, push constant size and workgroup size from the optimized SPIR-V
+#  4. Writes the words and the reflection into VulkanPractice/Generated/EmbeddedShaders.h as constexpr data,
+#     so the app neither reads shader files nor reflects anything when it starts
+#
+#  glslc, spirv-opt and spirv-val are looked up in $VULKAN_SDK first, then on PATH.
+#  The header is only rewritten when its contents change, so unchanged shaders don't trigger a rebuild.
+#
+
+import argparse
+import os
+import shutil
+import struct
+import subprocess
+import sys
+import tempfile
+
+SHADER_DIR = os.path.dirname(os.path.abspath(__file__))
+DEFAULT_OUTPUT = os.path.join(SHADER_DIR, "..", "VulkanPractice", "VulkanPractice", "Generated", "EmbeddedShaders.h")
+
+# Has to match VkApplicationInfo::apiVersion
+TARGET_ENV = "vulkan1.1"
+
+STAGES = {
+    ".vert": "VK_SHADER_STAGE_VERTEX_BIT",
+    ".frag": "VK_SHADER_STAGE_FRAGMENT_BIT",
+    ".comp": "VK_SHADER_STAGE_COMPUTE_BIT",
+}
+
+# Shaders compiled again from another source with defines, embedded as if they were files of their own
+VARIANTS = {
+    # For render passes without a view mask, on devices without the multiview feature
+    "multiview_layer.vert": ("multiview.vert", ["SINGLE_VIEW"]),
+}
+
+# SPIR-V opcodes, decorations and storage classes the reflection needs
+OP_NAME = 5
+OP_EXECUTION_MODE = 16
+OP_TYPE_BOOL = 20
+OP_TYPE_INT = 21
+OP_TYPE_FLOAT = 22
+OP_TYPE_VECTOR = 23
+OP_TYPE_MATRIX = 24
+OP_TYPE_IMAGE = 25
+OP_TYPE_SAMPLER = 26
+OP_TYPE_SAMPLED_IMAGE = 27
+OP_TYPE_ARRAY = 28
+OP_TYPE_RUNTIME_ARRAY = 29
+OP_TYPE_STRUCT = 30
+OP_TYPE_POINTER = 32
+OP_CONSTANT = 43
+OP_VARIABLE = 59
+OP_DECORATE = 71
+OP_MEMBER_DECORATE = 72
+
+DECORATION_BLOCK = 2
+DECORATION_BUFFER_BLOCK = 3
+DECORATION_ARRAY_STRIDE = 6
+DECORATION_MATRIX_STRIDE = 7
+DECORATION_BINDING = 33
+DECORATION_DESCRIPTOR_SET = 34
+DECORATION_OFFSET = 35
+
+STORAGE_UNIFORM_CONSTANT = 0
+STORAGE_UNIFORM = 2
+STORAGE_PUSH_CONSTANT = 9
+STORAGE_STORAGE_BUFFER = 12
+
+EXECUTION_MODE_LOCAL_SIZE = 17
+
+DIM_BUFFER = 5
+DIM_SUBPASS_DATA = 6
+
+
+class ShaderError(Exception):
+    pass
+
+
+def find_tool(name):
+    sdk = os.environ.get("VULKAN_SDK")
+    if sdk:
+        for directory in ("bin", "Bin"):
+            for candidate in (name, name + ".exe"):
+                path = os.path.join(sdk, directory, candidate)
+                if os.path.isfile(path):
+                    return path
+    path = shutil.which(name)
+    if path is None:
+        raise ShaderError(name + " not found, install the Vulkan SDK and set VULKAN_SDK or add it to PATH")
+    return path
+
+
+def run(command):
+    result = subprocess.run(command, stdout=subprocess.PIPE, stderr=subprocess.STDOUT, universal_newlines=True)
+    if result.returncode != 0:
+        raise ShaderError(" ".join(command) + "\n" + result.stdout)
+
+
+def read_words(path):
+    with open(path, "rb") as file:
+        data = file.read()
+    if len(data) % 4 != 0:
+        raise ShaderError(path + " is not SPIR-V")
+    words = list(struct.unpack("<%dI" % (len(data) // 4), data))
+    if not words or words[0] != 0x07230203:
+        raise ShaderError(path + " is not little endian SPIR-V")
+    return words
+
+
+def decode_string(words):
+    data = struct.pack("<%dI" % len(words), *words)
+    return data[:data.index(b"\0")].decode("utf-8")
+
+
+class Module:
+    """The parts of a SPIR-V module the reflection looks at, indexed by result id"""
+
+    def __init__(self, words):
+        self.names = {}
+        self.types = {}
+        self.constants = {}
+        self.variables = []
+        self.decorations = {}
+        self.member_decorations = {}
+        self.local_size = None
+
+        position = 5
+        while position < len(words):
+            count = words[position] >> 16
+            opcode = words[position] & 0xFFFF
+            if count == 0:
+                raise ShaderError("malformed SPIR-V")
+            operands = words[position + 1:position + count]
+            position += count
+
+            if opcode == OP_NAME:
+                self.names[operands[0]] = decode_string(operands[1:])
+            elif opcode == OP_EXECUTION_MODE and operands[1] == EXECUTION_MODE_LOCAL_SIZE:
+                self.local_size = tuple(operands[2:5])
+            elif opcode == OP_DECORATE:
+                self.decorations.setdefault(operands[0], {})[operands[1]] = operands[2:]
+            elif opcode == OP_MEMBER_DECORATE:
+                self.member_decorations.setdefault((operands[0], operands[1]), {})[operands[2]] = operands[3:]
+            elif opcode in (OP_TYPE_BOOL, OP_TYPE_INT, OP_TYPE_FLOAT, OP_TYPE_VECTOR, OP_TYPE_MATRIX, OP_TYPE_IMAGE, OP_TYPE_SAMPLER,
+                            OP_TYPE_SAMPLED_IMAGE, OP_TYPE_ARRAY, OP_TYPE_RUNTIME_ARRAY, OP_TYPE_STRUCT, OP_TYPE_POINTER):
+                self.types[operands[0]] = (opcode, operands[1:])
+            elif opcode == OP_CONSTANT:
+                self.constants[operands[1]] = operands[2]
+            elif opcode == OP_VARIABLE:
+                self.variables.append((operands[1], operands[0], operands[2]))
+
+    def has_decoration(self, id, decoration):
+        return decoration in self.decorations.get(id, {})
+
+    def decoration(self, id, decoration):
+        values = self.decorations.get(id, {}).get(decoration)
+        return values[0] if values else None
+
+    def size(self, type_id, matrix_stride=None):
+        """Bytes a type takes in a block, with the offsets and strides the compiler decorated it with"""
+        opcode, operands = self.types[type_id]
+        if opcode in (OP_TYPE_INT, OP_TYPE_FLOAT):
+            return operands[0] // 8
+        if opcode == OP_TYPE_BOOL:
+            return 4
+        if opcode == OP_TYPE_VECTOR:
+            return self.size(operands[0]) * operands[1]
+        if opcode == OP_TYPE_MATRIX:
+            # Column major, the stride is decorated on the struct member holding the matrix
+            return (matrix_stride or self.size(operands[0])) * operands[1]
+        if opcode == OP_TYPE_ARRAY:
+            return self.decoration(type_id, DECORATION_ARRAY_STRIDE) * self.constants[operands[1]]
+        if opcode == OP_TYPE_RUNTIME_ARRAY:
+            return 0
+        if opcode == OP_TYPE_STRUCT:
+            end = 0
+            for member, member_type in enumerate(operands):
+                decorations = self.member_decorations.get((type_id, member), {})
+                offset = decorations.get(DECORATION_OFFSET, [0])[0]
+                stride = decorations.get(DECORATION_MATRIX_STRIDE, [None])[0]
+                end = max(end, offset + self.size(member_type, stride))
+            return end
+        raise ShaderError("type %d has no size in a block" % type_id)
+
+    def descriptor(self, type_id, storage_class):
+        """Descriptor type, array size (0 for runtime arrays) and block size of a resource variable"""
+        count = 1
+        opcode, operands = self.types[type_id]
+        if opcode == OP_TYPE_ARRAY:
+            count = self.constants[operands[1]]
+            type_id = operands[0]
+        elif opcode == OP_TYPE_RUNTIME_ARRAY:
+            count = 0
+            type_id = operands[0]
+        opcode, operands = self.types[type_id]
+
+        if storage_class == STORAGE_STORAGE_BUFFER:
+            return "VK_DESCRIPTOR_TYPE_STORAGE_BUFFER", count, self.size(type_id)
+        if storage_class == STORAGE_UNIFORM:
+            if self.has_decoration(type_id, DECORATION_BUFFER_BLOCK):
+                return "VK_DESCRIPTOR_TYPE_STORAGE_BUFFER", count, self.size(type_id)
+            return "VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER", count, self.size(type_id)
+        if opcode == OP_TYPE_SAMPLED_IMAGE:
+            return "VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER", count, 0
+        if opcode == OP_TYPE_SAMPLER:
+            return "VK_DESCRIPTOR_TYPE_SAMPLER", count, 0
+        if opcode == OP_TYPE_IMAGE:
+            dim, sampled = operands[1], operands[5]
+            if dim == DIM_SUBPASS_DATA:
+                return "VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT", count, 0
+            if dim == DIM_BUFFER:
+                return ("VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER" if sampled == 2 else "VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER"), count, 0
+            return ("VK_DESCRIPTOR_TYPE_STORAGE_IMAGE" if sampled == 2 else "VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE"), count, 0
+        raise ShaderError("unsupported resource type %d" % type_id)
+
+
+def reflect(words):
+    module = Module(words)
+    bindings = []
+    push_constant_size = 0
+
+    for variable, pointer_type, storage_class in module.variables:
+        if storage_class not in (STORAGE_UNIFORM_CONSTANT, STORAGE_UNIFORM, STORAGE_PUSH_CONSTANT, STORAGE_STORAGE_BUFFER):
+            continue
+        pointee = module.types[pointer_type][1][1]
+
+        if storage_class == STORAGE_PUSH_CONSTANT:
+            push_constant_size = max(push_constant_size, module.size(pointee))
+            continue
+
+        descriptor_type, count, block_size = module.descriptor(pointee, storage_class)
+        name = module.names.get(variable) or module.names.get(pointee, "")
+        bindings.append((module.decoration(variable, DECORATION_DESCRIPTOR_SET) or 0,
+                         module.decoration(variable, DECORATION_BINDING) or 0,
+                         descriptor_type, count, block_size, name))
+
+    bindings.sort()
+    return bindings, push_constant_size, module.local_size or (0, 0, 0)
+
+
+def identifier(source):
+    """shader.vert -> shaderVert, post_bloom.comp -> postBloomComp"""
+    stem, extension = os.path.splitext(source)
+    parts = stem.replace("-", "_").split("_") + [extension[1:]]
+    return parts[0] + "".join(part[:1].upper() + part[1:] for part in parts[1:])
+
+
+def compile_shader(source, tools, temp):
+    input, defines = VARIANTS.get(source, (source, []))
+    source_path = os.path.join(SHADER_DIR, input)
+    compiled = os.path.join(temp, source + ".spv")
+    optimized = os.path.join(temp, source + ".opt.spv")
+    stripped = os.path.join(temp, source + ".min.spv")
+
+    run([tools["glslc"], "-O", "--target-env=" + TARGET_ENV] + ["-D" + define for define in defines] + [source_path, "-o", compiled])
+    # Performance passes first, then the size passes clean up what they left and drop the debug info.
+    # Reflection looks at the module in between, while the names are still there
+    run([tools["spirv-opt"], "-O", "--target-env=" + TARGET_ENV, compiled, "-o", optimized])
+    bindings, push_constant_size, local_size = reflect(read_words(optimized))
+    run([tools["spirv-opt"], "-Os", "--strip-debug", "--target-env=" + TARGET_ENV, optimized, "-o", stripped])
+    run([tools["spirv-val"], "--target-env", TARGET_ENV, stripped])
+
+    return read_words(stripped), bindings, push_constant_size, local_size
+
+
+def emit(shaders):
+    lines = [
+        "//",
+        "//  EmbeddedShaders.h",
+        "//  VulkanPractice",
+        "//",
+        "//  Generated by shaders/build_shaders.py, don't edit",
+        "//",
+        "",
+        "#pragma once",
+        "",
+        "#include \"ShaderReflection.h\"",
+        "",
+        "namespace shaders {",
+    ]
+
+    for source, words, bindings, push_constant_size, local_size in shaders:
+        name = identifier(source)
+        stage = STAGES[os.path.splitext(source)[1]]
+
+        lines.append("")
+        lines.append("// " + source)
+        lines.append("inline constexpr uint32_t %sCode[] = {" % name)
+        for start in range(0, len(words), 8):
+            lines.append("    " + ", ".join("0x%08x" % word for word in words[start:start + 8]) + ",")
+        lines.append("};")
+
+        if bindings:
+            lines.append("inline constexpr ReflectedBinding %sBindings[] = {" % name)
+            for set, binding, descriptor_type, count, block_size, variable in bindings:
+                comment = "    // " + variable if variable else ""
+                lines.append("    {%d, %d, %s, %d, %d},%s" % (set, binding, descriptor_type, count, block_size, comment))
+            lines.append("};")
+
+        lines.append("inline constexpr EmbeddedShader %s = {" % name)
+        lines.append("    \"%s\", %sCode, sizeof(%sCode), %s," % (source, name, name, stage))
+        if bindings:
+            lines.append("    %sBindings, %d," % (name, len(bindings)))
+        else:
+            lines.append("    nullptr, 0,")
+        lines.append("    %d, {%d, %d, %d}," % ((push_constant_size,) + tuple(local_size)))
+        lines.append("};")
+
+    lines.append("")
+    lines.append("}")
+    lines.append("")
+    return "\n".join(lines)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Compile, optimize, reflect and embed the shaders")
+    parser.add_argument("--output", default=DEFAULT_OUTPUT, help="generated header")
+    parser.add_argument("--force", action="store_true", help="rebuild even if the header is newer than every shader")
+    arguments = parser.parse_args()
+
+    output = os.path.abspath(arguments.output)
+    files = [name for name in os.listdir(SHADER_DIR) if os.path.splitext(name)[1] in STAGES]
+    sources = sorted(files + list(VARIANTS))
+
+    # Includes aren't followed, touch the including shader after changing one
+    inputs = [os.path.join(SHADER_DIR, source) for source in files] + [os.path.abspath(__file__)]
+    if not arguments.force and os.path.isfile(output):
+        built = os.path.getmtime(output)
+        if all(os.path.getmtime(path) <= built for path in inputs):
+            return 0
+
+    tools = {name: find_tool(name) for name in ("glslc", "spirv-opt", "spirv-val")}
+
+    shaders = []
+    with tempfile.TemporaryDirectory() as temp:
+        for source in sources:
+            words, bindings, push_constant_size, local_size = compile_shader(source, tools, temp)
+            shaders.append((source, words, bindings, push_constant_size, local_size))
+            print("%-20s %6d bytes, %d bindings, %d bytes of push constants" % (source, len(words) * 4, len(bindings), push_constant_size))
+
+    header = emit(shaders)
+    previous = None
+    if os.path.isfile(output):
+        with open(output, "r") as file:
+            previous = file.read()
+
+    if header != previous:
+        os.makedirs(os.path.dirname(output), exist_ok=True)
+        with open(output, "w", newline="\n") as file:
+            file.write(header)
+    else:
+        # Keeps the up to date check from compiling everything again next time
+        os.utime(output, None)
+    return 0
+
+
+if __name__ == "__main__":
+    try:
+        sys.exit(main())
+    except ShaderError as error:
+        print("build_shaders.py: error: " + str(error), file=sys.stderr)
+        sys.exit(1)
@@ -1,2 +1,3 @@
-/Users/lingadan/VulkanSDK/1.3.236.0/macOS/bin/glslc shader.vert -o vert.spv
-/Users/lingadan/VulkanSDK/1.3.236.0/macOS/bin/glslc shader.frag -o frag.spv
+# Compiles, optimizes and reflects the shaders into VulkanPractice/Generated/EmbeddedShaders.h.
+# The builds run this on their own, pass --force to rebuild when nothing changed
+python3 "$(dirname "$0")/build_shaders.py" "$@"
@@ -0,0 +1,14 @@
+#version 450
+
+layout(location = 0) in vec3 normal;
+layout(location = 1) in vec2 uv;
+layout(location = 2) in vec4 color;
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+    // Two sided diffuse from a fixed direction plus some ambient, enough to see the shape
+    const vec3 lightDirection = normalize(vec3(0.4, -0.6, 0.7));
+    float diffuse = abs(dot(normalize(normal), lightDirection));
+    outColor = vec4(color.rgb * (0.2 + 0.8 * diffuse), color.a);
+}
@@ -0,0 +1,38 @@
+#version 450
+
+// Quantized vertices come in as snorm16 positions inside the mesh bounds and octahedral snorm16 normals.
+// The vertex input unit already converted them to floats, only the bounds and the folding are left to undo
+layout(constant_id = 0) const bool QUANTIZED = false;
+
+layout(push_constant) uniform Draw {
+    mat4 transform;
+    vec4 boundsCenter;
+    vec4 boundsHalfExtent;
+} draw;
+
+layout(location = 0) in vec3 inPosition;
+// Octahedral encoding in xy when quantized
+layout(location = 1) in vec3 inNormal;
+layout(location = 2) in vec2 inUV;
+layout(location = 3) in vec4 inColor;
+
+layout(location = 0) out vec3 normal;
+layout(location = 1) out vec2 uv;
+layout(location = 2) out vec4 color;
+
+vec3 octahedralDecode(vec2 encoded) {
+    vec3 n = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+    if (n.z < 0.0) {
+        n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    }
+    return normalize(n);
+}
+
+void main() {
+    vec3 position = QUANTIZED ? draw.boundsCenter.xyz + inPosition * draw.boundsHalfExtent.xyz : inPosition;
+    gl_Position = draw.transform * vec4(position, 1.0);
+
+    normal = QUANTIZED ? octahedralDecode(inNormal.xy) : inNormal;
+    uv = inUV;
+    color = inColor;
+}
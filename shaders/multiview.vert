@@ -0,0 +1,53 @@
+#version 450
+// mesh.vert with the camera picked per view. Inside a multiview render pass one draw is replayed for every view
+// and gl_ViewIndex tells them apart. build_shaders.py also compiles it with SINGLE_VIEW, as multiview_layer.vert:
+// without the extension and the MultiView capability it declares, for ordinary render passes on devices without
+// the multiview feature. baseView alone selects the camera there
+#ifdef SINGLE_VIEW
+#define VIEW_INDEX 0
+#else
+#extension GL_EXT_multiview : require
+#define VIEW_INDEX gl_ViewIndex
+#endif
+
+layout(constant_id = 0) const bool QUANTIZED = false;
+
+const int MAX_VIEWS = 4;
+
+layout(set = 0, binding = 0) uniform Views {
+    mat4 viewProjection[MAX_VIEWS];
+} views;
+
+layout(push_constant) uniform Draw {
+    mat4 model;
+    vec4 boundsCenter;
+    vec4 boundsHalfExtent;
+    uint baseView;
+} draw;
+
+layout(location = 0) in vec3 inPosition;
+// Octahedral encoding in xy when quantized
+layout(location = 1) in vec3 inNormal;
+layout(location = 2) in vec2 inUV;
+layout(location = 3) in vec4 inColor;
+
+layout(location = 0) out vec3 normal;
+layout(location = 1) out vec2 uv;
+layout(location = 2) out vec4 color;
+
+vec3 octahedralDecode(vec2 encoded) {
+    vec3 n = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+    if (n.z < 0.0) {
+        n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    }
+    return normalize(n);
+}
+
+void main() {
+    vec3 position = QUANTIZED ? draw.boundsCenter.xyz + inPosition * draw.boundsHalfExtent.xyz : inPosition;
+    gl_Position = views.viewProjection[draw.baseView + VIEW_INDEX] * draw.model * vec4(position, 1.0);
+
+    normal = mat3(draw.model) * (QUANTIZED ? octahedralDecode(inNormal.xy) : inNormal);
+    uv = inUV;
+    color = inColor;
+}
@@ -0,0 +1,16 @@
+#version 450
+
+// The layers of the multiview target side by side, layer 0 on the left
+layout(constant_id = 0) const int VIEW_COUNT = 2;
+
+layout(set = 0, binding = 0) uniform sampler2DArray layers;
+
+layout(location = 0) in vec2 uv;
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+    float column = uv.x * float(VIEW_COUNT);
+    float layer = min(floor(column), float(VIEW_COUNT - 1));
+    outColor = texture(layers, vec3(column - layer, uv.y, layer));
+}
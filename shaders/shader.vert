@@ -1,11 +1,19 @@
 #version 450
 
+layout(set = 0, binding = 0) uniform Camera {
+    mat4 viewProjection;
+    mat4 view;
+    mat4 projection;
+    vec4 position;
+} camera;
+
 layout(location = 0) out vec3 fragColor;
 
-vec2 positions[3] = vec2[](
-    vec2(0.0, -0.5),
-    vec2(0.5, 0.5),
-    vec2(-0.5, 0.5)
+// World space, y points up
+vec3 positions[3] = vec3[](
+    vec3(0.0, 0.5, 0.0),
+    vec3(0.5, -0.5, 0.0),
+    vec3(-0.5, -0.5, 0.0)
 );
 
 vec3 colors[3] = vec3[](
@@ -15,6 +23,6 @@ vec3 colors[3] = vec3[](
 );
 
 void main() {
-    gl_Position = vec4(positions[gl_VertexIndex], 0.0, 1.0);
+    gl_Position = camera.viewProjection * vec4(positions[gl_VertexIndex], 1.0);
     fragColor = colors[gl_VertexIndex];
 }
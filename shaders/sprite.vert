@@ -0,0 +1,20 @@
+#version 450
+
+layout(push_constant) uniform Screen {
+    // 2 / size of the render target in pixels
+    vec2 scale;
+} screen;
+
+layout(location = 0) in vec2 inPosition;
+layout(location = 1) in vec2 inUV;
+layout(location = 2) in vec4 inColor;
+
+layout(location = 0) out vec2 uv;
+layout(location = 1) out vec4 color;
+
+void main() {
+    // Pixels with the origin at the top left to clip space, where y points down as well
+    gl_Position = vec4(inPosition * screen.scale - 1.0, 0.0, 1.0);
+    uv = inUV;
+    color = inColor;
+}
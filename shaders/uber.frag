@@ -0,0 +1,48 @@
+#version 450
+
+// Without specialization this is the uber-shader, every feature is a runtime branch on the push constants.
+// Pipelines which set SPECIALIZED take the features from the constants below instead,
+// so the driver can drop the disabled branches and unroll the loop
+layout(constant_id = 0) const bool SPECIALIZED = false;
+layout(constant_id = 1) const int ITERATIONS = 1;
+layout(constant_id = 2) const bool ENABLE_TINT = false;
+layout(constant_id = 3) const bool ENABLE_NOISE = false;
+layout(constant_id = 4) const bool ENABLE_VIGNETTE = false;
+
+const uint TINT_BIT = 1u;
+const uint NOISE_BIT = 2u;
+const uint VIGNETTE_BIT = 4u;
+
+layout(push_constant) uniform Features {
+    int iterations;
+    uint flags;
+} features;
+
+layout(location = 0) in vec2 uv;
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+    int iterations = SPECIALIZED ? ITERATIONS : features.iterations;
+    bool tint = SPECIALIZED ? ENABLE_TINT : (features.flags & TINT_BIT) != 0u;
+    bool noise = SPECIALIZED ? ENABLE_NOISE : (features.flags & NOISE_BIT) != 0u;
+    bool vignette = SPECIALIZED ? ENABLE_VIGNETTE : (features.flags & VIGNETTE_BIT) != 0u;
+
+    vec3 color = vec3(uv, 0.5);
+    for (int i = 0; i < iterations; i++) {
+        color = fract(color * 1.618 + sin(color.zxy * 3.1));
+    }
+
+    if (tint) {
+        color *= vec3(1.0, 0.9, 0.8);
+    }
+    if (noise) {
+        color += (fract(sin(dot(gl_FragCoord.xy, vec2(12.9898, 78.233))) * 43758.5453) - 0.5) * 0.05;
+    }
+    if (vignette) {
+        vec2 offset = uv - 0.5;
+        color *= 1.0 - dot(offset, offset);
+    }
+
+    outColor = vec4(color, 1.0);
+}
@@ -1,2 +1,3 @@
-C:/VulkanSDK/1.3.261.1/Bin/glslc.exe ../shader.vert -o vert.spv
-C:/VulkanSDK/1.3.261.1/Bin/glslc.exe ../shader.frag -o frag.spv
+rem Compiles, optimizes and reflects the shaders into VulkanPractice\Generated\EmbeddedShaders.h.
+rem The build runs this on its own, pass --force to rebuild when nothing changed
+python "%~dp0..\build_shaders.py" %*